@@ -359,6 +359,69 @@ double get_load_average (void)
 	return (-1.0);
 }
 
+/* Map a file into memory for reading.  Returns NULL if the file cannot be mapped. */
+
+void *mapFileForReading (
+	int	fd,
+	int64_t	size,
+	void	**map_handle)
+{
+	HANDLE	hMap;
+	void	*addr;
+
+	*map_handle = NULL;
+	if (size <= 0) return (NULL);
+	hMap = CreateFileMapping ((HANDLE) _get_osfhandle (fd), NULL, PAGE_READONLY, (DWORD) (size >> 32), (DWORD) size, NULL);
+	if (hMap == NULL) return (NULL);
+	addr = MapViewOfFile (hMap, FILE_MAP_READ, 0, 0, (SIZE_T) size);
+	if (addr == NULL) {
+		CloseHandle (hMap);
+		return (NULL);
+	}
+	*map_handle = (void *) hMap;
+	return (addr);
+}
+
+/* Unmap a file mapped by mapFileForReading */
+
+void unmapFile (
+	void	*addr,
+	int64_t	size,
+	void	*map_handle)
+{
+	if (addr == NULL) return;
+	UnmapViewOfFile (addr);
+	CloseHandle ((HANDLE) map_handle);
+}
+
+/* Reserve disk space for a file without writing data.  Returns TRUE only if the file system reserved real disk blocks for the entire size. */
+/* Compressed and sparse files do not get real disk blocks. */
+
+int allocateFileSpace (
+	int	fd,
+	int64_t	size)
+{
+	HANDLE	hFile;
+	BY_HANDLE_FILE_INFORMATION info;
+	FILE_ALLOCATION_INFO alloc;
+	LARGE_INTEGER eof;
+	int	rc;
+
+	hFile = (HANDLE) _get_osfhandle (fd);
+	if (!GetFileInformationByHandle (hFile, &info)) return (FALSE);
+	if (info.dwFileAttributes & (FILE_ATTRIBUTE_COMPRESSED | FILE_ATTRIBUTE_SPARSE_FILE)) return (FALSE);
+	alloc.AllocationSize.QuadPart = size;
+	if (!SetFileInformationByHandle (hFile, FileAllocationInfo, &alloc, sizeof (alloc))) return (FALSE);
+	eof.QuadPart = size;
+	rc = SetFilePointerEx (hFile, eof, NULL, FILE_BEGIN) && SetEndOfFile (hFile);
+
+/* Whether or not setting the end of file worked, the caller expects to write from the start of the file */
+
+	eof.QuadPart = 0;
+	SetFilePointerEx (hFile, eof, NULL, FILE_BEGIN);
+	return (rc);
+}
+
 /* Tell malloc to free memory back to the OS */
 
 void mallocFreeForOS () {
@@ -165,6 +165,7 @@ void rangeStatusMessage (
 				     w->work_type == WORK_ADVANCEDTEST ? "Lucas-Lehmer test" :
 				     w->work_type == WORK_DBLCHK ? "Double-check" :
 				     w->work_type == WORK_CERT ? "Certify" :
+				     w->work_type == WORK_VERIFYPROOF ? "Verify proof" :
 				     w->prp_dblchk ? "PRPDC" : "PRP");
 		buf += strlen (buf);
 
@@ -751,6 +751,52 @@ void SetAuxThreadPriority (int aux_thread_num, int action, void *data)
 	}
 }
 
+/* Gwnum NUMA callback routine.  Ask for a page-aligned memory area to be placed on the first NUMA node local to the CPUs this thread is bound to. */
+/* Gwnum calls this before first touching the memory, so nothing needs to be migrated.  The binding is not strict (on Linux this is the */
+/* MPOL_PREFERRED policy) so that a full node spills onto another node rather than running out of memory.  Returns the node number or -1. */
+
+int SetNumaMemoryBinding (void *addr, size_t size, void *data)
+{
+	hwloc_bitmap_t cpuset, nodeset;
+	int	node = -1;
+
+	if (HW_NUM_NUMA_NODES <= 1) return (-1);
+	cpuset = hwloc_bitmap_alloc ();
+	nodeset = hwloc_bitmap_alloc ();
+	if (hwloc_get_cpubind (hwloc_topology, cpuset, HWLOC_CPUBIND_THREAD) == 0) {
+		hwloc_cpuset_to_nodeset (hwloc_topology, cpuset, nodeset);
+		if (!hwloc_bitmap_iszero (nodeset)) {
+			hwloc_bitmap_only (nodeset, hwloc_bitmap_first (nodeset));
+			if (hwloc_set_area_membind (hwloc_topology, addr, size, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET) == 0)
+				node = hwloc_bitmap_first (nodeset);
+		}
+	}
+	hwloc_bitmap_free (nodeset);
+	hwloc_bitmap_free (cpuset);
+	return (node);
+}
+
+/* Set the gwnum NUMA placement policy.  Must be called before gwsetup.  NUMA placement is off unless NumaLocalMemory=1 is set in prime.txt. */
+
+void SetGwnumNumaPolicy (gwhandle *gwdata)
+{
+	if (IniGetInt (INI_FILE, "ParallelFirstTouch", 0)) gwset_parallel_first_touch (gwdata);
+	if (!IniGetInt (INI_FILE, "NumaLocalMemory", 0)) return;
+	gwset_numa_policy (gwdata, GWNUMA_LOCAL);
+	gwset_numa_callback (gwdata, SetNumaMemoryBinding);
+}
+
+/* Point gwnum at the on-disk FFT table cache, if the user enabled one.  Must be called before gwsetup. */
+
+void SetGwnumTableCache (gwhandle *gwdata)
+{
+	char	dir[260];
+
+	IniGetString (INI_FILE, "FFTTableCacheDir", dir, sizeof (dir), NULL);
+	if (dir[0]) gwset_table_cache_dir (gwdata, dir);
+	gwset_table_cache_max_size (gwdata, (uint64_t) IniGetInt (INI_FILE, "FFTTableCacheMaxMB", 2048) << 20);
+}
+
 /**************************************************************/
 /*       Routines and globals dealing with stop codes         */
 /*             and the write save files timer                 */
@@ -3222,6 +3268,10 @@ int primeContinue (
 		if (w == NULL) break;
 		if (w->work_type == WORK_NONE) continue;
 
+/* Free the kept trial factoring data when the next work unit is not trial factoring */
+
+		if (w->work_type != WORK_FACTOR) factorBatchDone (thread_num);
+
 /* Clear flags indicating this work_unit is using a lot of memory */
 
 		set_default_memory_usage (thread_num);
@@ -3276,6 +3326,12 @@ int primeContinue (
 			stop_reason = cert (thread_num, &sp_info, w, pass);
 		}
 
+/* Verify a PRP proof file */
+
+		if (w->work_type == WORK_VERIFYPROOF && pass == 2) {
+			stop_reason = verifyProof (thread_num, &sp_info, w);
+		}
+
 /* Set us back to default memory usage */
 
 		set_default_memory_usage (thread_num);
@@ -3341,6 +3397,11 @@ int primeContinue (
 
 check_stop_code:
 
+/* Free the trial factoring data kept for the next Factor= work unit.  We are either stopping */
+/* or starting another scan of the worktodo file. */
+
+	factorBatchDone (thread_num);
+
 /* If we aborted a work unit (probably because it is being deleted) */
 /* then loop to find next work unit to process. */
 
@@ -4086,37 +4147,55 @@ struct facasm_data {
 
 /* This defines the factoring data handled in C code.  The handle */
 /* abstracts all the internal details from callers of the factoring code. */
-/* When multi-threading, there is only one copy of this structure.  Obviously, */
-/* one must obtain a lock before accessing structure members. */
+/* When multi-threading, there is only one copy of this structure.  The hot paths (picking a siever, */
+/* handing sieved areas to TF threads) are lock-free.  The lock is only used for found factors and sleeping threads. */
+
+/* A lock-free work queue owned by one TF thread.  Only the owning thread adds entries (at the bottom).  Any thread, */
+/* including the owner, removes entries from the top -- the owner to get its next piece of work, other threads to */
+/* steal work once their own queue is empty.  Because the owner adds and removes in FIFO order, its work is handed */
+/* out round-robin. */
+
+struct tf_deque {
+	gwatomic top;				/* Index of the next entry to remove */
+	gwatomic bottom;			/* Index of the next entry to add */
+	gwatomic *entries;			/* Circular array of entries */
+	int	capacity;			/* Size of the circular array.  Must be at least the number of entries that can be queued. */
+};
 
 struct tf_thread_info {
 	int	pool;				/* Pool this thread belongs to */
 	int	thread_can_sieve;		/* Flag indicating this thread can do sieving. */
-	int	last_siever_used;		/* Last siever this thread used.  Try to use it again for good locality. */
+	int	first_sieve_area;		/* First sieve area in the pool that this sieving thread owns */
+	int	sieve_area_stride;		/* Distance between the sieve areas this sieving thread owns */
 	int	last_sieve_area_used;		/* Last sieve area this thread used.  Try to use it again for good locality. */
+	int	current_siever;			/* Siever this thread is using (-1 if none).  Try to use it again for good locality. */
+	int	sievings_left_in_batch;		/* Sievings left before the current siever goes to the back of our queue */
+	struct tf_deque sievers;		/* Queue of sievers owned by this sieving thread */
+	struct tf_deque sieved_areas;		/* Queue of sieve areas this thread sieved that are waiting to be TFed */
+	uint64_t num_areas_sieved;		/* Statistics: count of sieve areas this thread sieved */
+	uint64_t num_areas_TFed;		/* Statistics: count of sieve areas this thread TFed */
+	uint64_t num_sievers_stolen;		/* Statistics: count of sievers this thread stole from another thread */
+	uint64_t num_areas_stolen;		/* Statistics: count of sieve areas this thread TFed that another thread sieved */
 	gwthread thread_id;			/* Auxiliary thread id */
+	gwevent	work_available;			/* Set when another thread makes more sieving or TF work available (or the pass ends). */
+						/* Only this thread resets it, so a wakeup meant for this thread cannot be cleared by another. */
 };
 
 struct siever_info {
 	int	state;				/* State of this siever (see below) */
-	int	last_thread_used;		/* Last thread to use this siever */
-	uint64_t next_sieve_first_factor[2];	/* First factor for next sieve area */
+	volatile uint64_t next_sieve_first_factor[2]; /* First factor for next sieve area.  Read without a lock by factorFindSmallestNotTFed. */
 	void	*offsetarray;			/* bit-to-clear offsets for each sieve prime */
-	uint64_t num_areas_to_sieve;		/* Count of remaining needed factor64_sieve calls for this siever */
+	gwatomic num_areas_to_sieve;		/* Count of remaining needed factor64_sieve calls for this siever */
 };
 
 struct sieve_area_info {
-	int	state;				/* State of this sieve area (see below) */
+	gwatomic state;				/* State of this sieve area (see below) */
 	uint64_t first_factor[2];		/* First factor of the sieved area */
 	void	*sieve;				/* The 12KB sieved bit array */
 };
 
 struct pool_info {
-	int	num_sievers_active;		/* Count of threads currently running the sieving assembly code */
-	int	num_free_sieve_areas;		/* Count of sieve areas that are free */
-	int	num_sieved_sieve_areas;		/* Count of sieve areas that are sieved */
-	int	last_sieve_area_for_sieve;	/* When pooling, last sieve area handed out for sieving */
-	int	last_sieve_area_for_tf;		/* When pooling, last sieve area handed out for TF */
+	gwatomic num_sieved_sieve_areas;	/* Count of sieve areas that are sieved and waiting to be TFed */
 	struct sieve_area_info *sieve_areas;	/* Ptr to info about each sieve area */
 };
 
@@ -4131,8 +4210,10 @@ typedef struct {
 	struct pool_info *pools;		/* Ptr to info about each pool */
 
 	int	num_sievers;			/* Number of allocated sievers (residue classes of num_siever_groups) */
+	int	num_siever_groups;		/* Multipler for facdist */
 	struct siever_info *sievers;		/* Ptr to info about each allocated siever */
-	uint64_t total_num_areas_to_sieve;	/* Count of remaining needed factor64_sieve calls */
+	gwatomic total_num_areas_to_sieve;	/* Count of remaining needed factor64_sieve calls */
+	gwatomic num_sievers_active;		/* Count of threads currently running the sieving assembly code */
 
 	double	endpt;				/* Factoring limit for this pass */
 	struct PriorityInfo *sp_info;		/* Priority structure for setting aux thread priority */
@@ -4142,18 +4223,20 @@ typedef struct {
 	uint32_t initsieve_primes;		/* Which primes are sieved when initializing from initsieve */
 	uint32_t one_eighth_initsieve_primes;	/* (1 / (8 * facdist1)) mod initsieve_primes.  Used to calculate first byte to copy from initsieve */
 	uint32_t *modinvarray;			/* Modular inverse of facdist for each sieving prime.  Used to set offsetarray. */
-	int	num_chunks_TFed;		/* Count of chunks TFed since last call to factorChunksProcessed */
-	uint64_t total_num_chunks_TFed;		/* Number of chunks TFed this pass */
-	uint64_t total_num_chunks_to_TF;	/* Number of chunks to TF this pass */
+	int	num_small_primes;		/* Number of primes the ASM code will use for sieving */
+	int	maxprime;			/* Largest possible sieving prime.  Exponents this small are excluded from the sieving primes. */
+	gwatomic num_chunks_TFed;		/* Count of chunks TFed since last call to factorChunksProcessed */
+	gwatomic total_num_chunks_TFed;		/* Number of chunks TFed this pass */
+	gwatomic total_num_chunks_to_TF;	/* Number of chunks to TF this pass */
 	uint32_t found_lsw[MAX_TF_FOUND_COUNT];	/* LSW of a found factor */
 	uint32_t found_msw[MAX_TF_FOUND_COUNT];	/* MSW of a found factor */
 	uint32_t found_hsw[MAX_TF_FOUND_COUNT];	/* HSW of a found factor */
 	uint32_t found_count;			/* Count of found factors */
 	unsigned int num_active_threads;	/* Count of the number of active auxiliary threads */
+	gwatomic num_waiting_threads;		/* Count of threads sleeping until more sieving or TF work is available */
 	int	threads_must_exit;		/* Flag set to force all auxiliary threads to terminate */
 	gwmutex	thread_lock;			/* This mutex limits one thread at a time in critical sections. */
 	gwevent	thread_work_to_do;		/* This event is set whenever the auxiliary threads have work to do. */
-	gwevent	sieved_areas_available;		/* This event is set whenever a sieved area is made available for TF. */
 	gwevent	all_threads_started;		/* This event is set whenever the auxiliary threads are done and the */
 	gwevent	all_threads_done;		/* This event is set when all the auxiliary threads have started */
 						/* main thread can resume.  That is, it is set when num_active_threads==0 */
@@ -4161,7 +4244,6 @@ typedef struct {
 
 /* Possible states for a siever */
 
-#define SIEVER_ASSIGNED			0x8000	/* Set if the siever has been assigned to a thread */
 #define SIEVER_ACTIVE			0	/* Thread actively sieving */
 #define SIEVER_INACTIVE			1	/* Thread not actively sieving */
 #define SIEVER_UNINITIALIZED		2	/* Thread not fully initialized */
@@ -4173,6 +4255,15 @@ typedef struct {
 #define SIEVE_AREA_SIEVED		2	/* Area sieved, ready for TF */
 #define SIEVE_AREA_TFING		3	/* Area currently being TFed */
 
+/* Scheduling of sievers.  A thread sieves a batch of areas from one siever because the siever's bit-to-clear offsets */
+/* are then likely to be in the CPU's caches.  After each batch the siever goes to the back of the thread's queue so */
+/* that all sievers make close to uniform progress (which is prefered should we need to create a save file). */
+/* Near the end of a pass, a siever goes back in the queue after every sieving so that idle threads can steal it */
+/* and every thread finishes at about the same time. */
+
+#define TF_SIEVER_BATCH			64	/* Sievings before moving on to the next siever in our queue */
+#define TF_SIEVER_ENDGAME		20	/* Sievers with fewer areas left to sieve are requeued after every sieving */
+
 /* ASM entry points */
 
 EXTERNC int factor64_pass_setup (struct facasm_data *);	/* Assembly code, setup required for each mod-120 pass */
@@ -4185,6 +4276,34 @@ EXTERNC int factor64_tf (struct facasm_data *);		/* Assembly code, TF a sieved b
 int factorChunkMultithreaded (fachandle *facdata, struct facasm_data *asm_data, int aux_thread_num);
 void factorFindSmallestNotTFed (fachandle *facdata);
 
+/* Add an entry to the bottom of a TF work queue.  Only the owning thread may call this. */
+
+void tfDequePush (
+	struct tf_deque *dq,		/* Queue owned by the calling thread */
+	int	value)			/* Siever or sieve area index to queue */
+{
+	int64_t	bottom = atomic_get (dq->bottom);
+	atomic_set (dq->entries[bottom % dq->capacity], value);
+	atomic_incr (dq->bottom);		// Publish the new entry
+}
+
+/* Remove an entry from the top of a TF work queue.  Any thread may call this.  Returns -1 if the queue is empty. */
+/* The top index only increases, so a successful compare-and-exchange guarantees no other thread took the same entry. */
+
+int tfDequeTake (
+	struct tf_deque *dq)		/* Queue to take from */
+{
+	int64_t	top;
+	int	value;
+
+	for ( ; ; ) {
+		top = atomic_get (dq->top);
+		if (top >= atomic_get (dq->bottom)) return (-1);
+		value = (int) atomic_get (dq->entries[top % dq->capacity]);
+		if (atomic_compare_exchange (dq->top, top, top + 1)) return (value);
+	}
+}
+
 /* Routine for auxiliary threads */
 
 struct factor_thread_data {
@@ -4265,6 +4384,32 @@ void factor_auxiliary_thread (void *arg)
 }
 
 
+/* Pre-calculate useful constants that depend on the exponent.  Everything else factorSetup does is the same for */
+/* every exponent, which lets consecutive Factor= work units reuse a factoring handle (see factorGetHandle). */
+
+void factorSetExponent (
+	unsigned long p,
+	fachandle *facdata)
+{
+	struct facasm_data *asm_data = facdata->asm_data;
+	int	i;
+
+	asm_data->p = p;
+	for (i = 0; i < 65; i++) asm_data->facdists[i] = i * 120 * (uint64_t) facdata->num_siever_groups * (uint64_t) p; // Compute multiples of 120 * p.
+	asm_data->facdist12K = (SIEVE_SIZE_IN_BYTES * 8) * 120 * (uint64_t) facdata->num_siever_groups * (uint64_t) p; // Distance between first factor in sieve areas
+
+/* Initialize the modular inverse of all the sieving primes */
+
+	for (i = 0; i < facdata->num_small_primes; i++)
+		facdata->modinvarray[i] = (uint32_t) modinv (asm_data->facdists[1], ((uint32_t *)asm_data->primearray)[i]);
+
+/* Each bit in the sieve represents one facdist.  We need to find the multiple of 8 (byte boundary) */
+/* to start copying data from the sieve initializer array.  This modular inverse lets us do that. */
+
+	facdata->one_eighth_initsieve_primes = (uint32_t) modinv (8 * asm_data->facdists[1], facdata->initsieve_primes);
+	facdata->found_count = 0;
+}
+
 /* Prepare for a factoring run */
 
 int factorSetup (
@@ -4354,7 +4499,9 @@ memerr:		OutputStr (thread_num, "Error allocating memory for trial factoring.\n"
 	facdata->pooling = (pct != 100);
 	num_siever_threads_per_pool = (pct * facdata->num_threads_per_pool + 99) / 100;
 
-/* Initialize threads info (what pool the thread is in and if the thread can sieve) */
+/* Initialize threads info (what pool the thread is in and if the thread can sieve).  Each sieving thread owns */
+/* every num_siever_threads_per_pool-th sieve area in its pool, starting with its index among the pool's sieving threads. */
+/* When not pooling, every thread sieves and owns exactly one sieve area. */
 
 	for (i = 0; i < facdata->num_threads; i++) {
 		int	thread_within_pool;
@@ -4364,7 +4511,10 @@ memerr:		OutputStr (thread_num, "Error allocating memory for trial factoring.\n"
 			(thread_within_pool == 0 ||
 			 thread_within_pool * num_siever_threads_per_pool / facdata->num_threads_per_pool !=
 			 (thread_within_pool-1) * num_siever_threads_per_pool / facdata->num_threads_per_pool);
-		facdata->tf_threads[i].last_sieve_area_used = thread_within_pool;
+		facdata->tf_threads[i].first_sieve_area = thread_within_pool * num_siever_threads_per_pool / facdata->num_threads_per_pool;
+		facdata->tf_threads[i].sieve_area_stride = num_siever_threads_per_pool;
+		facdata->tf_threads[i].last_sieve_area_used = facdata->tf_threads[i].first_sieve_area;
+		facdata->tf_threads[i].current_siever = -1;
 	}
 
 /* We often must allocate more sievers than siever threads.  For example, if num_siever_threads is 7, and */
@@ -4441,19 +4591,15 @@ memerr:		OutputStr (thread_num, "Error allocating memory for trial factoring.\n"
 		}
 		*primearray = 0;		// Terminate the prime array
 		end_sieve (sieve_info);
+		facdata->maxprime = maxprime;
 	}
+	facdata->num_small_primes = num_small_primes;
+	facdata->num_siever_groups = num_siever_groups;
 
-/* Pre-calculate useful constants the assembly code will need */
-
-	for (i = 0; i < 65; i++) asm_data->facdists[i] = i * 120 * (uint64_t) num_siever_groups * (uint64_t) p; // Compute multiples of 120 * p.
-	asm_data->facdist12K = (SIEVE_SIZE_IN_BYTES * 8) * 120 * (uint64_t) num_siever_groups * (uint64_t) p; // Distance between first factor in sieve areas
-
-/* Allocate and initialize the modular inverse of all the sieving primes */
+/* Allocate the modular inverse of all the sieving primes */
 
 	facdata->modinvarray = (uint32_t *) malloc (num_small_primes * sizeof (uint32_t));
 	if (facdata->modinvarray == NULL) goto memerr;
-	for (i = 0; i < num_small_primes; i++)
-		facdata->modinvarray[i] = (uint32_t) modinv (asm_data->facdists[1], ((uint32_t *)asm_data->primearray)[i]);
 
 /* Allocate the bit-to-clear array for each allocated siever */
 
@@ -4485,6 +4631,19 @@ memerr:		OutputStr (thread_num, "Error allocating memory for trial factoring.\n"
 		}
 	}
 			
+/* Allocate the work queues for each sieving thread.  Any one queue may end up holding every siever. */
+
+	for (i = 0; i < facdata->num_threads; i++) {
+		struct tf_thread_info *tf_thread = &facdata->tf_threads[i];
+		if (!tf_thread->thread_can_sieve) continue;
+		tf_thread->sievers.capacity = facdata->num_sievers;
+		tf_thread->sievers.entries = (gwatomic *) malloc (facdata->num_sievers * sizeof (gwatomic));
+		if (tf_thread->sievers.entries == NULL) goto memerr;
+		tf_thread->sieved_areas.capacity = facdata->num_sieve_areas_per_pool;
+		tf_thread->sieved_areas.entries = (gwatomic *) malloc (facdata->num_sieve_areas_per_pool * sizeof (gwatomic));
+		if (tf_thread->sieved_areas.entries == NULL) goto memerr;
+	}
+
 /* Allocate and initialize the bytes used to initialize a sieve */
 
 	asm_data->initsieve = malloc (facdata->initsieve_primes + SIEVE_SIZE_IN_BYTES);
@@ -4496,16 +4655,15 @@ memerr:		OutputStr (thread_num, "Error allocating memory for trial factoring.\n"
 		for (j = 0; j < (facdata->initsieve_primes + SIEVE_SIZE_IN_BYTES) * 8; j += i) bitclr (asm_data->initsieve, j);
 	}
 
-/* Each bit in the sieve represents one facdist.  We need to find the multiple of 8 (byte boundary) */
-/* to start copying data from the sieve initializer array.  This modular inverse lets us do that. */
+/* Pre-calculate the constants that depend on the exponent */
 
-	facdata->one_eighth_initsieve_primes = (uint32_t) modinv (8 * asm_data->facdists[1], facdata->initsieve_primes);
+	factorSetExponent (p, facdata);
 
 /* Init mutexes and events used to control auxiliary threads */
 
 	gwmutex_init (&facdata->thread_lock);
 	gwevent_init (&facdata->thread_work_to_do);
-	gwevent_init (&facdata->sieved_areas_available);
+	for (i = 0; i < facdata->num_threads; i++) gwevent_init (&facdata->tf_threads[i].work_available);
 	gwevent_init (&facdata->all_threads_started);
 	gwevent_init (&facdata->all_threads_done);
 	gwevent_signal (&facdata->all_threads_done);
@@ -4552,7 +4710,7 @@ void factorDone (
 
 		facdata->threads_must_exit = TRUE;
 		gwevent_signal (&facdata->thread_work_to_do);
-		gwevent_signal (&facdata->sieved_areas_available);
+		for (i = 0; i < facdata->num_threads; i++) gwevent_signal (&facdata->tf_threads[i].work_available);
 
 /* Wait for all the threads to exit.  We must do this so */
 /* that this thread can safely delete the facdata structure */
@@ -4564,14 +4722,20 @@ void factorDone (
 
 /* Free up memory */
 
-	free (facdata->tf_threads);
-	facdata->tf_threads = NULL;
+	if (facdata->tf_threads != NULL) {
+		for (i = 0; i < facdata->num_threads; i++) {
+			free (facdata->tf_threads[i].sievers.entries);
+			free (facdata->tf_threads[i].sieved_areas.entries);
+			gwevent_destroy (&facdata->tf_threads[i].work_available);
+		}
+		free (facdata->tf_threads);
+		facdata->tf_threads = NULL;
+	}
 
 /* Now free up the multithread resources */
 
 	gwmutex_destroy (&facdata->thread_lock);
 	gwevent_destroy (&facdata->thread_work_to_do);
-	gwevent_destroy (&facdata->sieved_areas_available);
 	gwevent_destroy (&facdata->all_threads_started);
 	gwevent_destroy (&facdata->all_threads_done);
 	facdata->thread_lock = NULL;
@@ -4866,29 +5030,35 @@ int factorPassSetup (
 	asm_data->savefac1 = facdata->sievers[0].next_sieve_first_factor[1];
 	factor64_pass_setup (asm_data);
 
-/* Start each sieving-capable thread with a different siever */
+/* Deal the sievers round-robin into the sieving-capable threads' queues.  Threads that run out of sievers */
+/* will steal from the other threads' queues. */
 
-	j = 0;
 	for (i = 0; (int) i < facdata->num_threads; i++) {
-		if (facdata->tf_threads[i].thread_can_sieve) {
-			facdata->sievers[j].last_thread_used = i;
-			facdata->sievers[j].state |= SIEVER_ASSIGNED;
-			facdata->tf_threads[i].last_siever_used = j++;
-		}
+		struct tf_thread_info *tf_thread = &facdata->tf_threads[i];
+		tf_thread->current_siever = -1;
+		tf_thread->sievings_left_in_batch = 0;
+		atomic_set (tf_thread->sievers.top, 0);
+		atomic_set (tf_thread->sievers.bottom, 0);
+		atomic_set (tf_thread->sieved_areas.top, 0);
+		atomic_set (tf_thread->sieved_areas.bottom, 0);
+	}
+	for (i = 0, j = 0; (int) i < facdata->num_sievers; i++, j = (j + 1) % facdata->num_threads) {
+		while (!facdata->tf_threads[j].thread_can_sieve) j = (j + 1) % facdata->num_threads;
+		tfDequePush (&facdata->tf_threads[j].sievers, i);
 	}
 
-/* Init sieve area counters, clear counter of chunks processed */
+/* Init sieve areas and counters, clear counter of chunks processed */
 
 	for (i = 0; (int) i < facdata->num_pools; i++) {
-		facdata->pools[i].num_sievers_active = 0;
-		facdata->pools[i].num_free_sieve_areas = facdata->num_sieve_areas_per_pool;
-		facdata->pools[i].num_sieved_sieve_areas = 0;
-		facdata->pools[i].last_sieve_area_for_sieve = 0;
-		facdata->pools[i].last_sieve_area_for_tf = 0;
-	}
-	facdata->num_chunks_TFed = 0;
-	facdata->total_num_chunks_TFed = 0;
-	facdata->total_num_chunks_to_TF = facdata->total_num_areas_to_sieve;
+		atomic_set (facdata->pools[i].num_sieved_sieve_areas, 0);
+		for (j = 0; (int) j < facdata->num_sieve_areas_per_pool; j++)
+			atomic_set (facdata->pools[i].sieve_areas[j].state, SIEVE_AREA_FREE);
+	}
+	atomic_set (facdata->num_sievers_active, 0);
+	atomic_set (facdata->num_waiting_threads, 0);
+	atomic_set (facdata->num_chunks_TFed, 0);
+	atomic_set (facdata->total_num_chunks_TFed, 0);
+	atomic_set (facdata->total_num_chunks_to_TF, facdata->total_num_areas_to_sieve);
 	facdata->pass_complete = FALSE;
 
 /* Signal the auxiliary threads to resume working */
@@ -4984,134 +5154,269 @@ int factorChunk (			/* Return 1 if factor found, 2 if factor not found */
 	return (2);						// Return factor not found
 }
 
-/* Like the code above, but a multithreaded version */
+/* Signal every thread's work available event */
 
-int factorChunkMultithreaded (		/* Return TRUE when there is no more work to do */
+void factorWakeAllThreads (
+	fachandle *facdata)		/* Handle returned by factorSetup */
+{
+	int	i;
+
+	for (i = 0; i < facdata->num_threads; i++) gwevent_signal (&facdata->tf_threads[i].work_available);
+}
+
+/* Wake any threads sleeping in factorIdle.  Called whenever a thread makes more sieving or TF work available. */
+/* A locked read-modify-write is used to read the count of sleeping threads so that the read cannot be reordered */
+/* ahead of our earlier stores -- a thread about to sleep increments the count and then looks for work. */
+
+void factorWakeThreads (
+	fachandle *facdata)		/* Handle returned by factorSetup */
+{
+	if (atomic_fetch_addin (facdata->num_waiting_threads, 0) == 0) return;
+	factorWakeAllThreads (facdata);
+}
+
+/* Claim one area to sieve from a siever.  Returns FALSE if the siever has no work left. */
+/* A compare-and-exchange is needed as a found factor can reduce the siever's count at any time. */
+
+int factorClaimSieveArea (
 	fachandle *facdata,		/* Handle returned by factorSetup */
-	struct facasm_data *asm_data,	/* This thread's asm data */
-	int	aux_thread_num)		/* Auxiliary thread number (or zero for main thread) */
+	struct siever_info *siever)	/* Siever to claim an area from */
 {
-	int	i, res, siever_uninitialized;
-	struct tf_thread_info *tf_thread;
-	struct pool_info *pool;
-	struct sieve_area_info *sieve_area;
+	int64_t	n;
 
-/* Get info on this particular thread */
+	for ( ; ; ) {
+		n = atomic_get (siever->num_areas_to_sieve);
+		if (n <= 0) return (FALSE);
+		if (atomic_compare_exchange (siever->num_areas_to_sieve, n, n - 1)) break;
+	}
+	atomic_decr (facdata->total_num_areas_to_sieve);
+	return (TRUE);
+}
 
-	tf_thread = &facdata->tf_threads[aux_thread_num];
-	pool = &facdata->pools[tf_thread->pool];
+/* Put the thread's current siever at the back of its queue (where other threads can steal it). */
+/* A siever with nothing left to sieve is simply dropped. */
 
-/* Acquire the lock */
+void factorReleaseSiever (
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	struct tf_thread_info *tf_thread) /* Thread releasing its siever */
+{
+	if (tf_thread->current_siever < 0) return;
+	if (atomic_get (facdata->sievers[tf_thread->current_siever].num_areas_to_sieve) > 0) {
+		tfDequePush (&tf_thread->sievers, tf_thread->current_siever);
+		factorWakeThreads (facdata);
+	}
+	tf_thread->current_siever = -1;
+}
 
-	gwmutex_lock (&facdata->thread_lock);
+/* Get a siever and claim one of its areas to sieve.  Stay with our current siever until its batch is done, */
+/* then take the next siever from the top of our queue.  When our queue is empty, steal from the other sieving */
+/* threads.  Stealing from the top of a queue takes the siever that has waited longest, helping uniform progress. */
+/* Returns NULL if no siever with work left could be found. */
 
-/* See if we should do some sieving.  The thread must be one that can sieve and there must be more sieve work left to do */
+struct siever_info *factorGetSiever (
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	int	aux_thread_num)		/* Auxiliary thread number (or zero for main thread) */
+{
+	struct tf_thread_info *tf_thread = &facdata->tf_threads[aux_thread_num];
+	struct siever_info *siever;
+	int	i, siever_num;
 
-	if (facdata->total_num_areas_to_sieve > 0 &&				// Is any sieving needed?
-	    (!facdata->pooling ||						// If not pooling, then we can always sieve
-	     (tf_thread->thread_can_sieve &&					// Pooling: Is thread allowed to sieve?
-	      pool->num_free_sieve_areas &&					// Pooling: Are there sieve areas free to work on?
-	      pool->num_sieved_sieve_areas < facdata->num_threads_per_pool*2))){// Pooling: Are there adequate areas already sieved? */
-		struct siever_info *siever;
-		siever = &facdata->sievers[tf_thread->last_siever_used];
+/* Continue with our current siever if we can */
 
-/* We prefer to use the same siever as last time because the bit-to-clear offsets are likely to */
-/* be in one of the CPU's caches.  When we are not close to finishing up, we switch sievers after */
-/* every 64 sievings so that we make close to uniform progress (which is prefered should we need */
-/* to create a save file).  When we are close to finishing up, we want every thread to end at the */
-/* same time so we become very strict about selecting neediest siever. */
+	if (tf_thread->current_siever >= 0) {
+		siever = &facdata->sievers[tf_thread->current_siever];
+		if (tf_thread->sievings_left_in_batch > 0 && factorClaimSieveArea (facdata, siever)) {
+			tf_thread->sievings_left_in_batch--;
+			return (siever);
+		}
+		factorReleaseSiever (facdata, tf_thread);
+	}
 
-		if (siever->last_thread_used == aux_thread_num &&		// Siever is assigned to this thread
-		    (siever->state == SIEVER_ASSIGNED + SIEVER_UNINITIALIZED ||	// Siever hasn't started yet
-		     ((siever->num_areas_to_sieve & 0x3F) &&			// Siever is in middle of 64 sievings
-		      (siever->num_areas_to_sieve >= 20 ||			// and not near the end of the pass
-		       facdata->num_threads == 1))))				// or only one thread: uniform progress at end is unimportant
-			;							// Stay with our assigned siever
+/* Take a siever from our own queue, otherwise steal one.  Sievers with no work left are dropped. */
 
-/* Find the inactive siever with the most work left to do. */
-/* We fudge a little here so that we prefer to stay with the same siever. */
+	for (i = 0; i < facdata->num_threads; ) {
+		siever_num = tfDequeTake (&facdata->tf_threads[(aux_thread_num + i) % facdata->num_threads].sievers);
+		if (siever_num < 0) {
+			i++;
+			continue;
+		}
+		siever = &facdata->sievers[siever_num];
+		if (!factorClaimSieveArea (facdata, siever)) continue;
+		if (i) tf_thread->num_sievers_stolen++;
+		tf_thread->current_siever = siever_num;
+		if (facdata->num_threads > 1 && atomic_get (siever->num_areas_to_sieve) < TF_SIEVER_ENDGAME)
+			tf_thread->sievings_left_in_batch = 0;
+		else
+			tf_thread->sievings_left_in_batch = TF_SIEVER_BATCH - 1;
+		return (siever);
+	}
+	return (NULL);
+}
 
-		else {
-			int	i, best_siever;
-			uint64_t score, best_score_thusfar;
+/* Find one of this thread's sieve areas that is free for sieving.  Returns -1 if all are in use. */
 
-			// Mark our old siever unassigned if the siever was assigned to this thread
-			if (siever->last_thread_used == aux_thread_num) siever->state = SIEVER_INACTIVE;
+int factorFindFreeSieveArea (
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	struct tf_thread_info *tf_thread) /* Sieving thread */
+{
+	struct pool_info *pool = &facdata->pools[tf_thread->pool];
+	int	i;
 
-			// If not multithreading, we simply move onto the next siever for uniform progress
-			if (facdata->num_threads == 1) {
-				best_siever = tf_thread->last_siever_used + 1;
-				if (best_siever == facdata->num_sievers) best_siever = 0;
-			}
+	// If we can use the same sieve area as last time, do so for better locality.
+	// When we are not really pooling, this will always be the case.
+	if (atomic_get (pool->sieve_areas[tf_thread->last_sieve_area_used].state) == SIEVE_AREA_FREE)
+		return (tf_thread->last_sieve_area_used);
+	for (i = tf_thread->first_sieve_area; i < facdata->num_sieve_areas_per_pool; i += tf_thread->sieve_area_stride)
+		if (atomic_get (pool->sieve_areas[i].state) == SIEVE_AREA_FREE) return (i);
+	return (-1);
+}
 
-			// Multithreaded case.  Use heuristics to prefer re-using our current siever or an
-			// unassigned siever except when we get near the end of a pass.
-			else {
-				best_siever = -1;
-				if (siever->last_thread_used == aux_thread_num) {
-					best_siever = tf_thread->last_siever_used;
-					best_score_thusfar = siever->num_areas_to_sieve;
-					if (siever->num_areas_to_sieve > 128) best_score_thusfar += 128;
-					else if (siever->num_areas_to_sieve > 64) best_score_thusfar += 64;
-				}
-				for (i = 0; i < facdata->num_sievers; i++) {
-					// We cannot steal a siever that is actively sieving
-					if (facdata->sievers[i].state == SIEVER_ASSIGNED + SIEVER_ACTIVE) continue;
-					// We don't steal sievers until we get very close to finishing
-					if ((facdata->sievers[i].state & SIEVER_ASSIGNED) &&
-					    facdata->sievers[i].num_areas_to_sieve > 20) continue;
-					// Does this inactive siever have more work left to do than any sievers we've looked at thusfar?
-					score = facdata->sievers[i].num_areas_to_sieve;
-					if (best_siever == -1 || score > best_score_thusfar) {
-						best_siever = i;
-						best_score_thusfar = score;
-					}
-				}
-			}
+/* Get a sieved area to TF.  Take from our own queue first, then steal from the other sieving threads in our pool, */
+/* and finally from the other pools.  Returns NULL if there are no sieved areas waiting to be TFed. */
+
+struct sieve_area_info *factorGetSievedArea (
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	int	aux_thread_num)		/* Auxiliary thread number (or zero for main thread) */
+{
+	struct tf_thread_info *tf_thread = &facdata->tf_threads[aux_thread_num];
+	struct pool_info *pool;
+	int	i, j, pool_num, victim, area_num;
 
-			// Assign the best siever to this thread
-			tf_thread->last_siever_used = best_siever;
-			siever = &facdata->sievers[best_siever];
-			siever->state |= SIEVER_ASSIGNED;
-			siever->last_thread_used = aux_thread_num;
+	for (i = 0; i < facdata->num_pools; i++) {
+		pool_num = (tf_thread->pool + i) % facdata->num_pools;
+		pool = &facdata->pools[pool_num];
+		for (j = 0; j < facdata->num_threads_per_pool; j++) {
+			victim = pool_num * facdata->num_threads_per_pool + (aux_thread_num + j) % facdata->num_threads_per_pool;
+			if (!facdata->tf_threads[victim].thread_can_sieve) continue;
+			area_num = tfDequeTake (&facdata->tf_threads[victim].sieved_areas);
+			if (area_num < 0) continue;
+			atomic_decr (pool->num_sieved_sieve_areas);
+			if (victim != aux_thread_num) tf_thread->num_areas_stolen++;
+			return (&pool->sieve_areas[area_num]);
 		}
+	}
+	return (NULL);
+}
 
-/* It is possible to get here with a siever that has no work to do (all sievers with work */
-/* to do are currently tied up sieving).  Because we try to make uniform progress for */
-/* the last 20 sievings, this should be pretty darn rare.  */
+/* Return TRUE if the pass is complete: nothing left to sieve, no thread sieving, and no sieved areas waiting to be TFed. */
+/* The order of the checks matters.  A sieving thread queues its sieved area before it decrements num_sievers_active. */
+
+int factorPassDone (
+	fachandle *facdata)		/* Handle returned by factorSetup */
+{
+	int	i;
 
-		if (siever->num_areas_to_sieve == 0) {
-			if (facdata->pooling && pool->num_sieved_sieve_areas) goto tf;
-			gwevent_reset (&facdata->sieved_areas_available);
-			gwmutex_unlock (&facdata->thread_lock);
-			gwevent_wait (&facdata->sieved_areas_available, 0);
+	if (atomic_get (facdata->total_num_areas_to_sieve) > 0) return (FALSE);
+	if (atomic_get (facdata->num_sievers_active) > 0) return (FALSE);
+	for (i = 0; i < facdata->num_threads; i++)
+		if (atomic_get (facdata->tf_threads[i].sieved_areas.top) < atomic_get (facdata->tf_threads[i].sieved_areas.bottom))
 			return (FALSE);
-		}
+	return (TRUE);
+}
+
+/* Return TRUE if this thread might find sieving or TF work to do (or the pass is complete) */
+
+int factorWorkAvailable (
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	int	aux_thread_num)		/* Auxiliary thread number (or zero for main thread) */
+{
+	struct tf_thread_info *tf_thread = &facdata->tf_threads[aux_thread_num];
+	int	i, sievers_queued;
+
+	if (factorPassDone (facdata)) return (TRUE);
+	for (i = 0; i < facdata->num_threads; i++)
+		if (atomic_get (facdata->tf_threads[i].sieved_areas.top) < atomic_get (facdata->tf_threads[i].sieved_areas.bottom))
+			return (TRUE);
+	if (!tf_thread->thread_can_sieve || atomic_get (facdata->total_num_areas_to_sieve) <= 0) return (FALSE);
+	for (i = 0, sievers_queued = FALSE; i < facdata->num_threads && !sievers_queued; i++)
+		sievers_queued = (atomic_get (facdata->tf_threads[i].sievers.top) < atomic_get (facdata->tf_threads[i].sievers.bottom));
+	return (sievers_queued && factorFindFreeSieveArea (facdata, tf_thread) >= 0);
+}
+
+/* This thread could not find any sieving or TF work.  Return TRUE if the pass is complete.  Otherwise, sleep */
+/* until another thread makes more work available and return FALSE. */
+
+int factorIdle (
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	int	aux_thread_num)		/* Auxiliary thread number (or zero for main thread) */
+{
+	struct tf_thread_info *tf_thread = &facdata->tf_threads[aux_thread_num];
+
+/* Hand our siever back so that other threads can steal it while we wait */
+
+	if (tf_thread->current_siever >= 0) {
+		factorReleaseSiever (facdata, tf_thread);
+		return (FALSE);
+	}
+
+/* If the pass is complete, wake all sleeping threads so that they too notice the pass is complete */
+
+	if (factorPassDone (facdata)) {
+		factorWakeAllThreads (facdata);
+		return (TRUE);
+	}
+
+/* Clear our own event, announce we are going to sleep, then look for work one last time.  A thread making work available */
+/* after our check will see the waiting count and signal our event.  Since no other thread resets our event, that signal */
+/* cannot be lost.  A stale signal merely sends us back to look for work again. */
+
+	gwevent_reset (&tf_thread->work_available);
+	atomic_incr (facdata->num_waiting_threads);
+	if (factorWorkAvailable (facdata, aux_thread_num)) {
+		atomic_decr (facdata->num_waiting_threads);
+		return (FALSE);
+	}
+	gwevent_wait (&tf_thread->work_available, 0);
+	atomic_decr (facdata->num_waiting_threads);
+	return (facdata->threads_must_exit);
+}
+
+/* Like the code above, but a multithreaded version */
+
+int factorChunkMultithreaded (		/* Return TRUE when there is no more work to do */
+	fachandle *facdata,		/* Handle returned by factorSetup */
+	struct facasm_data *asm_data,	/* This thread's asm data */
+	int	aux_thread_num)		/* Auxiliary thread number (or zero for main thread) */
+{
+	int	i, res, siever_uninitialized;
+	struct tf_thread_info *tf_thread;
+	struct pool_info *pool;
+	struct siever_info *siever;
+	struct sieve_area_info *sieve_area;
+
+/* Get info on this particular thread */
+
+	tf_thread = &facdata->tf_threads[aux_thread_num];
+	pool = &facdata->pools[tf_thread->pool];
 
-/* Find a free sieve area and do the small prime sieving. */
+/* See if we should do some sieving.  The thread must be one that can sieve, there must be more sieve work left to do, */
+/* one of the thread's sieve areas must be free, and when pooling there must not be plenty of areas already sieved. */
 
-		pool->num_sievers_active++;
-		siever_uninitialized = (siever->state == SIEVER_ASSIGNED + SIEVER_UNINITIALIZED);
-		siever->state = SIEVER_ASSIGNED + SIEVER_ACTIVE;
-		siever->num_areas_to_sieve--;
-		facdata->total_num_areas_to_sieve--;
-		// If we can use the same sieve area as last time, do so for better locality.
-		// When we are not really pooling, this will always be the case.
-		if (pool->sieve_areas[tf_thread->last_sieve_area_used].state == SIEVE_AREA_FREE)
-			i = tf_thread->last_sieve_area_used;
-		// Otherwise, find the next free sieve area
-		else for (i = pool->last_sieve_area_for_sieve + 1; ; i++) {
-			if (i == facdata->num_sieve_areas_per_pool) i = 0;
-			if (pool->sieve_areas[i].state == SIEVE_AREA_FREE) break;
+	if (tf_thread->thread_can_sieve &&
+	    atomic_get (facdata->total_num_areas_to_sieve) > 0 &&
+	    (!facdata->pooling || atomic_get (pool->num_sieved_sieve_areas) < facdata->num_threads_per_pool*2) &&
+	    (i = factorFindFreeSieveArea (facdata, tf_thread)) >= 0) {
+
+/* Get a siever.  It is possible that all sievers with work left are tied up by other threads. */
+/* Bump the active sievers count first so that no thread thinks the pass is done while we sieve. */
+
+		atomic_incr (facdata->num_sievers_active);
+		siever = factorGetSiever (facdata, aux_thread_num);
+		if (siever == NULL) {
+			atomic_decr (facdata->num_sievers_active);
+			goto tf;
 		}
+
+/* Do the small prime sieving.  The sieve area's first factor must be set before its state changes, */
+/* factorFindSmallestNotTFed relies on this. */
+
 		tf_thread->last_sieve_area_used = i;
-		pool->last_sieve_area_for_sieve = i;
 		sieve_area = &pool->sieve_areas[i];
-		pool->num_free_sieve_areas--;
-		sieve_area->state = SIEVE_AREA_SIEVING;		/* Update sieve area's state */
-		gwmutex_unlock (&facdata->thread_lock);
+		siever_uninitialized = (siever->state == SIEVER_UNINITIALIZED);
+		siever->state = SIEVER_ACTIVE;
 		sieve_area->first_factor[0] = asm_data->savefac0 = siever->next_sieve_first_factor[0];
 		sieve_area->first_factor[1] = asm_data->savefac1 = siever->next_sieve_first_factor[1];
+		atomic_set (sieve_area->state, SIEVE_AREA_SIEVING);
 		asm_data->initstart = (uint32_t)
 			((uint64_t) mod96_32 (asm_data->savefac0, asm_data->savefac1, facdata->initsieve_primes) *
 			 (uint64_t) facdata->one_eighth_initsieve_primes % facdata->initsieve_primes);
@@ -5119,78 +5424,57 @@ int factorChunkMultithreaded (		/* Return TRUE when there is no more work to do
 		asm_data->offsetarray = siever->offsetarray;
 		if (siever_uninitialized) factorPassSetupPart2 (facdata, asm_data, siever);
 		factor64_sieve (asm_data);
-		gwmutex_lock (&facdata->thread_lock);
-		siever->next_sieve_first_factor[0] = asm_data->savefac0; /* Remember next sieve's first factor */
+		// Remember next sieve's first factor.  Write the low word first, factorFindSmallestNotTFed reads the high word first.
 		siever->next_sieve_first_factor[1] = asm_data->savefac1;
-		sieve_area->state = SIEVE_AREA_SIEVED;
-		pool->num_sieved_sieve_areas++;
-		gwevent_signal (&facdata->sieved_areas_available);
-		siever->state = SIEVER_ASSIGNED + SIEVER_INACTIVE;
-		pool->num_sievers_active--;
+		siever->next_sieve_first_factor[0] = asm_data->savefac0;
+		siever->state = SIEVER_INACTIVE;
+		tf_thread->num_areas_sieved++;
 
-/* If we are pooling, then return since we did some work. */
-/* Otherwise, fall through and TF the area we just sieved. */
+/* If we are not pooling, TF the area we just sieved -- perfect locality. */
 
-		if (facdata->pooling) {
-			gwmutex_unlock (&facdata->thread_lock);
-			return (FALSE);
+		if (!facdata->pooling) {
+			atomic_decr (facdata->num_sievers_active);
+			goto tf_area;
 		}
-	}
 
-/* See if there are any sieved areas available to TF.  If not, wait or exit */
+/* If we are pooling, queue the sieved area for any thread to TF and return since we did some work. */
 
-	while (pool->num_sieved_sieve_areas == 0) {
-		if ((!facdata->pooling || pool->num_sievers_active == 0) && facdata->total_num_areas_to_sieve == 0) {
-			gwmutex_unlock (&facdata->thread_lock);
-			return (TRUE);			// Return no more work to do flag
-		}
-		gwevent_reset (&facdata->sieved_areas_available);
-		gwmutex_unlock (&facdata->thread_lock);
-		gwevent_wait (&facdata->sieved_areas_available, 0);
-		if (facdata->threads_must_exit) return (TRUE);
-		gwmutex_lock (&facdata->thread_lock);
+		atomic_set (sieve_area->state, SIEVE_AREA_SIEVED);
+		tfDequePush (&tf_thread->sieved_areas, i);
+		atomic_incr (pool->num_sieved_sieve_areas);
+		atomic_decr (facdata->num_sievers_active);
+		factorWakeThreads (facdata);
+		return (FALSE);
 	}
 
-/* Find a sieved area and TF it. */
+/* Find a sieved area to TF.  If there isn't one, wait or exit. */
 
-	// If not pooling then use the same sieve area as last time for better locality.
-tf:	if (!facdata->pooling)
-		i = tf_thread->last_sieve_area_used;
-	// Otherwise, find the sieved area with smallest first factor.  Well, rather than find the smallest
-	// we just circle through the array by starting one after the last index used.  It won't take long
-	// before the smallest sieved area is handed out for TF. */
-	else for (i = pool->last_sieve_area_for_tf+1; ; i++) {
-		if (i == facdata->num_sieve_areas_per_pool) i = 0;
-		if (pool->sieve_areas[i].state == SIEVE_AREA_SIEVED) break;
-	}
-	tf_thread->last_sieve_area_used = i;
-	pool->last_sieve_area_for_tf = i;
-	sieve_area = &pool->sieve_areas[i];
-	pool->num_sieved_sieve_areas--;
-	sieve_area->state = SIEVE_AREA_TFING;			/* Update sieve area's state */
+tf:	sieve_area = factorGetSievedArea (facdata, aux_thread_num);
+	if (sieve_area == NULL) return (factorIdle (facdata, aux_thread_num));
+
+/* TF the sieved area */
+
+tf_area:atomic_set (sieve_area->state, SIEVE_AREA_TFING);	/* Update sieve area's state */
 	asm_data->savefac0 = sieve_area->first_factor[0];
 	asm_data->savefac1 = sieve_area->first_factor[1];
 	asm_data->sieve = sieve_area->sieve;
-	gwmutex_unlock (&facdata->thread_lock);
 	res = factor64_tf (asm_data);
-	gwmutex_lock (&facdata->thread_lock);
 	if (res == 1) {							/* Remember a found factor */
+		gwmutex_lock (&facdata->thread_lock);
 		// On first found factor, only sieve areas below the found factor
 		if (facdata->found_count == 0 && !IniGetInt (INI_FILE, "TFFullBitLevel", 0)) {
 			double factor = ((double) asm_data->FACHSW * 4294967296.0 + (double) asm_data->FACMSW) * 4294967296.0;
-			uint64_t reduction = (uint64_t) ((facdata->endpt - factor) / (double) asm_data->facdist12K);
+			int64_t reduction = (int64_t) ((facdata->endpt - factor) / (double) asm_data->facdist12K);
 			for (i = 0; i < facdata->num_sievers; i++) {
-				if (facdata->sievers[i].num_areas_to_sieve >= reduction) {
-					facdata->total_num_chunks_to_TF -= reduction;
-					facdata->total_num_areas_to_sieve -= reduction;
-					facdata->sievers[i].num_areas_to_sieve -= reduction;
-				} else {
-					facdata->total_num_chunks_to_TF -= facdata->sievers[i].num_areas_to_sieve;
-					facdata->total_num_areas_to_sieve -= facdata->sievers[i].num_areas_to_sieve;
-					facdata->sievers[i].num_areas_to_sieve = 0;
-				}
+				int64_t	n, cut;
+				do {
+					n = atomic_get (facdata->sievers[i].num_areas_to_sieve);
+					cut = (n >= reduction) ? reduction : n;
+				} while (cut > 0 && !atomic_compare_exchange (facdata->sievers[i].num_areas_to_sieve, n, n - cut));
+				if (cut <= 0) continue;
+				atomic_fetch_addin (facdata->total_num_chunks_to_TF, -cut);
+				atomic_fetch_addin (facdata->total_num_areas_to_sieve, -cut);
 			}
-			gwevent_signal (&facdata->sieved_areas_available); // In case a thread was waiting for a siever we just zeroed
 		}
 		// Remember the found factor
 		if (facdata->found_count < MAX_TF_FOUND_COUNT) {	/* I can't imagine finding too many factors so close together */
@@ -5199,12 +5483,13 @@ tf:	if (!facdata->pooling)
 			facdata->found_hsw[facdata->found_count] = asm_data->FACHSW;
 			facdata->found_count++;
 		}
+		gwmutex_unlock (&facdata->thread_lock);
 	}
-	facdata->num_chunks_TFed++;
-	facdata->total_num_chunks_TFed++;
-	sieve_area->state = SIEVE_AREA_FREE;			/* Update sieve area's state */
-	pool->num_free_sieve_areas++;
-	gwmutex_unlock (&facdata->thread_lock);
+	atomic_incr (facdata->num_chunks_TFed);
+	atomic_incr (facdata->total_num_chunks_TFed);
+	tf_thread->num_areas_TFed++;
+	atomic_set (sieve_area->state, SIEVE_AREA_FREE);		/* Update sieve area's state */
+	factorWakeThreads (facdata);					// A thread may be waiting for a free sieve area or for the pass to end
 	return (FALSE);							// Return more work to do flag
 }
 
@@ -5214,32 +5499,34 @@ int factorChunksProcessed (
 	fachandle *facdata)		/* Handle returned by factorSetup */
 {
 	int	res;
-	res = facdata->num_chunks_TFed;
-	facdata->num_chunks_TFed = 0;		// Yes, we could have a race condition here, but it does not really matter
+	res = (int) atomic_get (facdata->num_chunks_TFed);
+	atomic_fetch_addin (facdata->num_chunks_TFed, -res);
 	return (res);
 }
 
-/* Find sieved area with smallest first factor so that we can write a save file */
+/* Find the smallest first factor that has not been TFed so that we can write a save file.  This runs without a lock */
+/* while the TF threads continue working.  We read the sievers before the sieve areas.  If a siever has moved past */
+/* an area's first factor by the time we read it, then that area's state was already no longer free when we look at it. */
 
 void factorFindSmallestNotTFed (
 	fachandle *facdata)		/* Handle returned by factorSetup */
 {
 	int	i, j;
-	uint64_t smallest, temp;
+	uint64_t smallest, temp, hi, lo;
 	struct facasm_data *asm_data = facdata->asm_data;
 
-/* Search for the smallest sieved area.  If there are no sieved areas, we'll end up */
-/* returning the next factor to sieve. */
+/* Search for the smallest sieve area that is being sieved, is sieved, or is being TFed.  If there are no such */
+/* sieve areas, we'll end up returning the next factor to sieve. */
 
-	gwmutex_lock (&facdata->thread_lock);
 	for (i = 0; i < facdata->num_sievers; i++) {
-		temp = (facdata->sievers[i].next_sieve_first_factor[0] << 32) +
-		       (facdata->sievers[i].next_sieve_first_factor[1] >> 32);
+		hi = facdata->sievers[i].next_sieve_first_factor[0];	// Read high word first, the sieving thread writes it last
+		lo = facdata->sievers[i].next_sieve_first_factor[1];
+		temp = (hi << 32) + (lo >> 32);
 		if (i == 0 || temp < smallest) smallest = temp;
 	}
 	for (i = 0; i < facdata->num_pools; i++) {
 		for (j = 0; j < facdata->num_sieve_areas_per_pool; j++) {
-			if (facdata->pools[i].sieve_areas[j].state != SIEVE_AREA_SIEVED) continue;
+			if (atomic_get (facdata->pools[i].sieve_areas[j].state) == SIEVE_AREA_FREE) continue;
 			temp = (facdata->pools[i].sieve_areas[j].first_factor[0] << 32) +
 			       (facdata->pools[i].sieve_areas[j].first_factor[1] >> 32);
 			if (temp < smallest) smallest = temp;
@@ -5250,7 +5537,29 @@ void factorFindSmallestNotTFed (
 
 	asm_data->FACHSW = (uint32_t) (smallest >> 32);
 	asm_data->FACMSW = (uint32_t) smallest;
-	gwmutex_unlock (&facdata->thread_lock);
+}
+
+/* Output per-thread sieving and TF counts.  Useful for checking how well TF scales with more threads. */
+
+void factorOutputThreadStats (
+	int	thread_num,
+	fachandle *facdata)		/* Handle returned by factorSetup */
+{
+	struct tf_thread_info *tf_thread;
+	char	buf[200];
+	int	i;
+
+	for (i = 0; i < facdata->num_threads; i++) {
+		tf_thread = &facdata->tf_threads[i];
+		sprintf (buf, "TF thread %d (pool %d): sieved %" PRIu64 " areas, TFed %" PRIu64 " areas, stole %" PRIu64 " sievers and %" PRIu64 " sieved areas\n",
+			 i, tf_thread->pool, tf_thread->num_areas_sieved, tf_thread->num_areas_TFed,
+			 tf_thread->num_sievers_stolen, tf_thread->num_areas_stolen);
+		OutputStr (thread_num, buf);
+		tf_thread->num_areas_sieved = 0;
+		tf_thread->num_areas_TFed = 0;
+		tf_thread->num_sievers_stolen = 0;
+		tf_thread->num_areas_stolen = 0;
+	}
 }
 
 /* Return a second or third found factor.  Should be extremely rare.  Can only happen in multithreaded case. */
@@ -5268,6 +5577,91 @@ int getAnotherFactorIfAny (
 
 #endif
 
+/* Batched trial factoring.  Workers given long lists of Factor= work units at low bit levels spend a surprising */
+/* amount of time in factorSetup and factorDone -- launching the auxiliary threads, allocating sievers and sieve */
+/* areas, and generating the sieving primes.  None of this depends on the exponent (except a few constants that */
+/* factorSetExponent recalculates).  Thus, we keep the factoring handle between consecutive Factor= work units. */
+/* Unfortunately, the sieve itself cannot be shared between exponents: the candidates 2kp+1 and the bit-to-clear */
+/* offsets both depend on the exponent. */
+
+fachandle *TF_BATCH_HANDLE[MAX_NUM_WORKERS] = {NULL};	/* Factoring handle kept from this worker's previous Factor= work unit */
+
+/* Get a factoring handle, reusing the handle from the previous Factor= work unit if possible */
+
+int factorGetHandle (
+	int	thread_num,
+	unsigned long p,
+	struct PriorityInfo *sp_info,	/* SetPriority information */
+	fachandle **facdata_out)	/* Returned factoring handle */
+{
+	fachandle *facdata;
+	int	num_threads, stop_reason;
+
+	num_threads = get_worker_num_threads (thread_num, HYPERTHREAD_TF);
+
+#ifdef X86_64
+	facdata = TF_BATCH_HANDLE[thread_num];
+	TF_BATCH_HANDLE[thread_num] = NULL;
+	if (facdata != NULL) {
+		// Tiny exponents are excluded from the sieving primes, reuse is not possible
+		if (facdata->num_threads == num_threads && facdata->sp_info == sp_info &&
+		    p > (unsigned long) facdata->maxprime && facdata->asm_data->p > (uint64_t) facdata->maxprime) {
+			factorSetExponent (p, facdata);
+			*facdata_out = facdata;
+			return (0);
+		}
+		factorDone (facdata);
+		free (facdata);
+	}
+#endif
+
+/* Allocate and setup a new factoring handle */
+
+	facdata = (fachandle *) malloc (sizeof (fachandle));
+	if (facdata == NULL) {
+		OutputStr (thread_num, "Error allocating memory for trial factoring.\n");
+		return (STOP_OUT_OF_MEM);
+	}
+	facdata->num_threads = num_threads;
+	facdata->sp_info = sp_info;
+	stop_reason = factorSetup (thread_num, p, facdata);
+	if (stop_reason) {
+		factorDone (facdata);
+		free (facdata);
+		return (stop_reason);
+	}
+	*facdata_out = facdata;
+	return (0);
+}
+
+/* Done with a factoring handle.  Keep it for the next Factor= work unit if allowed. */
+
+void factorReleaseHandle (
+	int	thread_num,
+	fachandle *facdata,
+	int	keep)			/* TRUE if the handle is in a good state for reuse */
+{
+#ifdef X86_64
+	if (keep && IniGetInt (INI_FILE, "TFBatch", 1)) {
+		TF_BATCH_HANDLE[thread_num] = facdata;
+		return;
+	}
+#endif
+	factorDone (facdata);
+	free (facdata);
+}
+
+/* Free the factoring handle kept from the previous Factor= work unit.  Called when the worker moves on to other */
+/* work types or stops, so that the auxiliary TF threads and memory are not held needlessly. */
+
+void factorBatchDone (
+	int	thread_num)
+{
+	if (TF_BATCH_HANDLE[thread_num] == NULL) return;
+	factorDone (TF_BATCH_HANDLE[thread_num]);
+	free (TF_BATCH_HANDLE[thread_num]);
+	TF_BATCH_HANDLE[thread_num] = NULL;
+}
 
 
 /* Trial factor a Mersenne number prior to running a Lucas-Lehmer test */
@@ -5284,7 +5678,7 @@ int primeFactor (
 	struct work_unit *w,
 	unsigned int factor_limit_adjustment)
 {
-	fachandle facdata;		/* Handle to the factoring data */
+	fachandle *facdata;		/* Handle to the factoring data */
 	unsigned long p;		/* Exponent to factor */
 	unsigned long bits;		/* How far already factored in bits */
 	unsigned long test_bits;	/* How far to factor to */
@@ -5336,13 +5730,8 @@ begin:	factor_found = 0;
 /* Setup the factoring code */
 
 	if (HYPERTHREAD_TF) sp_info->normal_work_hyperthreading = TRUE;
-	facdata.num_threads = get_worker_num_threads (thread_num, HYPERTHREAD_TF);
-	facdata.sp_info = sp_info;
-	stop_reason = factorSetup (thread_num, p, &facdata);
-	if (stop_reason) {
-		factorDone (&facdata);
-		return (stop_reason);
-	}
+	stop_reason = factorGetHandle (thread_num, p, sp_info, &facdata);
+	if (stop_reason) return (stop_reason);
 
 /* Record the amount of memory being used by this thread (1MB). */
 
@@ -5350,7 +5739,7 @@ begin:	factor_found = 0;
 
 /* Note: The non-SSE2 code cannot handle factoring 79 bits and above. */
 
-	if (test_bits > 78 && !(facdata.asm_data->cpu_flags & (CPU_SSE2 | CPU_AVX2 | CPU_FMA3 | CPU_AVX512F))) {
+	if (test_bits > 78 && !(facdata->asm_data->cpu_flags & (CPU_SSE2 | CPU_AVX2 | CPU_FMA3 | CPU_AVX512F))) {
 		OutputBoth (thread_num, "Pre-SSE2 trial factoring code cannot go above 2^78.\n");
 		test_bits = 78;
 	}
@@ -5375,6 +5764,7 @@ begin:	factor_found = 0;
 			/* This sounds crazy, but has happened when OSes get in a funky state. */
 			if (read_save_file_state.a_non_bad_save_file_existed) {
 				OutputBoth (thread_num, ALLSAVEBAD_MSG);
+				factorReleaseHandle (thread_num, facdata, w->work_type == WORK_FACTOR);
 				return (0);
 			}
 			/* No save files existed, start from scratch. */
@@ -5396,8 +5786,8 @@ begin:	factor_found = 0;
 			    read_long (fd, &endpthi, NULL) &&
 			    read_long (fd, &endptlo, NULL) &&
 			    (fachsw < endpthi || (fachsw == endpthi && facmsw < endptlo))) {
-				facdata.asm_data->FACHSW = fachsw;
-				facdata.asm_data->FACMSW = facmsw;
+				facdata->asm_data->FACHSW = fachsw;
+				facdata->asm_data->FACMSW = facmsw;
 				continuation = TRUE;
 			}
 			_close (fd);
@@ -5486,31 +5876,31 @@ begin:	factor_found = 0;
 			continuation = FALSE;
 		else {
 			if (bits < 50) {
-				facdata.asm_data->FACHSW = 0;
-				facdata.asm_data->FACMSW = 0;
+				facdata->asm_data->FACHSW = 0;
+				facdata->asm_data->FACMSW = 0;
 			} else if (bits < 64) {
-				facdata.asm_data->FACHSW = 0;
-				facdata.asm_data->FACMSW = 1L << (bits-32);
+				facdata->asm_data->FACHSW = 0;
+				facdata->asm_data->FACMSW = 1L << (bits-32);
 			} else {
-				facdata.asm_data->FACHSW = 1L << (bits-64);
-				facdata.asm_data->FACMSW = 0;
+				facdata->asm_data->FACHSW = 1L << (bits-64);
+				facdata->asm_data->FACMSW = 0;
 			}
 		}
 
 /* Only test for factors less than 2^32 on the first pass */
 
-		if (facdata.asm_data->FACHSW == 0 &&
-		    facdata.asm_data->FACMSW == 0 && pass != 0)
-			facdata.asm_data->FACMSW = 1;
+		if (facdata->asm_data->FACHSW == 0 &&
+		    facdata->asm_data->FACMSW == 0 && pass != 0)
+			facdata->asm_data->FACMSW = 1;
 
 /* Setup the factoring program.  factorPassSetup needs to know the endpt in the case where */
 /* we've already found a factor and we are searching for a smaller factor -- factorPassSetup */
 /* used to assume the endpt was the next power of two. */
 
-		facdata.endpt = endpt * 4294967296.0;
-		stop_reason = factorPassSetup (thread_num, pass, &facdata);
+		facdata->endpt = endpt * 4294967296.0;
+		stop_reason = factorPassSetup (thread_num, pass, facdata);
 		if (stop_reason) {
-			factorDone (&facdata);
+			factorReleaseHandle (thread_num, facdata, FALSE);
 			return (stop_reason);
 		}
 
@@ -5524,7 +5914,7 @@ begin:	factor_found = 0;
 /* However, when multithreading the auxiliary threads are TFing chunks at the same time. */
 
 			start_timer (timers, 0);
-			res = factorChunk (&facdata);
+			res = factorChunk (facdata);
 			end_timer (timers, 0);
 
 /* If we found a factor, verify it */
@@ -5532,9 +5922,9 @@ begin:	factor_found = 0;
 			if (res == 1) {
 				stackgiant (f, 10);
 				stackgiant (x, 10);
-				itog ((int) facdata.asm_data->FACHSW, f); gshiftleft (32, f);
-				uladdg (facdata.asm_data->FACMSW, f); gshiftleft (32, f);
-				uladdg (facdata.asm_data->FACLSW, f);
+				itog ((int) facdata->asm_data->FACHSW, f); gshiftleft (32, f);
+				uladdg (facdata->asm_data->FACMSW, f); gshiftleft (32, f);
+				uladdg (facdata->asm_data->FACLSW, f);
 				itog (2, x);
 				powermod (x, p, f);
 
@@ -5546,7 +5936,7 @@ begin:	factor_found = 0;
 /* restart the factoring code. */
 
 				OutputBoth (thread_num, "ERROR: Incorrect factor found.\n");
-				factorDone (&facdata);
+				factorReleaseHandle (thread_num, facdata, FALSE);
 				stop_reason = SleepFive (thread_num);
 				if (stop_reason) return (stop_reason);
 				goto begin;
@@ -5556,15 +5946,15 @@ begin:	factor_found = 0;
 
 #ifdef X86_64
 			// Calc number of chunks left to do
-			currentpt = (double) facdata.total_num_chunks_to_TF - (double) facdata.total_num_chunks_TFed;
+			currentpt = (double) facdata->total_num_chunks_to_TF - (double) facdata->total_num_chunks_TFed;
 			// Calc average number of chunks to do in each siever
-			currentpt /= (double) facdata.num_sievers;
+			currentpt /= (double) facdata->num_sievers;
 			// Calc distance from endpt
-			currentpt *= (double) facdata.asm_data->facdist12K;
+			currentpt *= (double) facdata->asm_data->facdist12K;
 			// Calc currentpt scaled down by 2^32
 			currentpt = endpt - currentpt / 4294967296.0;
 #else
-			currentpt = facdata.asm_data->FACHSW * 4294967296.0 + facdata.asm_data->FACMSW;
+			currentpt = facdata->asm_data->FACHSW * 4294967296.0 + facdata->asm_data->FACMSW;
 			if (currentpt > endpt) currentpt = endpt;
 #endif
 			w->pct_complete = (pass + (currentpt - startpt) / (endpt - startpt)) / 16.0;
@@ -5574,7 +5964,7 @@ begin:	factor_found = 0;
 /* is close to zero.  We define one iteration as the time it takes to process 1Mbit of sieve. */
 
 			stop_reason = stopCheck (thread_num);
-			iters_just_processed = factorChunksProcessed (&facdata);
+			iters_just_processed = factorChunksProcessed (facdata);
 			iters += iters_just_processed;
 			if (((iters * FACTOR_CHUNK_SIZE) >> 7) >= ITER_OUTPUT || first_iter_msg) {
 				double	pct;
@@ -5615,12 +6005,12 @@ begin:	factor_found = 0;
 /* If an escape key was hit, write out the results and return */
 
 			if (stop_reason || testSaveFilesFlag (thread_num)) {
-				factorFindSmallestNotTFed (&facdata);
-				if (facdata.asm_data->FACHSW > endpthi ||
-				    (facdata.asm_data->FACHSW == endpthi && facdata.asm_data->FACMSW >= endptlo)) {
-					if (endptlo == 0) facdata.asm_data->FACHSW = endpthi - 1;
-					else facdata.asm_data->FACHSW = endpthi;
-					facdata.asm_data->FACMSW = endptlo - 1;
+				factorFindSmallestNotTFed (facdata);
+				if (facdata->asm_data->FACHSW > endpthi ||
+				    (facdata->asm_data->FACHSW == endpthi && facdata->asm_data->FACMSW >= endptlo)) {
+					if (endptlo == 0) facdata->asm_data->FACHSW = endpthi - 1;
+					else facdata->asm_data->FACHSW = endpthi;
+					facdata->asm_data->FACMSW = endptlo - 1;
 				}
 				fd = openWriteSaveFile (&write_save_file_state);
 				if (fd > 0 &&
@@ -5628,8 +6018,8 @@ begin:	factor_found = 0;
 				    write_long (fd, factor_found, NULL) &&
 				    write_long (fd, bits, NULL) &&
 				    write_long (fd, pass, NULL) &&
-				    write_long (fd, facdata.asm_data->FACHSW, NULL) &&
-				    write_long (fd, facdata.asm_data->FACMSW, NULL) &&
+				    write_long (fd, facdata->asm_data->FACHSW, NULL) &&
+				    write_long (fd, facdata->asm_data->FACMSW, NULL) &&
 				    write_long (fd, endpthi, NULL) &&
 				    write_long (fd, endptlo, NULL))
 					closeWriteSaveFile (&write_save_file_state, fd);
@@ -5640,7 +6030,7 @@ begin:	factor_found = 0;
 					if (fd > 0) deleteWriteSaveFile (&write_save_file_state, fd);
 				}
 				if (stop_reason) {
-					factorDone (&facdata);
+					factorReleaseHandle (thread_num, facdata, FALSE);
 					return (stop_reason);
 				}
 			}
@@ -5648,10 +6038,10 @@ begin:	factor_found = 0;
 /* Test for completion */
 
 #ifdef X86_64
-			if (facdata.pass_complete) goto nextpass;
+			if (facdata->pass_complete) goto nextpass;
 #else
-			if (facdata.asm_data->FACHSW > endpthi ||
-			    (facdata.asm_data->FACHSW == endpthi && facdata.asm_data->FACMSW >= endptlo))
+			if (facdata->asm_data->FACHSW > endpthi ||
+			    (facdata->asm_data->FACHSW == endpthi && facdata->asm_data->FACMSW >= endptlo))
 				goto nextpass;
 #endif
 		}
@@ -5669,7 +6059,7 @@ begin:	factor_found = 0;
 /* Format and output a message for each found factor */
 
 		do {
-			makestr (facdata.asm_data->FACHSW, facdata.asm_data->FACMSW, facdata.asm_data->FACLSW, str);
+			makestr (facdata->asm_data->FACHSW, facdata->asm_data->FACMSW, facdata->asm_data->FACLSW, str);
 			sprintf (buf, "M%ld has a factor: %s (TF:%d-%d)\n", p, str, (int) w->sieve_depth, (int) test_bits);
 			OutputStr (thread_num, buf);
 			formatMsgForResultsFile (buf, w);
@@ -5710,17 +6100,17 @@ begin:	factor_found = 0;
 				strcpy (pkt.JSONmessage, JSONbuf);
 				spoolMessage (PRIMENET_ASSIGNMENT_RESULT, &pkt);
 			}
-		} while (getAnotherFactorIfAny (&facdata));
+		} while (getAnotherFactorIfAny (facdata));
 
 /* If we're looking for smaller factors, set a new end point.  Otherwise, skip all remaining passes. */
 
 		if (!find_smaller_factor) break;
 
-		if (facdata.asm_data->FACMSW != 0xFFFFFFFF) {
-			endpthi = facdata.asm_data->FACHSW;
-			endptlo = facdata.asm_data->FACMSW+1;
+		if (facdata->asm_data->FACMSW != 0xFFFFFFFF) {
+			endpthi = facdata->asm_data->FACHSW;
+			endptlo = facdata->asm_data->FACMSW+1;
 		} else {
-			endpthi = facdata.asm_data->FACHSW+1;
+			endpthi = facdata->asm_data->FACHSW+1;
 			endptlo = 0;
 		}
 	        endpt = endpthi * 4294967296.0 + endptlo;
@@ -5730,6 +6120,12 @@ begin:	factor_found = 0;
 nextpass:	;
 	    }
 
+/* Optionally output per-thread statistics so that users can check how well TF scales with the number of threads */
+
+#ifdef X86_64
+	    if (facdata->num_threads > 1 && IniGetInt (INI_FILE, "TFThreadStats", 0)) factorOutputThreadStats (thread_num, facdata);
+#endif
+
 /* If we've found a factor then we need to send an assignment done message if we continued to look for a smaller factor. */
 
 	    if (factor_found) {
@@ -5802,9 +6198,9 @@ nextpass:	;
 	    bits = end_bits;
 	}
 
-/* Clean up allocated factoring data */
+/* Clean up allocated factoring data.  Keep it if a following Factor= work unit can use it. */
 
-	factorDone (&facdata);
+	factorReleaseHandle (thread_num, facdata, w->work_type == WORK_FACTOR);
 
 /* Delete the continuation file(s) */
 
@@ -5843,8 +6239,14 @@ typedef struct {		/* Some of the data kept during LL test */
 				/* gwsetup will return a handle */
 	gwnum	lldata;		/* Number in the lucas sequence */
 	unsigned long units_bit; /* Shift count */
+	struct ll_async_jacobi *async_jacobi; /* Background Jacobi check, NULL if never started */
+	struct ll_async_save *async_save; /* Background save file writer, NULL if never started */
 } llhandle;
 
+void freeAsyncJacobi (llhandle *lldata);
+void finishAsyncLLSave (llhandle *lldata);
+void freeAsyncLLSave (llhandle *lldata);
+
 /* Prepare for running a Lucas-Lehmer test.  Caller must have already called gwinit. */
 
 int lucasSetup (
@@ -5860,6 +6262,8 @@ int lucasSetup (
 
 	lldata->lldata = NULL;
 	lldata->units_bit = 0;
+	lldata->async_jacobi = NULL;
+	lldata->async_save = NULL;
 
 /* As a kludge for the benchmarking and timing code, an odd FFTlen sets up gwnum for negacyclic FFTs. */
 
@@ -5914,6 +6318,11 @@ void lucasDone (
 	llhandle *lldata)	/* Common LL data structure */
 {
 
+/* Wait for any background save file write and Jacobi check */
+
+	freeAsyncLLSave (lldata);
+	freeAsyncJacobi (lldata);
+
 /* Free memory for the Lucas-Lehmer data */
 
 	gwfree (&lldata->gwdata, lldata->lldata);
@@ -6372,30 +6781,22 @@ int gwrotate_left (			// Returns TRUE if successful
 	return (gwrotate_right (gwdata, x, gwdata->n - shift_count));
 }
 
-/* Perform a Jacobi test on the current LL iteration.  This check has a 50% chance of catching */
-/* a calculation error.  See http://www.mersenneforum.org/showthread.php?t=22471 especially */
-/* starting at post #30. */
+/* Convert the current LL iteration to binary, apply the shift count, and subtract two.  Returns 1 on success, 0 if the LL value */
+/* is corrupt, -1 on a memory allocation error.  On success, the caller must mpz_clear "a". */
 
-int jacobi_test (
+int jacobi_snapshot (
 	int	thread_num,		/* Window to display messages in */
 	unsigned long p,		/* Mersenne exponent */
-	llhandle *lldata)		/* Struct that points us to the LL data */
+	llhandle *lldata,		/* Struct that points us to the LL data */
+	mpz_t	a)			/* Returned LL value minus two, modulo 2^p-1 */
 {
 	giant	v;
-	mpz_t	a, b;
-	int	err_code, Jacobi_symbol, silent_Jacobi;
-	double	timers[1];
-	char	buf[80];
-
-/* Clear and start a timer */
-
-	clear_timers (timers, sizeof (timers) / sizeof (timers[0]));
-	start_timer (timers, 0);
+	int	err_code;
 
 /* Convert current iteration to binary.  Apply the shift count. */
 
 	v = popg (&lldata->gwdata.gdata, (p >> 5) + 5);
-	if (v == NULL) goto oom;
+	if (v == NULL) return (-1);
 	err_code = gwtogiant (&lldata->gwdata, lldata->lldata, v);
 	if (err_code < 0) {		/* LL value could not be calculated.  Should not happen, return failed-Jacobi-test */
 		OutputBoth (thread_num, "LL value corrupt.  Could not run Jacobi error check.\n");
@@ -6404,28 +6805,96 @@ int jacobi_test (
 	}
 	if (! rotateg (v, p, lldata->units_bit, &lldata->gwdata.gdata)) {
 		pushg (&lldata->gwdata.gdata, 1);
-		goto oom;
+		return (-1);
 	}
 
-/* Copy the LL value to "a" */
+/* Copy the LL value to "a", subtract two.  Since the LL value is in the range 0 to 2^p-1, adding 2^p-1 is cheaper than an mpz_mod. */
 
 	mpz_init (a);
 	gtompz (v, a);
 	pushg (&lldata->gwdata.gdata, 1);
+	mpz_sub_ui (a, a, 2);
+	if (mpz_sgn (a) < 0) {
+		mpz_t	b;
+		mpz_init (b);
+		mpz_ui_pow_ui (b, 2, p);
+		mpz_sub_ui (b, b, 1);
+		mpz_add (a, a, b);
+		mpz_clear (b);
+	}
+	return (1);
+}
 
-/* Generate the Mersenne number */
+/* Compute the Jacobi symbol (a|2^p-1).  GMP's mpz_jacobi is the default.  The giants library's half GCD is an alternative, */
+/* selected with JacobiUseGiants=1 in prime.txt.  Use the Jacobi benchmark (exponent 9953) to compare the two.  The giants */
+/* code is not interruptible, a stop request must not abandon a nearly finished check.  The symbol is never zero unless a is */
+/* a multiple of 2^p-1, so a zero from jacobig means it ran out of memory.  Let GMP compute the symbol in that case. */
+
+int jacobi_Mp (
+	mpz_t	a,			/* LL value minus two */
+	unsigned long p,		/* Mersenne exponent */
+	int	use_giants)		/* TRUE if giants rather than GMP should compute the symbol */
+{
+	mpz_t	b;
+	int	Jacobi_symbol;
+
+	if (use_giants) {
+		giant	ga, gb;
+		ga = allocgiant ((p >> 5) + 5);
+		gb = allocgiant ((p >> 5) + 5);
+		if (ga != NULL && gb != NULL) {
+			mpztog (a, ga);
+			setone (gb);
+			gshiftleft (p, gb);
+			iaddg (-1, gb);
+			Jacobi_symbol = jacobig (ga, gb);
+			free (ga);
+			free (gb);
+			if (Jacobi_symbol) return (Jacobi_symbol);
+			ga = gb = NULL;
+		}
+		free (ga);
+		free (gb);
+	}
 
 	mpz_init (b);
 	mpz_ui_pow_ui (b, 2, p);
 	mpz_sub_ui (b, b, 1);
+	Jacobi_symbol = mpz_jacobi (a, b);
+	mpz_clear (b);
+	return (Jacobi_symbol);
+}
+
+/* Perform a Jacobi test on the current LL iteration.  This check has a 50% chance of catching */
+/* a calculation error.  See http://www.mersenneforum.org/showthread.php?t=22471 especially */
+/* starting at post #30. */
+
+int jacobi_test (
+	int	thread_num,		/* Window to display messages in */
+	unsigned long p,		/* Mersenne exponent */
+	llhandle *lldata)		/* Struct that points us to the LL data */
+{
+	mpz_t	a;
+	int	rc, Jacobi_symbol, silent_Jacobi;
+	double	timers[1];
+	char	buf[80];
 
-/* Free giants, compute the Jacobi symbol (a-2|Mp) */
+/* Clear and start a timer */
+
+	clear_timers (timers, sizeof (timers) / sizeof (timers[0]));
+	start_timer (timers, 0);
+
+/* Convert current iteration to binary, apply the shift count, subtract two */
+
+	rc = jacobi_snapshot (thread_num, p, lldata, a);
+	if (rc == 0) return (0);
+	if (rc < 0) goto oom;
+
+/* Compute the Jacobi symbol (a-2|Mp) */
 
 	silent_Jacobi = IniGetInt (INI_FILE, "SilentJacobi", 0);
 	if (!silent_Jacobi) OutputStr (thread_num, "Running Jacobi error check.  ");
-	mpz_sub_ui (a, a, 2);
-	if (mpz_sgn (a) < 0) mpz_add (a, a, b);
-	Jacobi_symbol = mpz_jacobi (a, b);
+	Jacobi_symbol = jacobi_Mp (a, p, IniGetInt (INI_FILE, "JacobiUseGiants", 0));
 
 /* End the timer, print out PASS/FAIL message along with time taken */
 
@@ -6437,7 +6906,6 @@ int jacobi_test (
 /* Cleanup and return */
 
 	mpz_clear (a);
-	mpz_clear (b);
 	return (Jacobi_symbol == -1);
 
 /* Memory allocation error */
@@ -6446,6 +6914,295 @@ oom:	OutputBoth (thread_num, "Memory allocation error.  Could not run Jacobi err
 	return (1);			/* Assume the Jacobi test would have passed */
 }
 
+/* Asynchronous Jacobi checks.  For large exponents mpz_jacobi takes many seconds while the FFT helper threads sit idle.  Instead, the */
+/* worker snapshots the LL value and keeps iterating while a helper thread computes the Jacobi symbol.  The save file written at the */
+/* snapshot iteration is marked special only after the check passes.  On failure, every save file written since the snapshot is suspect */
+/* and the worker restarts from the last save file that predates the snapshot. */
+
+struct ll_async_jacobi {
+	int	thread_num;		/* Worker number for messages */
+	unsigned long p;		/* Mersenne exponent */
+	unsigned long counter;		/* Iteration that was snapshotted */
+	mpz_t	a;			/* LL value minus two at the snapshot iteration */
+	int	use_giants;		/* TRUE if the giants half GCD computes the symbol */
+	int	Jacobi_symbol;		/* Result from the helper thread */
+	double	timers[1];		/* Time spent in the helper thread */
+	gwatomic done;			/* Set by the helper thread when Jacobi_symbol is valid */
+	gwthread helper;		/* Thread id of the helper thread */
+	int	active;			/* TRUE if a check has been started and not yet finished */
+	int	snapshot_saved;		/* TRUE if the save file at the snapshot iteration was written */
+	int	saves;			/* Number of save files written at or after the snapshot iteration */
+};
+
+/* The Jacobi helper thread */
+
+void asyncJacobiHelper (void *arg)
+{
+	struct ll_async_jacobi *aj = (struct ll_async_jacobi *) arg;
+
+	clear_timers (aj->timers, sizeof (aj->timers) / sizeof (aj->timers[0]));
+	start_timer (aj->timers, 0);
+	aj->Jacobi_symbol = jacobi_Mp (aj->a, aj->p, aj->use_giants);
+	end_timer (aj->timers, 0);
+	atomic_set (aj->done, 1);
+}
+
+/* Return TRUE if a background Jacobi check is outstanding */
+
+int asyncJacobiPending (
+	llhandle *lldata)
+{
+	return (lldata->async_jacobi != NULL && lldata->async_jacobi->active);
+}
+
+/* Return TRUE if the outstanding background Jacobi check has a result */
+
+int asyncJacobiDone (
+	llhandle *lldata)
+{
+	return (asyncJacobiPending (lldata) && atomic_get (lldata->async_jacobi->done));
+}
+
+/* Record that a save file was successfully written */
+
+void asyncJacobiSaved (
+	llhandle *lldata,
+	int	snapshot_iteration)	/* TRUE if this save file is for the snapshot iteration */
+{
+	if (!asyncJacobiPending (lldata)) return;
+	if (snapshot_iteration) lldata->async_jacobi->snapshot_saved = TRUE;
+	lldata->async_jacobi->saves++;
+}
+
+/* Snapshot the LL value and start a helper thread to compute the Jacobi symbol.  Returns FALSE if the caller must run a */
+/* synchronous Jacobi check instead.  Any previous background check must have been finished. */
+
+int startAsyncJacobi (
+	int	thread_num,		/* Worker number */
+	unsigned long p,		/* Mersenne exponent */
+	llhandle *lldata,		/* Struct that points us to the LL data */
+	unsigned long counter)		/* Current iteration */
+{
+	struct ll_async_jacobi *aj;
+
+	if (!IniGetInt (INI_FILE, "AsyncJacobi", 1)) return (FALSE);
+
+/* Allocate the structure the first time through */
+
+	aj = lldata->async_jacobi;
+	if (aj == NULL) {
+		aj = (struct ll_async_jacobi *) malloc (sizeof (struct ll_async_jacobi));
+		if (aj == NULL) return (FALSE);
+		memset (aj, 0, sizeof (struct ll_async_jacobi));
+		lldata->async_jacobi = aj;
+	}
+
+/* Snapshot the LL value.  A corrupt LL value or memory error is left for the synchronous check to report. */
+
+	if (jacobi_snapshot (thread_num, p, lldata, aj->a) != 1) return (FALSE);
+
+/* Start the helper thread */
+
+	aj->thread_num = thread_num;
+	aj->p = p;
+	aj->counter = counter;
+	aj->use_giants = IniGetInt (INI_FILE, "JacobiUseGiants", 0);
+	aj->snapshot_saved = FALSE;
+	aj->saves = 0;
+	atomic_set (aj->done, 0);
+	gwthread_create_waitable (&aj->helper, &asyncJacobiHelper, (void *) aj);
+	aj->active = TRUE;
+	return (TRUE);
+}
+
+/* Wait for the background Jacobi check to complete.  If it passed, mark the snapshot's save file as special.  Returns TRUE if the */
+/* check passed.  If it failed, *suspect_saves is set to the number of most recent save files that must not be trusted. */
+
+int finishAsyncJacobi (
+	llhandle *lldata,		/* Struct that points us to the LL data */
+	writeSaveFileState *state,	/* Save file names and rename chain */
+	int	*suspect_saves)		/* Returned count of bad save files */
+{
+	struct ll_async_jacobi *aj = lldata->async_jacobi;
+	char	buf[120];
+
+/* Any save file still being written must be counted before we work out which save files the check covers */
+
+	finishAsyncLLSave (lldata);
+	*suspect_saves = 0;
+	if (!asyncJacobiPending (lldata)) return (TRUE);
+	gwthread_wait_for_exit (&aj->helper);
+	aj->active = FALSE;
+	mpz_clear (aj->a);
+
+/* Output PASS/FAIL message along with time taken */
+
+	if (!IniGetInt (INI_FILE, "SilentJacobi", 0)) {
+		sprintf (buf, "Jacobi error check of iteration %lu %s.  Time: %6.3f sec.\n",
+			 aj->counter, aj->Jacobi_symbol == -1 ? "passed" : "failed", timer_value (aj->timers, 0));
+		OutputStr (aj->thread_num, buf);
+	} else if (aj->Jacobi_symbol != -1)
+		OutputStr (aj->thread_num, "Jacobi error-check failed\n");
+
+/* On success, find the snapshot's save file in the rename chain and mark it special.  If it has already fallen off the end */
+/* of the ordinary save files, it is gone and there is nothing to mark. */
+
+	if (aj->Jacobi_symbol == -1) {
+		if (aj->snapshot_saved && state->num_ordinary_save_files != 99 && aj->saves <= state->num_ordinary_save_files)
+			state->special |= 1ULL << (aj->saves - 1);
+		return (TRUE);
+	}
+
+/* On failure, every save file written since the snapshot is suspect */
+
+	if (state->num_ordinary_save_files == 99) *suspect_saves = 0;
+	else if (aj->saves > state->num_ordinary_save_files) *suspect_saves = state->num_ordinary_save_files;
+	else *suspect_saves = aj->saves;
+	return (FALSE);
+}
+
+/* Wait for any background Jacobi check, then free the async Jacobi structure.  Must be called before the LL gwdata is freed. */
+
+void freeAsyncJacobi (
+	llhandle *lldata)
+{
+	if (lldata->async_jacobi == NULL) return;
+	if (asyncJacobiPending (lldata)) {
+		gwthread_wait_for_exit (&lldata->async_jacobi->helper);
+		mpz_clear (lldata->async_jacobi->a);
+	}
+	free (lldata->async_jacobi);
+	lldata->async_jacobi = NULL;
+}
+
+/* Asynchronous LL save files.  Like PRP save files, snapshot the LL value using the multithreaded gwcopy and let a writer thread */
+/* convert it to binary and write it to disk using a cloned gwdata.  The writer thread owns the writeSaveFileState until */
+/* finishAsyncLLSave is called. */
+
+struct ll_async_save {
+	llhandle ll;			/* Cloned gwdata and snapshot of the LL value used by the writer thread */
+	int	clone_initialized;	/* TRUE if the clone needs a gwdone */
+	int	thread_num;		/* Worker number for messages */
+	writeSaveFileState *write_save_file_state; /* Save file names and rename chain */
+	struct work_unit w;		/* Copy of the work unit */
+	unsigned long counter;		/* Iteration being saved */
+	unsigned long error_count;	/* Error count being saved */
+	int	special;		/* TRUE if the save file is to be marked special (Jacobi checked) */
+	int	jacobi_snapshot;	/* TRUE if this save file is for a background Jacobi check's snapshot iteration */
+	int	ok;			/* Set by the writer thread if the save file was written */
+	gwthread writer;		/* Thread id of the writer thread */
+	int	writer_active;		/* TRUE if the writer thread is running */
+};
+
+/* The save file writer thread */
+
+void asyncLLSaveWriter (void *arg)
+{
+	struct ll_async_save *as = (struct ll_async_save *) arg;
+	char	buf[200];
+
+	as->ok = writeLLSaveFile (&as->ll, as->write_save_file_state, &as->w, as->counter, as->error_count);
+	if (!as->ok) {
+		sprintf (buf, WRITEFILEERR, as->write_save_file_state->base_filename);
+		OutputBoth (as->thread_num, buf);
+		OutputBothErrno (as->thread_num);
+	}
+}
+
+/* Wait for the save file writer thread to finish, then do the bookkeeping a synchronous write would have done */
+
+void finishAsyncLLSave (
+	llhandle *lldata)
+{
+	struct ll_async_save *as = lldata->async_save;
+
+	if (as == NULL || !as->writer_active) return;
+	gwthread_wait_for_exit (&as->writer);
+	as->writer_active = FALSE;
+	if (as->ok) asyncJacobiSaved (lldata, as->jacobi_snapshot);
+	if (as->special) setWriteSaveFileSpecial (as->write_save_file_state);
+}
+
+/* Wait for the writer thread, then free the snapshot and cloned gwdata.  Must be called before the LL gwdata is freed. */
+/* Callers that keep using the writeSaveFileState must call finishAsyncLLSave first. */
+
+void freeAsyncLLSave (
+	llhandle *lldata)
+{
+	struct ll_async_save *as = lldata->async_save;
+
+	if (as == NULL) return;
+	if (as->writer_active) {
+		gwthread_wait_for_exit (&as->writer);
+		as->writer_active = FALSE;
+	}
+	if (as->clone_initialized) {
+		if (as->ll.lldata != NULL) gwfree (&as->ll.gwdata, as->ll.lldata);
+		gwdone (&as->ll.gwdata);
+	}
+	free (as);
+	lldata->async_save = NULL;
+}
+
+/* Snapshot the LL value and start a writer thread to create the save file.  Returns FALSE if the caller must write the save file itself. */
+
+int startAsyncLLSave (
+	int	thread_num,		/* Worker number */
+	llhandle *lldata,		/* Struct that points us to the LL data */
+	writeSaveFileState *write_save_file_state,
+	struct work_unit *w,
+	unsigned long counter,
+	unsigned long error_count,
+	int	special,		/* TRUE if save file should be marked special */
+	int	jacobi_snapshot)	/* TRUE if a background Jacobi check was just started at this iteration */
+{
+	struct ll_async_save *as;
+
+/* The previous save file must be complete before we touch the save file state again */
+
+	finishAsyncLLSave (lldata);
+	if (!IniGetInt (INI_FILE, "AsyncSaveFiles", 1)) return (FALSE);
+
+/* Allocate the clone and snapshot the first time through */
+
+	as = lldata->async_save;
+	if (as == NULL) {
+		as = (struct ll_async_save *) malloc (sizeof (struct ll_async_save));
+		if (as == NULL) return (FALSE);
+		memset (as, 0, sizeof (struct ll_async_save));
+		lldata->async_save = as;
+		if (gwclone (&as->ll.gwdata, &lldata->gwdata)) {
+			freeAsyncLLSave (lldata);
+			return (FALSE);
+		}
+		as->clone_initialized = TRUE;
+		as->ll.lldata = gwalloc (&lldata->gwdata);
+		if (as->ll.lldata == NULL) {
+			freeAsyncLLSave (lldata);
+			return (FALSE);
+		}
+	}
+
+/* Snapshot the LL value using gwcopy, which uses all the worker's threads */
+
+	gwcopy (&lldata->gwdata, lldata->lldata, as->ll.lldata);
+	as->ll.units_bit = lldata->units_bit;
+
+/* Copy the rest of the state and start the writer thread */
+
+	as->thread_num = thread_num;
+	as->write_save_file_state = write_save_file_state;
+	as->w = *w;
+	as->counter = counter;
+	as->error_count = error_count;
+	as->special = special;
+	as->jacobi_snapshot = jacobi_snapshot;
+	as->ok = FALSE;
+	gwthread_create_waitable (&as->writer, &asyncLLSaveWriter, (void *) as);
+	as->writer_active = TRUE;
+	return (TRUE);
+}
+
 /* Do the Lucas-Lehmer test */
 
 int prime (
@@ -6462,6 +7219,7 @@ int prime (
 	unsigned long iters;
 	readSaveFileState read_save_file_state; /* Manage savefile names during reading */
 	writeSaveFileState write_save_file_state; /* Manage savefile names during writing */
+	int	jacobi_suspect_saves = 0;	/* On a restart, number of save files written after a failed background Jacobi check */
 	char	filename[32];
 	double	timers[2];
 	double	inverse_p;
@@ -6565,6 +7323,8 @@ begin:	gwinit (&lldata.gwdata);
 	else gwset_will_error_check_near_limit (&lldata.gwdata);
 	gwset_num_threads (&lldata.gwdata, get_worker_num_threads (thread_num, HYPERTHREAD_LL));
 	gwset_thread_callback (&lldata.gwdata, SetAuxThreadPriority);
+	SetGwnumNumaPolicy (&lldata.gwdata);
+	SetGwnumTableCache (&lldata.gwdata);
 	gwset_thread_callback_data (&lldata.gwdata, sp_info);
 	gwset_use_spin_wait (&lldata.gwdata, IniGetInt (INI_FILE, "SpinWait", 0));
 	stop_reason = lucasSetup (thread_num, p, w->minimum_fftlen, &lldata);
@@ -6583,6 +7343,7 @@ begin:	gwinit (&lldata.gwdata);
 /* If there are no more save files, start off with the 1st Lucas number. */
 
 		if (! saveFileExists (&read_save_file_state)) {
+			jacobi_suspect_saves = 0;
 			/* If there were save files, they are all bad.  Report a message */
 			/* and temporarily abandon the work unit.  We do this in hopes that */
 			/* we can successfully read one of the bad save files at a later time. */
@@ -6599,6 +7360,14 @@ begin:	gwinit (&lldata.gwdata);
 			break;
 		}
 
+/* A background Jacobi check failed.  Set aside the save files written since its snapshot. */
+
+		if (jacobi_suspect_saves) {
+			jacobi_suspect_saves--;
+			saveFileBad (&read_save_file_state);
+			continue;
+		}
+
 /* Read an LL save file.  If successful, break out of loop. */
 
 		if (readLLSaveFile (&lldata, read_save_file_state.current_filename, w, &counter, &error_count) &&
@@ -6712,7 +7481,7 @@ begin:	gwinit (&lldata.gwdata);
 	iters = 0;
 	error_count_messages = IniGetInt (INI_FILE, "ErrorCountMessages", 3);
 	while (counter < p) {
-		int	saving, Jacobi_testing, echk, sending_residue, interim_residue, interim_file;
+		int	saving, Jacobi_testing, Jacobi_async, echk, sending_residue, interim_residue, interim_file;
 		int	actual_frequency;
 
 /* See if we should stop processing after this iteration */
@@ -6848,9 +7617,23 @@ begin:	gwinit (&lldata.gwdata);
 			goto restart;
 		}
 
-/* Check the Jacobi symbol */
+/* Collect the result of a background Jacobi check.  Wait for the helper thread if we are about to write the save file */
+/* before stopping, on the last iteration, or if another Jacobi check is due. */
+
+		if (asyncJacobiPending (&lldata) && (stop_reason || counter+1 == p || Jacobi_testing || asyncJacobiDone (&lldata))) {
+			if (!finishAsyncJacobi (&lldata, &write_save_file_state, &jacobi_suspect_saves)) {
+				sprintf (buf, ERRMSG0, lldata.async_jacobi->counter, p, ERRMSG1G);
+				OutputBoth (thread_num, buf);
+				inc_error_count (4, &error_count);
+				sleep5 = FALSE;
+				goto restart;
+			}
+		}
+
+/* Check the Jacobi symbol.  Except on the last iteration, try to do this in the background. */
 
-		if (Jacobi_testing && !jacobi_test (thread_num, p, &lldata)) {
+		Jacobi_async = Jacobi_testing && counter+1 != p && startAsyncJacobi (thread_num, p, &lldata, counter);
+		if (Jacobi_testing && !Jacobi_async && !jacobi_test (thread_num, p, &lldata)) {
 			sprintf (buf, ERRMSG0, counter, p, ERRMSG1G);
 			OutputBoth (thread_num, buf);
 			inc_error_count (4, &error_count);
@@ -6964,13 +7747,15 @@ begin:	gwinit (&lldata.gwdata);
 /* Write results to a file every DISK_WRITE_TIME minutes */
 /* On error, retry in 10 minutes (it could be a temporary disk-full situation) */
 
-		if (saving) {
+		if (saving && !startAsyncLLSave (thread_num, &lldata, &write_save_file_state, w, counter, error_count,
+						 Jacobi_testing && !Jacobi_async, Jacobi_async)) {
 			if (! writeLLSaveFile (&lldata, &write_save_file_state, w, counter, error_count)) {
 				sprintf (buf, WRITEFILEERR, filename);
 				OutputBoth (thread_num, buf);
 				OutputBothErrno (thread_num);
-			}
-			if (Jacobi_testing) setWriteSaveFileSpecial (&write_save_file_state);
+			} else
+				asyncJacobiSaved (&lldata, Jacobi_async);
+			if (Jacobi_testing && !Jacobi_async) setWriteSaveFileSpecial (&write_save_file_state);
 		}
 
 /* If an escape key was hit, write out the results and return */
@@ -7062,6 +7847,10 @@ begin:	gwinit (&lldata.gwdata);
 		}
 	}
 
+/* Wait for the last save file to be written */
+
+	finishAsyncLLSave (&lldata);
+
 /* Check for a successful completion */
 /* We found a prime if result is zero */
 /* Note that all values of -1 is the same as zero */
@@ -7162,7 +7951,16 @@ begin:	gwinit (&lldata.gwdata);
 /* An error occurred, output a message saying we are restarting, sleep, */
 /* then try restarting at last save point. */
 
-restart:if (sleep5) OutputBoth (thread_num, ERRMSG2);
+/* Collect any background save file write and the result of any background Jacobi check first.  If the check passed, its snapshot */
+/* save file is marked special.  If it failed, the save files written since the snapshot are set aside when we restart. */
+
+restart:finishAsyncLLSave (&lldata);
+	if (asyncJacobiPending (&lldata) && !finishAsyncJacobi (&lldata, &write_save_file_state, &jacobi_suspect_saves)) {
+		sprintf (buf, ERRMSG0, lldata.async_jacobi->counter, p, ERRMSG1G);
+		OutputBoth (thread_num, buf);
+		inc_error_count (4, &error_count);
+	}
+	if (sleep5) OutputBoth (thread_num, ERRMSG2);
 	OutputBoth (thread_num, ERRMSG3);
 
 /* Save the incremented error count to be used in the restart rather than the error count read from a save file */
@@ -7173,7 +7971,10 @@ restart:if (sleep5) OutputBoth (thread_num, ERRMSG2);
 
 	if (sleep5) {
 		stop_reason = SleepFive (thread_num);
-		if (stop_reason) return (stop_reason);
+		if (stop_reason) {
+			lucasDone (&lldata);
+			return (stop_reason);
+		}
 	}
 
 /* Return so that last continuation file is read in */
@@ -7631,6 +8432,8 @@ int selfTestInternal (
 		gwclear_use_benchmarks (&lldata.gwdata);
 		gwset_num_threads (&lldata.gwdata, num_threads);
 		gwset_thread_callback (&lldata.gwdata, SetAuxThreadPriority);
+		SetGwnumNumaPolicy (&lldata.gwdata);
+		SetGwnumTableCache (&lldata.gwdata);
 		gwset_thread_callback_data (&lldata.gwdata, sp_info);
 		lldata.gwdata.GW_BIGBUF = (char *) bigbuf;
 		lldata.gwdata.GW_BIGBUF_SIZE = (bigbuf != NULL) ? (intptr_t) memory * (intptr_t) 1048576 : 0;
@@ -8576,69 +9379,334 @@ nextp:		stop_reason = stopCheck (thread_num);
 	return (0);
 }
 
-/******************/
-/* Debugging code */
-/******************/
+/* Benchmark the segmented wheel sieve against the original sieve.  The original sieve is kept here only as a baseline.  It scans a */
+/* 4KB bit array of odd numbers one bit at a time. */
 
-int cpuid_dump (
-	int	thread_num)
-{
-	struct cpuid_data reg;
-	unsigned int i, j, max_cpuid_value, max_extended_cpuid_value;
-	char	buf[200];
-#define dumpreg() {sprintf(buf,"i: %08lX, EAX: %08lX, EBX: %08lX, ECX: %08lX, EDX: %08lX\n",(long)i,(long)reg.EAX,(long)reg.EBX,(long)reg.ECX,(long)reg.EDX); OutputBoth(thread_num,buf);}
+typedef struct {
+	uint32_t *primes;
+	uint64_t first_number;
+	unsigned int bit_number;
+	unsigned int num_primes;
+	unsigned int num_elimination_primes;
+	uint64_t start;
+	char	array[4096];
+} legacy_sieve_info;
+
+void legacy_fill_sieve (
+	legacy_sieve_info *si)
+{
+	unsigned int i;
+	uint32_t fmax;
+
+	fmax = (uint32_t) sqrt ((double) (si->first_number + sizeof (si->array) * 8 * 2));
+	for (i = si->num_primes; i < si->num_elimination_primes * 2; i += 2) {
+		uint32_t f, r, bit;
+		f = si->primes[i];
+		if (f > fmax) break;
+		if (si->first_number == 3) {
+			bit = (f * f - 3) >> 1;
+		} else {
+			r = (uint32_t) (si->first_number % f);
+			if (r == 0) bit = 0;
+			else if (r & 1) bit = (f - r) / 2;
+			else bit = (f + f - r) / 2;
+			if (f == si->first_number + 2 * bit) bit += f;
+		}
+		si->primes[i+1] = bit;
+	}
+	si->num_primes = i;
 
-/* Call CPUID with 0 and 0x80000000 arguments to get how many functions are supported. */
+	memset (si->array, 0xFF, sizeof (si->array));
+	for (i = 0; i < si->num_primes; i += 2) {
+		uint32_t f, bit;
+		f = si->primes[i];
+		for (bit = si->primes[i+1]; bit < sizeof (si->array) * 8; bit += f) bitclr (si->array, bit);
+		si->primes[i+1] = bit - sizeof (si->array) * 8;
+	}
+	si->bit_number = 0;
+}
 
-	Cpuid (0, &reg);
-	max_cpuid_value = reg.EAX;
-	Cpuid (0x80000000, &reg);
-	max_extended_cpuid_value = reg.EAX;
+legacy_sieve_info *legacy_start_sieve (
+	uint64_t start,
+	uint32_t max_elimination_factor)
+{
+	legacy_sieve_info *si;
+	unsigned int i, estimated_num_primes;
+	uint32_t f;
 
-/* Dump the regular CPUID data */
+	si = (legacy_sieve_info *) malloc (sizeof (legacy_sieve_info));
+	if (si == NULL) return (NULL);
+	memset (si, 0, sizeof (legacy_sieve_info));
+	if (start < 2) start = 2;
+	si->start = start;
+	estimated_num_primes = (unsigned int) ((double) max_elimination_factor / (log ((double) max_elimination_factor) - 1.0) * 1.01);
+	si->primes = (uint32_t *) malloc (estimated_num_primes * 2 * sizeof (uint32_t));
+	if (si->primes == NULL) {
+		free (si);
+		return (NULL);
+	}
+	for (i = 0, f = 3; f <= max_elimination_factor && i < estimated_num_primes; f += 2)
+		if (isPrime (f)) si->primes[i*2] = f, i++;
+	si->num_elimination_primes = i;
+	si->first_number = start | 1;
+	legacy_fill_sieve (si);
+	return (si);
+}
 
-	for (i = 0; i <= max_cpuid_value; i++) {
-		for (j = 0; j < 5; j++) {
-			memset (&reg, 0, sizeof (reg));
-			reg.ECX = j;
-			Cpuid (i, &reg);
-			dumpreg ();
-			if (i != 4 && i != 7 && i != 11) break;
+uint64_t legacy_sieve (
+	legacy_sieve_info *si)
+{
+	if (si->start == 2) {
+		si->start = 3;
+		return (2);
+	}
+	for ( ; ; ) {
+		unsigned int bit;
+		if (si->bit_number == sizeof (si->array) * 8) {
+			si->first_number += 2 * sizeof (si->array) * 8;
+			legacy_fill_sieve (si);
 		}
+		bit = si->bit_number++;
+		if (bittst (si->array, bit))
+			return (si->first_number + 2 * bit);
 	}
+}
 
-/* Dump the extended CPUID data */
+void legacy_end_sieve (
+	legacy_sieve_info *si)
+{
+	free (si->primes);
+	free (si);
+}
 
-	for (i = 0x80000000; i <= max_extended_cpuid_value; i++) {
-		for (j = 0; j < 5; j++) {
-			memset (&reg, 0, sizeof (reg));
-			reg.ECX = j;
-			Cpuid (i, &reg);
-			dumpreg ();
-			if (i != 0x8000001D) break;
-		}
-	}
+/* Each thread of the parallel benchmark sieves its own segment of the range */
 
-/* Dump the extended GETBV (control registers) data */
+struct sieve_bench_segment {
+	int	thread_num;
+	uint64_t start;
+	uint64_t end;
+	uint32_t max_elimination_factor;
+	uint64_t count;
+	uint64_t sum;
+	int	stop_reason;
+};
 
-	Cpuid (1, &reg);
-	if ((reg.ECX >> 27) & 0x1) {
-		Xgetbv (0, &reg);
-		dumpreg ();
-		if (IniGetInt (INI_FILE, "AdditionalGetBV", 0)) {
-			Xgetbv (IniGetInt (INI_FILE, "AdditionalGetBV", 0), &reg);
-			dumpreg ();
-		}
-	}
+void sieve_bench_segment_thread (
+	void	*arg)
+{
+	struct sieve_bench_segment *seg = (struct sieve_bench_segment *) arg;
+	uint64_t primes[4096];
+	unsigned int i, count;
+	void	*si = NULL;
 
-	return (0);
+	seg->count = seg->sum = 0;
+	seg->stop_reason = start_sieve_with_limit (seg->thread_num, seg->start, seg->max_elimination_factor, &si);
+	if (seg->stop_reason) return;
+	do {
+		count = sieve_primes (si, seg->end, primes, 4096);
+		for (i = 0; i < count; i++) seg->sum += primes[i];
+		seg->count += count;
+	} while (count == 4096);
+	end_sieve (si);
 }
 
-/*********************/
-/* Benchmarking code */
-/*********************/
+/* Time the original sieve, the new sieve one prime at a time, the new sieve in batches, and the new sieve in parallel segments. */
+/* Each run returns the same primes, which is verified by comparing counts and sums. */
 
-/* Time a few iterations of an LL test on a given exponent */
+int primeSieveBench (
+	int	thread_num)
+{
+#define SIEVE_BENCH_PRIMES	10000000
+	static const double starts[4] = {2.0, 1.0e9, 1.0e12, 1.0e14};
+	struct sieve_bench_segment segs[64];
+	gwthread threads[64];
+	uint64_t primes[4096];
+	double	timers[2];
+	char	buf[200];
+	int	i, j, num_threads, stop_reason;
+
+	num_threads = IniGetInt (INI_FILE, "SieveBenchThreads", HW_NUM_CORES);
+	if (num_threads < 1) num_threads = 1;
+	if (num_threads > 64) num_threads = 64;
+	OutputBoth (thread_num, "Sieve benchmark, primes per second.\n");
+
+	for (i = 0; i < 4; i++) {
+		uint64_t start, last, sum, new_sum, batch_sum, count, par_count, par_sum;
+		uint32_t max_elim;
+		double	old_time, new_time, batch_time, par_time;
+		legacy_sieve_info *lsi;
+		void	*si = NULL;
+
+		start = (uint64_t) starts[i];
+		max_elim = (uint32_t) sqrt (starts[i] + 40.0 * SIEVE_BENCH_PRIMES * log (starts[i] + 40.0 * SIEVE_BENCH_PRIMES)) + 1;
+
+		// The original sieve
+		clear_timer (timers, 0);
+		start_timer (timers, 0);
+		lsi = legacy_start_sieve (start, max_elim);
+		if (lsi == NULL) return (OutOfMemory (thread_num));
+		for (j = 0, sum = 0; j < SIEVE_BENCH_PRIMES; j++) sum += (last = legacy_sieve (lsi));
+		legacy_end_sieve (lsi);
+		end_timer (timers, 0);
+		old_time = timer_value (timers, 0);
+
+		// The new sieve, one prime at a time
+		clear_timer (timers, 0);
+		start_timer (timers, 0);
+		stop_reason = start_sieve_with_limit (thread_num, start, max_elim, &si);
+		if (stop_reason) return (stop_reason);
+		for (j = 0, new_sum = 0; j < SIEVE_BENCH_PRIMES; j++) new_sum += sieve (si);
+		end_timer (timers, 0);
+		new_time = timer_value (timers, 0);
+
+		// The new sieve in batches
+		clear_timer (timers, 0);
+		start_timer (timers, 0);
+		stop_reason = start_sieve_with_limit (thread_num, start, max_elim, &si);
+		if (stop_reason) return (stop_reason);
+		for (count = 0, batch_sum = 0; count < SIEVE_BENCH_PRIMES; ) {
+			unsigned int k, n = sieve_primes (si, last, primes, 4096);
+			for (k = 0; k < n; k++) batch_sum += primes[k];
+			count += n;
+			if (n < 4096) break;
+		}
+		end_sieve (si);
+		end_timer (timers, 0);
+		batch_time = timer_value (timers, 0);
+
+		// The new sieve in parallel segments
+		clear_timer (timers, 0);
+		start_timer (timers, 0);
+		for (j = 0; j < num_threads; j++) {
+			segs[j].thread_num = thread_num;
+			segs[j].start = start + (last - start + 1) / num_threads * j;
+			segs[j].end = (j == num_threads - 1) ? last : start + (last - start + 1) / num_threads * (j + 1) - 1;
+			segs[j].max_elimination_factor = max_elim;
+			gwthread_create_waitable (&threads[j], &sieve_bench_segment_thread, &segs[j]);
+		}
+		for (j = 0, par_count = 0, par_sum = 0, stop_reason = 0; j < num_threads; j++) {
+			gwthread_wait_for_exit (&threads[j]);
+			par_count += segs[j].count;
+			par_sum += segs[j].sum;
+			if (segs[j].stop_reason) stop_reason = segs[j].stop_reason;
+		}
+		if (stop_reason) return (stop_reason);
+		end_timer (timers, 0);
+		par_time = timer_value (timers, 0);
+
+		sprintf (buf, "Start %.0e: original %.1fM, new %.1fM, batch %.1fM, %d threads %.1fM\n", starts[i],
+			 SIEVE_BENCH_PRIMES / old_time / 1.0e6, SIEVE_BENCH_PRIMES / new_time / 1.0e6,
+			 count / batch_time / 1.0e6, num_threads, par_count / par_time / 1.0e6);
+		OutputBoth (thread_num, buf);
+		if (new_sum != sum || batch_sum != sum || count != SIEVE_BENCH_PRIMES || par_sum != sum || par_count != SIEVE_BENCH_PRIMES)
+			OutputBoth (thread_num, "ERROR: sieves returned different primes.\n");
+	}
+	return (0);
+#undef SIEVE_BENCH_PRIMES
+}
+
+/* Time GMP's Jacobi symbol against the giants half GCD Jacobi symbol on a random residue mod 2^p-1.  The exponent defaults */
+/* to 100M, set JacobiBenchExponent in prime.txt to change it.  Both symbols must agree. */
+
+int jacobiBench (
+	int	thread_num)
+{
+	unsigned long p;
+	gmp_randstate_t rstate;
+	mpz_t	a;
+	double	timers[2];
+	char	buf[200];
+	int	gmp_symbol, giants_symbol;
+
+	p = IniGetInt (INI_FILE, "JacobiBenchExponent", 100000000);
+	if (p < 100) p = 100;
+	sprintf (buf, "Jacobi benchmark, M%lu.\n", p);
+	OutputBoth (thread_num, buf);
+
+	mpz_init (a);
+	gmp_randinit_default (rstate);
+	gmp_randseed_ui (rstate, (unsigned long) time (NULL));
+	mpz_urandomb (a, rstate, p - 1);
+	gmp_randclear (rstate);
+
+	clear_timers (timers, sizeof (timers) / sizeof (timers[0]));
+	start_timer (timers, 0);
+	gmp_symbol = jacobi_Mp (a, p, FALSE);
+	end_timer (timers, 0);
+	start_timer (timers, 1);
+	giants_symbol = jacobi_Mp (a, p, TRUE);
+	end_timer (timers, 1);
+	mpz_clear (a);
+
+	sprintf (buf, "GMP: %.3f sec, giants: %.3f sec\n", timer_value (timers, 0), timer_value (timers, 1));
+	OutputBoth (thread_num, buf);
+	if (gmp_symbol != giants_symbol) OutputBoth (thread_num, "ERROR: Jacobi symbols differ.\n");
+	return (0);
+}
+
+/******************/
+/* Debugging code */
+/******************/
+
+int cpuid_dump (
+	int	thread_num)
+{
+	struct cpuid_data reg;
+	unsigned int i, j, max_cpuid_value, max_extended_cpuid_value;
+	char	buf[200];
+#define dumpreg() {sprintf(buf,"i: %08lX, EAX: %08lX, EBX: %08lX, ECX: %08lX, EDX: %08lX\n",(long)i,(long)reg.EAX,(long)reg.EBX,(long)reg.ECX,(long)reg.EDX); OutputBoth(thread_num,buf);}
+
+/* Call CPUID with 0 and 0x80000000 arguments to get how many functions are supported. */
+
+	Cpuid (0, &reg);
+	max_cpuid_value = reg.EAX;
+	Cpuid (0x80000000, &reg);
+	max_extended_cpuid_value = reg.EAX;
+
+/* Dump the regular CPUID data */
+
+	for (i = 0; i <= max_cpuid_value; i++) {
+		for (j = 0; j < 5; j++) {
+			memset (&reg, 0, sizeof (reg));
+			reg.ECX = j;
+			Cpuid (i, &reg);
+			dumpreg ();
+			if (i != 4 && i != 7 && i != 11) break;
+		}
+	}
+
+/* Dump the extended CPUID data */
+
+	for (i = 0x80000000; i <= max_extended_cpuid_value; i++) {
+		for (j = 0; j < 5; j++) {
+			memset (&reg, 0, sizeof (reg));
+			reg.ECX = j;
+			Cpuid (i, &reg);
+			dumpreg ();
+			if (i != 0x8000001D) break;
+		}
+	}
+
+/* Dump the extended GETBV (control registers) data */
+
+	Cpuid (1, &reg);
+	if ((reg.ECX >> 27) & 0x1) {
+		Xgetbv (0, &reg);
+		dumpreg ();
+		if (IniGetInt (INI_FILE, "AdditionalGetBV", 0)) {
+			Xgetbv (IniGetInt (INI_FILE, "AdditionalGetBV", 0), &reg);
+			dumpreg ();
+		}
+	}
+
+	return (0);
+}
+
+/*********************/
+/* Benchmarking code */
+/*********************/
+
+/* Time a few iterations of an LL test on a given exponent */
 
 int primeTime (
 	int	thread_num,
@@ -8681,6 +9749,10 @@ static	int	time_negacyclic = 0;		/* TRUE if we should time negacyclic FFTs */
 			return (primeSieveTest (thread_num));
 		if (p == 9950)
 			return (cpuid_dump (thread_num));
+		if (p == 9952)
+			return (primeSieveBench (thread_num));
+		if (p == 9953)
+			return (jacobiBench (thread_num));
 		if (p == 9951) {
 			time_negacyclic = !time_negacyclic;
 			return (0);
@@ -8745,6 +9817,8 @@ static	int	time_negacyclic = 0;		/* TRUE if we should time negacyclic FFTs */
 				gwinit (&gwdata); 
 				gwset_num_threads (&gwdata, HW_NUM_CORES);
 				gwset_thread_callback (&gwdata, SetAuxThreadPriority);
+				SetGwnumNumaPolicy (&gwdata);
+				SetGwnumTableCache (&gwdata);
 				gwset_thread_callback_data (&gwdata, &sp_info);
 				gwset_use_spin_wait (&gwdata, 1);
 				gwsetup (&gwdata, 1.0, 2, EXP, -1);
@@ -8867,6 +9941,8 @@ static	int	time_negacyclic = 0;		/* TRUE if we should time negacyclic FFTs */
 			if (IniGetInt (INI_FILE, "TimeSpecificFFTImplementations", 0)) lldata.gwdata.bench_pick_nth_fft = p % 100;
 			gwset_num_threads (&lldata.gwdata, get_ranked_num_threads (0, num_cores, num_hyperthreads > 1));
 			gwset_thread_callback (&lldata.gwdata, SetAuxThreadPriority);
+			SetGwnumNumaPolicy (&lldata.gwdata);
+			SetGwnumTableCache (&lldata.gwdata);
 			gwset_thread_callback_data (&lldata.gwdata, &sp_info);
 			gwset_use_spin_wait (&lldata.gwdata, IniGetInt (INI_FILE, "SpinWait", 0));
 			stop_reason = lucasSetup (thread_num, p, time_negacyclic, &lldata);
@@ -9194,6 +10270,8 @@ void primeBenchOneWorker (void *arg)
 	gwinit (&lldata.gwdata);
 	gwset_num_threads (&lldata.gwdata, get_ranked_num_threads (info->core_num, info->core_count, info->hyperthreading));
 	gwset_thread_callback (&lldata.gwdata, SetAuxThreadPriority);
+	SetGwnumNumaPolicy (&lldata.gwdata);
+	SetGwnumTableCache (&lldata.gwdata);
 	gwset_thread_callback_data (&lldata.gwdata, &sp_info);
 	lldata.gwdata.bench_pick_nth_fft = info->impl;
 	stop_reason = lucasSetup (info->main_thread_num, info->fftlen * 17 + 1, info->fftlen + info->plus1, &lldata);
@@ -10063,6 +11141,8 @@ int primeBench (
 		  sp_info.bench_base_core_num = 0;
 		  sp_info.bench_hyperthreading = (hypercpu > 1);
 		  gwset_thread_callback (&lldata.gwdata, SetAuxThreadPriority);
+		  SetGwnumNumaPolicy (&lldata.gwdata);
+		  SetGwnumTableCache (&lldata.gwdata);
 		  gwset_thread_callback_data (&lldata.gwdata, &sp_info);
 		  if (all_bench) lldata.gwdata.bench_pick_nth_fft = impl;
 		  gwset_use_spin_wait (&lldata.gwdata, IniGetInt (INI_FILE, "SpinWait", 0));
@@ -10271,6 +11351,17 @@ struct prp_state {
 	int	num_emergency_allocs;	/* Number of emergency proof residues in memory */
 	char	**emergency_allocs;	/* Array of emergency memory allocs */
 	int	first_emergency_residue_number; /* Residue number of first entry in emergency_allocs */
+	gwmutex	residues_mutex;		/* Protects emergency_allocs, the queue shared with the residue writer thread */
+	gwevent	residues_queued;	/* Signals the residue writer thread that there are residues to write */
+	gwevent	residues_written;	/* Signals the PRP thread that the residue writer finished a write attempt */
+	gwthread residues_writer;	/* Thread id of the residue writer thread */
+	int	residues_writer_active;	/* True if the residue writer thread is running */
+	int	residues_writer_exit;	/* Set to tell the residue writer thread to terminate */
+	int	residues_write_error;	/* True if the residue writer's last write attempt failed */
+	char	*residues_map;		/* Memory-mapped interim residues file (only during proof generation) */
+	int64_t	residues_map_size;	/* Size of the memory-mapped interim residues file */
+	void	*residues_map_handle;	/* OS handle for the memory map */
+	struct prp_async_save *async_save; /* Snapshot and writer thread for asynchronous save files */
 	char	res2048[513];		/* 2048-bit residue at end of PRP test */
 	char	res64[17];		/* 64-bit residue at end of PRP test */
 };
@@ -10298,6 +11389,8 @@ void createProofResiduesFile (
 {
 	int	fd, i, j;
 	uint64_t total_size, randomizer, *p;
+	double	timers[1];
+	int	reserved;
 	char	buf[65536];
 
 // Create the file to hold the interim proof residues
@@ -10311,16 +11404,15 @@ void createProofResiduesFile (
 		return;
 	}
 
-// Prefill the disk space with random data in case some kind of disk compression is being used
+// Preallocate the disk space.  Ask the file system to reserve the space.  If that fails, prefill the disk space with random data
+// in case some kind of disk compression is being used.  PreallocateDisk=2 forces the slow random data method.
 
 	if (prefill) {
 		// Output a message
 		sprintf (buf, "Preallocating disk space for the proof interim residues file %s\n", ps->residues_filename);
 		OutputStr (ps->thread_num, buf);
-
-		// Create a buffer filled with random data
-		srand ((unsigned) time (NULL));
-		for (i = 0; i < sizeof (buf); i++) buf[i] = rand() & 0xFF;
+		clear_timers (timers, 1);
+		start_timer (timers, 0);
 
 		// Calculate how much disk space we need to fill
 		if (!ps->md5_residues)
@@ -10328,8 +11420,15 @@ void createProofResiduesFile (
 		else
 			total_size = (1ULL << ps->proof_power) * (uint64_t) (ps->residue_size + 16);
 
+		// Try the fast method
+		reserved = (prefill != 2 && allocateFileSpace (fd, total_size));
+
+		// Create a buffer filled with random data
+		srand ((unsigned) time (NULL));
+		for (i = 0; i < sizeof (buf); i++) buf[i] = rand() & 0xFF;
+
 		// Write out the random bytes, randomize them some more each time
-		for (i = 0; i < (int) divide_rounding_up (total_size, sizeof (buf)); i++) {
+		if (!reserved) for (i = 0; i < (int) divide_rounding_up (total_size, sizeof (buf)); i++) {
 			if (_write (fd, buf, sizeof (buf)) != sizeof (buf)) {
 				int	num_residues, new_power, new_power_mult;
 				sprintf (buf, "Error preallocating proof interim residues file\n");
@@ -10370,6 +11469,14 @@ void createProofResiduesFile (
 			randomizer = p[i & (sizeof (buf) / 8 - 1)] << 1;
 			for (j = 0; j < sizeof (buf) / 8; j++) *p++ ^= randomizer;
 		}
+
+		// Output how long the startup delay was so that the preallocation methods can be compared
+		end_timer (timers, 0);
+		if (reserved || i == (int) divide_rounding_up (total_size, sizeof (buf))) {
+			sprintf (buf, "Preallocated %.2fGB (%s) in %.3f seconds\n", (double) total_size / 1.0e9,
+				 reserved ? "reserved by the file system" : "filled with random data", timer_value (timers, 0));
+			OutputStr (ps->thread_num, buf);
+		}
 	}
 
 // Close file and return
@@ -10394,6 +11501,162 @@ unsigned long proofResidueIteration (
 	return (result);
 }
 
+/* Write the residues queued in emergency memory to the interim residues file.  Called either from the PRP thread or from the residue writer thread. */
+/* The emergency memory array is the queue of residues waiting to be written.  Only the writer removes entries, only the PRP thread adds entries. */
+
+int writeQueuedProofResidues (		/* Returns TRUE if all queued residues were written */
+	struct prp_state *ps,
+	int	*fd)			/* Open residues file handle or -1 */
+{
+
+/* Open the interim residues file if it is not already open */
+
+	if (*fd < 0) {
+		*fd = _open (ps->residues_filename, _O_BINARY | _O_WRONLY | _O_CREAT, CREATE_FILE_ACCESS);
+		if (*fd < 0) {
+			char	buf[1000];
+			sprintf (buf, "Cannot open PRP proof interim residues file: %s\n", ps->residues_filename);
+			OutputBoth (ps->thread_num, buf);
+			OutputBothErrno (ps->thread_num);
+			OutputStr (ps->thread_num, "Keeping proof interim residues in emergency memory in hopes problem will resolve itself.\n");
+			OutputStr (ps->thread_num, "Errors such as disk full and network disk offline can be temporary.\n");
+			return (FALSE);
+		}
+	}
+
+// Output all the residues we've been saving in memory
+
+	for ( ; ; ) {
+		char	*residue;
+		int	file_residue_number;
+
+		// Get the first queued residue.  Convert its residue number to a zero-based residue number located in the file.
+		// Proof power multiplier reduces the number of residues written.
+		gwmutex_lock (&ps->residues_mutex);
+		if (ps->num_emergency_allocs == 0) {
+			gwmutex_unlock (&ps->residues_mutex);
+			break;
+		}
+		residue = ps->emergency_allocs[0];
+		file_residue_number = ps->first_emergency_residue_number - 1;
+		file_residue_number &= (1 << ps->proof_power) - 1;
+		gwmutex_unlock (&ps->residues_mutex);
+
+		// Write residue to the file
+		if (!ps->md5_residues) {		// Version 30.1 and 30.2
+			if (_lseeki64 (*fd, (int64_t) file_residue_number * (int64_t) ps->residue_size, SEEK_SET) < 0 ||
+			    _write (*fd, residue, ps->residue_size) != ps->residue_size) goto write_error;
+		}
+
+		// Write MD5(residue) and residue to the file
+		else {
+			unsigned char MD5[16];
+			md5_digest_buffer (MD5, residue, ps->residue_size);
+			if (_lseeki64 (*fd, (int64_t) file_residue_number * (int64_t) (ps->residue_size + 16), SEEK_SET) < 0 ||
+			    _write (*fd, MD5, 16) != 16 ||
+			    _write (*fd, residue, ps->residue_size) != ps->residue_size) goto write_error;
+// BUG - read md5 and data and compare?  reopen file beforehand?  
+		}
+
+		// Free memory, shuffle the emergency array down
+		gwmutex_lock (&ps->residues_mutex);
+		free (ps->emergency_allocs[0]);
+		ps->num_emergency_allocs--;
+		memmove (ps->emergency_allocs, ps->emergency_allocs + 1, ps->num_emergency_allocs * sizeof (char *));
+		ps->first_emergency_residue_number++;
+		gwmutex_unlock (&ps->residues_mutex);
+	}
+	return (TRUE);
+
+// Keep residue in emergency memory.  Close the file so that the next attempt reopens it.
+
+write_error:
+	{
+		char	buf[1000];
+		sprintf (buf, "Error writing to PRP proof interim residues file: %s\n", ps->residues_filename);
+		OutputBoth (ps->thread_num, buf);
+		OutputBothErrno (ps->thread_num);
+		OutputStr (ps->thread_num, "Keeping proof interim residues in emergency memory in hopes problem will resolve itself.\n");
+		OutputStr (ps->thread_num, "Errors such as disk full and network disk offline can be temporary.\n");
+	}
+	_close (*fd);
+	*fd = -1;
+	return (FALSE);
+}
+
+/* The residue writer thread.  Writes queued interim residues so that the PRP thread never waits on disk I/O.  Keeps the residues file open. */
+
+void proofResiduesWriter (void *arg)
+{
+	struct prp_state *ps = (struct prp_state *) arg;
+	int	fd = -1;
+
+	for ( ; ; ) {
+		// Wait for residues to write.  After a write error, retry every minute.
+		gwevent_wait (&ps->residues_queued, ps->residues_write_error ? 60 : 0);
+		gwevent_reset (&ps->residues_queued);
+
+		// Write all queued residues, tell PRP thread we made progress
+		ps->residues_write_error = !writeQueuedProofResidues (ps, &fd);
+		gwevent_signal (&ps->residues_written);
+
+		// Exit when asked to
+		if (ps->residues_writer_exit) break;
+	}
+	if (fd >= 0) _close (fd);
+}
+
+/* Start the residue writer thread */
+
+void startProofResiduesWriter (
+	struct prp_state *ps)
+{
+	if (ps->residues_writer_active || !ps->proof_power) return;
+	if (!IniGetInt (INI_FILE, "ProofResiduesWriterThread", 1)) return;
+	gwmutex_init (&ps->residues_mutex);
+	gwevent_init (&ps->residues_queued);
+	gwevent_init (&ps->residues_written);
+	ps->residues_writer_exit = FALSE;
+	ps->residues_write_error = FALSE;
+	gwthread_create_waitable (&ps->residues_writer, &proofResiduesWriter, (void *) ps);
+	ps->residues_writer_active = TRUE;
+}
+
+/* Stop the residue writer thread.  The writer makes one last attempt to write any queued residues. */
+
+void stopProofResiduesWriter (
+	struct prp_state *ps)
+{
+	if (!ps->residues_writer_active) return;
+	ps->residues_writer_exit = TRUE;
+	gwevent_signal (&ps->residues_queued);
+	gwthread_wait_for_exit (&ps->residues_writer);
+	gwmutex_destroy (&ps->residues_mutex);
+	gwevent_destroy (&ps->residues_queued);
+	gwevent_destroy (&ps->residues_written);
+	ps->residues_writer_active = FALSE;
+}
+
+/* Wait for the residue writer thread to empty the queue.  Gives up if the writer reports a write error. */
+
+void flushProofResidues (
+	struct prp_state *ps)
+{
+	if (!ps->residues_writer_active) {
+		int	fd = -1;
+		writeQueuedProofResidues (ps, &fd);
+		if (fd >= 0) _close (fd);
+		return;
+	}
+	ps->residues_write_error = FALSE;
+	for ( ; ; ) {
+		gwevent_reset (&ps->residues_written);
+		gwevent_signal (&ps->residues_queued);
+		gwevent_wait (&ps->residues_written, 0);
+		if (ps->num_emergency_allocs == 0 || ps->residues_write_error) break;
+	}
+}
+
 /* Output one of the PRP Proof intermediate residues */
 
 void outputProofResidue (
@@ -10402,17 +11665,17 @@ void outputProofResidue (
 	int	residue_number,			/* Can be zero to indicate output emergency residues sitting in memory */
 	giant	g)				/* Can be NULL to indicate output emergency residues sitting in memory */
 {
-	int	i, fd;
+	int	i;
 
 /* If a new residue was passed in, allocate buffer and convert from giant to zero-padded binary */
 
 	if (residue_number) {
 		char	*buf, *p;
 
-/* If we are out of emergency memory, make one last try at writing residues to disk */
+/* If we are out of emergency memory, wait for the writer to make one last try at writing residues to disk */
 
 		if (ps->num_emergency_allocs == ps->max_emergency_allocs) {
-			outputProofResidue (gwdata, ps, 0, NULL);
+			flushProofResidues (ps);
 			if (ps->num_emergency_allocs == ps->max_emergency_allocs) {
 				OutputBoth (ps->thread_num, "No more emergency memory is available to hold interim proof residues.\n");
 				goto abort_proof;
@@ -10426,8 +11689,6 @@ void outputProofResidue (
 			OutputStr (ps->thread_num, "Emergency memory allocation error.\n");
 			goto abort_proof;
 		}
-		ps->emergency_allocs[ps->num_emergency_allocs++] = buf;
-		if (ps->num_emergency_allocs == 1) ps->first_emergency_residue_number = residue_number;
 
 // Format giant as a little-Endian zero-padded fixed size number of bytes
 
@@ -10438,6 +11699,20 @@ void outputProofResidue (
 			p[2] = (g->n[i] >> 16) & 0xFF;
 			p[3] = (g->n[i] >> 24) & 0xFF;
 		}
+
+// Queue the residue
+
+		gwmutex_lock (&ps->residues_mutex);
+		ps->emergency_allocs[ps->num_emergency_allocs++] = buf;
+		if (ps->num_emergency_allocs == 1) ps->first_emergency_residue_number = residue_number;
+		gwmutex_unlock (&ps->residues_mutex);
+
+// Wake the writer thread.  It will write the residue while we continue squaring.
+
+		if (ps->residues_writer_active) {
+			gwevent_signal (&ps->residues_queued);
+			return;
+		}
 	}
 
 /* If there are no residues to write, we are done */
@@ -10448,69 +11723,7 @@ void outputProofResidue (
 /* If an error occurs, we'll keep the residue in emergency memory and hope */
 /* the disk full error or network disk offline error resolves itself */
 
-	fd = _open (ps->residues_filename, _O_BINARY | _O_WRONLY | _O_CREAT, CREATE_FILE_ACCESS);
-	if (fd < 0) {
-		char	buf[1000];
-		sprintf (buf, "Cannot open PRP proof interim residues file: %s\n", ps->residues_filename);
-		OutputBoth (ps->thread_num, buf);
-		OutputBothErrno (ps->thread_num);
-		OutputStr (ps->thread_num, "Keeping proof interim residues in emergency memory in hopes problem will resolve itself.\n");
-		OutputStr (ps->thread_num, "Errors such as disk full and network disk offline can be temporary.\n");
-		return;
-	}
-
-// Output all the residues we've been saving in memory
-
-	while (ps->num_emergency_allocs) {
-		int	file_residue_number;
-
-		// Convert passed in residue number to a zero-based residue number located in the file.
-		// Proof power multiplier reduces the number of residues written.
-		file_residue_number = ps->first_emergency_residue_number - 1;
-		file_residue_number &= (1 << ps->proof_power) - 1;
-
-		// Write residue to the file
-		if (!ps->md5_residues) {		// Version 30.1 and 30.2
-			if (_lseeki64 (fd, (int64_t) file_residue_number * (int64_t) ps->residue_size, SEEK_SET) < 0 ||
-			    _write (fd, ps->emergency_allocs[0], ps->residue_size) != ps->residue_size) {
-				char	buf[1000];
-				sprintf (buf, "Error writing to PRP proof interim residues file: %s\n", ps->residues_filename);
-				OutputBoth (ps->thread_num, buf);
-				OutputBothErrno (ps->thread_num);
-				OutputStr (ps->thread_num, "Keeping proof interim residues in emergency memory in hopes problem will resolve itself.\n");
-				OutputStr (ps->thread_num, "Errors such as disk full and network disk offline can be temporary.\n");
-				break;
-			}
-		}
-
-		// Write MD5(residue) and residue to the file
-		else {
-			unsigned char MD5[16];
-			md5_digest_buffer (MD5, ps->emergency_allocs[0], ps->residue_size);
-			if (_lseeki64 (fd, (int64_t) file_residue_number * (int64_t) (ps->residue_size + 16), SEEK_SET) < 0 ||
-			    _write (fd, MD5, 16) != 16 ||
-			    _write (fd, ps->emergency_allocs[0], ps->residue_size) != ps->residue_size) {
-				char	buf[1000];
-				sprintf (buf, "Error writing to PRP proof interim residues file: %s\n", ps->residues_filename);
-				OutputBoth (ps->thread_num, buf);
-				OutputBothErrno (ps->thread_num);
-				OutputStr (ps->thread_num, "Keeping proof interim residues in emergency memory in hopes problem will resolve itself.\n");
-				OutputStr (ps->thread_num, "Errors such as disk full and network disk offline can be temporary.\n");
-				break;
-			}
-// BUG - read md5 and data and compare?  reopen file beforehand?  
-		}
-
-		// Free memory, shuffle the emergency array down
-		free (ps->emergency_allocs[0]);
-		ps->num_emergency_allocs--;
-		memmove (ps->emergency_allocs, ps->emergency_allocs + 1, ps->num_emergency_allocs * sizeof (char *));
-		ps->first_emergency_residue_number++;
-	}
-
-// All done
-
-	_close (fd);
+	flushProofResidues (ps);
 	return;
 
 // We've held residues in emergency memory for as long as we can.  The errors writing interim residues to disk have not gone away.
@@ -10518,6 +11731,7 @@ void outputProofResidue (
 
 abort_proof:
 	OutputBoth (ps->thread_num, "Aborting PRP proof.\n");
+	stopProofResiduesWriter (ps);
 	for (i = 0; i < ps->num_emergency_allocs; i++) free (ps->emergency_allocs[i]);
 	ps->num_emergency_allocs = 0;
 	_unlink (ps->residues_filename);
@@ -10540,6 +11754,26 @@ int readResidue (			/* Returns TRUE if successful, FALSE for failure that might
 
 	// Allocate an array for binary value
 	arraylen = divide_rounding_up (ps->residue_size, 4);
+
+	// If the residues file is memory-mapped and the residue is a whole number of 32-bit words, then on little-endian machines
+	// we can convert the residue straight from the file's pages
+	if (ps->residues_map != NULL && ps->md5_residues && (ps->residue_size & 3) == 0 &&
+	    !(ps->num_emergency_allocs && residue_number >= ps->first_emergency_residue_number)) {
+		unsigned char actual_MD5[16];	/* Actual MD5 hash of the residue */
+		char	*p = ps->residues_map + ((int64_t) residue_number - 1) * (int64_t) (ps->residue_size + 16);
+		if ((int64_t) residue_number * (int64_t) (ps->residue_size + 16) > ps->residues_map_size) {
+			OutputBoth (ps->thread_num, "Error reading PRP proof interim residues file.\n");
+			return (FALSE);
+		}
+		md5_digest_buffer (actual_MD5, p + 16, ps->residue_size);
+		if (memcmp (p, actual_MD5, 16) != 0) {
+			OutputBoth (ps->thread_num, "MD5 error reading PRP proof interim residues file.\n");
+			return (-1);
+		}
+		binarytogw (gwdata, (uint32_t *) (p + 16), arraylen, x);
+		return (TRUE);
+	}
+
 	array = (uint32_t *) malloc (arraylen * sizeof(uint32_t));
 	if (array == NULL) {
 		OutputBoth (ps->thread_num, "Error allocating memory for reading PRP proof interim residue.\n");
@@ -10563,6 +11797,17 @@ int readResidue (			/* Returns TRUE if successful, FALSE for failure that might
 				return (FALSE);
 			}
 		}
+		else if (ps->residues_map != NULL && (int64_t) residue_number * (int64_t) (ps->residue_size + 16) <= ps->residues_map_size) {
+			unsigned char actual_MD5[16];	/* Actual MD5 hash of the residue */
+			char	*p = ps->residues_map + ((int64_t) residue_number - 1) * (int64_t) (ps->residue_size + 16);
+			memcpy (array, p + 16, ps->residue_size);
+			md5_digest_buffer (actual_MD5, array, ps->residue_size);
+			if (memcmp (p, actual_MD5, 16) != 0) {
+				OutputBoth (ps->thread_num, "MD5 error reading PRP proof interim residues file.\n");
+				free (array);
+				return (-1);
+			}
+		}
 		else {
 			unsigned char expected_MD5[16];	/* Expected MD5 hash of the residue */
 			unsigned char actual_MD5[16];	/* Actual MD5 hash of the residue */
@@ -10755,6 +12000,172 @@ err:	gwfree (gwdata, tmp);
 
 #endif
 
+// Multithreaded version of calc_middle.  The recursive calc_middle does one exponentiate after another using gwnum's FFT threads.  For large proof powers
+// that is a lot of 64-bit exponentiations that each only scale as well as a single FFT does.  Instead, we read a window of residues and combine pairs
+// of residues at the bottom levels of the tree in parallel, each polymult helper thread using its own cloned gwdata.  The completed window subtrees are
+// kept on a small stack until their sibling is available.  These few top-of-tree combines use the main gwdata with all its FFT threads.
+// The window and stack gwnums are allocated once and reused for every middle value in the proof.
+
+struct proof_builder {
+	struct prp_state *ps;		// PRP state (for error messages and residue reading)
+	pmhandle pmdata;		// Polymult handle -- we borrow its helper threads
+	int	num_threads;		// Number of threads combining pairs of residues
+	int	max_window_size;	// Maximum number of residues read into memory at one time (a power of two)
+	gwnum	*window;		// Residues read from the interim residues file
+	gwnum	stack[20];		// Completed subtrees waiting for their right sibling to be computed
+	// Arguments to the current pass of pair combines
+	uint64_t hash;			// Hash to raise the left residue of each pair
+	int	stride;			// Distance between left and right residue of each pair in the window
+	int	num_pairs;		// Number of pairs to combine in this pass
+};
+
+void proof_builder_helper (
+	int	helper_num,		// 0 = main thread, 1+ = helper thread num
+	gwhandle *gwdata,		// Single-threaded, thread-safe gwdata (probably cloned) to use
+	void	*info)
+{
+	struct proof_builder *pb = (struct proof_builder *) info;
+
+	for ( ; ; ) {
+		int	j = (int) atomic_fetch_incr (pb->pmdata.helper_counter);
+		if (j >= pb->num_pairs) break;
+		exponentiate (gwdata, pb->window[2*j*pb->stride], pb->hash);
+		gwmul (gwdata, pb->window[(2*j+1)*pb->stride], pb->window[2*j*pb->stride]);
+	}
+}
+
+void proof_builder_done (
+	gwhandle *gwdata,
+	struct proof_builder *pb)
+{
+	int	i;
+
+	if (pb->pmdata.gwdata != NULL) polymult_done (&pb->pmdata);
+	if (pb->window != NULL) {
+		for (i = 0; i < pb->max_window_size; i++) gwfree (gwdata, pb->window[i]);
+		free (pb->window);
+		pb->window = NULL;
+	}
+	for (i = 0; i < 20; i++) gwfree (gwdata, pb->stack[i]), pb->stack[i] = NULL;
+}
+
+int proof_builder_init (		/* Returns TRUE if the multithreaded proof builder is ready for use */
+	gwhandle *gwdata,
+	struct prp_state *ps,
+	struct proof_builder *pb)
+{
+	int	i, max_gwnums;
+
+	memset (pb, 0, sizeof (struct proof_builder));
+	pb->ps = ps;
+
+// Multithreading is only possible if the gwdata has more than one thread
+
+	pb->num_threads = IniGetInt (INI_FILE, "ProofgenThreads", gwget_num_threads (gwdata));
+	if (pb->num_threads > (int) gwget_num_threads (gwdata)) pb->num_threads = gwget_num_threads (gwdata);
+	if (pb->num_threads <= 1) return (FALSE);
+
+// Compute the window size from the cap on resident gwnums.  Each thread needs four temporaries to exponentiate, we need a stack entry for each
+// level of the proof tree above the window, and one gwnum for the middle value.  Make the window at least two pairs per thread if the cap allows.
+
+	max_gwnums = IniGetInt (INI_FILE, "ProofgenMaxGwnums", 6 * pb->num_threads + 20);
+	for (pb->max_window_size = 1; pb->max_window_size < 4 * pb->num_threads && pb->max_window_size < (1 << (ps->proof_power - 1)); pb->max_window_size *= 2) {
+		int	next_size = pb->max_window_size * 2;
+		int	threads = (pb->num_threads < next_size / 2) ? pb->num_threads : next_size / 2;
+		if (next_size + threads * 4 + ps->proof_power + 1 > max_gwnums) break;
+	}
+	if (pb->max_window_size < 4) return (FALSE);
+	if (pb->num_threads > pb->max_window_size / 2) pb->num_threads = pb->max_window_size / 2;
+
+// Allocate the window
+
+	pb->window = (gwnum *) calloc (pb->max_window_size, sizeof (gwnum));
+	if (pb->window == NULL) return (FALSE);
+	for (i = 0; i < pb->max_window_size; i++) {
+		pb->window[i] = gwalloc (gwdata);
+		if (pb->window[i] == NULL) {
+			OutputStr (ps->thread_num, "Not enough memory for multithreaded proof generation.\n");
+			proof_builder_done (gwdata, pb);
+			return (FALSE);
+		}
+	}
+
+// Prepare the polymult helper threads
+
+	polymult_init (&pb->pmdata, gwdata);
+	polymult_set_max_num_threads (&pb->pmdata, pb->num_threads);
+	pb->pmdata.helper_callback = &proof_builder_helper;
+	pb->pmdata.helper_callback_data = pb;
+	return (TRUE);
+}
+
+int calc_middle_parallel (		/* Returns TRUE if successful, FALSE for failure that might "get better", -1 for failures that won't "get better" */
+	struct proof_builder *pb,
+	gwhandle *gwdata,
+	int	fd,			// File handle to array of residues
+	int	level,			// Process 2^level values
+	uint64_t *hash_array,		// Array of hashes
+	gwnum	result)			// Return result here
+{
+	struct prp_state *ps = pb->ps;
+	int	num_leaves, leaf_spacing, window_size, log2_window_size, first_leaf, i, t, rc;
+
+	num_leaves = 1 << level;
+	leaf_spacing = (1 << ps->proof_power) >> level;
+	window_size = (pb->max_window_size < num_leaves) ? pb->max_window_size : num_leaves;
+	for (log2_window_size = 0; (1 << log2_window_size) < window_size; log2_window_size++);
+
+	for (first_leaf = 0; first_leaf < num_leaves; first_leaf += window_size) {
+		int	depth, subtree_number;
+		gwnum	subtree;
+
+		// Read the next window of residues
+		for (i = 0; i < window_size; i++) {
+			rc = readResidue (ps, gwdata, fd, (first_leaf + i) * leaf_spacing + leaf_spacing / 2, pb->window[i]);
+			if (rc <= 0) return (rc);
+		}
+
+		// Combine pairs from the bottom of the tree up.  The pairs in each pass are independent, spread them across the helper threads.
+		for (t = 0; t < log2_window_size; t++) {
+			pb->hash = hash_array[level - 1 - t];
+			pb->stride = 1 << t;
+			pb->num_pairs = window_size >> (t + 1);
+			if (pb->num_pairs > 1) polymult_launch_helpers (&pb->pmdata);
+			else {
+				atomic_set (pb->pmdata.helper_counter, 0);
+				proof_builder_helper (0, gwdata, pb);
+			}
+		}
+
+		// Combine the window's subtree with completed left siblings on the stack
+		subtree = pb->window[0];
+		subtree_number = first_leaf / window_size;
+		for (depth = level - log2_window_size - 1; depth >= 0 && (subtree_number & 1); depth--, subtree_number >>= 1) {
+			exponentiate (gwdata, pb->stack[depth], hash_array[depth]);
+			gwmul (gwdata, subtree, pb->stack[depth]);
+			gwswap (pb->stack[depth], subtree);
+		}
+
+		// Either we have the final result or we push the subtree on the stack.  The window's first gwnum gets whatever buffer the stack had.
+		if (depth < 0) {
+			gwcopy (gwdata, subtree, result);
+			pb->window[0] = subtree;
+		} else {
+			pb->window[0] = pb->stack[depth];
+			pb->stack[depth] = subtree;
+			if (pb->window[0] == NULL) {
+				pb->window[0] = gwalloc (gwdata);
+				if (pb->window[0] == NULL) {
+					OutputBoth (ps->thread_num, "Error allocating memory for proof hash multiplications.\n");
+					return (FALSE);
+				}
+			}
+		}
+	}
+
+	return (TRUE);
+}
+
 /* Generate the PRP proof file */
 
 int generateProofFile (
@@ -10780,6 +12191,10 @@ int generateProofFile (
 //		M1 = residue[topK/4]^h0 * residue[3*topK/4].
 //		M2 = r[topK/8]^(h1*h0) * r[3*topK/8]^h0 * r[5*topK/8]^h1 * r[7*topK/8], etc.
 
+// Wait for the residue writer thread to finish writing all interim residues.  Proof generation reads the residues file directly.
+
+	stopProofResiduesWriter (ps);
+
 // Get the maximum number of 5 minute waits trying to generate the proof file.
 // We must store the current counter in the INI file when our loop is interrupted by a stop_reason.
 // Otherwise, an infinite loop could occur with the wait counter reset after each interruprion.
@@ -10808,6 +12223,8 @@ int generateProofFile (
 		uint64_t h[20];
 		hash256_t rooth, *prevh, thish;
 		gwnum	M;
+		struct proof_builder pb;
+		int	use_builder;
 		MD5_CTX context;
 		unsigned char digest[16];
 		char	MD5_output[33];
@@ -10817,6 +12234,7 @@ int generateProofFile (
 		fd = -1;
 		fdout = -1;
 		MD5Init (&context);
+		memset (&pb, 0, sizeof (pb));
 		M = gwalloc (gwdata);
 		if (M == NULL) {
 			OutputBoth (ps->thread_num, "Error allocating proof memory\n");
@@ -10824,6 +12242,14 @@ int generateProofFile (
 		}
 		gwfree_internal_memory (gwdata);
 
+// Prepare the multithreaded proof builder
+
+		use_builder = proof_builder_init (gwdata, ps, &pb);
+		if (use_builder) {
+			sprintf (buf, "Using %d threads to combine up to %d proof residues at a time\n", pb.num_threads, pb.max_window_size);
+			OutputStr (ps->thread_num, buf);
+		}
+
 // Open the PRP residues file unless all residues are in emergency memory, create or open the PRP proof file
 
 		if (ps->num_emergency_allocs == 0 || ps->first_emergency_residue_number != 1) {
@@ -10834,6 +12260,11 @@ int generateProofFile (
 				OutputBothErrno (ps->thread_num);
 				goto pfail;
 			}
+			// Memory map the residues file so that residues can be read without a seek and read for each residue
+			if (ps->md5_residues && IniGetInt (INI_FILE, "ProofResiduesMmap", 1)) {
+				ps->residues_map_size = _lseeki64 (fd, 0, SEEK_END);
+				ps->residues_map = (char *) mapFileForReading (fd, ps->residues_map_size, &ps->residues_map_handle);
+			}
 		}
 		if (proof_number == 1) fdout = _open (tmp_proof_filename, _O_BINARY | _O_WRONLY | _O_CREAT, CREATE_FILE_ACCESS);
 		else fdout = _open (tmp_proof_filename, _O_BINARY | _O_WRONLY);
@@ -10902,8 +12333,10 @@ int generateProofFile (
 
 		// If this proof has already been completely written to the proof file, then we don't need to write this full or partial proof
 		if (proofs_written >= proof_number) {
+			unmapFile (ps->residues_map, ps->residues_map_size, ps->residues_map_handle), ps->residues_map = NULL;
 			_close (fd);
 			_close (fdout);
+			proof_builder_done (gwdata, &pb);
 			gwfree (gwdata, M);
 			sprintf (buf, "Proof has already been written to %s.\n", tmp_proof_filename);
 			OutputBoth (ps->thread_num, buf);
@@ -10962,7 +12395,8 @@ int generateProofFile (
 			h[i] = truncate_hash (thish, ps->hashlen);
 			sprintf (buf, "hash%d = %016" PRIX64 "\n", i, h[i]);
 			OutputStr (ps->thread_num, buf);
-			rc = calc_middle (ps, gwdata, fd, 0, 1 << ps->proof_power, i + 1, h, M);
+			if (use_builder) rc = calc_middle_parallel (&pb, gwdata, fd, i + 1, h, M);
+			else rc = calc_middle (ps, gwdata, fd, 0, 1 << ps->proof_power, i + 1, h, M);
 			if (rc < 0) goto pfail_wont_get_better;
 			if (!rc) goto pfail;
 			if (!writeResidue (ps, gwdata, fdout, M, &context)) goto pfail;
@@ -10972,8 +12406,10 @@ int generateProofFile (
 
 // Close input and output files, free memory
 
+		unmapFile (ps->residues_map, ps->residues_map_size, ps->residues_map_handle), ps->residues_map = NULL;
 		if (fd >= 0) _close (fd), fd = -1;
 		if (fdout >= 0) _close (fdout), fdout = -1;
+		proof_builder_done (gwdata, &pb);
 		gwfree (gwdata, M); M = NULL;
 
 // Check if an error occurred before publishing our proof
@@ -11010,12 +12446,14 @@ int generateProofFile (
 
 pfail_wont_get_better:
 		if (proofgen_waits > 2) proofgen_waits = 2;
-pfail:		if (fd >= 0) _close (fd);
+pfail:		unmapFile (ps->residues_map, ps->residues_map_size, ps->residues_map_handle), ps->residues_map = NULL;
+		if (fd >= 0) _close (fd);
 		if (fdout >= 0) {
 			_chsize_s (fdout, proof_file_start_offset);
 			_close (fdout);
 			if (proof_file_start_offset == 0) _unlink (tmp_proof_filename);
 		}
+		proof_builder_done (gwdata, &pb);
 		if (M != NULL) gwfree (gwdata, M);
 
 // Test 5 minute counter.  We hope that errors are due to a disk full or disk offline situation, which could resolve itself
@@ -11220,6 +12658,141 @@ err:	deleteWriteSaveFile (write_save_file_state, fd);
 	return (FALSE);
 }
 
+/* Asynchronous PRP save files.  Writing a save file converts each gwnum to a giant, checksums it, and flushes it to disk, all on the */
+/* PRP thread while the FFT helper threads sit idle.  Instead, snapshot the gwnums using the multithreaded gwcopy and let a writer thread */
+/* do the rest using a cloned gwdata.  The writer thread owns the writeSaveFileState until finishAsyncPRPSave is called. */
+
+struct prp_async_save {
+	gwhandle clone;			/* Clone of the PRP gwdata used by the writer thread */
+	int	clone_initialized;	/* TRUE if clone needs a gwdone */
+	gwnum	snap[4];		/* Snapshots of x, alt_x, u0, d */
+	writeSaveFileState *write_save_file_state; /* Save file names and rename chain */
+	struct work_unit w;		/* Copy of the work unit */
+	struct prp_state ps;		/* Copy of the PRP state with its gwnums pointing at the snapshots */
+	int	special;		/* TRUE if the save file is to be marked highly reliable */
+	gwthread writer;		/* Thread id of the writer thread */
+	int	writer_active;		/* TRUE if the writer thread is running */
+};
+
+/* The save file writer thread */
+
+void asyncPRPSaveWriter (void *arg)
+{
+	struct prp_async_save *as = (struct prp_async_save *) arg;
+
+	if (writePRPSaveFile (&as->clone, as->write_save_file_state, &as->w, &as->ps)) {
+		if (as->special) setWriteSaveFileSpecial (as->write_save_file_state);
+	}
+}
+
+/* Wait for the save file writer thread to finish */
+
+void finishAsyncPRPSave (
+	struct prp_state *ps)
+{
+	if (ps->async_save == NULL || !ps->async_save->writer_active) return;
+	gwthread_wait_for_exit (&ps->async_save->writer);
+	ps->async_save->writer_active = FALSE;
+}
+
+/* Wait for the writer thread, then free the snapshots and cloned gwdata.  Must be called before the PRP gwdata is freed. */
+
+void freeAsyncPRPSave (
+	struct prp_state *ps)
+{
+	struct prp_async_save *as = ps->async_save;
+	int	i;
+
+	if (as == NULL) return;
+	finishAsyncPRPSave (ps);
+	if (as->clone_initialized) {
+		for (i = 0; i < 4; i++) if (as->snap[i] != NULL) gwfree (&as->clone, as->snap[i]);
+		gwdone (&as->clone);
+	}
+	free (as);
+	ps->async_save = NULL;
+}
+
+/* Snapshot the PRP state and start a writer thread to create the save file.  Returns FALSE if the caller must write the save file itself. */
+
+int startAsyncPRPSave (
+	gwhandle *gwdata,
+	writeSaveFileState *write_save_file_state,
+	struct work_unit *w,
+	struct prp_state *ps,
+	int	special)		/* TRUE if save file should be marked highly reliable */
+{
+	struct prp_async_save *as;
+	gwnum	*live[4];
+	int	i;
+
+/* The previous save file must be complete before we touch the save file state again */
+
+	finishAsyncPRPSave (ps);
+
+/* Write synchronously if the user turned this feature off or if this is an MMGW general mod gwdata (clones do not support */
+/* the cyclic/negacyclic pair) */
+
+	if (!IniGetInt (INI_FILE, "AsyncSaveFiles", 1)) return (FALSE);
+	if (gwdata->GENERAL_MMGW_MOD) return (FALSE);
+
+/* Proof residues briefly held in memory are normally waiting on the proof residue writer thread.  Flush them to disk.  Should they */
+/* stay in memory (a write error), let writePRPSaveFile report why no save file is written. */
+
+	if (ps->num_emergency_allocs) {
+		outputProofResidue (gwdata, ps, 0, NULL);
+		if (ps->num_emergency_allocs) return (FALSE);
+	}
+
+/* Allocate the clone and snapshots the first time through */
+
+	as = ps->async_save;
+	if (as == NULL) {
+		as = (struct prp_async_save *) malloc (sizeof (struct prp_async_save));
+		if (as == NULL) return (FALSE);
+		memset (as, 0, sizeof (struct prp_async_save));
+		ps->async_save = as;
+		if (gwclone (&as->clone, gwdata)) {
+			freeAsyncPRPSave (ps);
+			return (FALSE);
+		}
+		as->clone_initialized = TRUE;
+	}
+
+/* Snapshot the gwnums using gwcopy, which uses all the worker's threads */
+
+	live[0] = &ps->x;
+	live[1] = &ps->alt_x;
+	live[2] = &ps->u0;
+	live[3] = &ps->d;
+	for (i = 0; i < 4; i++) {
+		if (*live[i] == NULL) continue;
+		if (as->snap[i] == NULL) {
+			as->snap[i] = gwalloc (gwdata);
+			if (as->snap[i] == NULL) {
+				freeAsyncPRPSave (ps);
+				return (FALSE);
+			}
+		}
+		gwcopy (gwdata, *live[i], as->snap[i]);
+	}
+
+/* Copy the rest of the state and start the writer thread */
+
+	as->write_save_file_state = write_save_file_state;
+	as->w = *w;
+	as->ps = *ps;
+	as->ps.x = as->snap[0];
+	as->ps.alt_x = as->snap[1];
+	as->ps.u0 = as->snap[2];
+	as->ps.d = as->snap[3];
+	as->ps.async_save = NULL;
+	as->special = special;
+	gwthread_create_waitable (&as->writer, &asyncPRPSaveWriter, (void *) as);
+	as->writer_active = TRUE;
+	return (TRUE);
+}
+
 /* Read the data portion of an intermediate PRP save file */
 
 int readPRPSaveFile (
@@ -11837,6 +13410,8 @@ begin:	N = exp = NULL;
 	else gwset_will_error_check_near_limit (&gwdata);
 	gwset_num_threads (&gwdata, get_worker_num_threads (thread_num, HYPERTHREAD_LL));
 	gwset_thread_callback (&gwdata, SetAuxThreadPriority);
+	SetGwnumNumaPolicy (&gwdata);
+	SetGwnumTableCache (&gwdata);
 	gwset_thread_callback_data (&gwdata, sp_info);
 	gwset_minimum_fftlen (&gwdata, w->minimum_fftlen);
 	gwset_safety_margin (&gwdata, IniGetFloat (INI_FILE, "ExtraSafetyMargin", 0.0));
@@ -12095,6 +13670,10 @@ begin:	N = exp = NULL;
 			}
 			break;
 		}
+
+// Start the thread that writes interim residues to disk so that squaring never waits on disk I/O
+
+		startProofResiduesWriter (&ps);
 	}
 
 /* Calculate the exponent we will use to do our left-to-right binary exponentiation */
@@ -12863,6 +14442,7 @@ OutputStr (thread_num, "Iteration failed.\n");
 			int proof_number = (ps.counter - initiallog2k_iters) / ps.proof_num_iters;
 			stop_reason = generateProofFile (&gwdata, &ps, w, proof_number, proof_hash);
 			if (stop_reason) goto exit;
+			startProofResiduesWriter (&ps);
 			initial_nonproof_iters += ps.proof_num_iters;
 			proof_next_interim_residue = 1;
 			proof_next_interim_residue_iter = proofResidueIteration (&ps, proof_next_interim_residue);
@@ -12870,7 +14450,7 @@ OutputStr (thread_num, "Iteration failed.\n");
 
 /* Write results to a file every DISK_WRITE_TIME minutes */
 
-		if (saving) {
+		if (saving && !startAsyncPRPSave (&gwdata, &write_save_file_state, w, &ps, saving_highly_reliable)) {
 			if (writePRPSaveFile (&gwdata, &write_save_file_state, w, &ps)) {
 				// Mark save files that contain verified computations.  This will keep the save file
 				// for a longer period of time (i.e. will not be replaced by a save file that does
@@ -13129,6 +14709,7 @@ pushg(&gwdata.gdata, 2);}
 
 /* Delete the continuation files. */
 
+	freeAsyncPRPSave (&ps);
 	unlinkSaveFiles (&write_save_file_state);
 
 /* If this is a PRP-CF test auto-generated by a newly found ECM test, then the next worktodo entry could be doing more ECM.  This would be pointless! */
@@ -13154,7 +14735,9 @@ pushg(&gwdata.gdata, 2);}
 
 /* Cleanup and exit */
 
-exit:	gwdone (&gwdata);
+exit:	stopProofResiduesWriter (&ps);
+	freeAsyncPRPSave (&ps);
+	gwdone (&gwdata);
 	free (N);
 	free (exp);
 	for (i = 0; i < ps.num_emergency_allocs; i++) free (ps.emergency_allocs[i]);
@@ -13166,6 +14749,8 @@ exit:	gwdone (&gwdata);
 
 restart:if (sleep5) OutputBoth (thread_num, ERRMSG2);
 	OutputBoth (thread_num, ERRMSG3);
+	stopProofResiduesWriter (&ps);
+	freeAsyncPRPSave (&ps);
 
 /* Save the incremented error count to be used in the restart rather than the error count read from a save file */
 
@@ -13191,3 +14776,4 @@ restart:if (sleep5) OutputBoth (thread_num, ERRMSG2);
 }
 
 #include "cert.c"
+#include "proof_verify.c"
@@ -86,6 +86,7 @@ struct PriorityInfo {
 };
 void SetPriority (struct PriorityInfo *);
 void SetAuxThreadPriority (int aux_thread_num, int action, void *data);
+int SetNumaMemoryBinding (void *addr, size_t size, void *data);
 /* The hwloc library numbers cores from 0 to HW_NUM_CORES-1.  But we do not necessarily assign cores in that order. */
 /* With the introduction of Alder Lake, we first assign compute/performance cores.  Then assign efficiency cores. */
 /* This routine maps "prime95 core numbers" into "hwloc core numbers", returning the index into the HW_CORES array */
@@ -107,9 +108,11 @@ int selfTest (int, struct PriorityInfo *, struct work_unit *);
 int primeTime (int, unsigned long, unsigned long);
 int primeBench (int, int);
 int primeFactor (int, struct PriorityInfo *, struct work_unit *, unsigned int);
+void factorBatchDone (int);
 int prime (int, struct PriorityInfo *, struct work_unit *, int);
 int prp (int, struct PriorityInfo *, struct work_unit *, int);
 int cert (int, struct PriorityInfo *, struct work_unit *, int);
+int verifyProof (int, struct PriorityInfo *, struct work_unit *);
 void autoBench (void);
 
 /* Utility routines */
@@ -118,6 +121,8 @@ int isKnownMersennePrime (unsigned long);
 void makestr (unsigned long, unsigned long, unsigned long, char *);
 
 int exponent_near_fft_limit (gwhandle *gwdata);
+void SetGwnumNumaPolicy (gwhandle *gwdata);
+void SetGwnumTableCache (gwhandle *gwdata);
 void calc_interval_adjustments (gwhandle *gwdata, double *output_adjustment, double *title_adjustment);
 double trunc_percent (double percent);
 int testSaveFilesFlag (int thread_num);
@@ -288,6 +293,7 @@ void registerThreadTermination (void);
 void raiseAllWorkersPriority (void);
 void flashWindowAndBeep (void);
 int primeSieveTest (int);
+int primeSieveBench (int);
 int test_randomly (int, struct PriorityInfo *);
 int test_all_impl (int, struct PriorityInfo *);
 
@@ -98,6 +98,13 @@ struct work_unit_array WORK_UNITS[MAX_NUM_WORKERS] = {0}; /* An array of work un
 unsigned int WORKTODO_COUNT = 0;	/* Count of valid work lines */
 unsigned int WORKTODO_IN_USE_COUNT = 0;	/* Count of work units in use */
 int	WORKTODO_CHANGED = 0;		/* Flag indicating worktodo file needs writing */
+unsigned int WORKTODO_JOURNAL_LIMIT = 1000; /* Journal records before worktodo.txt is rewritten, zero disables journaling */
+int	WORKTODO_JOURNAL_FD = -1;	/* Open worktodo journal file or -1 */
+uint64_t WORKTODO_JOURNAL_BASE = 0;	/* Hash of the worktodo state the next journal applies to */
+unsigned int WORKTODO_JOURNAL_RECORDS = 0; /* Count of records in the worktodo journal */
+int	WORKTODO_COMPACTING = FALSE;	/* TRUE if a background thread is writing worktodo.txt */
+int volatile WORKTODO_COMPACT_DONE = FALSE; /* Set by the background thread when worktodo.txt has been written */
+gwthread WORKTODO_COMPACT_THREAD;	/* Background thread writing worktodo.txt */
 
 hwloc_topology_t hwloc_topology;	/* Hardware topology */
 uint32_t CPU_TOTAL_L1_CACHE_SIZE = 0;	/* Sum of all the L1 caches in KB as determined by hwloc */
@@ -867,58 +874,168 @@ int isPrime (
 }
 
 
-/* Routines that use a simple sieve to find "may be prime" numbers.  That is, numbers without any small factors. */
+/* Routines that use a segmented sieve to find "may be prime" numbers.  That is, numbers without any small factors. */
 /* This is used by ECM, P-1, and P+1.  Also, used by 64-bit trial factoring setup code. */
+/* The sieve uses a mod 30 wheel.  Each byte of the sieve array covers 30 numbers, one bit for each of the 8 residues coprime to 30. */
+/* The array is sized to fit in the L1 cache, or in the L2 cache when there are more sieving primes than L1 cache bytes. */
+/* Each sieve is independent and can start anywhere, so callers can sieve separate segments of a range in parallel. */
+
+#define SIEVE_L1_BYTES	32768		/* Size of the sieve array when there are few sieving primes */
+#define SIEVE_L2_BYTES	262144		/* Size of the sieve array when there are many sieving primes */
+
+#if defined (_MSC_VER) && defined (_WIN64)
+#include <intrin.h>
+static __inline int sieve_ctz64 (uint64_t x) { unsigned long i; _BitScanForward64 (&i, x); return ((int) i); }
+#elif defined (_MSC_VER)
+#include <intrin.h>
+static __inline int sieve_ctz64 (uint64_t x) { unsigned long i; if ((uint32_t) x) { _BitScanForward (&i, (uint32_t) x); return ((int) i); }
+						_BitScanForward (&i, (uint32_t) (x >> 32)); return ((int) i + 32); }
+#else
+#define sieve_ctz64(x)	__builtin_ctzll (x)
+#endif
+
+typedef struct {
+	uint32_t prime;				// Sieving prime
+	uint32_t offset;			// Byte in the sieve array of the next multiple to clear
+	uint32_t wheel;				// Wheel position of the next multiple (8 * residue index of prime + residue index of multiplier)
+} sieve_prime;
 
 typedef struct {
-	uint32_t *primes;				// Sieving primes and the bit-to-clear
-	uint64_t first_number;
-	unsigned int bit_number;
-	unsigned int num_primes;
-	unsigned int num_elimination_primes;
-	unsigned int max_elimination;
-	uint64_t start;
-	char	array[4096];
+	sieve_prime *primes;			// Sieving primes
+	unsigned int num_primes;		// Number of sieving primes in use
+	unsigned int num_elimination_primes;	// Number of sieving primes
+	unsigned int max_elimination;		// Sieve eliminates composites with any factors less than this number
+	uint64_t start;				// Starting point (used to return 2, 3, and 5)
+	uint64_t base;				// First number covered by the sieve array (a multiple of 30)
+	unsigned int array_size;		// Size of the sieve array in bytes
+	unsigned int word_number;		// 64-bit word of the sieve array being scanned
+	uint64_t word;				// Bits of that word not yet returned
+	uint64_t *array;			// The sieve array
 } sieve_info;
 
+static const uint8_t sieve_residues[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+static const uint8_t sieve_gaps[8] = {6, 4, 2, 4, 2, 4, 6, 2};
+
+/* The wheel tables are constants so that sieves can be started from any thread without an initialization race. */
+/* Wheel position a*8+i is the multiplier sieve_residues[i] of a prime that is sieve_residues[a] mod 30. */
+
+static const uint8_t sieve_next_residue[30] = {		// Index of the first residue coprime to 30 that is greater than or equal to 0 through 29
+	0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 4, 4, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7};
+static const uint8_t sieve_masks[64] = {			// Mask clearing a multiple's bit, indexed by wheel position
+	0xFE, 0xFD, 0xFB, 0xF7, 0xEF, 0xDF, 0xBF, 0x7F,
+	0xFD, 0xDF, 0xEF, 0xFE, 0x7F, 0xF7, 0xFB, 0xBF,
+	0xFB, 0xEF, 0xFE, 0xBF, 0xFD, 0x7F, 0xF7, 0xDF,
+	0xF7, 0xFE, 0xBF, 0xDF, 0xFB, 0xFD, 0x7F, 0xEF,
+	0xEF, 0x7F, 0xFD, 0xFB, 0xDF, 0xBF, 0xFE, 0xF7,
+	0xDF, 0xF7, 0x7F, 0xFD, 0xBF, 0xFE, 0xEF, 0xFB,
+	0xBF, 0xFB, 0xF7, 0x7F, 0xFE, 0xEF, 0xDF, 0xFD,
+	0x7F, 0xBF, 0xDF, 0xEF, 0xF7, 0xFB, 0xFD, 0xFE};
+static const uint8_t sieve_adjust[64] = {		// Bytes to advance to the next multiple, beyond prime/30 * gap, indexed by wheel position
+	0, 0, 0, 0, 0, 0, 0, 1,
+	1, 1, 1, 0, 1, 1, 1, 1,
+	2, 2, 0, 2, 0, 2, 2, 1,
+	3, 1, 1, 2, 1, 1, 3, 1,
+	3, 3, 1, 2, 1, 3, 3, 1,
+	4, 2, 2, 2, 2, 2, 4, 1,
+	5, 3, 1, 4, 1, 3, 5, 1,
+	6, 4, 2, 4, 2, 4, 6, 1};
+
+/* Internal routine to find a sieving prime's first multiple in the sieve array.  Multiples below the prime's square need not be cleared. */
+/* The multiplier must be coprime to 30. */
+
+void sieve_prime_start (
+	sieve_info *si,
+	sieve_prime *sp)
+{
+	uint64_t p, first, k;
+
+	p = sp->prime;
+	first = (si->base > p * p) ? si->base : p * p;
+	k = (first + p - 1) / p;
+	k = k - k % 30 + sieve_residues[sieve_next_residue[k % 30]];
+	sp->offset = (uint32_t) ((p * k - si->base) / 30);
+	sp->wheel = sieve_next_residue[p % 30] * 8 + sieve_next_residue[k % 30];
+}
+
+/* Internal routine to generate the sieving primes from 7 up to max_elimination_factor.  Uses a simple segmented sieve of odd numbers. */
+
+int sieve_generate_primes (
+	sieve_info *si,
+	uint32_t max_elimination_factor)
+{
+	uint32_t small_primes[6550];		// Odd primes below 65536
+	unsigned int i, num_small_primes, estimated_num_primes;
+	uint32_t f;
+	uint64_t lo, hi, m;
+	char	odds[16384];
+
+	estimated_num_primes = (max_elimination_factor < 1000) ? 200 :
+		(unsigned int) ((double) max_elimination_factor / (log ((double) max_elimination_factor) - 1.0) * 1.01);
+	si->primes = (sieve_prime *) malloc (estimated_num_primes * sizeof (sieve_prime));
+	if (si->primes == NULL) return (FALSE);
+	for (num_small_primes = 0, f = 3; f <= 65535 && f * f <= max_elimination_factor; f += 2)
+		if (isPrime (f)) small_primes[num_small_primes++] = f;
+
+	si->num_elimination_primes = 0;
+	for (lo = 7; lo <= max_elimination_factor; lo = hi) {
+		hi = lo + 2 * sizeof (odds);
+		memset (odds, 1, sizeof (odds));
+		for (i = 0; i < num_small_primes && (uint64_t) small_primes[i] * small_primes[i] < hi; i++) {
+			f = small_primes[i];
+			m = (uint64_t) f * f;
+			if (m < lo) m = (lo + f - 1) / f * f;
+			if ((m & 1) == 0) m += f;
+			for ( ; m < hi; m += 2 * f) odds[(m - lo) / 2] = 0;
+		}
+		for (i = 0; i < sizeof (odds) && lo + 2 * i <= max_elimination_factor && si->num_elimination_primes < estimated_num_primes; i++)
+			if (odds[i]) si->primes[si->num_elimination_primes++].prime = (uint32_t) (lo + 2 * i);
+	}
+	si->max_elimination = max_elimination_factor;
+	return (TRUE);
+}
+
 /* Internal routine to fill up the sieve array */
 
 void fill_sieve (
 	sieve_info *si)
 {
+	unsigned char *array = (unsigned char *) si->array;
 	unsigned int i;
-	uint32_t fmax;
+	uint64_t fmax;
 
-/* Determine the first sieve bit to clear for each small prime */
+/* Start using more sieving primes as the sieve array moves past their squares */
 
-	fmax = (uint32_t) sqrt ((double) (si->first_number + sizeof (si->array) * 8 * 2));
-	for (i = si->num_primes; i < si->num_elimination_primes * 2; i += 2) {
-		uint32_t f, r, bit;
-		f = si->primes[i];
-		if (f > fmax) break;
-		if (si->first_number == 3) {
-			bit = (f * f - 3) >> 1;
-		} else {
-			r = (uint32_t) (si->first_number % f);
-			if (r == 0) bit = 0;
-			else if (r & 1) bit = (f - r) / 2;
-			else bit = (f + f - r) / 2;
-			if (f == si->first_number + 2 * bit) bit += f;
+	fmax = (uint64_t) sqrt ((double) (si->base + (uint64_t) si->array_size * 30)) + 1;
+	for (i = si->num_primes; i < si->num_elimination_primes && si->primes[i].prime <= fmax; i++) sieve_prime_start (si, &si->primes[i]);
+	si->num_primes = i;
+
+/* Fill the sieve with ones, then zero out the composites.  Step through each prime's multiples whose multiplier is coprime to 30. */
+
+	memset (array, 0xFF, si->array_size);
+	for (i = 0; i < si->num_primes; i++) {
+		sieve_prime *sp = &si->primes[i];
+		uint32_t step = sp->prime / 30;
+		uint32_t offset = sp->offset;
+		uint32_t wheel = sp->wheel;
+		while (offset < si->array_size) {
+			array[offset] &= sieve_masks[wheel];
+			offset += step * sieve_gaps[wheel & 7] + sieve_adjust[wheel];
+			wheel = (wheel & 0x38) | ((wheel + 1) & 7);
 		}
-		si->primes[i+1] = bit;
+		sp->offset = offset - si->array_size;
+		sp->wheel = wheel;
 	}
-	si->num_primes = i;
+}
 
-/* Fill the sieve with ones, then zero out the composites */
+/* Internal routine to position the sieve scan at a number within the sieve array */
 
-	memset (si->array, 0xFF, sizeof (si->array));
-	for (i = 0; i < si->num_primes; i += 2) {
-		uint32_t f, bit;
-		f = si->primes[i];
-		for (bit = si->primes[i+1]; bit < sizeof (si->array) * 8; bit += f) bitclr (si->array, bit);
-		si->primes[i+1] = bit - sizeof (si->array) * 8;
-	}
-	si->bit_number = 0;
+void sieve_seek (
+	sieve_info *si,
+	uint64_t start)
+{
+	unsigned int bit = (unsigned int) ((start - si->base) / 30 * 8 + sieve_next_residue[(start - si->base) % 30]);
+	si->word_number = bit / 64;
+	si->word = si->array[si->word_number] & (~0ULL << (bit & 63));
 }
 
 /* Either:  1) Recycle a sieve_info structure using the same number of small primes, OR 2) Allocate a new sieve_info structure. */
@@ -940,7 +1057,7 @@ int start_sieve_with_limit (
 	void	**si_to_recycle_or_returned_new_si)	/* Returned sieving structure */
 {
 	sieve_info *si;
-	unsigned int i;
+	unsigned int array_size;
 
 /* Re-use or allocate the sieve structure */
 
@@ -953,50 +1070,54 @@ int start_sieve_with_limit (
 		memset (si, 0, sizeof (sieve_info));
 	}
 
-/* Remember starting point (in case its 2) and make real start odd */
+/* Remember starting point (in case it is 2, 3, or 5).  The sieve array handles numbers from 7 on. */
 
 	if (start < 2) start = 2;
 	si->start = start;
-	start |= 1;
+	if (start < 7) start = 7;
 
-/* Delete old small primes array if it is not big enough */
+/* Delete old sieving primes array if it is not big enough */
 
 	if (si->primes != NULL && max_elimination_factor > si->max_elimination) {
 		free (si->primes);
 		si->primes = NULL;
-		si->first_number = 0;
+		si->base = 0;
+		si->num_primes = 0;
 	}
 
-/* See if we can just reuse the existing sieve */
+/* See if we can just reuse the existing sieve array */
 
-	if (si->first_number && start >= si->first_number && start < si->first_number + sizeof (si->array) * 8 * 2) {
-		si->bit_number = (unsigned int) (start - si->first_number) / 2;
+	if (si->primes != NULL && si->array != NULL && start >= si->base && start < si->base + (uint64_t) si->array_size * 30) {
+		sieve_seek (si, start);
 		return (0);
 	}
 
 /* Initialize sieving primes */
 
-	if (si->primes == NULL) {
-		uint32_t f;
-		unsigned int estimated_num_primes;
-		estimated_num_primes = (unsigned int) ((double) max_elimination_factor / (log ((double) max_elimination_factor) - 1.0) * 1.01);
-		si->primes = (uint32_t *) malloc (estimated_num_primes * 2 * sizeof (uint32_t));
-		if (si->primes == NULL) goto oom;
-		for (i = 0, f = 3; f <= max_elimination_factor && i < estimated_num_primes; f += 2)
-			if (isPrime (f)) si->primes[i*2] = f, i++;
-		si->num_elimination_primes = i;
-		si->max_elimination = max_elimination_factor;
+	if (si->primes == NULL && !sieve_generate_primes (si, max_elimination_factor)) goto oom;
+
+/* Allocate the sieve array.  Use an L2 cache sized array when there are more sieving primes than L1 cache bytes. */
+
+	array_size = (si->num_elimination_primes > SIEVE_L1_BYTES) ? SIEVE_L2_BYTES : SIEVE_L1_BYTES;
+	if (si->array != NULL && si->array_size != array_size) free (si->array), si->array = NULL;
+	if (si->array == NULL) {
+		si->array = (uint64_t *) malloc (array_size);
+		if (si->array == NULL) goto oom;
+		si->array_size = array_size;
 	}
 
-	si->first_number = start;
+/* Fill the sieve array starting at the multiple of 30 at or below the starting point */
+
+	si->base = start - start % 30;
 	si->num_primes = 0;
 	fill_sieve (si);
+	sieve_seek (si, start);
 	return (0);
 
 /* Out of memory exit path */
 
 oom:	*si_to_recycle_or_returned_new_si = NULL;
-	free (si);
+	end_sieve (si);
 	return (OutOfMemory (thread_num));
 }
 
@@ -1006,24 +1127,67 @@ uint64_t sieve (
 	void	*si_arg)
 {
 	sieve_info *si = (sieve_info *) si_arg;
+	int	bit;
 
-	if (si->start == 2) {
-		si->start = 3;
-		return (2);
+	if (si->start <= 5) {
+		uint64_t p = (si->start <= 2) ? 2 : (si->start <= 3) ? 3 : 5;
+		si->start = p + 1;
+		return (p);
 	}
-	for ( ; ; ) {
-		unsigned int bit;
-		if (si->bit_number == sizeof (si->array) * 8) {
-			si->first_number += 2 * sizeof (si->array) * 8;
+	while (si->word == 0) {
+		if (++si->word_number == si->array_size / 8) {
+			si->base += (uint64_t) si->array_size * 30;
 			fill_sieve (si);
+			si->word_number = 0;
+		}
+		si->word = si->array[si->word_number];
+	}
+	bit = sieve_ctz64 (si->word);
+	si->word &= si->word - 1;
+	return (si->base + 30 * (si->word_number * 8 + (bit >> 3)) + sieve_residues[bit & 7]);
+}
+
+/* Return a batch of primes from the sieve.  Stops after max_primes primes or when the next prime is larger than limit.  The next prime */
+/* is not consumed, the next call to sieve or sieve_primes will return it.  Returns the number of primes stored in the primes array. */
+
+unsigned int sieve_primes (
+	void	*si_arg,
+	uint64_t limit,			/* Return no primes above this value */
+	uint64_t *primes,		/* Array to receive primes */
+	unsigned int max_primes)	/* Size of the primes array */
+{
+	sieve_info *si = (sieve_info *) si_arg;
+	unsigned int count = 0;
+
+	while (si->start <= 5 && count < max_primes) {
+		uint64_t p = (si->start <= 2) ? 2 : (si->start <= 3) ? 3 : 5;
+		if (p > limit) return (count);
+		si->start = p + 1;
+		primes[count++] = p;
+	}
+	while (count < max_primes) {
+		uint64_t word_base;
+		while (si->word == 0) {
+			if (++si->word_number == si->array_size / 8) {
+				si->base += (uint64_t) si->array_size * 30;
+				fill_sieve (si);
+				si->word_number = 0;
+			}
+			si->word = si->array[si->word_number];
 		}
-		bit = si->bit_number++;
-		if (bittst (si->array, bit))
-			return (si->first_number + 2 * bit);
+		word_base = si->base + 240 * (uint64_t) si->word_number;
+		do {
+			int bit = sieve_ctz64 (si->word);
+			uint64_t p = word_base + 30 * (bit >> 3) + sieve_residues[bit & 7];
+			if (p > limit) return (count);
+			si->word &= si->word - 1;
+			primes[count++] = p;
+		} while (si->word && count < max_primes);
 	}
+	return (count);
 }
 
-/* Return next "may be prime" from the sieve */
+/* Free the sieve */
 
 void end_sieve (
 	void	*si_arg)
@@ -1031,6 +1195,7 @@ void end_sieve (
 	sieve_info *si = (sieve_info *) si_arg;
 	if (si == NULL) return;
 	free (si->primes);
+	free (si->array);
 	free (si);
 }
 
@@ -2673,6 +2838,142 @@ void addKnownFermatFactors (
 	}
 }	    
 
+/* Hash routine for assignment IDs, worktodo lines, and the entire worktodo state (64-bit FNV-1a).  MD5 is overkill here. */
+
+#define WORKTODO_HASH_INIT	14695981039346656037ULL
+
+uint64_t worktodo_hash (
+	uint64_t hash,		/* WORKTODO_HASH_INIT or hash of preceding data */
+	const char *data,	/* Data to hash */
+	size_t	len)		/* Length of data */
+{
+	size_t	i;
+	for (i = 0; i < len; i++) hash = (hash ^ (unsigned char) data[i]) * 1099511628211ULL;
+	return (hash);
+}
+
+/* The comm thread looks up a work unit by assignment ID for most messages it sends.  With tens of thousands of lines */
+/* in worktodo.txt a linear scan is expensive, so each worker keeps a hash table of its work units keyed by */
+/* assignment ID.  The buckets are chained through the work units.  Caller must hold WORKTODO_MUTEX. */
+
+void aidIndexInsert (
+	unsigned int tnum,	/* Worker the work unit belongs to */
+	struct work_unit *w)	/* Work unit to add to the index */
+{
+	struct work_unit_array *wa = &WORK_UNITS[tnum];
+	unsigned int bucket;
+
+	if (w->aid_indexed || !w->assignment_uid[0]) return;
+
+/* Double the size of the hash table when it averages more than one work unit per bucket.  If we can't allocate */
+/* the bigger table, live with longer chains. */
+
+	if (wa->aid_index_count >= wa->aid_index_size) {
+		unsigned int new_size, i;
+		struct work_unit **new_index, *p, *next;
+
+		new_size = wa->aid_index_size ? wa->aid_index_size * 2 : 256;
+		new_index = (struct work_unit **) calloc (new_size, sizeof (struct work_unit *));
+		if (new_index != NULL) {
+			for (i = 0; i < wa->aid_index_size; i++) {
+				for (p = wa->aid_index[i]; p != NULL; p = next) {
+					next = p->aid_next;
+					bucket = (unsigned int) p->aid_hash & (new_size - 1);
+					p->aid_next = new_index[bucket];
+					new_index[bucket] = p;
+				}
+			}
+			free (wa->aid_index);
+			wa->aid_index = new_index;
+			wa->aid_index_size = new_size;
+		}
+		if (wa->aid_index == NULL) return;
+	}
+
+/* Add work unit to the front of its bucket */
+
+	w->aid_hash = worktodo_hash (WORKTODO_HASH_INIT, w->assignment_uid, strlen (w->assignment_uid));
+	bucket = (unsigned int) w->aid_hash & (wa->aid_index_size - 1);
+	w->aid_next = wa->aid_index[bucket];
+	wa->aid_index[bucket] = w;
+	w->aid_indexed = TRUE;
+	wa->aid_index_count++;
+}
+
+void aidIndexRemove (
+	unsigned int tnum,	/* Worker the work unit belongs to */
+	struct work_unit *w)	/* Work unit to remove from the index */
+{
+	struct work_unit_array *wa = &WORK_UNITS[tnum];
+	struct work_unit **p;
+
+	if (!w->aid_indexed) return;
+	for (p = &wa->aid_index[(unsigned int) w->aid_hash & (wa->aid_index_size - 1)]; *p != NULL; p = &(*p)->aid_next) {
+		if (*p != w) continue;
+		*p = w->aid_next;
+		wa->aid_index_count--;
+		break;
+	}
+	w->aid_indexed = FALSE;
+}
+
+/* Find the work unit with the given assignment ID.  Like getNextWorkToDoLine, the returned work unit's use count */
+/* is incremented.  Caller must call decrementWorkUnitUseCount with SHORT_TERM_USE. */
+
+struct work_unit *findWorkUnitByAID (
+	const char *aid)	/* Assignment ID to look for */
+{
+	unsigned int tnum;
+	uint64_t hash;
+	struct work_unit *w;
+
+	if (aid[0] == 0) return (NULL);
+	hash = worktodo_hash (WORKTODO_HASH_INIT, aid, strlen (aid));
+
+	gwmutex_lock (&WORKTODO_MUTEX);
+	for (tnum = 0; tnum < NUM_WORKERS; tnum++) {
+		struct work_unit_array *wa = &WORK_UNITS[tnum];
+		if (wa->aid_index == NULL) continue;
+		for (w = wa->aid_index[(unsigned int) hash & (wa->aid_index_size - 1)]; w != NULL; w = w->aid_next) {
+			if (w->aid_hash != hash || w->work_type == WORK_DELETED || strcmp (aid, w->assignment_uid)) continue;
+			w->in_use_count++;
+			WORKTODO_IN_USE_COUNT++;
+			gwmutex_unlock (&WORKTODO_MUTEX);
+			return (w);
+		}
+	}
+	gwmutex_unlock (&WORKTODO_MUTEX);
+	return (NULL);
+}
+
+/* Unlink a work unit from a worker's list and free it.  Caller must hold WORKTODO_MUTEX. */
+
+void freeWorkUnit (
+	unsigned int tnum,	/* Worker the work unit belongs to */
+	struct work_unit *w)	/* Work unit to free */
+{
+
+/* Unlink the work unit from the list and the assignment ID index */
+
+	if (w->prev == NULL)
+		WORK_UNITS[tnum].first = w->next;
+	else
+		w->prev->next = w->next;
+	if (w->next == NULL)
+		WORK_UNITS[tnum].last = w->prev;
+	else
+		w->next->prev = w->prev;
+	aidIndexRemove (tnum, w);
+
+/* Free memory allocated for this work unit */
+
+	free (w->gmp_ecm_file);
+	free (w->proof_file);
+	free (w->known_factors);
+	free (w->comment);
+	free (w);
+}
+
 /* Add a work_unit to the work_unit array.  Grow the work_unit array if necessary */
 
 int addToWorkUnitArray (
@@ -2738,6 +3039,7 @@ int addToWorkUnitArray (
 		WORK_UNITS[tnum].last = w;
 	else
 		w->next->prev = w;
+	aidIndexInsert (tnum, w);
 
 /* Bump count of valid work lines and wake up thread if it is waiting for work to do. */
 
@@ -3113,6 +3415,35 @@ int parseWorkToDoLine (
 		for (i = 1; i <= 3; i++) if ((q = strchr (q+1, ',')) == NULL) goto illegal_line;
 	}
 
+/* Handle VerifyProof= lines.  Verifying a PRP proof file locally.  Double quote file name if it contains special characters. */
+/*	VerifyProof=k,b,n,c,filename			*/
+
+	else if (strcmp (keyword, "VERIFYPROOF") == 0) {
+		int	len;
+		char	*q, *end;
+
+		w->work_type = WORK_VERIFYPROOF;
+		w->k = atof (value);
+		if ((q = strchr (value, ',')) == NULL) goto illegal_line;
+		sscanf (q+1, "%lu,%lu,%ld", &w->b, &w->n, &w->c);
+		for (i = 1; i <= 3; i++) if ((q = strchr (q+1, ',')) == NULL) goto illegal_line;
+		q++;
+		if (q[0] == '"') {
+			q++;
+			end = strchr (q, '"');
+			if (end == NULL) goto illegal_line;
+		} else {
+			end = strchr (q, ',');
+			if (end == NULL) end = q + strlen (q);
+		}
+		len = (int) (end - q);
+		if (len == 0) goto illegal_line;
+		w->proof_file = (char *) malloc (len + 1);
+		if (w->proof_file == NULL) goto nomem;
+		memcpy (w->proof_file, q, len);
+		w->proof_file[len] = 0;
+	}
+
 /* Uh oh.  We have a worktodo.txt line we cannot process. */
 
 	else if (strcmp (keyword, "ADVANCEDFACTOR") == 0) {
@@ -3218,6 +3549,522 @@ comment:w->work_type = WORK_NONE;
 nomem:	return (OutOfMemory (MAIN_THREAD_NUM));
 }
 
+/* Format one worktodo.txt line.  Buf must be MAX_WORKTODO_LINE bytes. */
+
+#define MAX_WORKTODO_LINE	20000
+
+void formatWorkToDoLine (
+	struct work_unit *w,	/* Work unit to format */
+	char	*buf)		/* Returned worktodo.txt line without the trailing newline */
+{
+	char	idbuf[100];
+
+/* Format the optional assignment id */
+
+	idbuf[0] = 0;
+	if (w->assignment_uid[0])
+		sprintf (idbuf, "%s,", w->assignment_uid);
+	else if (w->ra_failed)
+		sprintf (idbuf, "%s,", "N/A");
+
+/* Format the FFT length */
+
+	if (w->minimum_fftlen) {
+		strcat (idbuf, "FFT");
+		if (CPU_FLAGS & CPU_SSE2) strcat (idbuf, "2");
+		if ((w->minimum_fftlen & 0xFFFFF) == 0)
+			sprintf (idbuf+strlen(idbuf), "=%luM,", w->minimum_fftlen >> 20);
+		else if ((w->minimum_fftlen & 0x3FF) == 0)
+			sprintf (idbuf+strlen(idbuf), "=%luK,", w->minimum_fftlen >> 10);
+		else
+			sprintf (idbuf+strlen(idbuf), "=%lu,", w->minimum_fftlen);
+	}
+
+/* Output the optional file name extension (no good use right now, */
+/* was formerly used for multiple workers ECMing the same number) */
+
+	if (w->extension[0]) {
+		sprintf (idbuf+strlen(idbuf), "EXT=%s,", w->extension);
+	}
+
+/* Write out comment lines just as we read them in */
+/* Format normal work unit lines */
+
+	switch (w->work_type) {
+
+	case WORK_NONE:
+		strcpy (buf, w->comment);
+		break;
+
+	case WORK_TEST:
+		if (w->sieve_depth != 99.0 || w->pminus1ed != 1)
+			sprintf (buf, "Test=%s%lu,%.0f,%d", idbuf, w->n, w->sieve_depth, w->pminus1ed);
+		else
+			sprintf (buf, "Test=%s%lu", idbuf, w->n);
+		break;
+
+	case WORK_DBLCHK:
+		if (w->sieve_depth != 99.0 || w->pminus1ed != 1)
+			sprintf (buf, "DoubleCheck=%s%lu,%.0f,%d", idbuf, w->n, w->sieve_depth, w->pminus1ed);
+		else
+			sprintf (buf, "DoubleCheck=%s%lu", idbuf, w->n);
+		break;
+
+	case WORK_ADVANCEDTEST:
+		sprintf (buf, "AdvancedTest=%lu", w->n);
+		break;
+
+	case WORK_FACTOR:
+		sprintf (buf, "Factor=%s%ld,%.0f,%.0f", idbuf, w->n, w->sieve_depth, w->factor_to);
+		break;
+
+	case WORK_PFACTOR:
+		sprintf (buf, "Pfactor=%s%.0f,%lu,%lu,%ld,%g,%g", idbuf, w->k, w->b, w->n, w->c, w->sieve_depth, w->tests_saved);
+		if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
+		break;
+
+	case WORK_ECM:
+		if (w->gmp_ecm_file != NULL) {
+			if (w->n == 0) sprintf (buf, "ECMSTAGE2N=%s\"%s\"", idbuf, w->gmp_ecm_file);
+			else sprintf (buf, "ECMSTAGE2=%s%.0f,%lu,%lu,%ld,\"%s\"", idbuf, w->k, w->b, w->n, w->c, w->gmp_ecm_file);
+			if (w->B2 || w->skip_curves || w->curves_to_do) sprintf (buf + strlen (buf), ",%" PRIu64, w->B2);
+			if (w->skip_curves || w->curves_to_do) sprintf (buf + strlen (buf), ",%u", w->skip_curves);
+			if (w->curves_to_do) sprintf (buf + strlen (buf), ",%u", w->curves_to_do);
+		} else {
+			sprintf (buf, "ECM=%s%.0f,%lu,%lu,%ld,%" PRIu64, idbuf, w->k, w->b, w->n, w->c, w->B1);
+			if (w->B2 || w->curves_to_do != 100 || w->curve) sprintf (buf + strlen (buf), ",%" PRIu64, w->B2);
+			if (w->curves_to_do != 100 || w->curve) sprintf (buf + strlen (buf), ",%u", w->curves_to_do);
+			if (w->curve) sprintf (buf + strlen (buf), ",%" PRIu64, w->curve);
+		}
+		if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
+		break;
+
+	case WORK_PMINUS1:
+		sprintf (buf, "Pminus1=%s%.0f,%lu,%lu,%ld,%" PRIu64 ",%" PRIu64, idbuf, w->k, w->b, w->n, w->c, w->B1, w->B2);
+		if (w->sieve_depth > 0.0) sprintf (buf + strlen (buf), ",%.0f", w->sieve_depth);
+		if (w->B2_start > w->B1) sprintf (buf + strlen (buf), ",%" PRIu64, w->B2_start);
+		if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
+		break;
+
+	case WORK_PPLUS1:
+		sprintf (buf, "Pplus1=%s%.0f,%lu,%lu,%ld,%" PRIu64 ",%" PRIu64 ",%d", idbuf, w->k, w->b, w->n, w->c, w->B1, w->B2, w->nth_run);
+		if (w->sieve_depth > 0.0) sprintf (buf + strlen (buf), ",%.0f", w->sieve_depth);
+		if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
+		break;
+
+	case WORK_PRP:
+		sprintf (buf, "PRP%s=%s%.0f,%lu,%lu,%ld", w->prp_dblchk ? "DC" : "", idbuf, w->k, w->b, w->n, w->c);
+		if (w->sieve_depth != 99.0 || w->tests_saved > 0.0 || w->prp_base || w->prp_residue_type) {
+			sprintf (buf + strlen (buf), ",%g,%g", w->sieve_depth, w->tests_saved);
+			if (w->prp_base || w->prp_residue_type)
+				sprintf (buf + strlen (buf), ",%u,%d", w->prp_base, w->prp_residue_type);
+		}
+		if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
+		break;
+
+	case WORK_CERT:
+		sprintf (buf, "Cert=%s%.0f,%lu,%lu,%ld,%d", idbuf, w->k, w->b, w->n, w->c, w->cert_squarings);
+		break;
+
+	case WORK_VERIFYPROOF:
+		sprintf (buf, "VerifyProof=%s%.0f,%lu,%lu,%ld,\"%s\"", idbuf, w->k, w->b, w->n, w->c, w->proof_file);
+		break;
+	}
+}
+
+/* Format the entire worktodo state exactly as writeWorkToDoFile writes it to worktodo.txt.  Also remember the */
+/* hash of each line so that later worktodo journal records can identify the line.  Caller must hold WORKTODO_MUTEX. */
+
+char *formatWorkToDoState (	/* Returns malloc'ed buffer or NULL if out of memory */
+	size_t	*buflen,	/* Returned length of the formatted worktodo.txt */
+	uint64_t *state_hash)	/* Returned hash of the formatted worktodo.txt */
+{
+	char	*buf, *newbuf;
+	size_t	bufsize, len;
+	int	last_line_was_blank;
+	unsigned int tnum;
+
+	bufsize = 65536;
+	buf = (char *) malloc (bufsize);
+	if (buf == NULL) return (NULL);
+	len = 0;
+
+/* Loop over all workers */
+
+	last_line_was_blank = FALSE;
+	for (tnum = 0; tnum < MAX_NUM_WORKERS; tnum++) {
+	    struct work_unit *w;
+
+/* If we've processed all the workers and there is nothing left to output, then we are done. */
+
+	    if (tnum >= NUM_WORKERS && WORK_UNITS[tnum].first == NULL) break;
+
+/* Output a standardized section header */
+
+	    if (tnum || NUM_WORKERS > 0) {
+		if (tnum && !last_line_was_blank) buf[len++] = '\n';
+		len += sprintf (buf + len, "[Worker #%d]\n", tnum+1);
+		last_line_was_blank = FALSE;
+	    }
+
+/* Loop over each assignment for this worker */
+
+	    for (w = WORK_UNITS[tnum].first; w != NULL; w = w->next) {
+		size_t	linelen;
+
+/* Do not output deleted lines */
+
+		if (w->work_type == WORK_DELETED) continue;
+
+/* Make sure there is room in the buffer for the longest possible line and the next section header */
+
+		if (len + MAX_WORKTODO_LINE + 40 > bufsize) {
+			bufsize += bufsize;
+			newbuf = (char *) realloc (buf, bufsize);
+			if (newbuf == NULL) {
+				free (buf);
+				return (NULL);
+			}
+			buf = newbuf;
+		}
+
+/* Format the line.  Do not output a section header read from worktodo.txt. */
+
+		formatWorkToDoLine (w, buf + len);
+		linelen = strlen (buf + len);
+		w->line_hash = worktodo_hash (WORKTODO_HASH_INIT, buf + len, linelen);
+		if (w == WORK_UNITS[tnum].first && w->work_type == WORK_NONE && w->comment[0] == '[') continue;
+		len += linelen;
+		buf[len++] = '\n';
+		last_line_was_blank = (linelen == 0);
+	    }
+	}
+
+/* Return the formatted worktodo.txt and its hash */
+
+	*buflen = len;
+	*state_hash = worktodo_hash (WORKTODO_HASH_INIT, buf, len);
+	return (buf);
+}
+
+/* The worktodo journal.  Rewriting all of worktodo.txt whenever a line is added, updated, or deleted gets expensive */
+/* when worktodo.txt has tens of thousands of lines -- and the comm thread and workers wait on WORKTODO_MUTEX all the */
+/* while.  Instead, each change appends one short record to worktodo.jnl.  Once the journal holds WorktodoJournal */
+/* records, a background thread writes a fresh worktodo.txt.  The journal it replaces is renamed to worktodo.jnl.old */
+/* and deleted once the new worktodo.txt is safely on disk.  Leftover journals are replayed when worktodo.txt is read. */
+/* Lines are identified by a hash of their text and, as worktodo.txt can contain identical lines, by how many earlier lines */
+/* in the worker's section have the same hash.  Journal records are: */
+/*	C<state hash>				Changes that follow apply to the worktodo state with this hash */
+/*	A<worker> <add point> <line>		Add a line */
+/*	U<worker> <line hash>:<ordinal> <line>	Replace the line with this hash and ordinal */
+/*	D<worker> <line hash>:<ordinal>		Delete the line with this hash and ordinal */
+
+void worktodoJournalFilename (
+	char	*filename,	/* Returned journal file name */
+	int	old)		/* TRUE for the journal being replaced by a background write of worktodo.txt */
+{
+	char	*dot;
+
+	strcpy (filename, WORKTODO_FILE);
+	dot = strrchr (filename, '.');
+	if (dot == NULL || strchr (dot, '/') != NULL || strchr (dot, '\\') != NULL) dot = filename + strlen (filename);
+	strcpy (dot, old ? ".jnl.old" : ".jnl");
+}
+
+/* Count the lines before w in the worker's section with the same hash.  Caller must hold WORKTODO_MUTEX. */
+
+unsigned int worktodoLineOrdinal (
+	int	tnum,		/* Worker number */
+	struct work_unit *w)	/* Work unit to identify */
+{
+	struct work_unit *x;
+	unsigned int ordinal;
+
+	for (x = WORK_UNITS[tnum].first, ordinal = 0; x != NULL && x != w; x = x->next)
+		if (x->work_type != WORK_DELETED && x->line_hash == w->line_hash) ordinal++;
+	return (ordinal);
+}
+
+/* Append a record to the worktodo journal.  Returns TRUE if successful.  If FALSE is returned the caller must */
+/* set WORKTODO_CHANGED so that the entire worktodo.txt is written.  Caller must hold WORKTODO_MUTEX. */
+
+int journalWorkToDo (
+	const char *record)	/* Journal record without the trailing newline */
+{
+	unsigned int len;
+
+/* If journaling is disabled or there are changes that were not journaled, then worktodo.txt must be rewritten anyway */
+
+	if (WORKTODO_JOURNAL_LIMIT == 0 || WORKTODO_CHANGED) return (FALSE);
+
+/* Create a new journal if necessary.  A journal starts with the hash of the worktodo state it applies to. */
+
+	if (WORKTODO_JOURNAL_FD < 0) {
+		char	filename[280], buf[40];
+		worktodoJournalFilename (filename, FALSE);
+		WORKTODO_JOURNAL_FD = _open (filename, _O_CREAT | _O_TRUNC | _O_WRONLY | _O_TEXT, CREATE_FILE_ACCESS);
+		if (WORKTODO_JOURNAL_FD < 0) return (FALSE);
+		sprintf (buf, "C%016" PRIX64 "\n", WORKTODO_JOURNAL_BASE);
+		len = (unsigned int) strlen (buf);
+		if (_write (WORKTODO_JOURNAL_FD, buf, len) != len) goto write_error;
+	}
+
+/* Append the record */
+
+	len = (unsigned int) strlen (record);
+	if (_write (WORKTODO_JOURNAL_FD, record, len) != len || _write (WORKTODO_JOURNAL_FD, "\n", 1) != 1) goto write_error;
+	WORKTODO_JOURNAL_RECORDS++;
+	return (TRUE);
+
+/* On a write error, stop using this journal */
+
+write_error:
+	_close (WORKTODO_JOURNAL_FD);
+	WORKTODO_JOURNAL_FD = -1;
+	return (FALSE);
+}
+
+/* Before worktodo.txt is rewritten, record the new state's hash in any existing journals.  Should we crash after the */
+/* new worktodo.txt is written but before the journals are deleted, this tells replay that the journals' earlier */
+/* changes are already in worktodo.txt.  Caller must hold WORKTODO_MUTEX. */
+
+void journalCheckpoint (
+	uint64_t state_hash)	/* Hash of the worktodo.txt about to be written */
+{
+	char	filename[280], buf[40];
+	unsigned int len;
+	int	old, fd;
+
+	if (WORKTODO_JOURNAL_FD >= 0) {
+		_close (WORKTODO_JOURNAL_FD);
+		WORKTODO_JOURNAL_FD = -1;
+	}
+	sprintf (buf, "C%016" PRIX64 "\n", state_hash);
+	len = (unsigned int) strlen (buf);
+	for (old = 0; old <= 1; old++) {
+		worktodoJournalFilename (filename, old);
+		fd = _open (filename, _O_WRONLY | _O_APPEND | _O_TEXT);
+		if (fd < 0) continue;
+		if (_write (fd, buf, len) != len) OutputBoth (MAIN_THREAD_NUM, "Error writing worktodo journal\n");
+		_close (fd);
+	}
+}
+
+/* Write a formatted worktodo.txt to disk */
+
+int writeWorkToDoBuffer (
+	const char *buf,	/* Formatted worktodo.txt */
+	size_t	len)		/* Length of buf */
+{
+	int	fd;
+	char	tmp_filename[280];
+
+/* Create a temporary file.  The journals are deleted once worktodo.txt is replaced, so a crash must never */
+/* leave behind a partially written worktodo.txt. */
+
+	sprintf (tmp_filename, "%s.tmp", WORKTODO_FILE);
+	fd = _open (tmp_filename, _O_CREAT | _O_TRUNC | _O_WRONLY | _O_TEXT, CREATE_FILE_ACCESS);
+	if (fd < 0) {
+		OutputBoth (MAIN_THREAD_NUM, "Error creating worktodo.txt file\n");
+		return (STOP_FILE_IO_ERROR);
+	}
+
+/* Write it, flush it to disk, and close it */
+
+	if (_write (fd, buf, (unsigned int) len) != (int) len) {
+		OutputBoth (MAIN_THREAD_NUM, "Error writing worktodo.txt file\n");
+		_close (fd);
+		_unlink (tmp_filename);
+		return (STOP_FILE_IO_ERROR);
+	}
+	_commit (fd);
+	_close (fd);
+
+/* Replace worktodo.txt.  Some OSes will not rename over an existing file. */
+
+	if (rename (tmp_filename, WORKTODO_FILE)) {
+		_unlink (WORKTODO_FILE);
+		if (rename (tmp_filename, WORKTODO_FILE)) {
+			OutputBoth (MAIN_THREAD_NUM, "Error renaming worktodo.txt file\n");
+			return (STOP_FILE_IO_ERROR);
+		}
+	}
+	return (0);
+}
+
+/* Background thread that writes worktodo.txt and then deletes the journal it replaces */
+
+struct compact_data {
+	char	*buf;		/* Formatted worktodo.txt */
+	size_t	len;		/* Length of buf */
+};
+
+void compactWorkToDoThread (
+	void	*arg)
+{
+	struct compact_data *cd = (struct compact_data *) arg;
+	char	filename[280];
+
+	if (writeWorkToDoBuffer (cd->buf, cd->len) == 0) {
+		worktodoJournalFilename (filename, TRUE);
+		_unlink (filename);
+	} else {
+		gwmutex_lock (&WORKTODO_MUTEX);
+		WORKTODO_CHANGED = TRUE;
+		gwmutex_unlock (&WORKTODO_MUTEX);
+	}
+	free (cd->buf);
+	free (cd);
+	WORKTODO_COMPACT_DONE = TRUE;
+}
+
+/* Clean up after the background thread writing worktodo.txt.  If wait is set, wait for the background thread to finish. */
+/* Returns TRUE if no background write is in progress.  Caller must hold WORKTODO_MUTEX, which is released while waiting. */
+
+int reapWorkToDoCompaction (
+	int	wait)		/* TRUE if we should wait for the background thread */
+{
+	while (WORKTODO_COMPACTING) {
+		if (WORKTODO_COMPACT_DONE) {
+			gwthread_wait_for_exit (&WORKTODO_COMPACT_THREAD);
+			WORKTODO_COMPACTING = FALSE;
+			break;
+		}
+		if (!wait) return (FALSE);
+		gwmutex_unlock (&WORKTODO_MUTEX);
+		Sleep (20);
+		gwmutex_lock (&WORKTODO_MUTEX);
+	}
+	return (TRUE);
+}
+
+/* Replay the worktodo journals left behind by a crash, a background write of worktodo.txt that did not finish, or */
+/* changes made since worktodo.txt was last written.  Caller must hold WORKTODO_MUTEX and no work units can be in use. */
+
+int replayWorkToDoJournal (void)
+{
+	int	old, rc;
+	char	*line;
+	FILE	*fd;
+
+/* Allocate a buffer for journal records */
+
+	line = (char *) malloc (MAX_WORKTODO_LINE + 80);
+	if (line == NULL) return (OutOfMemory (MAIN_THREAD_NUM));
+
+/* Replay the older journal first */
+
+	for (old = 1; old >= 0; old--) {
+		char	filename[280];
+		char	*p;
+		uint64_t state_hash, hash;
+		size_t	len;
+		unsigned long recnum, start_recnum;
+
+		worktodoJournalFilename (filename, old);
+		fd = fopen (filename, "r");
+		if (fd == NULL) continue;
+
+/* Journals are deleted only after the replayed state is written to worktodo.txt */
+
+		WORKTODO_CHANGED = TRUE;
+
+		p = formatWorkToDoState (&len, &state_hash);
+		if (p == NULL) goto nomem;
+		free (p);
+
+/* Find the last point in the journal where the worktodo state matched our worktodo.txt.  Changes before that point */
+/* are already in worktodo.txt.  If there is no such point, then worktodo.txt was edited by hand.  Do the best we */
+/* can by applying all the changes to the edited worktodo.txt. */
+
+		start_recnum = 0xFFFFFFFF;
+		for (recnum = 0; fgets (line, MAX_WORKTODO_LINE + 80, fd); recnum++) {
+			if (line[0] == 'C' && strtoull (line+1, NULL, 16) == state_hash) start_recnum = recnum;
+		}
+		if (start_recnum == 0xFFFFFFFF) {
+			char	buf[600];
+			sprintf (buf, "%s does not match %s.  Applying its changes to the edited file.\n", filename, WORKTODO_FILE);
+			OutputBoth (MAIN_THREAD_NUM, buf);
+			start_recnum = 0;
+		}
+		rewind (fd);
+
+/* Apply each change after the starting point */
+
+		for (recnum = 0; fgets (line, MAX_WORKTODO_LINE + 80, fd); recnum++) {
+			unsigned int tnum, ordinal;
+			int	add_point;
+			struct work_unit *w, *new_w;
+
+/* Remove trailing CRLFs, skip checkpoints and records that are already in worktodo.txt */
+
+			if (line[0] && line[strlen(line)-1] == '\n') line[strlen(line)-1] = 0;
+			if (line[0] && line[strlen(line)-1] == '\r') line[strlen(line)-1] = 0;
+			if (recnum <= start_recnum) continue;
+			if (line[0] != 'A' && line[0] != 'U' && line[0] != 'D') continue;
+
+/* Parse the worker number and the add point or line hash */
+
+			tnum = (unsigned int) strtoul (line+1, &p, 10);
+			if (*p++ != ' ' || tnum >= MAX_NUM_WORKERS) continue;
+			add_point = 0, hash = 0, ordinal = 0;
+			if (line[0] == 'A') add_point = (int) strtol (p, &p, 10);
+			else {
+				hash = strtoull (p, &p, 16);
+				if (*p == ':') ordinal = (unsigned int) strtoul (p+1, &p, 10);
+			}
+			if (line[0] != 'D' && *p++ != ' ') continue;
+
+/* Find the line to update or delete.  If it isn't there, the change was made to a line that has since been edited by hand. */
+
+			w = NULL;
+			if (line[0] != 'A') {
+				for (w = WORK_UNITS[tnum].first; w != NULL; w = w->next)
+					if (w->work_type != WORK_DELETED && w->line_hash == hash && ordinal-- == 0) break;
+				if (w == NULL) continue;
+			}
+
+/* Delete the line */
+
+			if (line[0] == 'D') {
+				if (w->work_type != WORK_NONE) WORKTODO_COUNT--;
+				freeWorkUnit (tnum, w);
+				continue;
+			}
+
+/* Parse the added or updated line */
+
+			new_w = (struct work_unit *) malloc (sizeof (struct work_unit));
+			if (new_w == NULL) goto nomem;
+			rc = parseWorkToDoLine (p, new_w);
+			if (rc) goto retrc;
+
+/* Add the new line.  An updated line is added after the line it replaces, which is then deleted. */
+
+			if (line[0] == 'U') {
+				new_w->next = w;
+				rc = addToWorkUnitArray (tnum, new_w, ADD_AFTER_SPECIFIC);
+				if (w->work_type != WORK_NONE) WORKTODO_COUNT--;
+				freeWorkUnit (tnum, w);
+			} else
+				rc = addToWorkUnitArray (tnum, new_w, add_point == ADD_TO_FRONT || add_point == ADD_TO_LOGICAL_END ? add_point : ADD_TO_END);
+			if (rc) goto retrc;
+			formatWorkToDoLine (new_w, line);
+			new_w->line_hash = worktodo_hash (WORKTODO_HASH_INIT, line, strlen (line));
+		}
+		fclose (fd);
+	}
+	free (line);
+	return (0);
+
+/* Close the file, free the buffer and return out of memory or error code from routine we called */
+
+nomem:	rc = OutOfMemory (MAIN_THREAD_NUM);
+retrc:	fclose (fd);
+	free (line);
+	return (rc);
+}
+
 /* Read the entire worktodo.txt file into memory.  Return error_code if we have a memory or file I/O error. */
 
 int readWorkToDoFile (void)
@@ -3233,6 +4080,10 @@ int readWorkToDoFile (void)
 	for (i = 1; ; i++) {
 		gwmutex_lock (&WORKTODO_MUTEX);
 
+/* Wait for any background write of worktodo.txt to finish */
+
+		reapWorkToDoCompaction (TRUE);
+
 /* Make sure no other threads are accessing work units right now. */
 /* There should be no workers active so any use should be short-lived. */
 
@@ -3257,28 +4108,32 @@ int readWorkToDoFile (void)
 
 	WORKTODO_CHANGED = FALSE;
 	WORKTODO_COUNT = 0;
+	WORKTODO_JOURNAL_LIMIT = IniGetInt (INI_FILE, "WorktodoJournal", 1000);
+
+/* Close the worktodo journal.  Any changes in it are replayed after worktodo.txt is read. */
+
+	if (WORKTODO_JOURNAL_FD >= 0) {
+		_close (WORKTODO_JOURNAL_FD);
+		WORKTODO_JOURNAL_FD = -1;
+	}
+	WORKTODO_JOURNAL_RECORDS = 0;
 
 /* Free old work_units for each worker. */
 /* We sometimes reread the worktodo.txt file in case the user */
 /* manually edits the file while the program is running. */
 
 	for (tnum = 0; tnum < MAX_NUM_WORKERS; tnum++) {
-		struct work_unit *w, *next_w;
-		for (w = WORK_UNITS[tnum].first; w != NULL; w = next_w) {
-			next_w = w->next;
-			free (w->gmp_ecm_file);
-			free (w->known_factors);
-			free (w->comment);
-			free (w);
-		}
-		WORK_UNITS[tnum].first = NULL;
-		WORK_UNITS[tnum].last = NULL;
+		while (WORK_UNITS[tnum].first != NULL) freeWorkUnit (tnum, WORK_UNITS[tnum].first);
+		free (WORK_UNITS[tnum].aid_index);
+		WORK_UNITS[tnum].aid_index = NULL;
+		WORK_UNITS[tnum].aid_index_size = 0;
+		WORK_UNITS[tnum].aid_index_count = 0;
 	}
 
 /* Read the lines of the work file.  It is OK if the worktodo.txt file does not exist. */
 
 	fd = fopen (WORKTODO_FILE, "r");
-	if (fd == NULL) goto done;
+	if (fd == NULL) goto replay;
 
 	tnum = 0;
 	linenum = 0;
@@ -3322,6 +4177,12 @@ int readWorkToDoFile (void)
 	    rc = addToWorkUnitArray (tnum, w, ADD_TO_END_NO_CHANGE);
 	    if (rc) goto retrc;
 	}
+	fclose (fd);
+
+/* Apply changes recorded in the worktodo journals since worktodo.txt was last written */
+
+replay:	rc = replayWorkToDoJournal ();
+	if (rc) goto unlock;
 
 /* Now that we've finished reading the worktodo file, set stage and pct_complete based on existing save files. */
 
@@ -3393,10 +4254,19 @@ next_wu:	first_real_work_line = FALSE;
 	    }
 	}
 
-/* Close the file, free the lock and return success */
+/* Future worktodo journal records apply to the worktodo state we just read */
 
-	fclose (fd);
-done:	gwmutex_unlock (&WORKTODO_MUTEX);
+	if (!WORKTODO_CHANGED) {
+		char	*buf;
+		size_t	len;
+		buf = formatWorkToDoState (&len, &WORKTODO_JOURNAL_BASE);
+		if (buf == NULL) WORKTODO_CHANGED = TRUE;
+		free (buf);
+	}
+
+/* Free the lock */
+
+	gwmutex_unlock (&WORKTODO_MUTEX);
 
 /* If the worktodo file changed, write the changed worktodo file */
 
@@ -3409,7 +4279,7 @@ done:	gwmutex_unlock (&WORKTODO_MUTEX);
 /* Close the file, free the lock and return error from routine we called */
 
 retrc:	fclose (fd);
-	gwmutex_unlock (&WORKTODO_MUTEX);
+unlock:	gwmutex_unlock (&WORKTODO_MUTEX);
 	return (rc);
 
 /* Free the lock and return out of memory error code */
@@ -3419,17 +4289,21 @@ nomem:	fclose (fd);
 	return (OutOfMemory (MAIN_THREAD_NUM));
 }
 
-/* Write the updated worktodo.txt to disk */
+/* Write the updated worktodo.txt to disk.  Unless forced, a worktodo.txt with only journaled changes is written */
+/* once the journal gets long -- and then by a background thread. */
 
 int writeWorkToDoFile (
 	int	force)		/* Force writing file even if WELL_BEHAVED */
 {
-	int	fd, last_line_was_blank;
-	unsigned int tnum;
+	char	*buf, filename[280], oldname[280];
+	size_t	len;
+	uint64_t state_hash;
+	int	rc;
 
-/* If work to do hasn't changed, then don't write the file */
+/* If work to do hasn't changed and the journal is short, then don't write the file.  When forced, we must */
+/* also wait for any background write of worktodo.txt to finish. */
 
-	if (!WORKTODO_CHANGED) return (0);
+	if (!force && !WORKTODO_CHANGED && (WORKTODO_JOURNAL_FD < 0 || WORKTODO_JOURNAL_RECORDS < WORKTODO_JOURNAL_LIMIT)) return (0);
 
 /* If the well-behaved-work-option is on, then only write the file every */
 /* half hour.  The user should set this option when the worktodo file is */
@@ -3449,182 +4323,67 @@ int writeWorkToDoFile (
 
 	gwmutex_lock (&WORKTODO_MUTEX);
 
-/* Create the WORKTODO.TXT file */
+/* If a background write is still in progress, let it finish.  Unless forced, we'll write worktodo.txt after the */
+/* next change.  Then check again whether there is anything to write now that we own the lock. */
 
-	fd = _open (WORKTODO_FILE, _O_CREAT | _O_TRUNC | _O_WRONLY | _O_TEXT, CREATE_FILE_ACCESS);
-	if (fd < 0) {
-		OutputBoth (MAIN_THREAD_NUM, "Error creating worktodo.txt file\n");
+	if (!reapWorkToDoCompaction (force)) {
 		gwmutex_unlock (&WORKTODO_MUTEX);
-		return (STOP_FILE_IO_ERROR);
+		return (0);
+	}
+	if (!WORKTODO_CHANGED && WORKTODO_JOURNAL_FD < 0) {
+		gwmutex_unlock (&WORKTODO_MUTEX);
+		return (0);
 	}
 
-/* Loop over all workers */
-
-	last_line_was_blank = FALSE;
-	for (tnum = 0; tnum < MAX_NUM_WORKERS; tnum++) {
-	    struct work_unit *w;
-	    unsigned int len;
-
-/* If we've processed all the workers and there is nothing left to output, then we are done. */
-
-	    if (tnum >= NUM_WORKERS && WORK_UNITS[tnum].first == NULL) break;
-
-/* Output a standardized section header */
-
-	    if (tnum || NUM_WORKERS > 0) {
-		char	buf[40];
-		if (tnum && !last_line_was_blank && _write (fd, "\n", 1) != 1)
-			goto write_error;
-		sprintf (buf, "[Worker #%d]\n", tnum+1);
-		len = (unsigned int) strlen (buf);
-		if (_write (fd, buf, len) != len) goto write_error;
-		last_line_was_blank = FALSE;
-	    }
-
-/* Loop over each assignment for this worker */
-
-	    for (w = WORK_UNITS[tnum].first; w != NULL; w = w->next) {
-		char	idbuf[100];
-		char	buf[4096];
-
-/* Do not output deleted lines */
-
-		if (w->work_type == WORK_DELETED) continue;
-
-/* Do not output section header */
-
-		if (w == WORK_UNITS[tnum].first &&
-		    w->work_type == WORK_NONE &&
-		    w->comment[0] == '[') continue;
-
-/* Format the optional assignment id */
-
-		idbuf[0] = 0;
-		if (w->assignment_uid[0])
-			sprintf (idbuf, "%s,", w->assignment_uid);
-		else if (w->ra_failed)
-			sprintf (idbuf, "%s,", "N/A");
-
-/* Format the FFT length */
-
-		if (w->minimum_fftlen) {
-			strcat (idbuf, "FFT");
-			if (CPU_FLAGS & CPU_SSE2) strcat (idbuf, "2");
-			if ((w->minimum_fftlen & 0xFFFFF) == 0)
-				sprintf (idbuf+strlen(idbuf), "=%luM,", w->minimum_fftlen >> 20);
-			else if ((w->minimum_fftlen & 0x3FF) == 0)
-				sprintf (idbuf+strlen(idbuf), "=%luK,", w->minimum_fftlen >> 10);
-			else
-				sprintf (idbuf+strlen(idbuf), "=%lu,", w->minimum_fftlen);
-		}
-
-/* Output the optional file name extension (no good use right now, */
-/* was formerly used for multiple workers ECMing the same number) */
-
-		if (w->extension[0]) {
-			sprintf (idbuf+strlen(idbuf), "EXT=%s,", w->extension);
-		}
-
-/* Write out comment lines just as we read them in */
-/* Format normal work unit lines */
-
-		switch (w->work_type) {
-
-		case WORK_NONE:
-			strcpy (buf, w->comment);
-			break;
-
-		case WORK_TEST:
-			if (w->sieve_depth != 99.0 || w->pminus1ed != 1)
-				sprintf (buf, "Test=%s%lu,%.0f,%d", idbuf, w->n, w->sieve_depth, w->pminus1ed);
-			else
-				sprintf (buf, "Test=%s%lu", idbuf, w->n);
-			break;
-
-		case WORK_DBLCHK:
-			if (w->sieve_depth != 99.0 || w->pminus1ed != 1)
-				sprintf (buf, "DoubleCheck=%s%lu,%.0f,%d", idbuf, w->n, w->sieve_depth, w->pminus1ed);
-			else
-				sprintf (buf, "DoubleCheck=%s%lu", idbuf, w->n);
-			break;
-
-		case WORK_ADVANCEDTEST:
-			sprintf (buf, "AdvancedTest=%lu", w->n);
-			break;
-
-		case WORK_FACTOR:
-			sprintf (buf, "Factor=%s%ld,%.0f,%.0f", idbuf, w->n, w->sieve_depth, w->factor_to);
-			break;
-
-		case WORK_PFACTOR:
-			sprintf (buf, "Pfactor=%s%.0f,%lu,%lu,%ld,%g,%g", idbuf, w->k, w->b, w->n, w->c, w->sieve_depth, w->tests_saved);
-			if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
-			break;
-
-		case WORK_ECM:
-			if (w->gmp_ecm_file != NULL) {
-				if (w->n == 0) sprintf (buf, "ECMSTAGE2N=%s\"%s\"", idbuf, w->gmp_ecm_file);
-				else sprintf (buf, "ECMSTAGE2=%s%.0f,%lu,%lu,%ld,\"%s\"", idbuf, w->k, w->b, w->n, w->c, w->gmp_ecm_file);
-				if (w->B2 || w->skip_curves || w->curves_to_do) sprintf (buf + strlen (buf), ",%" PRIu64, w->B2);
-				if (w->skip_curves || w->curves_to_do) sprintf (buf + strlen (buf), ",%u", w->skip_curves);
-				if (w->curves_to_do) sprintf (buf + strlen (buf), ",%u", w->curves_to_do);
-			} else {
-				sprintf (buf, "ECM=%s%.0f,%lu,%lu,%ld,%" PRIu64, idbuf, w->k, w->b, w->n, w->c, w->B1);
-				if (w->B2 || w->curves_to_do != 100 || w->curve) sprintf (buf + strlen (buf), ",%" PRIu64, w->B2);
-				if (w->curves_to_do != 100 || w->curve) sprintf (buf + strlen (buf), ",%u", w->curves_to_do);
-				if (w->curve) sprintf (buf + strlen (buf), ",%" PRIu64, w->curve);
-			}
-			if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
-			break;
-
-		case WORK_PMINUS1:
-			sprintf (buf, "Pminus1=%s%.0f,%lu,%lu,%ld,%" PRIu64 ",%" PRIu64, idbuf, w->k, w->b, w->n, w->c, w->B1, w->B2);
-			if (w->sieve_depth > 0.0) sprintf (buf + strlen (buf), ",%.0f", w->sieve_depth);
-			if (w->B2_start > w->B1) sprintf (buf + strlen (buf), ",%" PRIu64, w->B2_start);
-			if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
-			break;
-
-		case WORK_PPLUS1:
-			sprintf (buf, "Pplus1=%s%.0f,%lu,%lu,%ld,%" PRIu64 ",%" PRIu64 ",%d", idbuf, w->k, w->b, w->n, w->c, w->B1, w->B2, w->nth_run);
-			if (w->sieve_depth > 0.0) sprintf (buf + strlen (buf), ",%.0f", w->sieve_depth);
-			if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
-			break;
+/* Format the new worktodo.txt.  Record its hash in the journals for crash recovery. */
 
-		case WORK_PRP:
-			sprintf (buf, "PRP%s=%s%.0f,%lu,%lu,%ld", w->prp_dblchk ? "DC" : "", idbuf, w->k, w->b, w->n, w->c);
-			if (w->sieve_depth != 99.0 || w->tests_saved > 0.0 || w->prp_base || w->prp_residue_type) {
-				sprintf (buf + strlen (buf), ",%g,%g", w->sieve_depth, w->tests_saved);
-				if (w->prp_base || w->prp_residue_type)
-					sprintf (buf + strlen (buf), ",%u,%d", w->prp_base, w->prp_residue_type);
-			}
-			if (w->known_factors != NULL) sprintf (buf + strlen (buf), ",\"%s\"", w->known_factors);
-			break;
+	buf = formatWorkToDoState (&len, &state_hash);
+	if (buf == NULL) {
+		gwmutex_unlock (&WORKTODO_MUTEX);
+		return (OutOfMemory (MAIN_THREAD_NUM));
+	}
+	journalCheckpoint (state_hash);
 
-		case WORK_CERT:
-			sprintf (buf, "Cert=%s%.0f,%lu,%lu,%ld,%d", idbuf, w->k, w->b, w->n, w->c, w->cert_squarings);
-			break;
-		}
+/* Changes from now on go in a new journal */
 
-/* Write out the formatted line */
+	WORKTODO_JOURNAL_BASE = state_hash;
+	WORKTODO_JOURNAL_RECORDS = 0;
+	WORKTODO_CHANGED = FALSE;
 
-		strcat (buf, "\n");
-		len = (unsigned int) strlen (buf);
-		if (_write (fd, buf, len) != len) {
-write_error:		OutputBoth (MAIN_THREAD_NUM, "Error writing worktodo.txt file\n");
-			_close (fd);
+/* Unless forced, write worktodo.txt in a background thread so that the comm thread and workers need not wait. */
+/* The current journal is renamed so that a new journal can be started.  Fall back to writing worktodo.txt */
+/* ourselves if the previous background write failed to delete its journal. */
+
+	worktodoJournalFilename (filename, FALSE);
+	worktodoJournalFilename (oldname, TRUE);
+	if (!force && WORKTODO_JOURNAL_LIMIT && !fileExists (oldname) && (!fileExists (filename) || rename (filename, oldname) == 0)) {
+		struct compact_data *cd = (struct compact_data *) malloc (sizeof (struct compact_data));
+		if (cd != NULL) {
+			cd->buf = buf;
+			cd->len = len;
+			WORKTODO_COMPACTING = TRUE;
+			WORKTODO_COMPACT_DONE = FALSE;
+			gwthread_create_waitable (&WORKTODO_COMPACT_THREAD, &compactWorkToDoThread, cd);
 			gwmutex_unlock (&WORKTODO_MUTEX);
-			return (STOP_FILE_IO_ERROR);
+			return (0);
 		}
-		last_line_was_blank = (len == 1);
-	    }
 	}
 
-/* Close file, unlock, and return success */
+/* Write worktodo.txt while holding the lock so that no journal records are written until it is safely on disk. */
+/* Then delete the journals, their changes are all in worktodo.txt. */
+
+	rc = writeWorkToDoBuffer (buf, len);
+	if (rc == 0) {
+		_unlink (filename);
+		_unlink (oldname);
+	} else
+		WORKTODO_CHANGED = TRUE;
+
+/* Unlock and return */
 
-	_close (fd);
-	WORKTODO_CHANGED = FALSE;
 	gwmutex_unlock (&WORKTODO_MUTEX);
-	return (0);
+	free (buf);
+	return (rc);
 }
 
 /* Return a worktodo.txt entry for the given worker */
@@ -3658,25 +4417,8 @@ struct work_unit *getNextWorkToDoLine (
 
 /* Free the work unit if it has been deleted and use count is now zero */
 
-		if (w->work_type == WORK_DELETED && w->in_use_count == 0) {
-
-/* Unlink the work unit from the list */
-
-			if (w->prev == NULL)
-				WORK_UNITS[thread_num].first = w->next;
-			else
-				w->prev->next = w->next;
-			if (w->next == NULL)
-				WORK_UNITS[thread_num].last = w->prev;
-			else
-				w->next->prev = w->prev;
-
-/* Free memory allocated for this work unit */
-
-			free (w->known_factors);
-			free (w->comment);
-			free (w);
-		}
+		if (w->work_type == WORK_DELETED && w->in_use_count == 0)
+			freeWorkUnit (thread_num, w);
 	}
 
 /* Increment the in-use count.  If this is a long-term usage, remember */
@@ -3725,7 +4467,7 @@ int addWorkToDoLine (
 	int	add_point)	/* Three possible insertion points */
 {
 	struct work_unit *malloc_w;
-	int	rc;
+	int	rc, changed;
 
 /* Do more initialization of the work_unit structure */
 
@@ -3737,20 +4479,39 @@ int addWorkToDoLine (
 	if (malloc_w == NULL) return (OutOfMemory (MAIN_THREAD_NUM));
 	memcpy (malloc_w, w, sizeof (struct work_unit));
 
-/* If this is ECM, P-1, or P+1 on a Fermat number, then automatically add known Fermat factors */
-
-	addKnownFermatFactors (malloc_w);
-
 /* Grab the lock so that comm thread and/or workers do not */
 /* access structure while the other is adding/deleting lines. */
 
 	gwmutex_lock (&WORKTODO_MUTEX);
+	changed = WORKTODO_CHANGED;
+
+/* If this is ECM, P-1, or P+1 on a Fermat number, then automatically add known Fermat factors */
+
+	addKnownFermatFactors (malloc_w);
 
 /* Add the work unit to the start or end of the array.  Well, actually before the last set of blank lines. */
 
 	rc = addToWorkUnitArray (tnum, malloc_w, add_point);
 	if (rc) goto retrc;
 
+/* Record the new line in the worktodo journal rather than rewriting all of worktodo.txt */
+
+	if (add_point == ADD_TO_FRONT || add_point == ADD_TO_LOGICAL_END || add_point == ADD_TO_END) {
+		char	*record, *line;
+		record = (char *) malloc (MAX_WORKTODO_LINE + 80);
+		if (record != NULL) {
+			sprintf (record, "A%u %d ", tnum % NUM_WORKERS, add_point);
+			line = record + strlen (record);
+			formatWorkToDoLine (malloc_w, line);
+			WORKTODO_CHANGED = changed;
+			if (journalWorkToDo (record))
+				malloc_w->line_hash = worktodo_hash (WORKTODO_HASH_INIT, line, strlen (line));
+			else
+				WORKTODO_CHANGED = TRUE;
+			free (record);
+		}
+	}
+
 /* Unlock and write the worktodo.txt file to disk */
 
 	gwmutex_unlock (&WORKTODO_MUTEX);
@@ -3768,13 +4529,37 @@ int updateWorkToDoLine (
 	int	tnum,		/* Worker to process this work unit */
 	struct work_unit *w)	/* Type of work */
 {
+	char	*record, *line;
+	uint64_t line_hash;
 
-/* Set flag indicating worktodo needs writing */
+/* Grab the lock so that comm thread and/or workers don't access structure while we are journaling the change */
 
-	WORKTODO_CHANGED = TRUE;
+	gwmutex_lock (&WORKTODO_MUTEX);
 
-/* Write the worktodo.txt file to disk */
+/* The assignment ID may have changed, reindex the work unit */
 
+	aidIndexRemove (tnum, w);
+	aidIndexInsert (tnum, w);
+
+/* Record the updated line in the worktodo journal.  If that fails, set flag indicating worktodo needs writing. */
+
+	record = (char *) malloc (MAX_WORKTODO_LINE + 80);
+	if (record == NULL) WORKTODO_CHANGED = TRUE;
+	else {
+		sprintf (record, "U%d %016" PRIX64 ":%u ", tnum, w->line_hash, worktodoLineOrdinal (tnum, w));
+		line = record + strlen (record);
+		formatWorkToDoLine (w, line);
+		line_hash = worktodo_hash (WORKTODO_HASH_INIT, line, strlen (line));
+		if (line_hash != w->line_hash) {
+			if (journalWorkToDo (record)) w->line_hash = line_hash;
+			else WORKTODO_CHANGED = TRUE;
+		}
+		free (record);
+	}
+
+/* Unlock and write the worktodo.txt file to disk */
+
+	gwmutex_unlock (&WORKTODO_MUTEX);
 	return (writeWorkToDoFile (FALSE));
 }
 
@@ -3788,6 +4573,7 @@ int deleteWorkToDoLine (
 	struct work_unit *w,	/* Work unit pointer */
 	int	stop_if_in_progress) /* Stop thread processing work unit */
 {
+	char	record[40];
 
 /* If this work unit has already been deleted, then ignore this delete */
 /* request.  This should only happen in a bizarre race condition. */
@@ -3812,13 +4598,18 @@ int deleteWorkToDoLine (
 
 	if (w->work_type != WORK_NONE) WORKTODO_COUNT--;
 
-/* Mark this work unit deleted */
+/* Format the journal record while the work unit can still be identified by its hash and ordinal */
+
+	sprintf (record, "D%d %016" PRIX64 ":%u", tnum, w->line_hash, worktodoLineOrdinal (tnum, w));
+
+/* Mark this work unit deleted and remove it from the assignment ID index */
 
 	w->work_type = WORK_DELETED;
+	aidIndexRemove (tnum, w);
 
-/* Set flag indicating worktodo needs writing */
+/* Record the deletion in the worktodo journal.  If that fails, set flag indicating worktodo needs writing. */
 
-	WORKTODO_CHANGED = TRUE;
+	if (!journalWorkToDo (record)) WORKTODO_CHANGED = TRUE;
 
 /* Unlock and write the worktodo.txt file to disk */
 
@@ -4058,6 +4849,13 @@ double work_estimate (
 		if (w->stage[0] == 'C') est *= (1.0 - pct_complete);
 	}
 
+/* Proof verification costs about n / 2^proof_power squarings.  Assume a typical proof power of 8. */
+
+	if (w->work_type == WORK_VERIFYPROOF) {
+		est = w->n / 256.0 * gwmap_to_timing (w->k, w->b, w->n, w->c);
+		if (w->stage[0] == 'V') est *= (1.0 - pct_complete);
+	}
+
 /* Factor in the hours per day the computer is running and the */
 /* rolling average */
 
@@ -5531,22 +6329,15 @@ void aid_to_text (
 	char	*buf,
 	char	*aid)
 {
-	unsigned int tnum;
 	struct work_unit *w;
 
-/* Scan all work units until we find a matching assignment id */
+/* Look up the work unit with a matching assignment id */
 
-	for (tnum = 0; tnum < NUM_WORKERS; tnum++) {
-	    w = NULL;
-	    for ( ; ; ) {
-		w = getNextWorkToDoLine (tnum, w, SHORT_TERM_USE);
-		if (w == NULL) break;
-		if (w->work_type == WORK_NONE) continue;
-		if (strcmp (aid, w->assignment_uid)) continue;
+	w = findWorkUnitByAID (aid);
+	if (w != NULL) {
 		gw_as_string (buf, w->k, w->b, w->n, w->c);
 		decrementWorkUnitUseCount (w, SHORT_TERM_USE);
 		return;
-	    }
 	}
 	sprintf (buf, "assignment %s", aid);
 }
@@ -6444,7 +7235,7 @@ retry:
 /* Register assignments that were not issued by the server */
 
 		registered_assignment = FALSE;
-		if (!w->assignment_uid[0] && !w->ra_failed) {
+		if (!w->assignment_uid[0] && !w->ra_failed && w->work_type != WORK_VERIFYPROOF) {
 			struct primenetRegisterAssignment pkt;
 			memset (&pkt, 0, sizeof (pkt));
 			strcpy (pkt.computer_guid, COMPUTER_GUID);
@@ -344,6 +344,7 @@ int isPrime (unsigned long p);
 int start_sieve (int thread_num, uint64_t start, void **returned_si);		// Default sieve eliminates numbers with factors < 64K
 int start_sieve_with_limit (int thread_num, uint64_t start, uint32_t max_elimination_factor, void **returned_si);
 uint64_t sieve (void *si);
+unsigned int sieve_primes (void *si, uint64_t limit, uint64_t *primes, unsigned int max_primes);
 void end_sieve (void *si);
 uint64_t _intgcd (uint64_t, uint64_t);
 uint64_t modinv (uint64_t, uint64_t);
@@ -409,6 +410,7 @@ int OutOfMemory (int);
 #define WORK_PFACTOR		7
 #define WORK_PRP		10
 #define WORK_CERT		11
+#define WORK_VERIFYPROOF	12
 #define WORK_NONE		100	/* Comment line in worktodo.ini */
 #define WORK_DELETED		101	/* Deleted work_unit */
 
@@ -437,6 +439,7 @@ struct work_unit {		/* One line from the worktodo file */
 	int	prp_dblchk;	/* True if this is a doublecheck of a previous PRP */
 	int	cert_squarings; /* Number of squarings required for PRP proof certification */
 	char	*gmp_ecm_file;	/* Save file from GMP-ECM to run stage 2 on */
+	char	*proof_file;	/* VerifyProof - PRP proof file to verify */
 	char	*known_factors;	/* ECM, P-1, P+1, PRP - list of known factors */
 	char	*comment;	/* Comment line in worktodo.txt */
 		/* Runtime variables */
@@ -449,10 +452,17 @@ struct work_unit {		/* One line from the worktodo file */
 	double	pct_complete;	/* Percent complete (misnomer as value is between 0.0 and 1.0) */
 	unsigned long fftlen;	/* FFT length in use */
 	int	ra_failed;	/* Set when register assignment fails, tells us not to try registering it again. */
+	uint64_t line_hash;	/* Hash of this line as last written to worktodo.txt or the worktodo journal */
+	uint64_t aid_hash;	/* Hash of the assignment ID */
+	int	aid_indexed;	/* Set if this work unit is in the assignment ID index */
+	struct work_unit *aid_next; /* Next work unit in the same assignment ID index bucket */
 };
 struct work_unit_array {	/* All the lines for one worker */
 	struct work_unit *first; /* First work unit */
 	struct work_unit *last;	/* Last work unit */
+	struct work_unit **aid_index; /* Hash table of work units with an assignment ID */
+	unsigned int aid_index_size; /* Number of buckets in the hash table (a power of two) */
+	unsigned int aid_index_count; /* Number of work units in the hash table */
 };
 
 int readWorkToDoFile (void);
@@ -472,6 +482,7 @@ int updateWorkToDoLine (int, struct work_unit *);
 int deleteWorkToDoLine (int, struct work_unit *, int);
 int isWorkUnitActive (struct work_unit *);
 int addToWorkUnitArray (unsigned int, struct work_unit *, int);
+struct work_unit *findWorkUnitByAID (const char *);
 
 void rolling_average_work_unit_complete (int, struct work_unit *);
 void invalidateNextRollingAverageUpdate (void);
@@ -558,6 +569,9 @@ int ProofFileNames (char filenames[50][255]);
 void ProofUpload (char *);
 int ProofGetData (char *, void *, int, char *);
 char getDirectorySeparator ();
+void *mapFileForReading (int, int64_t, void **);
+void unmapFile (void *, int64_t, void *);
+int allocateFileSpace (int, int64_t);
 void mallocFreeForOS ();
 
 
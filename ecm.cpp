@@ -726,6 +726,7 @@ struct common_cost_data {
 	uint64_t gap_end;		/* a.k.a C_done (when pairmaps are split, gap_end to C are the remaining primes to pair) */
 	/* Data returned from cost function follows */
 	double	max_pairmap_size;	/* Maximum size of the pairing map */
+	bool	pairmap_producer;	/* TRUE if the next pairing map is built in the background while the current one is in use */
 	int	D;			/* D value for big steps */
 	int	totrels;		/* Total number of relative primes used for pairing */
 	int	numrels;		/* Number of relative primes less than D / 2 */
@@ -872,6 +873,10 @@ double best_stage2_impl_internal (
 			c->max_pairmap_Dsections = estimate_max_pairmap_Dsections (c->max_pairmap_size, c->numDsections, est_totpairs);
 			c->numvals_consumed_by_pairmap = (int)
 				((est_totpairs > c->max_pairmap_size ? c->max_pairmap_size : est_totpairs) / (c->stage2_fftlen * sizeof (double)));
+			// When the pairing map is split, the background producer builds a second map (plus fill_pairmap's working memory)
+			// while stage 2 uses the first.  Charge for both maps and a gwnum of working memory.
+			if (c->pairmap_producer && c->max_pairmap_Dsections < c->numDsections)
+				c->numvals_consumed_by_pairmap = c->numvals_consumed_by_pairmap * 2 + 1;
 			// Catch cases where not enough memory for totrels and the pairing map
 			if (c->totrels + c->numvals_consumed_by_pairmap > max_numvals) continue;
 
@@ -972,9 +977,12 @@ double best_stage2_impl (
 		if (max_pairmap_size > 2000) max_pairmap_size = 2000;
 		if (max_pairmap_size < 1) max_pairmap_size = 1;
 		c->max_pairmap_size = (double) max_pairmap_size * 1000000.0;
+		c->pairmap_producer = IniGetInt (INI_FILE, "PairmapProducer", 1);
 		// Don't let the pairmap consume more than half the numvals (this may not be optimal).  Not worth investigating as polymult is the optimal choice.
-		if (c->max_pairmap_size > (double) numvals / 2 * c->stage2_fftlen * sizeof (double))
-			c->max_pairmap_size = (double) numvals / 2 * c->stage2_fftlen * sizeof (double);
+		// With the background producer two pairmaps can be in memory, each gets a quarter of the numvals.
+		double max_pairmap_numvals = (double) numvals / (c->pairmap_producer ? 4 : 2);
+		if (c->max_pairmap_size > max_pairmap_numvals * c->stage2_fftlen * sizeof (double))
+			c->max_pairmap_size = max_pairmap_numvals * c->stage2_fftlen * sizeof (double);
 	}
 
 /* Estimate the number of primes between B1 and B2 */
@@ -1240,19 +1248,26 @@ int testFactor (
 
 /* See if this is a valid factor */
 
-	tmp = popg (&gwdata->gdata, f->sign + 5);	/* Allow room for mul by KARG */
+	/* A NULL gwdata means gwsetup failed, use the heap rather than the gwdata's giants stack */
+	if (gwdata != NULL) tmp = popg (&gwdata->gdata, f->sign + 5);	/* Allow room for mul by KARG */
+	else {
+		tmp = allocgiant (f->sign + 5);
+		if (tmp == NULL) return (TRUE);		/* Cannot validate, assume the GCD's factor is good */
+	}
 	itog (w->b, tmp);
 	powermod (tmp, w->n, f);
 	dblmulg (w->k, tmp);
 	iaddg (w->c, tmp);
-	modgi (&gwdata->gdata, f, tmp);
+	if (gwdata != NULL) modgi (&gwdata->gdata, f, tmp);
+	else modg (f, tmp);
 	divides_ok = isZero (tmp);
-	pushg (&gwdata->gdata, 1);
+	if (gwdata != NULL) pushg (&gwdata->gdata, 1);
+	else free (tmp);
 	if (!divides_ok) return (FALSE);
 
 /* If QAing, see if we found the expected factor */
 
-	if (QA_IN_PROGRESS) {
+	if (QA_IN_PROGRESS && gwdata != NULL) {
 		tmp = popg (&gwdata->gdata, f->sign + 5);
 		gtog (f, tmp);
 		modg (QA_FACTOR, tmp);
@@ -1390,6 +1405,82 @@ int gcd (
 oom:	return (OutOfMemory (thread_num));
 }
 
+/* Background GCDs.  A stage 1 or stage 2 GCD can take minutes on large numbers.  Rather than idle the FFT threads, convert the value to binary */
+/* and have a helper thread run the GCD while the worker moves on to stage 2 or the next ECM curve.  The worker polls for the result now and */
+/* then and must wait for the helper before exiting. */
+
+struct background_gcd {
+	int	active;			/* TRUE if the helper thread is running or has not been waited on */
+	int	volatile done;		/* Set by the helper thread when the GCD is complete */
+	int	thread_num;		/* Worker number */
+	giant	v;			/* Snapshot of the value to GCD with N */
+	giant	N;			/* Copy of the number being factored (the worker may divide out a factor from its copy) */
+	giant	factor;			/* Factor found, if any */
+	gwthread thread;		/* Thread id of the helper thread */
+};
+
+void background_gcd_thread (void *arg)
+{
+	struct background_gcd *bg = (struct background_gcd *) arg;
+	gcd (bg->thread_num, bg->v, bg->N, &bg->factor);
+	bg->done = TRUE;
+}
+
+/* Start a GCD in the background.  Returns FALSE if the caller must do the GCD itself. */
+
+int start_background_gcd (
+	struct background_gcd *bg,
+	gwhandle *gwdata,
+	int	thread_num,
+	gwnum	gg,
+	giant	N)		/* Number we are factoring */
+{
+	ASSERTG (!bg->active);
+	if (QA_IN_PROGRESS || !IniGetInt (INI_FILE, "BackgroundGCD", 1)) return (FALSE);
+
+/* Snapshot the value and N */
+
+	bg->v = allocgiant (((int) gwdata->bit_length >> 5) + 10);
+	bg->N = allocgiant (N->sign);
+	if (bg->v == NULL || bg->N == NULL) goto fail;
+	gwunfft (gwdata, gg, gg);		// Just in case caller partially FFTed gg
+	if (gwtogiant (gwdata, gg, bg->v)) goto fail;
+	gtog (N, bg->N);
+
+/* Start the helper thread */
+
+	bg->thread_num = thread_num;
+	bg->factor = NULL;
+	bg->done = FALSE;
+	gwthread_create_waitable (&bg->thread, &background_gcd_thread, (void *) bg);
+	bg->active = TRUE;
+	return (TRUE);
+
+/* Let the caller do a normal GCD */
+
+fail:	free (bg->v), bg->v = NULL;
+	free (bg->N), bg->N = NULL;
+	return (FALSE);
+}
+
+/* Collect the result of a background GCD.  If wait is FALSE, only collect the result if the helper thread is already done. */
+/* Returns TRUE if a factor was found. */
+
+int finish_background_gcd (
+	struct background_gcd *bg,
+	int	wait,		/* TRUE if we should wait for the helper thread */
+	giant	*factor)	/* Factor found if any */
+{
+	*factor = NULL;
+	if (!bg->active || (!wait && !bg->done)) return (FALSE);
+	gwthread_wait_for_exit (&bg->thread);
+	bg->active = FALSE;
+	free (bg->v), bg->v = NULL;
+	free (bg->N), bg->N = NULL;
+	*factor = bg->factor, bg->factor = NULL;
+	return (*factor != NULL);
+}
+
 /* Test if N is a probable prime.  Compute i^(N-1) mod N for i = 3,5,7 */
 
 int isProbablePrime (
@@ -1450,6 +1541,316 @@ uint64_t calc_new_first_relocatable (
 	return (divide_rounding_up (C_done, D_data[D_index].first_missing_prime));
 }
 
+/* Get the pairmap starting at C_done.  Use the pairmap built in the background if there is one, otherwise build it now. */
+/* Then, if stage 2 needs more pairmaps, start building the following pairmap in the background while this one is processed. */
+
+int next_pairmap (
+	pairmap_producer *pp,		/* Background pairmap generation state */
+	gwhandle *gwdata,		/* Handle for the stage 2 FFTs */
+	int	thread_num,		/* For outputting informative messages */
+	int	D,			/* Calculated by best_stage2_impl, best D value ("big step") */
+	int	totrels,		/* Calculated by best_stage2_impl, number of relative primes to use for pairing */
+	int16_t	*relp_sets,		/* The relp sets we are using in stage 2 */
+	uint64_t first_relocatable,	/* First relocatable prime for this pairmap */
+	uint64_t last_relocatable,	/* End of relocatable primes */
+	uint64_t C_done,		/* First D section to place in this pairmap */
+	uint64_t C,			/* Bound #2 */
+	uint64_t max_pairmap_Dsections,	/* Number of D sections that can fit in a pairing map */
+	uint8_t	**pairmap,		/* Pairing map (the old one is freed) */
+	uint64_t *pairmap_size)		/* Size of the pairing map */
+{
+	int	fill_window, stop_reason;
+	uint64_t next_start, B2_end;
+	double	timers[1];
+
+	fill_window = pair_window_size (gwdata->bit_length, relp_sets);
+
+/* Wait for the background thread to finish this pairmap.  If it wasn't building this one, build the pairmap now. */
+
+	clear_timer (timers, 0);
+	start_timer (timers, 0);
+	if (finish_pairmap_producer (pp, C_done, &stop_reason, pairmap, pairmap_size)) {
+		end_timer (timers, 0);
+		pp->wait_time += timer_value (timers, 0);
+		pp->num_produced++;
+	} else {
+		gwfree_internal_memory (gwdata);
+		stop_reason = fill_pairmap (thread_num, NULL, D, fill_window,0,0,0, totrels, relp_sets+3, first_relocatable, last_relocatable,
+					    C_done, C, max_pairmap_Dsections, pairmap, pairmap_size);
+	}
+	if (stop_reason) return (stop_reason);
+
+/* Start building the next pairmap if this pairmap does not reach B2.  Computation of B2_end must match fill_pairmap. */
+/* This costs memory for a second pairmap, which is bounded by max_pairmap_Dsections. */
+
+	next_start = C_done + max_pairmap_Dsections * D;
+	B2_end = round_up_to_multiple_of (C + D / 2, D) - D / 2;
+	if (next_start < B2_end && IniGetInt (INI_FILE, "PairmapProducer", 1))
+		start_pairmap_producer (pp, thread_num, D, fill_window, totrels, relp_sets+3, calc_new_first_relocatable (D, next_start),
+					last_relocatable, next_start, C, max_pairmap_Dsections);
+
+	return (0);
+}
+
+/* Output and reset the time stage 2 spent waiting on background pairmap generation */
+
+void report_pairmap_wait (
+	int	thread_num,
+	pairmap_producer *pp)
+{
+	char	buf[200];
+
+	if (pp->num_produced) {
+		sprintf (buf, "Stage 2 used %d pairing maps built in the background, waited %.3f sec.\n", pp->num_produced, pp->wait_time);
+		OutputStr (thread_num, buf);
+	}
+	pp->num_produced = 0;
+	pp->wait_time = 0.0;
+}
+
+/*************************************************/
+/* Asynchronous I/O for Ftree rows saved to disk */
+/*************************************************/
+
+/* ECM polymult stage 2 may save two Ftree rows to disk.  The rows are written once, in order, while building F(X).  Working down the */
+/* remainder tree reads them back in an order known in advance.  A helper thread writes one buffer while the caller fills the other, and */
+/* reads the next buffer while the caller converts the previous one.  Reads are also hinted to the OS well ahead of time. */
+
+#define FTREE_IO_MAX_SEGMENTS	4
+#define FTREE_IO_PREFETCH_BUFS	8	/* Number of buffers to hint ahead of the read in progress */
+
+struct ftree_io {
+	bool	open;			/* TRUE if the Ftree file is open */
+	int	fd;			/* Ftree file */
+	char	filename[40];		/* Ftree file name, deleted when closed */
+	uint32_t coeff_size;		/* Size in bytes of one coefficient in binary */
+	uint32_t coeffs_per_buf;	/* Number of coefficients in each of the two buffers */
+	char	*buf[2];		/* The two buffers */
+	int	cur;			/* Buffer being filled or consumed by the caller */
+	uint32_t cur_count;		/* Coefficients consumed from buf[cur] */
+	uint32_t cur_avail;		/* Coefficients read into buf[cur] */
+	int64_t	cur_offset;		/* File offset of the coefficients in buf[cur] */
+	gwthread thread;		/* Helper thread reading or writing the other buffer */
+	bool	thread_active;		/* TRUE if the helper thread must be waited on */
+	bool	io_write;		/* Helper thread arguments: write vs. read */
+	int	io_buf;			/* Buffer to read into or write from */
+	int64_t	io_offset;		/* File offset */
+	uint32_t io_count;		/* Number of coefficients */
+	bool	error;			/* A read or write failed */
+	int64_t	write_offset;		/* File offset of the next write */
+	int	num_segments;		/* Read schedule, segments of coefficients in the order they will be consumed */
+	int	segment;		/* Segment the next read comes from */
+	int64_t	read_offset;		/* File offset of the next read */
+	int64_t	read_end;		/* File offset of the end of the segment */
+	int64_t	prefetch_len;		/* Bytes to hint ahead of the read in progress */
+	struct {
+		int64_t	offset;
+		int64_t	length;
+	} segments[FTREE_IO_MAX_SEGMENTS];
+	char	*batch;			/* Coefficients for ecm_helper to convert */
+	uint64_t batch_first;		/* Poly index of the first coefficient in the batch */
+	uint32_t batch_count;		/* Number of coefficients in the batch */
+	bool	batch_failed;		/* ecm_helper could not convert the batch */
+};
+
+/* Helper thread that reads or writes one buffer */
+
+void ftree_io_thread (
+	void	*arg)
+{
+	struct ftree_io *io = (struct ftree_io *) arg;
+	unsigned int bytes = io->io_count * io->coeff_size;
+
+	if (_lseeki64 (io->fd, io->io_offset, SEEK_SET) != io->io_offset) io->error = TRUE;
+	else if (io->io_write) {
+		if (_write (io->fd, io->buf[io->io_buf], bytes) != (int) bytes) io->error = TRUE;
+	} else {
+		if (_read (io->fd, io->buf[io->io_buf], bytes) != (int) bytes) io->error = TRUE;
+	}
+}
+
+/* Start the helper thread on a buffer.  The previous I/O must be complete. */
+
+void ftree_io_launch (
+	struct ftree_io *io,
+	bool	write,
+	int	buf,
+	int64_t	offset,
+	uint32_t count)
+{
+	ASSERTG (!io->thread_active);
+	io->io_write = write;
+	io->io_buf = buf;
+	io->io_offset = offset;
+	io->io_count = count;
+	io->thread_active = TRUE;
+	gwthread_create_waitable (&io->thread, &ftree_io_thread, io);
+}
+
+/* Wait for the helper thread.  Returns FALSE if any I/O has failed. */
+
+bool ftree_io_wait (
+	struct ftree_io *io)
+{
+	if (io->thread_active) {
+		gwthread_wait_for_exit (&io->thread);
+		io->thread_active = FALSE;
+	}
+	return (!io->error);
+}
+
+/* Create the Ftree file and allocate the buffers.  Returns FALSE on error. */
+
+bool ftree_io_open (
+	struct ftree_io *io,
+	const char *filename,
+	uint32_t coeff_size)		/* Size of a coefficient in binary */
+{
+	uint64_t bufsize;
+
+	memset (io, 0, sizeof (struct ftree_io));
+	io->coeff_size = coeff_size;
+	bufsize = (uint64_t) IniGetInt (INI_FILE, "EcmFtreeBufferSize", 8) << 20;
+	io->coeffs_per_buf = (uint32_t) (bufsize / coeff_size);
+	if (io->coeffs_per_buf < 1) io->coeffs_per_buf = 1;
+	io->buf[0] = (char *) malloc ((size_t) io->coeffs_per_buf * coeff_size);
+	io->buf[1] = (char *) malloc ((size_t) io->coeffs_per_buf * coeff_size);
+	if (io->buf[0] == NULL || io->buf[1] == NULL) goto err;
+	io->fd = _open (filename, _O_CREAT | _O_TRUNC | _O_BINARY | _O_RDWR, CREATE_FILE_ACCESS);
+	if (io->fd < 0) goto err;
+	strcpy (io->filename, filename);
+	io->open = TRUE;
+	return (TRUE);
+err:	free (io->buf[0]), io->buf[0] = NULL;
+	free (io->buf[1]), io->buf[1] = NULL;
+	return (FALSE);
+}
+
+/* Wait for any I/O, then close and delete the Ftree file */
+
+void ftree_io_close (
+	struct ftree_io *io)
+{
+	ftree_io_wait (io);
+	if (io->open) {
+		_chsize_s (io->fd, 0);		// On a google drive, deleting a big file does not free disk space.  So truncate it before deleting.
+		_close (io->fd);
+		_unlink (io->filename);
+		io->open = FALSE;
+	}
+	free (io->buf[0]), io->buf[0] = NULL;
+	free (io->buf[1]), io->buf[1] = NULL;
+}
+
+/* Write-behind.  The caller fills the buffer returned by ftree_io_write_buffer with up to coeffs_per_buf coefficients, then calls */
+/* ftree_io_write_commit.  That starts writing the buffer in the background and switches the caller to the other buffer. */
+
+char *ftree_io_write_buffer (
+	struct ftree_io *io)
+{
+	return (io->buf[io->cur]);
+}
+
+bool ftree_io_write_commit (
+	struct ftree_io *io,
+	uint32_t count)			/* Number of coefficients placed in the buffer */
+{
+	if (!ftree_io_wait (io)) return (FALSE);
+	ftree_io_launch (io, TRUE, io->cur, io->write_offset, count);
+	io->write_offset += (int64_t) count * io->coeff_size;
+	io->cur ^= 1;
+	return (TRUE);
+}
+
+/* Tell the OS which part of the file we will read soon or which part we are done with */
+
+void ftree_io_advise (
+	struct ftree_io *io,
+	int64_t	offset,
+	int64_t	len,
+	bool	willneed)		/* TRUE if the data will be read soon, FALSE if it will not be read again */
+{
+#ifdef POSIX_FADV_WILLNEED
+	if (len > 0) posix_fadvise (io->fd, offset, len, willneed ? POSIX_FADV_WILLNEED : POSIX_FADV_DONTNEED);
+#endif
+}
+
+/* Read-ahead.  Add segments to the read schedule in the order they will be consumed, then call ftree_io_start_reads. */
+
+void ftree_io_schedule_read (
+	struct ftree_io *io,
+	int64_t	first_coeff,		/* Offset of the segment in coefficients */
+	int64_t	num_coeffs)		/* Length of the segment in coefficients */
+{
+	ASSERTG (io->num_segments < FTREE_IO_MAX_SEGMENTS);
+	io->segments[io->num_segments].offset = first_coeff * io->coeff_size;
+	io->segments[io->num_segments].length = num_coeffs * io->coeff_size;
+	io->num_segments++;
+}
+
+/* Start reading the next buffer in the schedule into the buffer the caller is not using */
+
+void ftree_io_read_next (
+	struct ftree_io *io)
+{
+	uint32_t count;
+
+	while (io->read_offset == io->read_end) {
+		if (io->segment == io->num_segments) return;
+		io->read_offset = io->segments[io->segment].offset;
+		io->read_end = io->read_offset + io->segments[io->segment].length;
+		io->segment++;
+	}
+	count = (uint32_t) ((io->read_end - io->read_offset) / io->coeff_size);
+	if (count > io->coeffs_per_buf) count = io->coeffs_per_buf;
+	ftree_io_launch (io, FALSE, io->cur ^ 1, io->read_offset, count);
+	io->read_offset += (int64_t) count * io->coeff_size;
+	ftree_io_advise (io, io->read_offset, io->read_end - io->read_offset < io->prefetch_len ? io->read_end - io->read_offset : io->prefetch_len, TRUE);
+}
+
+/* Flush any writes and start reading the first buffer.  Call this as early as possible so the OS can read ahead while we do polymults. */
+
+bool ftree_io_start_reads (
+	struct ftree_io *io)
+{
+	if (!ftree_io_wait (io)) return (FALSE);
+	io->prefetch_len = (int64_t) FTREE_IO_PREFETCH_BUFS * io->coeffs_per_buf * io->coeff_size;
+	for (int i = 0; i < io->num_segments; i++)
+		ftree_io_advise (io, io->segments[i].offset, io->segments[i].length < io->prefetch_len ? io->segments[i].length : io->prefetch_len, TRUE);
+	io->segment = 0;
+	io->read_offset = io->read_end = 0;
+	io->cur = 0;
+	io->cur_count = io->cur_avail = 0;
+	ftree_io_read_next (io);
+	return (TRUE);
+}
+
+/* Return up to max_coeffs of the next coefficients in the schedule.  Returns NULL on a read error. */
+
+char *ftree_io_read (
+	struct ftree_io *io,
+	uint32_t max_coeffs,
+	uint32_t *count)		/* Returned number of coefficients */
+{
+	char	*data;
+
+	if (io->cur_count == io->cur_avail) {
+		if (!io->thread_active) return (NULL);		// Read past the end of the schedule
+		if (!ftree_io_wait (io)) return (NULL);
+		ftree_io_advise (io, io->cur_offset, (int64_t) io->cur_avail * io->coeff_size, FALSE);
+		io->cur ^= 1;
+		io->cur_offset = io->io_offset;
+		io->cur_count = 0;
+		io->cur_avail = io->io_count;
+		ftree_io_read_next (io);
+	}
+	*count = io->cur_avail - io->cur_count;
+	if (*count > max_coeffs) *count = max_coeffs;
+	data = io->buf[io->cur] + (size_t) io->cur_count * io->coeff_size;
+	io->cur_count += *count;
+	return (data);
+}
+
 /*************************************************/
 /* ECM structures and setup/termination routines */
 /*************************************************/
@@ -1470,6 +1871,15 @@ uint64_t calc_new_first_relocatable (
 #define ECM_STAGE2_PAIRING	0	/* Old fashioned prime pairing stage 2 */
 #define ECM_STAGE2_POLYMULT	1	/* FFT/polymult stage 2 */
 
+/* A curve whose stage 1 was run as part of a batch, waiting for its stage 2 */
+
+struct ecm_batch_curve {
+	uint64_t sigma;		/* Sigma for the curve */
+	giant	Qx_binary;	/* The x value of stage 1 result (Montgomery form) */
+	giant	Qz_binary;	/* The z value of stage 1 result (Montgomery form) */
+	giant	factor;		/* Factor found while choosing the curve or building a NAF dictionary, if any */
+};
+
 typedef struct {
 	gwhandle gwdata;	/* GWNUM handle */
 	int	thread_num;	/* Worker number */
@@ -1491,6 +1901,14 @@ typedef struct {
 	bool	optimal_B2;	/* TRUE if we calculate optimal bound #2 given currently available memory.  FALSE for a fixed bound #2. */
 	uint64_t average_B2;	/* Average Kruppa-adjusted bound #2 work done on ECM curves thusfar */
 	unsigned long stage1_fftlen; /* FFT length used in stage 1 */
+	struct background_gcd bg_gcd; /* Stage 2 GCD of the previous curve running in the background */
+	uint32_t bg_gcd_curve;	/* Curve # of the curve whose stage 2 GCD is running in the background */
+	uint64_t bg_gcd_sigma;	/* Sigma of that curve */
+	uint32_t bg_gcd_sigma_type; /* Sigma type of that curve */
+	uint64_t bg_gcd_C;	/* Bound #2 of that curve */
+	struct ecm_batch_curve *batch; /* Curves whose stage 1 was run as a batch */
+	uint32_t batch_count;	/* Number of curves in the batch */
+	uint32_t batch_next;	/* Next batch curve to run stage 2 on */
 
 	gwnum	Ad4;		/* Pre-computed value used for Montgomery doubling */
 	gwnum	ed_a;		/* "a" value in a twisted Edwards curve: ax^2 + y^2 = 1 + dx^2y^2 */
@@ -1502,9 +1920,8 @@ typedef struct {
 	void	*sieve_info;	/* Prime number sieve */
 	uint64_t stage1_prime;	/* Prime number being processed */
 
-	mpz_t	stage1_exp;	/* Edwards stage 1 exponent chunk (later converted to bit array indicating when to ed_dbl vs. ed_dbl and ed_add) */
-	char	*NAF_codes;	/* Edwards stage 1 NAF indexes extracted from exponent chunk and stored in a bit array */
-	bool	stage1_exp_initialized;/* Edwards stage 1 exponent initialized with mpz_init */
+	struct ecm_exp_chunk *stage1_exp; /* Edwards stage 1 exponent chunk, shared with other workers through the exponent cache */
+	struct ecm_NAF_codes *stage1_NAF; /* Edwards stage 1 bit arrays of which doublings need an add and the NAF indexes of those adds (also shared) */
 	uint64_t stage1_start_prime; /* Edwards stage 1 first prime in the current exponent chunk */
 	uint32_t stage1_exp_buffer_size; /* Edwards stage 1 buffer size (in bytes) used to build stage 1 exponent chunk */
 	uint32_t stage1_bitnum;	/* Edwards stage 1 bit number being processed in the exponent chunk */
@@ -1539,6 +1956,9 @@ typedef struct {
 	uint64_t last_relocatable; /* Last relocatable prime for filling pairmaps (unless mem change causes a replan) */
 	double	est_stage2_stage1_ratio; /* Estimated stage 2 runtime / stage 1 runtime ratio */
 	double	pct_mem_to_use;	/* If we get memory allocation errors, we progressively try using less and less. */
+	int	poly_file_failed; /* TRUE if the temporary file for out-of-core polys could not be created */
+	int	poly_in_core_only; /* TRUE if polys must be kept in memory because an out-of-core poly file could not be created */
+	char	poly_file_dir[260]; /* Directory for out-of-core poly files (OutOfCoreDir in prime.txt) */
 
 	struct xz Qm, Qprevm, QD; /* Values used to calculate successive D values in stage 2 */
 	struct xz QD_Eover2;	/* Normalized value used for second and later mQx blocks in two-FFT stage 2 */
@@ -1560,6 +1980,7 @@ typedef struct {
 	uint64_t max_pairmap_Dsections;	/* Number of D sections that can fit in a pairing map */
 	uint8_t	*pairmap;	/* Pairing map for prime pairs and singles in each D section */
 	uint64_t pairmap_size;	/* Size of the pairing map */
+	pairmap_producer bg_pairmap; /* Builds the next pairing map in the background */
 	uint8_t *pairmap_ptr;	/* Pointer to the next byte to process in the pairing map */
 
 	/* Polymult stage 2 data */
@@ -1577,6 +1998,7 @@ typedef struct {
 	int	norm_pool_temps_count; /* Number of free gwnums in norm_pool_temps */
 	int	Ftree_polys_in_mem; /* Number of Ftree polys to store in memory rather than on disk or rebuilding */
 	gwarray polyFtree[40];	/* Saved entries from polyF tree.  Needed by scaled remainders to work down the tree. */
+	struct ftree_io ftree_io; /* Ftree rows saved to disk */
 	gwarray	Ftree;		/* Array of gwnums used in Ftree reconstruction */
 
 	/* Helper routine data */
@@ -1586,6 +2008,16 @@ typedef struct {
 //	gwnum	*points;	/* Array of evaluated points for helper routine to accumulate into gg for later GCD */
 	int	helper_work;	/* Type of work ecm_helper should perform */
 	gwarray poly1;		/* Poly passed to ecm_helper */
+
+	/* Batch stage 1 data */
+	void	*batch_curves;	/* Array of per-curve ecmhandles, each with a cloned gwdata */
+	int	batch_first_NAF_index; /* First NAF index of the current exponent chunk */
+	uint64_t batch_num_doublings; /* Doublings needed for the current exponent chunk */
+	bool	batch_errchk;	/* TRUE if batch curves must always check for roundoff errors */
+	int	volatile batch_stop_reason; /* Set when a batch curve is interrupted or runs out of memory */
+	int	volatile batch_saving; /* Set when batch curves should pause so that their save files can be written */
+	double	batch_pct_base;	/* Stage 1 percent complete at the start of the current exponent chunk */
+	double	batch_pct_per_bit; /* Stage 1 percent complete of each exponent bit in the current chunk */
 } ecmhandle;
 
 /* Forward declarations */
@@ -1593,6 +2025,8 @@ typedef struct {
 void normalize_pool_term (ecmhandle *);
 void mQ_term (ecmhandle *);
 void NAF_dictionary_free (ecmhandle *);
+void ecm_batch_free (ecmhandle *);
+void ecm_exp_cache_release (struct ecm_exp_chunk **);
 
 /* Perform cleanup functions */
 
@@ -1607,12 +2041,14 @@ void ecm_mini_cleanup (
 	free (ecmdata->gg_binary), ecmdata->gg_binary = NULL;
 	if (ecmdata->stage2_type != ECM_STAGE2_POLYMULT) free (ecmdata->nQx);
 	ecmdata->nQx = NULL;
+	cancel_pairmap_producer (&ecmdata->bg_pairmap);
 	free (ecmdata->pairmap), ecmdata->pairmap = NULL;
 	free (ecmdata->factor), ecmdata->factor = NULL;
 	free (ecmdata->Ftree), ecmdata->Ftree = NULL;
+	ftree_io_close (&ecmdata->ftree_io);
 	end_sieve (ecmdata->sieve_info), ecmdata->sieve_info = NULL;
 	polymult_done (&ecmdata->polydata);
-	if (ecmdata->stage1_exp_initialized) mpz_clear (ecmdata->stage1_exp), ecmdata->stage1_exp_initialized = FALSE;
+	ecm_exp_cache_release (&ecmdata->stage1_exp), ecmdata->stage1_NAF = NULL;
 	NAF_dictionary_free (ecmdata);
 	gwfreeall (&ecmdata->gwdata);
 	memset (&ecmdata->xz, 0, sizeof (ecmdata->xz));
@@ -1627,6 +2063,11 @@ void ecm_mini_cleanup (
 void ecm_cleanup (
 	ecmhandle *ecmdata)
 {
+	giant	bg_factor;
+
+	finish_background_gcd (&ecmdata->bg_gcd, TRUE, &bg_factor);	// Should not happen, ecm() collects background GCD results before exiting
+	free (bg_factor);
+	ecm_batch_free (ecmdata);
 	ecm_mini_cleanup (ecmdata);
 	free (ecmdata->N), ecmdata->N = NULL;
 	if (ecmdata->N_short_string_rep != gwmodulo_as_string (&ecmdata->gwdata)) free (ecmdata->N_short_string_rep), ecmdata->N_short_string_rep = NULL;
@@ -1984,7 +2425,7 @@ void create_ed_half (
 #define ED_FFT_S1T		0x40	// For ed_add, FFT T in first source arg.  Second source arg is always FFTed.
 #define ED_SUBTRACT		0x80	// For ed_add, subtract instead of add.
 #define ED_FORCE_EXTEND		0x100	// For ed_extend, force extend computation using (or reusing) existing T buffer.
-#define ED_NO_GWALLOC		0x200	// For ed_dbl and ed_add called from NAF_dictionary_init.  Use in->t as for a temporary gwnum.
+#define ED_NO_GWALLOC		0x200	// For ed_dbl and ed_add called from NAF_dictionary_build.  Use in->t as for a temporary gwnum.
 
 /* Turn an (X:Y:Z) Edwards point into an extended (X:Y:T:Z) extended Edwards point */
 
@@ -4717,12 +5158,10 @@ bool dict_normalize (
 	return (TRUE);
 }
 
-/* Prepare for NAF exponentiation.  Convert the exponent to a bit array indicating which doublings will require an add.  Build the NAF dictionary. */
+/* Build the NAF dictionary of odd multiples of dict_start */
 
-bool NAF_dictionary_init (
-	ecmhandle *ecmdata,
-	int	*first_NAF_index,	// First NAF index to use to get the exponentiation started
-	uint64_t *num_doublings)	// Number of doubling that NAF exponentiation will need to perform
+bool NAF_dictionary_build (
+	ecmhandle *ecmdata)
 {
 	// Allocate the dictionary and gwnums
 	ecmdata->NAF_dictionary = (struct ed *) malloc (ecmdata->NAF_dictionary_size * sizeof (struct ed));
@@ -4796,23 +5235,31 @@ bool NAF_dictionary_init (
 		ecmdata->NAF_dictionary[i].t = *next_available_gwnum++;
 		ed_extend (ecmdata, &ecmdata->NAF_dictionary[i], ED_FORCE_EXTEND);
 	}
+	return (TRUE);
+}
 
-// Allocate a buffer for the NAF_codes
+/* Convert the exponent to a bit array indicating which doublings will require an add.  The NAF codes depend only on the exponent and */
+/* the dictionary size, so all curves using the same exponent chunk and dictionary size can share them. */
 
-	uint64_t len = mpz_sizeinbase (ecmdata->stage1_exp, 2);
-	ecmdata->NAF_codes = (char *) malloc ((size_t) divide_rounding_up (len, 8));
-	memset (ecmdata->NAF_codes, 0, (size_t) divide_rounding_up (len, 8));
+void NAF_codes_init (
+	mpz_t	exp,			// Exponent chunk, converted in place to the bit array of doublings that require an add
+	uint32_t dictionary_size,	// Size of the NAF dictionary
+	char	*NAF_codes,		// Zeroed bit array to receive the NAF codes
+	int	*first_NAF_index,	// First NAF index to use to get the exponentiation started
+	uint64_t *num_doublings)	// Number of doubling that NAF exponentiation will need to perform
+{
+	uint64_t len = mpz_sizeinbase (exp, 2);
 
 // The optimal scenario is for the first NAF code to consume as many most-significant bits as possible.  This will reduce the number of doublings
 // the exponentiation code needs to perform.
 
 	uint64_t bitnum = len - 1;
-	int max_dictionary_value = 2 * ecmdata->NAF_dictionary_size - 1;
+	int max_dictionary_value = 2 * dictionary_size - 1;
 	int first_NAF_value;
 	for (int tmp = 0; tmp * 2 + 1 <= max_dictionary_value; bitnum--) {
 		tmp *= 2;
-		if (mpz_tstbit64 (ecmdata->stage1_exp, bitnum)) {
-			mpz_clrbit64 (ecmdata->stage1_exp, bitnum);	// Clear bit in case there is a carry later on that alters first_NAF_value
+		if (mpz_tstbit64 (exp, bitnum)) {
+			mpz_clrbit64 (exp, bitnum);	// Clear bit in case there is a carry later on that alters first_NAF_value
 			tmp++;
 			first_NAF_value = tmp;
 			*num_doublings = bitnum;
@@ -4827,12 +5274,12 @@ bool NAF_dictionary_init (
 	int carry = 0;
 	for (bitnum = 0; bitnum < *num_doublings; bitnum++) {
 		// Combine carry from negative NAF code and the current exponent bit
-		int this_bit = carry + (mpz_tstbit64 (ecmdata->stage1_exp, bitnum) ? 1 : 0);
+		int this_bit = carry + (mpz_tstbit64 (exp, bitnum) ? 1 : 0);
 		carry = this_bit / 2;
 		this_bit = this_bit & 1;
 		// Flag the start of a new NAF value.  This is where a double and add operation must take place during NAF exponentiation.
-		if (NAF_value_under_construction == 0 && this_bit) mpz_setbit64 (ecmdata->stage1_exp, bitnum);
-		else mpz_clrbit64 (ecmdata->stage1_exp, bitnum);
+		if (NAF_value_under_construction == 0 && this_bit) mpz_setbit64 (exp, bitnum);
+		else mpz_clrbit64 (exp, bitnum);
 		// Continue construction of the NAF value
 		if (this_bit) NAF_value_under_construction += NAF_value_addin;
 		if (NAF_value_under_construction == 0) continue;
@@ -4845,9 +5292,9 @@ bool NAF_dictionary_init (
 		// We have a completed NAF value, turn it into a code and output it
 		int NAF_code;
 		if (NAF_value_under_construction <= max_dictionary_value) NAF_code = (NAF_value_under_construction - 1) / 2;
-		else NAF_code = (NAF_value_addin - NAF_value_under_construction - 1) / 2 + ecmdata->NAF_dictionary_size, carry = 1;
+		else NAF_code = (NAF_value_addin - NAF_value_under_construction - 1) / 2 + dictionary_size, carry = 1;
 		for (uint64_t write_bitnum = bitnum; NAF_value_addin >>= 1; write_bitnum--) {
-			if (NAF_code & NAF_value_addin) bitset (ecmdata->NAF_codes, write_bitnum);
+			if (NAF_code & NAF_value_addin) bitset (NAF_codes, write_bitnum);
 		}
 		// Setup to construct next NAF value
 		NAF_value_under_construction = 0;
@@ -4856,8 +5303,398 @@ bool NAF_dictionary_init (
 	// If there is a carry, the first NAF value needs to be changed
 	if (carry) for (first_NAF_value = first_NAF_value + 1; (first_NAF_value & 1) == 0; first_NAF_value /= 2) *num_doublings = *num_doublings + 1;
 	*first_NAF_index = (first_NAF_value - 1) / 2;
-	// Success
+}
+
+/**************************************************************
+ *
+ *	Stage 1 exponent cache
+ *
+ **************************************************************/
+
+/* ECM farms run thousands of curves at a handful of standard B1 values.  Rather than have every curve sieve and multiply the same primes into */
+/* the same exponent chunks and then recode them into the same NAF codes, chunks are cached and shared read-only by all workers.  An exponent */
+/* chunk depends only on B1, its starting prime, and ECMStage1ExpBufferSize.  Its NAF codes also depend on the dictionary size.  If */
+/* ECMExpCacheDir is set, exponent chunks are also saved in that directory and memory-mapped.  Other prime95 processes then share the same */
+/* pages and later runs skip building the chunks altogether. */
+
+#define ECM_EXP_CACHE_MAGIC	0x45434D58
+#define ECM_EXP_CACHE_VERSION	1
+#define ECM_EXP_CACHE_FILENAME_LEN (260+80)	/* ECMExpCacheDir plus the longest cache file name */
+
+struct ecm_exp_cache_header {		/* Header of an exponent chunk cache file */
+	uint32_t magic;
+	uint32_t version;
+	uint64_t B1;
+	uint64_t start_prime;
+	uint64_t bufsize;
+	uint64_t next_prime;
+	uint64_t explen;
+	uint32_t checksum;		/* Checksum of the exponent bytes that follow the header */
+	uint32_t pad;
+};
+
+struct ecm_NAF_codes {			/* An exponent chunk's NAF codes for one dictionary size */
+	struct ecm_NAF_codes *next;
+	uint32_t dictionary_size;	/* Dictionary size the NAF codes were built for */
+	int	first_NAF_index;	/* First NAF index to use to get the exponentiation started */
+	uint64_t num_doublings;		/* Number of doublings the NAF exponentiation will perform */
+	char	*add_bits;		/* Bit array indicating which doublings require an add */
+	char	*NAF_codes;		/* NAF indexes of the adds stored in a bit array */
+};
+
+struct ecm_exp_chunk {			/* A cached exponent chunk */
+	struct ecm_exp_chunk *next;
+	int	refcount;		/* Number of workers using (or waiting for) this chunk */
+	bool	building;		/* TRUE while a worker builds or reads the chunk outside the lock */
+	gwevent	built;			/* Signalled when the worker building the chunk is done */
+	uint64_t B1;			/* Stage 1 bound */
+	uint64_t start_prime;		/* First prime in the chunk */
+	uint64_t bufsize;		/* ECMStage1ExpBufferSize in bytes */
+	uint64_t next_prime;		/* First prime after the chunk */
+	uint64_t explen;		/* Length of the exponent in bits */
+	const unsigned char *exp;	/* Exponent bytes, least significant first.  Either malloc'ed or in the mapped cache file. */
+	void	*map;			/* Mapped cache file, if any */
+	int64_t	map_size;		/* Size of the mapped cache file */
+	void	*map_handle;		/* OS handle of the mapped cache file */
+	struct ecm_NAF_codes *NAF;	/* NAF codes built thusfar */
+	uint64_t mem_used;		/* Bytes of malloc'ed or mapped memory charged to the cache for this chunk */
+};
+
+static	int	ECM_EXP_CACHE_MUTEX_INITIALIZED = FALSE;
+static	gwmutex	ECM_EXP_CACHE_MUTEX;		/* Lock for accessing the exponent cache */
+static	struct ecm_exp_chunk *ECM_EXP_CACHE = NULL;	/* Cached exponent chunks, most recently used first */
+static	uint64_t ECM_EXP_CACHE_MEM = 0;		/* Bytes of memory used by cached exponent chunks */
+
+/* Checksum an exponent chunk's bytes */
+
+uint32_t ecm_exp_cache_checksum (
+	const unsigned char *exp,
+	uint64_t len)
+{
+	uint32_t sum = 0;
+	for (uint64_t i = 0; i < len; i++) sum = ((sum << 5) | (sum >> 27)) + exp[i];
+	return (sum);
+}
+
+/* Generate the file name of a cached exponent chunk.  Returns FALSE if the name does not fit. */
+
+bool ecm_exp_cache_filename (
+	const char *dir,
+	uint64_t B1,
+	uint64_t start_prime,
+	uint64_t bufsize,
+	char	*filename)		/* ECM_EXP_CACHE_FILENAME_LEN bytes */
+{
+	size_t	len = strlen (dir);
+	const char *separator = (len && dir[len-1] == getDirectorySeparator ()) ? "" : (getDirectorySeparator () == '/' ? "/" : "\\");
+	int	n = snprintf (filename, ECM_EXP_CACHE_FILENAME_LEN, "%s%secm_%" PRIu64 "_%" PRIu64 "_%" PRIu64 ".exp", dir, separator, B1, start_prime, bufsize);
+	return (n > 0 && n < ECM_EXP_CACHE_FILENAME_LEN);
+}
+
+/* Read an exponent chunk from the cache directory.  Memory-map the file if possible so that all processes share the same pages. */
+
+bool ecm_exp_cache_read (
+	const char *filename,
+	struct ecm_exp_chunk *chunk)
+{
+	struct ecm_exp_cache_header hdr;
+	int	fd;
+	int64_t	filesize, bytes;
+
+	fd = _open (filename, _O_BINARY | _O_RDONLY);
+	if (fd < 0) return (FALSE);
+	if (_read (fd, &hdr, sizeof (hdr)) != sizeof (hdr)) goto bad;
+	if (hdr.magic != ECM_EXP_CACHE_MAGIC || hdr.version != ECM_EXP_CACHE_VERSION ||
+	    hdr.B1 != chunk->B1 || hdr.start_prime != chunk->start_prime || hdr.bufsize != chunk->bufsize) goto bad;
+	bytes = divide_rounding_up (hdr.explen, 8);
+	filesize = _lseeki64 (fd, 0, SEEK_END);
+	if (bytes == 0 || filesize != (int64_t) sizeof (hdr) + bytes) goto bad;
+
+/* Map the file.  If that is not supported, read it into memory. */
+
+	chunk->map = mapFileForReading (fd, filesize, &chunk->map_handle);
+	if (chunk->map != NULL) {
+		chunk->map_size = filesize;
+		chunk->exp = (const unsigned char *) chunk->map + sizeof (hdr);
+		chunk->mem_used = filesize;		// Mapped pages count against the cache limit too
+	} else {
+		unsigned char *buf = (unsigned char *) malloc ((size_t) bytes);
+		if (buf == NULL) goto bad;
+		chunk->exp = buf;
+		chunk->mem_used = bytes;
+		_lseeki64 (fd, sizeof (hdr), SEEK_SET);
+		if (_read (fd, buf, (unsigned int) bytes) != bytes) goto bad;
+	}
+	_close (fd);
+
+/* Validate the checksum.  This guards against partial or corrupt files. */
+
+	if (ecm_exp_cache_checksum (chunk->exp, bytes) != hdr.checksum) goto bad2;
+	chunk->next_prime = hdr.next_prime;
+	chunk->explen = hdr.explen;
 	return (TRUE);
+
+bad:	_close (fd);
+bad2:	if (chunk->map != NULL) unmapFile (chunk->map, chunk->map_size, chunk->map_handle), chunk->map = NULL;
+	else free ((void *) chunk->exp);
+	chunk->exp = NULL;
+	chunk->mem_used = 0;
+	return (FALSE);
+}
+
+/* Save a newly built exponent chunk in the cache directory.  Write a temporary file and rename it so that no process maps a partial file. */
+
+void ecm_exp_cache_write (
+	const char *filename,
+	struct ecm_exp_chunk *chunk)
+{
+	struct ecm_exp_cache_header hdr;
+	char	tmp_filename[ECM_EXP_CACHE_FILENAME_LEN+8];
+	int	fd;
+	int64_t	bytes;
+	bool	ok;
+
+	memset (&hdr, 0, sizeof (hdr));
+	hdr.magic = ECM_EXP_CACHE_MAGIC;
+	hdr.version = ECM_EXP_CACHE_VERSION;
+	hdr.B1 = chunk->B1;
+	hdr.start_prime = chunk->start_prime;
+	hdr.bufsize = chunk->bufsize;
+	hdr.next_prime = chunk->next_prime;
+	hdr.explen = chunk->explen;
+	bytes = divide_rounding_up (chunk->explen, 8);
+	hdr.checksum = ecm_exp_cache_checksum (chunk->exp, bytes);
+
+	sprintf (tmp_filename, "%s.tmp", filename);
+	fd = _open (tmp_filename, _O_BINARY | _O_WRONLY | _O_CREAT | _O_TRUNC, CREATE_FILE_ACCESS);
+	if (fd < 0) return;
+	ok = (_write (fd, &hdr, sizeof (hdr)) == sizeof (hdr) && _write (fd, chunk->exp, (unsigned int) bytes) == bytes);
+	_close (fd);
+	if (!ok || rename (tmp_filename, filename)) _unlink (tmp_filename);
+}
+
+/* Free a cached exponent chunk */
+
+void ecm_exp_cache_free_chunk (
+	struct ecm_exp_chunk *chunk)
+{
+	while (chunk->NAF != NULL) {
+		struct ecm_NAF_codes *NAF = chunk->NAF;
+		chunk->NAF = NAF->next;
+		free (NAF->add_bits);
+		free (NAF);
+	}
+	if (chunk->map != NULL) unmapFile (chunk->map, chunk->map_size, chunk->map_handle);
+	else free ((void *) chunk->exp);
+	gwevent_destroy (&chunk->built);
+	free (chunk);
+}
+
+/* Return the exponent chunk for B1 starting at start_prime, building it if it is not in the cache.  The chunk is built (or read from the */
+/* cache directory) outside the lock.  A placeholder in the cache makes other workers wanting the same chunk wait rather than build it too. */
+
+int ecm_exp_cache_get (
+	int	thread_num,
+	void	**sieve_info,		/* Sieve to recycle when building the chunk */
+	uint64_t B1,			/* Stage 1 bound */
+	uint64_t start_prime,		/* First prime in the chunk */
+	uint64_t bufsize,		/* ECMStage1ExpBufferSize in bytes */
+	struct ecm_exp_chunk **returned_chunk)
+{
+	struct ecm_exp_chunk *chunk, **prev;
+	char	dir[260], filename[ECM_EXP_CACHE_FILENAME_LEN];
+	unsigned char *buf;
+	mpz_t	exp;
+	uint64_t p, bytes;
+	int	stop_reason;
+
+	if (!ECM_EXP_CACHE_MUTEX_INITIALIZED) {
+		ECM_EXP_CACHE_MUTEX_INITIALIZED = 1;
+		gwmutex_init (&ECM_EXP_CACHE_MUTEX);
+	}
+	gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+
+/* Look for the chunk in memory.  If another worker is building it, wait for that worker to finish. */
+
+retry:	for (prev = &ECM_EXP_CACHE; (chunk = *prev) != NULL; prev = &chunk->next) {
+		if (chunk->B1 == B1 && chunk->start_prime == start_prime && chunk->bufsize == bufsize) break;
+	}
+	if (chunk != NULL && chunk->building) {
+		chunk->refcount++;
+		gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+		gwevent_wait (&chunk->built, 0);
+		gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+		if (chunk->exp != NULL) {
+			chunk->refcount--;		// The found code takes this worker's reference
+			goto found;
+		}
+		// The other worker failed to build the chunk and has taken it out of the cache
+		if (--chunk->refcount == 0) ecm_exp_cache_free_chunk (chunk);
+		goto retry;
+	}
+	if (chunk != NULL) goto found;
+
+/* Add a placeholder for the chunk */
+
+	chunk = (struct ecm_exp_chunk *) malloc (sizeof (struct ecm_exp_chunk));
+	if (chunk == NULL) {
+		gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+		return (OutOfMemory (thread_num));
+	}
+	memset (chunk, 0, sizeof (struct ecm_exp_chunk));
+	chunk->B1 = B1;
+	chunk->start_prime = start_prime;
+	chunk->bufsize = bufsize;
+	chunk->building = TRUE;
+	chunk->refcount = 1;
+	gwevent_init (&chunk->built);
+	chunk->next = ECM_EXP_CACHE;
+	ECM_EXP_CACHE = chunk;
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+
+/* Look for the chunk in the cache directory */
+
+	IniGetString (INI_FILE, "ECMExpCacheDir", dir, sizeof (dir), NULL);
+	if (dir[0] && !ecm_exp_cache_filename (dir, B1, start_prime, bufsize, filename)) dir[0] = 0;
+	if (dir[0] && ecm_exp_cache_read (filename, chunk)) goto built;
+
+/* Build the chunk by sieving the primes and multiplying them together */
+
+	stop_reason = start_sieve_with_limit (thread_num, start_prime, (uint32_t) sqrt ((double) B1), sieve_info);
+	if (stop_reason) goto failed;
+	p = sieve (*sieve_info);
+	mpz_init (exp);
+	ecm_calc_exp (*sieve_info, exp, B1, &p, bufsize);
+	chunk->next_prime = p;
+	chunk->explen = mpz_sizeinbase (exp, 2);
+	bytes = divide_rounding_up (chunk->explen, 8);
+	buf = (unsigned char *) malloc ((size_t) bytes);
+	if (buf == NULL) {
+		mpz_clear (exp);
+		stop_reason = OutOfMemory (thread_num);
+		goto failed;
+	}
+	memset (buf, 0, (size_t) bytes);
+	mpz_export (buf, NULL, -1, 1, 0, 0, exp);
+	mpz_clear (exp);
+	chunk->exp = buf;
+	chunk->mem_used = bytes;
+	if (dir[0]) ecm_exp_cache_write (filename, chunk);
+
+/* Let waiting workers use the chunk */
+
+built:	gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+	ECM_EXP_CACHE_MEM += chunk->mem_used;
+	chunk->building = FALSE;
+	gwevent_signal (&chunk->built);
+	*returned_chunk = chunk;
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+	return (0);
+
+/* Put the chunk at the front of the most recently used list */
+
+found:	prev = &ECM_EXP_CACHE;
+	while (*prev != chunk) prev = &(*prev)->next;
+	*prev = chunk->next;
+	chunk->next = ECM_EXP_CACHE;
+	ECM_EXP_CACHE = chunk;
+	chunk->refcount++;
+	*returned_chunk = chunk;
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+	return (0);
+
+/* Building the chunk failed.  Remove the placeholder and wake any waiting workers so they can try building it. */
+
+failed:	gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+	prev = &ECM_EXP_CACHE;
+	while (*prev != chunk) prev = &(*prev)->next;
+	*prev = chunk->next;
+	chunk->building = FALSE;
+	gwevent_signal (&chunk->built);
+	if (--chunk->refcount == 0) ecm_exp_cache_free_chunk (chunk);
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+	return (stop_reason);
+}
+
+/* Return a chunk's NAF codes for a dictionary size, building them if necessary.  Returns NULL if out of memory.  The NAF codes are built */
+/* outside the lock.  Should another worker add the same NAF codes in the meantime, ours are discarded. */
+
+struct ecm_NAF_codes *ecm_exp_cache_NAF (
+	struct ecm_exp_chunk *chunk,
+	uint32_t dictionary_size)
+{
+	struct ecm_NAF_codes *NAF, *other;
+	mpz_t	exp;
+	uint64_t bytes;
+
+	gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+	for (NAF = chunk->NAF; NAF != NULL; NAF = NAF->next) if (NAF->dictionary_size == dictionary_size) break;
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+	if (NAF != NULL) return (NAF);
+
+/* Allocate and zero both bit arrays */
+
+	bytes = divide_rounding_up (chunk->explen, 8);
+	NAF = (struct ecm_NAF_codes *) malloc (sizeof (struct ecm_NAF_codes));
+	if (NAF == NULL) return (NULL);
+	NAF->add_bits = (char *) malloc ((size_t) (2 * bytes));
+	if (NAF->add_bits == NULL) {
+		free (NAF);
+		return (NULL);
+	}
+	memset (NAF->add_bits, 0, (size_t) (2 * bytes));
+	NAF->NAF_codes = NAF->add_bits + bytes;
+	NAF->dictionary_size = dictionary_size;
+
+/* Convert the exponent.  What remains of the exponent is the bit array of doublings that require an add. */
+
+	mpz_init (exp);
+	mpz_import (exp, (size_t) bytes, -1, 1, 0, 0, chunk->exp);
+	NAF_codes_init (exp, dictionary_size, NAF->NAF_codes, &NAF->first_NAF_index, &NAF->num_doublings);
+	mpz_export (NAF->add_bits, NULL, -1, 1, 0, 0, exp);
+	mpz_clear (exp);
+
+/* Add the NAF codes to the chunk */
+
+	gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+	for (other = chunk->NAF; other != NULL; other = other->next) if (other->dictionary_size == dictionary_size) break;
+	if (other != NULL) {
+		free (NAF->add_bits);
+		free (NAF);
+		NAF = other;
+	} else {
+		NAF->next = chunk->NAF;
+		chunk->NAF = NAF;
+		chunk->mem_used += 2 * bytes;
+		ECM_EXP_CACHE_MEM += 2 * bytes;
+	}
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
+	return (NAF);
+}
+
+/* Stop using an exponent chunk.  Unused chunks stay cached until the cache exceeds ECMExpCacheMemory, then the least recently used go first. */
+
+void ecm_exp_cache_release (
+	struct ecm_exp_chunk **chunk)
+{
+	struct ecm_exp_chunk *lru, **prev, **lru_prev;
+	uint64_t max_mem;
+
+	if (*chunk == NULL) return;
+	gwmutex_lock (&ECM_EXP_CACHE_MUTEX);
+	(*chunk)->refcount--;
+	*chunk = NULL;
+	max_mem = (uint64_t) IniGetInt (INI_FILE, "ECMExpCacheMemory", 256) << 20;
+	while (ECM_EXP_CACHE_MEM > max_mem) {
+		lru = NULL;
+		for (prev = &ECM_EXP_CACHE; *prev != NULL; prev = &(*prev)->next)
+			if ((*prev)->refcount == 0) lru = *prev, lru_prev = prev;
+		if (lru == NULL) break;
+		*lru_prev = lru->next;
+		ECM_EXP_CACHE_MEM -= lru->mem_used;
+		ecm_exp_cache_free_chunk (lru);
+	}
+	gwmutex_unlock (&ECM_EXP_CACHE_MUTEX);
 }
 
 void NAF_code (			// Return the NAF code for the doubling at bit i
@@ -4868,7 +5705,7 @@ void NAF_code (			// Return the NAF code for the doubling at bit i
 {
 	int NAF_code = 0;
 	for (int addin = 1; addin < (int) (2*ecmdata->NAF_dictionary_size); addin <<= 1, i++) {
-		if (bittst (ecmdata->NAF_codes, i)) NAF_code += addin;
+		if (bittst (ecmdata->stage1_NAF->NAF_codes, i)) NAF_code += addin;
 	}
 	if (NAF_code < (int) ecmdata->NAF_dictionary_size) *NAF_index = NAF_code, *subtract = FALSE;
 	else *NAF_index = NAF_code - ecmdata->NAF_dictionary_size, *subtract = TRUE;
@@ -4878,16 +5715,14 @@ void NAF_code (			// Return the NAF code for the doubling at bit i
 void NAF_dictionary_free (
 	ecmhandle *ecmdata)
 {
-	free (ecmdata->NAF_codes), ecmdata->NAF_codes = NULL;
 	gwfree_array (&ecmdata->gwdata, ecmdata->NAF_gwnums), ecmdata->NAF_gwnums = NULL;
 	free (ecmdata->NAF_dictionary), ecmdata->NAF_dictionary = NULL;
 }
 
 uint32_t NAF_best_size (	// Return the best size for the dictionary
-	ecmhandle *ecmdata)
+	ecmhandle *ecmdata,
+	uint64_t explen)	// Length of the exponent chunk in bits
 {
-	uint64_t explen = mpz_sizeinbase (ecmdata->stage1_exp, 2);
-
 // The "optimal" dictionary size occurs when the cost of adding one entry to the dictionary entry equals the savings from reduced ed_adds.
 // Initializing a dictionary and FFTing x,y,t costs 1 ed_add with 50% chance two is normalized, 3 muls to normalize z, 2 muls to norm x and y,
 // 1 mul for ed_extend, and one forward transform of t.  The ed_add costs 16 transforms half the time and 14 transforms the other half.  The 6 muls
@@ -5852,6 +6687,7 @@ if (cost_data->c.numvals < 6*32) return (-1.0);
 /* If excess memory is available, it can be used to save Ftree polys.  This will save on the costs of rebuilding F(X). */
 /* Saving (and restoring) two Ftree rows to/from disk requires gwtobinary and binarytogw on two polys.  This timed as equal to 13.2 transforms per gwnum (b=2) */
 /* and 687 transforms (b!=2) on a single-threaded FMA machine (ignoring disk read/write time).  For lack of a better place to record this cost, add it to cost_modinv. */
+/* The conversions are spread over all stage 2 threads and disk reads and writes overlap with them, so the cost is not multiplied by stage2_threads. */
 
 		int	num_Ftree_polys, Ftree_polys_in_mem, more_Ftree_polys_in_mem, total_Ftree_polys_in_mem, needing_rebuild;
 		num_Ftree_polys = (int) ceil (log2 ((double) poly_size));
@@ -5863,7 +6699,7 @@ if (Ftree_polys_in_mem + more_Ftree_polys_in_mem > num_Ftree_polys - 1) more_Ftr
 		total_Ftree_polys_in_mem = Ftree_polys_in_mem + more_Ftree_polys_in_mem;
 		cost_data->Ftree_polys_in_mem = total_Ftree_polys_in_mem;
 		cost_data->c.stage2_numvals += more_Ftree_polys_in_mem * poly_size;
-		if (total_Ftree_polys_in_mem < 2) cost_modinv += (cost_data->c.gwdata->b == 2 ? 13.2 : 687.0) * cost_data->c.stage2_threads * (2 - total_Ftree_polys_in_mem) * poly_size;
+		if (total_Ftree_polys_in_mem < 2) cost_modinv += (cost_data->c.gwdata->b == 2 ? 13.2 : 687.0) * (2 - total_Ftree_polys_in_mem) * poly_size;
 
 /* Rebuilding F(X) tree requires (log2(poly_size) - Ftree_polys_in_mem_or_on_disk) polymults on poly_size coefficients */
 
@@ -5930,6 +6766,8 @@ double ecm_stage2_impl_given_numvals (
 	cost_data.c.poly_compression = (double) gwfftlen (&ecmdata->gwdata) * (double) sizeof (double) / (double) array_gwnum_size (&ecmdata->gwdata);
 	if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == 2) cost_data.c.poly_compression *= 0.875;
 	if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == 0) cost_data.c.poly_compression = 1.0;
+	// PolyF and polyR stored out-of-core do not use any of our memory
+	else if (IniGetInt (INI_FILE, "ECMPolyOutOfCore", 0) && !ecmdata->poly_in_core_only) cost_data.c.poly_compression = 0.0;
 //GW: factor this compressed memory into numvals!
 
 /* Whether Ftree rows can be stored on disk may make a significant difference */
@@ -6175,6 +7013,7 @@ double ecm_stage2_impl (
 /* If are continuing from a save file that was in stage 2, toss the save file's pair map. */
 
 	if (ecmdata->state >= ECM_STATE_STAGE2) {
+		cancel_pairmap_producer (&ecmdata->bg_pairmap);
 		free (ecmdata->pairmap);
 		ecmdata->pairmap = NULL;
 		ecmdata->pairmap_size = 0;
@@ -6420,7 +7259,8 @@ readerr:
 }
 
 int ecm_restore (			/* For version 30.4 and later save files */
-	ecmhandle *ecmdata)
+	ecmhandle *ecmdata,
+	char	*filename)
 {
 	int	fd;
 	struct work_unit *w = ecmdata->w;
@@ -6429,7 +7269,7 @@ int ecm_restore (			/* For version 30.4 and later save files */
 
 /* Open the intermediate file */
 
-	fd = _open (ecmdata->read_save_file_state.current_filename, _O_BINARY | _O_RDONLY);
+	fd = _open (filename, _O_BINARY | _O_RDONLY);
 	if (fd < 0) goto err;
 
 /* Read the file header */
@@ -6599,11 +7439,217 @@ err:
 }
 
 
+/* Batched Edwards stage 1.  For small numbers the FFTs are too small for gwnum's multithreading to pay off.  Instead, each thread runs stage 1 */
+/* on its own curve using a cloned gwdata.  The curves share the stage 1 exponent chunks and their NAF codes, each curve builds its own NAF */
+/* dictionary.  Stage 1 results are converted to Montgomery form and queued up in binary until each curve gets its turn at stage 2. */
+
+void ecm_batch_free (
+	ecmhandle *ecmdata)
+{
+	for (uint32_t i = 0; i < ecmdata->batch_count; i++) {
+		free (ecmdata->batch[i].Qx_binary);
+		free (ecmdata->batch[i].Qz_binary);
+		free (ecmdata->batch[i].factor);
+	}
+	free (ecmdata->batch), ecmdata->batch = NULL;
+	ecmdata->batch_count = ecmdata->batch_next = 0;
+}
+
+/* Each batch curve gets its own save file, named after the work unit's save file and the curve number.  These save files are */
+/* in the normal single curve format so that an interrupted batch can resume one curve at a time. */
+
+void ecm_batch_filename (
+	ecmhandle *ecmdata,
+	uint32_t curve,
+	char	*filename)
+{
+	sprintf (filename, "%s.c%" PRIu32, ecmdata->write_save_file_state.base_filename, curve);
+}
+
+/* Write a batch curve's save file */
+
+void ecm_batch_save (
+	ecmhandle *ecmdata,	// Handle owning the batch
+	ecmhandle *cdata,	// The curve's handle using a cloned gwdata
+	uint32_t curve)		// The curve's number
+{
+	char	filename[80];
+
+	ecm_batch_filename (ecmdata, curve, filename);
+	writeSaveFileStateInit (&cdata->write_save_file_state, filename, 0);
+	cdata->w = ecmdata->w;
+	cdata->curve = curve;
+	cdata->average_B2 = ecmdata->average_B2;
+	cdata->C = ecmdata->C;
+	ecm_save (cdata);
+}
+
+/* Delete the save files of batch curves that are complete or no longer needed */
+
+void ecm_batch_unlink (
+	ecmhandle *ecmdata,
+	uint32_t first_curve,
+	uint32_t last_curve)
+{
+	writeSaveFileState write_save_file_state;
+	char	filename[80];
+
+	for (uint32_t curve = first_curve; curve <= last_curve; curve++) {
+		ecm_batch_filename (ecmdata, curve, filename);
+		writeSaveFileStateInit (&write_save_file_state, filename, 0);
+		unlinkSaveFiles (&write_save_file_state);
+	}
+}
+
+/* Look for a save file written by an interrupted batch for the current curve.  Returns TRUE if the curve was restored, */
+/* either in the middle of Edwards stage 1 or waiting for stage 2. */
+
+bool ecm_batch_restore (
+	ecmhandle *ecmdata)
+{
+	readSaveFileState read_save_file_state;
+	char	filename[80];
+	uint32_t curve = ecmdata->curve;
+	uint64_t average_B2 = ecmdata->average_B2;
+	uint64_t C = ecmdata->C;
+
+	ecm_batch_filename (ecmdata, curve, filename);
+	readSaveFileStateInit (&read_save_file_state, ecmdata->thread_num, filename);
+	while (saveFileExists (&read_save_file_state)) {
+		if (ecm_restore (ecmdata, read_save_file_state.current_filename)) {
+			if (ecmdata->curve == curve &&
+			    (ecmdata->state == ECM_STATE_MIDSTAGE || (ecmdata->state == ECM_STATE_STAGE1 && !ecmdata->montg_stage1))) return (TRUE);
+			free (ecmdata->Qx_binary), ecmdata->Qx_binary = NULL;
+			free (ecmdata->Qz_binary), ecmdata->Qz_binary = NULL;
+			free (ecmdata->gg_binary), ecmdata->gg_binary = NULL;
+			free_xz (ecmdata, &ecmdata->xz);
+			ed_free (ecmdata, &ecmdata->dict_start);
+			ed_free (ecmdata, &ecmdata->e);
+		}
+		saveFileBad (&read_save_file_state);
+	}
+
+/* No usable save file, start the curve from scratch */
+
+	ecmdata->curve = curve;
+	ecmdata->average_B2 = average_B2;
+	ecmdata->C = C;
+	ecmdata->state = ECM_STATE_STAGE1_INIT;
+	return (FALSE);
+}
+
+/* Run one exponent chunk of stage 1 on one batch curve */
+
+void ecm_batch_curve_chunk (
+	ecmhandle *ecmdata,	// Handle owning the exponent chunk and NAF codes
+	ecmhandle *cdata,	// The curve's handle using a cloned gwdata
+	int	helper_num)	// 0 = main thread, which also checks for interrupts and updates the title
+{
+	struct ed *ed_dbl_src;
+	int	NAF_index;
+	bool	subtract;
+
+/* Choose the curve and its starting point on the first chunk */
+
+	if (cdata->state == ECM_STATE_STAGE1_INIT) {
+		int stop_reason = init_curve (cdata);
+		if (stop_reason) {
+			ecmdata->batch_stop_reason = stop_reason;
+			return;
+		}
+		cdata->state = ECM_STATE_STAGE1;
+	}
+	if (cdata->factor != NULL) return;
+
+/* Build this chunk's dictionary from the current point.  Use the first NAF index to initialize the Edwards point.  When resuming */
+/* after the batch paused to write save files, the dictionary is still built and the Edwards point is in XYZ form. */
+
+	if (cdata->stage1_bitnum == 0) {
+		ed_swap (cdata->e, cdata->dict_start);
+		if (!NAF_dictionary_build (cdata) || !ed_alloc (cdata, &cdata->e)) {
+			ecmdata->batch_stop_reason = OutOfMemory (cdata->thread_num);
+			return;
+		}
+		if (cdata->factor != NULL) {				// Highly unlikely that the modinv in dictionary init found a factor
+			NAF_dictionary_free (cdata);
+			return;
+		}
+		ed_dbl_src = &cdata->NAF_dictionary[ecmdata->batch_first_NAF_index];
+	} else
+		ed_dbl_src = &cdata->e;
+
+/* Process each bit in the exponent chunk */
+
+	for (uint64_t bitnum = cdata->stage1_bitnum; bitnum < ecmdata->batch_num_doublings; bitnum++) {
+		uint64_t bit = ecmdata->batch_num_doublings - bitnum - 1;
+		bool	pausing = FALSE;
+
+/* Every so often, have the main thread check for interrupts and save file writing and update the title.  Curves pause for */
+/* save files by producing an XYZ point.  Any other error abandons the whole batch. */
+
+		if ((bitnum & 1023) == 1023) {
+			if (helper_num == 0) {
+				char	buf[120];
+				int stop_reason = stopCheck (cdata->thread_num);
+				if (stop_reason || testSaveFilesFlag (cdata->thread_num)) ecmdata->batch_saving = TRUE;
+				if (stop_reason && !ecmdata->batch_stop_reason) ecmdata->batch_stop_reason = stop_reason;
+				ecmdata->w->pct_complete = ecmdata->batch_pct_base + (double) bitnum * ecmdata->batch_pct_per_bit;
+				sprintf (buf, "%.*f%% of %s ECM curves %" PRIu32 "-%" PRIu32 " stage 1",
+					 (int) PRECISION, trunc_percent (ecmdata->w->pct_complete), ecmdata->N_short_string_rep,
+					 ecmdata->curve, ecmdata->curve + ecmdata->batch_count - 1);
+				title (cdata->thread_num, buf);
+			}
+			pausing = ecmdata->batch_saving;
+			if (ecmdata->batch_stop_reason && !pausing) {
+				cdata->stage1_bitnum = 0;			// The point cannot be saved
+				return;
+			}
+		}
+
+		int	options = (pausing || bitnum+1 == ecmdata->batch_num_doublings) ? ED_XYZ : ED_STARTNEXTFFT;
+		gwerror_checking (&cdata->gwdata, ecmdata->batch_errchk || pausing || ((bitnum & 127) == 64));
+		if (! bittst (ecmdata->stage1_NAF->add_bits, bit)) {
+			ed_dbl (cdata, ed_dbl_src, &cdata->e, ED_RESULT_FOR_DBL | options);
+		} else {
+			ed_dbl (cdata, ed_dbl_src, &cdata->e, ED_RESULT_FOR_ADD | ED_STARTNEXTFFT);
+			NAF_code (ecmdata, bit, &NAF_index, &subtract);
+			if (subtract) options |= ED_SUBTRACT;
+			ed_add (cdata, &cdata->e, &cdata->NAF_dictionary[NAF_index], &cdata->e, ED_RESULT_FOR_DBL | options);
+		}
+		ed_dbl_src = &cdata->e;
+		if (pausing) {
+			cdata->stage1_bitnum = (uint32_t) bitnum + 1;
+			return;
+		}
+	}
+
+/* The chunk is complete.  The caller frees the NAF dictionary, which holds the starting point should a save file be written. */
+
+	cdata->stage1_bitnum = (uint32_t) ecmdata->batch_num_doublings;
+}
+
+/* Have this thread run stage 1 on batch curves until all curves have completed the current exponent chunk */
+
+void ecm_batch_stage1_helper (
+	int	helper_num,	// 0 = main thread, 1+ = helper thread num
+	ecmhandle *ecmdata)
+{
+	ecmhandle *curves = (ecmhandle *) ecmdata->batch_curves;
+	for ( ; ; ) {
+		uint32_t i = (uint32_t) atomic_fetch_incr (ecmdata->polydata.helper_counter);
+		if (i >= ecmdata->batch_count) break;
+		ecm_batch_curve_chunk (ecmdata, &curves[i], helper_num);
+	}
+}
+
 /* Helper routine for multithreading ECM stage 2 */
 
 #define ECM_POLYF_LEVEL_ZERO	1
 #define ECM_POLYG_LEVEL_ZERO	2
 #define ECM_BUILD_GCDVAL	3
+#define ECM_BATCH_STAGE1	4
+#define ECM_FTREE_TO_BINARY	5
+#define ECM_FTREE_FROM_BINARY	6
 
 void ecm_helper (
 	int	helper_num,	// 0 = main thread, 1+ = helper thread num
@@ -6787,6 +7833,265 @@ void ecm_helper (
 		if (accumulator != NULL) gwfft (gwdata, accumulator, accumulator);
 		ecmdata->polyGH[helper_num] = accumulator;
 	}
+
+/* Run the batch curves' stage 1 (the gwdata passed in is not used, each curve has its own clone) */
+
+	if (ecmdata->helper_work == ECM_BATCH_STAGE1) {
+		ecm_batch_stage1_helper (helper_num, ecmdata);
+	}
+
+/* Convert a batch of Ftree coefficients to binary for writing to disk.  Unfft into a temporary as the poly may still be used FFTed. */
+
+	if (ecmdata->helper_work == ECM_FTREE_TO_BINARY) {
+		struct ftree_io *io = &ecmdata->ftree_io;
+		int	array_size = io->coeff_size / sizeof (uint32_t);
+		gwnum	tmp = gwalloc (gwdata);
+		if (tmp == NULL) { io->batch_failed = TRUE; return; }
+		for ( ; ; ) {
+			uint32_t i = (uint32_t) atomic_fetch_incr (ecmdata->polydata.helper_counter);
+			if (i >= io->batch_count) break;
+			uint32_t *array = (uint32_t *) (io->batch + (size_t) i * io->coeff_size);
+			gwunfft (gwdata, ecmdata->poly1[io->batch_first + i], tmp);
+			long size = gwtobinary (gwdata, tmp, array, array_size);
+			if (size < 0) {			// On unexpected error, fail the batch like an out-of-memory so that stage 2 init is redone
+				io->batch_failed = TRUE;
+				break;
+			}
+			memset (array + size, 0, (array_size - size) * sizeof (uint32_t));
+		}
+		gwfree (gwdata, tmp);
+	}
+
+/* Convert a batch of Ftree coefficients read from disk back to gwnums */
+
+	if (ecmdata->helper_work == ECM_FTREE_FROM_BINARY) {
+		struct ftree_io *io = &ecmdata->ftree_io;
+		int	array_size = io->coeff_size / sizeof (uint32_t);
+		for ( ; ; ) {
+			uint32_t i = (uint32_t) atomic_fetch_incr (ecmdata->polydata.helper_counter);
+			if (i >= io->batch_count) break;
+			binarytogw (gwdata, (uint32_t *) (io->batch + (size_t) i * io->coeff_size), array_size, ecmdata->poly1[io->batch_first + i]);
+		}
+	}
+}
+
+/* Choose a random sigma for a new curve */
+
+uint64_t ecm_random_sigma (void)
+{
+	uint64_t sigma;
+
+	do {
+		uint32_t hi, lo;
+		sigma = ((uint64_t) (rand () & 0x1F)) << 48;
+		sigma += ((uint64_t) (rand () & 0xFFFF)) << 32;
+		if (CPU_FLAGS & CPU_RDTSC) rdtsc (&hi, &lo);
+		sigma += lo ^ hi ^ ((uint32_t) rand () << 16);
+	} while (sigma <= 5);
+	return (sigma);
+}
+
+/* Decide if the next curves should run stage 1 as a batch, one curve per thread.  This only pays off for small FFTs. */
+
+bool ecm_use_batch_stage1 (
+	ecmhandle *ecmdata)
+{
+	struct work_unit *w = ecmdata->w;
+
+	if (ecmdata->montg_stage1 || ecmdata->stage1_threads < 2) return (FALSE);
+	if (ecmdata->gmp_ecm_file != NULL || w->curve > 5 || QA_IN_PROGRESS) return (FALSE);
+	if (w->curves_to_do == 0 || ecmdata->curve >= w->curves_to_do) return (FALSE);
+	return (gwfftlen (&ecmdata->gwdata) <= (unsigned long) IniGetInt (INI_FILE, "ECMBatchStage1MaxFFTLen", 8192));
+}
+
+/* Run stage 1 on a batch of curves, starting with the current curve and sigma.  The results are queued up in ecmdata->batch. */
+
+int ecm_batch_stage1 (
+	ecmhandle *ecmdata,
+	uint64_t dictionary_memory,	/* Memory to split among the curves' NAF dictionaries */
+	bool	near_fft_limit,		/* TRUE if we should always check for roundoff errors */
+	bool	*bad_point)		/* Returned TRUE if a stage 1 point is not on its curve */
+{
+	struct work_unit *w = ecmdata->w;
+	ecmhandle *curves;
+	uint32_t i, num_curves, num_cloned;
+	int	stop_reason;
+	char	buf[200];
+
+	*bad_point = FALSE;
+
+/* Run one curve per thread */
+
+	num_curves = ecmdata->stage1_threads;
+	if (num_curves > w->curves_to_do - ecmdata->curve + 1) num_curves = w->curves_to_do - ecmdata->curve + 1;
+	ecmdata->batch = (struct ecm_batch_curve *) malloc (num_curves * sizeof (struct ecm_batch_curve));
+	curves = (ecmhandle *) malloc (num_curves * sizeof (ecmhandle));
+	if (ecmdata->batch == NULL || curves == NULL) {
+		free (ecmdata->batch), ecmdata->batch = NULL;
+		free (curves);
+		return (OutOfMemory (ecmdata->thread_num));
+	}
+	memset (ecmdata->batch, 0, num_curves * sizeof (struct ecm_batch_curve));
+	memset (curves, 0, num_curves * sizeof (ecmhandle));
+	ecmdata->batch_count = num_curves;
+	ecmdata->batch_next = 0;
+	ecmdata->batch_curves = curves;
+	ecmdata->batch_stop_reason = 0;
+	ecmdata->batch_errchk = ERRCHK || near_fft_limit;
+
+/* Give each curve a sigma and its own clone of gwdata */
+
+	stop_reason = 0;
+	for (num_cloned = 0; num_cloned < num_curves; num_cloned++) {
+		ecmhandle *cdata = &curves[num_cloned];
+		if (gwclone (&cdata->gwdata, &ecmdata->gwdata)) {
+			stop_reason = OutOfMemory (ecmdata->thread_num);
+			goto done;
+		}
+		cdata->thread_num = ecmdata->thread_num;
+		cdata->N = ecmdata->N;
+		cdata->B = ecmdata->B;
+		cdata->sigma = (num_cloned == 0) ? ecmdata->sigma : ecm_random_sigma ();
+		cdata->sigma_type = ecmdata->sigma_type;
+		cdata->montg_stage1 = FALSE;
+		cdata->state = ECM_STATE_STAGE1_INIT;
+		ecmdata->batch[num_cloned].sigma = cdata->sigma;
+	}
+	sprintf (buf, "Running stage 1 of curves %" PRIu32 " through %" PRIu32 " in parallel, one curve per thread.\n",
+		 ecmdata->curve, ecmdata->curve + num_curves - 1);
+	OutputStr (ecmdata->thread_num, buf);
+
+/* Init the sieve and the polymult helper threads */
+
+	ecmdata->stage1_exp_buffer_size = IniGetInt (INI_FILE, "ECMStage1ExpBufferSize", 40);
+	if (ecmdata->stage1_exp_buffer_size < 1) ecmdata->stage1_exp_buffer_size = 1;
+	if (ecmdata->stage1_exp_buffer_size > 128) ecmdata->stage1_exp_buffer_size = 128;
+	ecmdata->stage1_exp_buffer_size <<= 20;
+	ecmdata->stage1_prime = 2;
+	polymult_init (&ecmdata->polydata, &ecmdata->gwdata);
+	polymult_set_max_num_threads (&ecmdata->polydata, num_curves);
+	ecmdata->polydata.helper_callback = &ecm_helper;
+	ecmdata->polydata.helper_callback_data = ecmdata;
+	ecmdata->helper_work = ECM_BATCH_STAGE1;
+
+/* Process the primes one exponent chunk at a time */
+
+	for ( ; ; ) {
+		uint32_t best_size;
+
+		ecmdata->stage1_start_prime = ecmdata->stage1_prime;
+		stop_reason = ecm_exp_cache_get (ecmdata->thread_num, &ecmdata->sieve_info, ecmdata->B, ecmdata->stage1_start_prime,
+						 ecmdata->stage1_exp_buffer_size, &ecmdata->stage1_exp);
+		if (stop_reason) goto done;
+		ecmdata->stage1_prime = ecmdata->stage1_exp->next_prime;
+		if (ecmdata->stage1_exp->explen == 1) break;		// Exponent is one
+
+		// Split the dictionary memory among the curves
+		best_size = NAF_best_size (ecmdata, ecmdata->stage1_exp->explen);
+		ecmdata->NAF_dictionary_size = (uint32_t) (dictionary_memory / num_curves / (3 * gwnum_size (&ecmdata->gwdata)));
+		if (ecmdata->NAF_dictionary_size > best_size) ecmdata->NAF_dictionary_size = best_size;
+		ecmdata->NAF_dictionary_size = IniGetInt (INI_FILE, "DictionarySize", ecmdata->NAF_dictionary_size);  // User override
+		if (ecmdata->NAF_dictionary_size < 7) ecmdata->NAF_dictionary_size = 7;		// Minimum size that does not crash
+		sprintf (buf, "%sxponent length is %" PRIu64 ", best dictionary size is %" PRIu32 ", actual dictionary size is %" PRIu32 "\n",
+			 ecmdata->stage1_prime <= ecmdata->B ? "Partial e" : "E",
+			 ecmdata->stage1_exp->explen, best_size, ecmdata->NAF_dictionary_size);
+		OutputStr (ecmdata->thread_num, buf);
+		set_memory_usage (ecmdata->thread_num, 0, cvt_gwnums_to_mem (&ecmdata->gwdata, num_curves * (ecmdata->NAF_dictionary_size * 3 + 8)));
+		for (i = 0; i < num_curves; i++) curves[i].NAF_dictionary_size = ecmdata->NAF_dictionary_size;
+
+		// Get the NAF codes all the curves will use
+		ecmdata->stage1_NAF = ecm_exp_cache_NAF (ecmdata->stage1_exp, ecmdata->NAF_dictionary_size);
+		if (ecmdata->stage1_NAF == NULL) {
+			stop_reason = OutOfMemory (ecmdata->thread_num);
+			goto done;
+		}
+		ecmdata->batch_first_NAF_index = ecmdata->stage1_NAF->first_NAF_index;
+		ecmdata->batch_num_doublings = ecmdata->stage1_NAF->num_doublings;
+		ecmdata->batch_pct_base = (double) ecmdata->stage1_start_prime / (double) ecmdata->B;
+		ecmdata->batch_pct_per_bit = (double) ((ecmdata->stage1_prime < ecmdata->B ? ecmdata->stage1_prime : ecmdata->B) - ecmdata->stage1_start_prime) /
+					     (double) ecmdata->batch_num_doublings / (double) ecmdata->B;
+
+		// Run this chunk on every curve.  When the user interrupts and every DISK_WRITE_TIME minutes, the curves pause so that
+		// each curve's save file can be written.  Unless interrupted, the curves then continue the chunk.
+		for (i = 0; i < num_curves; i++) curves[i].stage1_bitnum = 0;
+		for ( ; ; ) {
+			ecmdata->batch_saving = FALSE;
+			polymult_launch_helpers (&ecmdata->polydata);
+			if (!ecmdata->batch_saving) break;
+			for (i = 0; i < num_curves; i++) {
+				ecmhandle *cdata = &curves[i];
+				if (cdata->factor != NULL || cdata->stage1_bitnum == 0) continue;	// Nothing to save
+				if (!ed_check (cdata, &cdata->e)) {
+					*bad_point = TRUE;
+					break;
+				}
+				cdata->stage1_start_prime = ecmdata->stage1_start_prime;
+				cdata->stage1_exp_buffer_size = ecmdata->stage1_exp_buffer_size;
+				ecm_batch_save (ecmdata, cdata, ecmdata->curve + i);
+			}
+			if (ecmdata->batch_stop_reason || *bad_point) break;
+		}
+		for (i = 0; i < num_curves; i++) NAF_dictionary_free (&curves[i]);
+		ecm_exp_cache_release (&ecmdata->stage1_exp), ecmdata->stage1_NAF = NULL;
+		if (ecmdata->batch_stop_reason || *bad_point || ecmdata->stage1_prime > ecmdata->B) break;
+	}
+	stop_reason = ecmdata->batch_stop_reason;
+
+/* Merge the curves' error and transform counts.  Convert each curve's result to Montgomery form in binary. */
+
+	for (i = 0; i < num_curves; i++) {
+		ecmhandle *cdata = &curves[i];
+		gwclone_merge_stats (&ecmdata->gwdata, &cdata->gwdata);
+		ecmdata->modinv_count += cdata->modinv_count;
+		if (stop_reason || *bad_point) continue;
+		if (cdata->factor != NULL) {
+			ecmdata->batch[i].factor = cdata->factor, cdata->factor = NULL;
+			continue;
+		}
+		if (!ed_check (cdata, &cdata->e)) {
+			*bad_point = TRUE;
+			continue;
+		}
+		ed_to_Montgomery (cdata);
+		ecmdata->batch[i].Qx_binary = allocgiant (((int) ecmdata->gwdata.bit_length >> 5) + 10);
+		ecmdata->batch[i].Qz_binary = allocgiant (((int) ecmdata->gwdata.bit_length >> 5) + 10);
+		if (ecmdata->batch[i].Qx_binary == NULL || ecmdata->batch[i].Qz_binary == NULL) {
+			stop_reason = OutOfMemory (ecmdata->thread_num);
+			continue;
+		}
+		gwtogiant (&cdata->gwdata, cdata->xz.x, ecmdata->batch[i].Qx_binary);
+		gwtogiant (&cdata->gwdata, cdata->xz.z, ecmdata->batch[i].Qz_binary);
+
+		// Write a save file so that the curve survives until it gets its turn at stage 2
+		cdata->state = ECM_STATE_MIDSTAGE;
+		cdata->montg_stage1 = TRUE;
+		cdata->Qx_binary = ecmdata->batch[i].Qx_binary;
+		cdata->Qz_binary = ecmdata->batch[i].Qz_binary;
+		ecm_batch_save (ecmdata, cdata, ecmdata->curve + i);
+		cdata->Qx_binary = cdata->Qz_binary = NULL;
+	}
+
+/* Free the curves' memory and cloned gwdatas.  An interrupted batch is abandoned. */
+
+done:	for (i = 0; i < num_cloned; i++) {
+		ecmhandle *cdata = &curves[i];
+		NAF_dictionary_free (cdata);
+		ed_free (cdata, &cdata->dict_start);
+		ed_free (cdata, &cdata->e);
+		free_xz (cdata, &cdata->xz);
+		gwfree (&cdata->gwdata, cdata->Ad4);
+		gwfree (&cdata->gwdata, cdata->ed_a);
+		gwfree (&cdata->gwdata, cdata->ed_d);
+		gwfree (&cdata->gwdata, cdata->ed_half);
+		free (cdata->factor);
+		gwdone (&cdata->gwdata);
+	}
+	free (curves), ecmdata->batch_curves = NULL;
+	polymult_done (&ecmdata->polydata);
+	ecm_exp_cache_release (&ecmdata->stage1_exp), ecmdata->stage1_NAF = NULL;
+	end_sieve (ecmdata->sieve_info), ecmdata->sieve_info = NULL;
+	if (stop_reason || *bad_point) ecm_batch_free (ecmdata);
+	return (stop_reason);
 }
 
 
@@ -6810,8 +8115,10 @@ int ecm (
 	char	filename[32], ftree_filename[40], buf[255], JSONbuf[4000], fft_desc[200];
 	int	res, stop_reason, delayed_stop_reason, stage, first_iter_msg;
 	int	msglen, continueECM, prpAfterEcmFactor;
+	int	gwsetup_failed = FALSE;	/* TRUE if switching back to the stage 1 FFT failed, gwdata is unusable */
 	char	*str, *msg;
-	double	stage1_timer, stage2_timer, timers[10];
+	giant	bg_factor;
+	double	stage1_timer, stage2_timer, batch_stage1_timer, timers[10];
 	bool	near_fft_limit, saving, default_sigma_type;
 	double	allowable_maxerr;
 	int	maxerr_restart_count = 0;
@@ -7194,6 +8501,8 @@ if (w->n == 604) {
 	if (ERRCHK) gwset_will_error_check (&ecmdata.gwdata);
 	gwset_num_threads (&ecmdata.gwdata, ecmdata.stage1_threads);
 	gwset_thread_callback (&ecmdata.gwdata, SetAuxThreadPriority);
+	SetGwnumNumaPolicy (&ecmdata.gwdata);
+	SetGwnumTableCache (&ecmdata.gwdata);
 	gwset_thread_callback_data (&ecmdata.gwdata, sp_info);
 	gwset_safety_margin (&ecmdata.gwdata, IniGetFloat (INI_FILE, "ExtraSafetyMargin", 0.0));
 	gwset_larger_fftlen_count (&ecmdata.gwdata, maxerr_restart_count < 3 ? maxerr_restart_count : 3);
@@ -7211,7 +8520,7 @@ if (w->n == 604) {
 
 /* More random initializations */
 
-	stage1_timer = stage2_timer = 0.0;
+	stage1_timer = stage2_timer = batch_stage1_timer = 0.0;
 	last_output = last_output_t = ecmdata.modinv_count = 0;
 	gw_clear_fft_count (&ecmdata.gwdata);
 	first_iter_msg = TRUE;
@@ -7262,7 +8571,7 @@ if (w->n == 604) {
 
 /* Read in the save file.  If the save file is no good ecm_restore will have deleted it.  Loop trying to read a backup save file. */
 
-		if (! ecm_restore (&ecmdata)) {
+		if (! ecm_restore (&ecmdata, ecmdata.read_save_file_state.current_filename)) {
 			/* Close and rename the bad save file */
 			saveFileBad (&ecmdata.read_save_file_state);
 			continue;
@@ -7372,15 +8681,26 @@ restart0:
 	ASSERTG (ecmdata.e.x == NULL && ecmdata.e.y == NULL && ecmdata.e.z == NULL);
 	ASSERTG (ecmdata.gg == NULL);
 
+/* Resume a curve from the save file an interrupted stage 1 batch wrote */
+
+	if (ecmdata.batch_next == ecmdata.batch_count && w->curve <= 5 && ecm_batch_restore (&ecmdata)) {
+		curve_start_msg (&ecmdata);
+		stage1_timer = 0.0;					// This curve's stage 1 time is not known
+		if (ecmdata.state == ECM_STATE_MIDSTAGE) goto restart3;
+		stop_reason = init_curve (&ecmdata);
+		if (stop_reason) goto exit;
+		if (ecmdata.factor != NULL) goto bingo;			// Can't happen
+		if (!ed_check (&ecmdata, &ecmdata.e)) {
+			ecm_batch_unlink (&ecmdata, ecmdata.curve, ecmdata.curve);
+			goto ed_err;
+		}
+		sprintf (w->stage, "C%" PRIu32 "S1", ecmdata.curve);
+		goto restart1;
+	}
+
 /* Choose curve with order divisible by 16 and choose a point (x/z) on said curve. */
 
-	do {
-		uint32_t hi, lo;
-		ecmdata.sigma = ((uint64_t) (rand () & 0x1F)) << 48;
-		ecmdata.sigma += ((uint64_t) (rand () & 0xFFFF)) << 32;
-		if (CPU_FLAGS & CPU_RDTSC) rdtsc (&hi, &lo);
-		ecmdata.sigma += lo ^ hi ^ ((uint32_t) rand () << 16);
-	} while (ecmdata.sigma <= 5);
+	ecmdata.sigma = ecm_random_sigma ();
 	if (w->curve > 5) {
 		ecmdata.sigma = w->curve;
 		w->curves_to_do = 1;
@@ -7388,6 +8708,58 @@ restart0:
 	default_sigma_type = (IniGetInt (INI_FILE, "DictionarySize", (int) (dictionary_memory / (3 * gwnum_size (&ecmdata.gwdata)))) < 7) ? 1 : 0;
 	ecmdata.sigma_type = IniGetInt (INI_FILE, "MontgSigma", default_sigma_type);
 	ecmdata.montg_stage1 = IniGetInt(INI_FILE, "MontgStage1", ecmdata.sigma_type == 1);
+
+/* For small numbers, run stage 1 on several curves at once, one curve per thread */
+
+	if (ecmdata.batch_next == ecmdata.batch_count) {
+		ecm_batch_free (&ecmdata);
+		if (ecm_use_batch_stage1 (&ecmdata)) {
+			bool	bad_point;
+			sprintf (w->stage, "C%" PRIu32 "S1", ecmdata.curve);
+			w->pct_complete = 0.0;
+			start_timer_from_zero (timers, 1);
+			stop_reason = ecm_batch_stage1 (&ecmdata, dictionary_memory, near_fft_limit, &bad_point);
+			if (stop_reason) goto exit;
+			if (bad_point) goto ed_err;
+			if (gw_test_for_error (&ecmdata.gwdata) || gw_get_maxerr (&ecmdata.gwdata) > allowable_maxerr) goto err;
+			end_timer (timers, 1);
+			batch_stage1_timer = timers[1] / (double) ecmdata.batch_count;		// Each curve's share of the batch time
+			sprintf (buf, "Stage 1 of %" PRIu32 " curves complete. %" PRIu64 " transforms, %lu modular inverses. Total time: ",
+				 ecmdata.batch_count, gw_get_fft_count (&ecmdata.gwdata), ecmdata.modinv_count);
+			print_timer (timers, 1, buf, TIMER_NL | TIMER_CLR);
+			OutputStr (thread_num, buf);
+			last_output = last_output_t = ecmdata.modinv_count = 0;
+			gw_clear_fft_count (&ecmdata.gwdata);
+			if (ERRCHK) {
+				sprintf (buf, "Round off: %.10g\n", gw_get_maxerr (&ecmdata.gwdata));
+				OutputStr (thread_num, buf);
+				gw_clear_maxerr (&ecmdata.gwdata);
+			}
+		}
+	}
+
+/* If this curve's stage 1 was done in a batch, pick up the result and move on to stage 2 */
+
+	if (ecmdata.batch_next < ecmdata.batch_count) {
+		struct ecm_batch_curve *bc = &ecmdata.batch[ecmdata.batch_next++];
+		ecmdata.sigma = bc->sigma;
+		curve_start_msg (&ecmdata);
+		if (bc->factor != NULL) {
+			ecmdata.factor = bc->factor, bc->factor = NULL;
+			goto bingo;
+		}
+		ecmdata.state = ECM_STATE_MIDSTAGE;			// Compute the curve parameters without a starting point
+		ecmdata.montg_stage1 = TRUE;
+		stop_reason = init_curve (&ecmdata);
+		if (stop_reason) goto exit;
+		if (ecmdata.factor != NULL) goto bingo;			// Can't happen
+		ecm_stage1_memory_usage (thread_num, &ecmdata);
+		if (!alloc_xz (&ecmdata, &ecmdata.xz)) goto oom;
+		gianttogw (&ecmdata.gwdata, bc->Qx_binary, ecmdata.xz.x);
+		gianttogw (&ecmdata.gwdata, bc->Qz_binary, ecmdata.xz.z);
+		stage1_timer = batch_stage1_timer;			// This curve's share of the batch time
+		goto stage1_done;
+	}
 	curve_start_msg (&ecmdata);
 	stop_reason = init_curve (&ecmdata);
 	if (stop_reason) goto exit;
@@ -7491,9 +8863,15 @@ restart1:
 
 			if (gw_test_for_error (&ecmdata.gwdata) || gw_get_maxerr (&ecmdata.gwdata) > allowable_maxerr) goto err;
 
+/* See if the previous curve's background stage 2 GCD found a factor */
+
+			if (finish_background_gcd (&ecmdata.bg_gcd, FALSE, &bg_factor)) goto background_bingo;
+
 /* Write a save file when the user interrupts the calculation and every DISK_WRITE_TIME minutes. */
+/* The save file records the previous curve as done, so wait for its background GCD first. */
 
 			if (stop_reason || saving) {
+				if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 				ecm_save (&ecmdata);
 				if (stop_reason) goto exit;
 			}
@@ -7516,11 +8894,7 @@ restart1:
 			ecmdata.stage1_exp_buffer_size <<= 20;
 		}
 
-		stop_reason = start_sieve_with_limit (thread_num, ecmdata.stage1_start_prime, (uint32_t) sqrt ((double) ecmdata.B), &ecmdata.sieve_info);
-		if (stop_reason) goto exit;
-		ecmdata.stage1_prime = sieve (ecmdata.sieve_info);	// Get first prime from sieve
-
-		mpz_init (ecmdata.stage1_exp), ecmdata.stage1_exp_initialized = TRUE;
+		ecmdata.stage1_prime = ecmdata.stage1_start_prime;
 
 /* Process primes into one big exponent.  We may not be able to process all primes in one blast, so loop in case multiple exponent chunks are needed. */
 
@@ -7530,12 +8904,15 @@ restart1:
 			uint64_t num_doublings;
 			double	chunk_size, chunk_size_over_num_doublings;
 
-/* Create the big exponent and init the dictionary */
+/* Get the big exponent from the exponent cache and init the dictionary */
 
 			ecmdata.stage1_start_prime = ecmdata.stage1_prime;	// Remember stage1_exp's starting prime for saving to a file
-			ecm_calc_exp (ecmdata.sieve_info, ecmdata.stage1_exp, ecmdata.B, &ecmdata.stage1_prime, ecmdata.stage1_exp_buffer_size);
-			if (mpz_eq_ui (ecmdata.stage1_exp, 1)) break;
-			best_size = NAF_best_size (&ecmdata);
+			stop_reason = ecm_exp_cache_get (thread_num, &ecmdata.sieve_info, ecmdata.B, ecmdata.stage1_start_prime,
+							 ecmdata.stage1_exp_buffer_size, &ecmdata.stage1_exp);
+			if (stop_reason) goto exit;
+			ecmdata.stage1_prime = ecmdata.stage1_exp->next_prime;
+			if (ecmdata.stage1_exp->explen == 1) break;		// Exponent is one
+			best_size = NAF_best_size (&ecmdata, ecmdata.stage1_exp->explen);
 			if (ecmdata.stage1_bitnum == 0) {			// Dictionary size cannot be changed when resuming from a save file
 				ecmdata.NAF_dictionary_size = (uint32_t) (dictionary_memory / (3 * gwnum_size (&ecmdata.gwdata)));
 				if (ecmdata.NAF_dictionary_size > best_size) ecmdata.NAF_dictionary_size = best_size;
@@ -7544,11 +8921,15 @@ restart1:
 			}
 			sprintf (buf, "%sxponent length is %" PRIu64 ", best dictionary size is %" PRIu32 ", actual dictionary size is %" PRIu32 "\n",
 				 ecmdata.stage1_prime <= ecmdata.B ? "Partial e" : "E",
-				 (uint64_t) mpz_sizeinbase (ecmdata.stage1_exp, 2), best_size, ecmdata.NAF_dictionary_size);
+				 ecmdata.stage1_exp->explen, best_size, ecmdata.NAF_dictionary_size);
 			OutputStr (thread_num, buf);
 			ecm_stage1_memory_usage (thread_num, &ecmdata);
+			ecmdata.stage1_NAF = ecm_exp_cache_NAF (ecmdata.stage1_exp, ecmdata.NAF_dictionary_size);
+			if (ecmdata.stage1_NAF == NULL) goto oom;
+			NAF_index = ecmdata.stage1_NAF->first_NAF_index;
+			num_doublings = ecmdata.stage1_NAF->num_doublings;
 			if (ecmdata.stage1_bitnum == 0) ed_swap (ecmdata.e, ecmdata.dict_start);
-			NAF_dictionary_init (&ecmdata, &NAF_index, &num_doublings);
+			NAF_dictionary_build (&ecmdata);
 			if (ecmdata.factor != NULL) goto bingo;			// Highly unlikely that the modinv in dictionary init found a factor
 
 /* Init variables used in calculating percent complete. */
@@ -7570,7 +8951,7 @@ restart1:
 
 /* Either double point or double point and add from dictionary */
 
-				if (! mpz_tstbit64 (ecmdata.stage1_exp, num_doublings - ecmdata.stage1_bitnum - 1)) {
+				if (! bittst (ecmdata.stage1_NAF->add_bits, num_doublings - ecmdata.stage1_bitnum - 1)) {
 					stop_reason = 0;
 					saving = 0;
 					gwerror_checking (&ecmdata.gwdata, ERRCHK || near_fft_limit || ((ecmdata.stage1_bitnum & 127) == 64));
@@ -7628,25 +9009,32 @@ restart1:
 
 				if (gw_test_for_error (&ecmdata.gwdata) || gw_get_maxerr (&ecmdata.gwdata) > allowable_maxerr) goto err;
 
+/* See if the previous curve's background stage 2 GCD found a factor */
+
+				if (finish_background_gcd (&ecmdata.bg_gcd, FALSE, &bg_factor)) goto background_bingo;
+
 /* Write a save file when the user interrupts the calculation and every DISK_WRITE_TIME minutes. */
+/* The save file records the previous curve as done, so wait for its background GCD first. */
 
 				if (stop_reason || saving) {
+					if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 					if (!ed_check (&ecmdata, &ecmdata.e)) goto ed_err;
 					ecm_save (&ecmdata);
 					if (stop_reason) goto exit;
 				}
 			}
 
-/* Free the NAF dictionary */
+/* Free the NAF dictionary and release the exponent chunk */
 
 			NAF_dictionary_free (&ecmdata);
+			ecm_exp_cache_release (&ecmdata.stage1_exp), ecmdata.stage1_NAF = NULL;
 
 /* Are we done?  If not, prepare for the next looping. */
 
 			if (ecmdata.stage1_prime > ecmdata.B) break;
 			ecmdata.stage1_bitnum = 0;
 		}
-		mpz_clear (ecmdata.stage1_exp), ecmdata.stage1_exp_initialized = FALSE;
+		ecm_exp_cache_release (&ecmdata.stage1_exp), ecmdata.stage1_NAF = NULL;
 		ecmdata.stage1_bitnum = 0;
 
 /* Validate the final point */
@@ -7678,6 +9066,11 @@ restart1:
 		gw_clear_maxerr (&ecmdata.gwdata);
 	}
 
+/* Wait for the previous curve's background stage 2 GCD.  If it found a factor, this curve was not needed. */
+
+stage1_done:
+	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
+
 /* If we aren't doing a stage 2, then check to see if we found a factor. */
 /* If we are doing a stage 2, then the stage 2 init will do this GCD for us. */
 
@@ -7820,6 +9213,8 @@ replan:	unsigned long best_fftlen;
 
 		polymult_init (&ecmdata.polydata, &ecmdata.gwdata);
 		polymult_set_cpu_flags (&ecmdata.polydata, CPU_FLAGS);		// Allow AVX-512 polymults on FMA3 FFTs
+		IniGetString (INI_FILE, "OutOfCoreDir", ecmdata.poly_file_dir, sizeof (ecmdata.poly_file_dir), NULL);
+		if (ecmdata.poly_file_dir[0]) ecmdata.polydata.file_backed_dir = ecmdata.poly_file_dir;
 		polymult_set_max_num_threads (&ecmdata.polydata, ecmdata.stage2_threads);
 		polymult_default_tuning (&ecmdata.polydata,
 					 IniGetInt (INI_FILE, "PolymultCacheSize", CPU_NUM_L2_CACHES > 0 ? CPU_TOTAL_L2_CACHE_SIZE / CPU_NUM_L2_CACHES : 256),
@@ -7950,6 +9345,8 @@ OutputStr (thread_num, buf); }
 			if (ERRCHK) gwset_will_error_check (&ecmdata.gwdata);
 			gwset_num_threads (&ecmdata.gwdata, ecmdata.stage2_threads);
 			gwset_thread_callback (&ecmdata.gwdata, SetAuxThreadPriority);
+			SetGwnumNumaPolicy (&ecmdata.gwdata);
+			SetGwnumTableCache (&ecmdata.gwdata);
 			gwset_thread_callback_data (&ecmdata.gwdata, sp_info);
 			gwset_safety_margin (&ecmdata.gwdata, IniGetFloat (INI_FILE, "ExtraSafetyMargin", 0.0));
 			gwset_minimum_fftlen (&ecmdata.gwdata, next_fftlen);
@@ -8015,6 +9412,7 @@ OutputStr (thread_num, buf); }
 	// Beware that replaning may allocate a larger pairing map
 	if (set_memory_usage (thread_num, MEM_VARIABLE_USAGE, memused)) {
 		ecmdata.pct_mem_to_use *= 0.99;
+		cancel_pairmap_producer (&ecmdata.bg_pairmap);
 		free (ecmdata.pairmap); ecmdata.pairmap = NULL;
 		goto replan;
 	}
@@ -8039,11 +9437,9 @@ OutputStr (thread_num, buf); }
 /* Create a new map of (hopefully) close-to-optimal prime pairings */
 
 	if (ecmdata.pairmap == NULL) {
-		int fill_window = pair_window_size (ecmdata.gwdata.bit_length, ecmdata.relp_sets);
-		gwfree_internal_memory (&ecmdata.gwdata);
-		stop_reason = fill_pairmap (ecmdata.thread_num, &ecmdata.sieve_info, ecmdata.D, fill_window,0,0,0,
-					    ecmdata.totrels, ecmdata.relp_sets+3, ecmdata.first_relocatable, ecmdata.last_relocatable,
-					    ecmdata.B2_start, ecmdata.C, ecmdata.max_pairmap_Dsections, &ecmdata.pairmap, &ecmdata.pairmap_size);
+		stop_reason = next_pairmap (&ecmdata.bg_pairmap, &ecmdata.gwdata, ecmdata.thread_num, ecmdata.D, ecmdata.totrels, ecmdata.relp_sets,
+					    ecmdata.first_relocatable, ecmdata.last_relocatable, ecmdata.B2_start, ecmdata.C,
+					    ecmdata.max_pairmap_Dsections, &ecmdata.pairmap, &ecmdata.pairmap_size);
 		if (stop_reason) goto exit;
 		ecmdata.pairmap_ptr = ecmdata.pairmap;
 		ecmdata.Dsection = 0;
@@ -8683,11 +10079,9 @@ OutputStr (thread_num, buf); }
 			ASSERTG (ecmdata.relp == 0);
 			ecmdata.C_done = ecmdata.B2_start + ecmdata.Dsection * ecmdata.D;
 			ecmdata.first_relocatable = calc_new_first_relocatable (ecmdata.D, ecmdata.C_done);
-			int fill_window = pair_window_size (ecmdata.gwdata.bit_length, ecmdata.relp_sets);
-			gwfree_internal_memory (&ecmdata.gwdata);
-			stop_reason = fill_pairmap (ecmdata.thread_num, &ecmdata.sieve_info, ecmdata.D, fill_window,0,0,0,
-						    ecmdata.totrels, ecmdata.relp_sets+3, ecmdata.first_relocatable, ecmdata.last_relocatable,
-						    ecmdata.C_done, ecmdata.C, ecmdata.max_pairmap_Dsections, &ecmdata.pairmap, &ecmdata.pairmap_size);
+			stop_reason = next_pairmap (&ecmdata.bg_pairmap, &ecmdata.gwdata, ecmdata.thread_num, ecmdata.D, ecmdata.totrels, ecmdata.relp_sets,
+						    ecmdata.first_relocatable, ecmdata.last_relocatable, ecmdata.C_done, ecmdata.C,
+						    ecmdata.max_pairmap_Dsections, &ecmdata.pairmap, &ecmdata.pairmap_size);
 			if (stop_reason) {
 //GW:				is save possible here with no pairmap generated?
 				ecm_save (&ecmdata);
@@ -8772,6 +10166,7 @@ OutputStr (thread_num, buf); }
 	ecmdata.xz.x = ecmdata.nQx[0];
 	for (uint32_t i = 1; i < ecmdata.totrels; i++) gwfree (&ecmdata.gwdata, ecmdata.nQx[i]);
 	free (ecmdata.nQx); ecmdata.nQx = NULL;
+	cancel_pairmap_producer (&ecmdata.bg_pairmap);
 	free (ecmdata.pairmap); ecmdata.pairmap = NULL;
 
 /* All done except for the final GCD, go do it. */
@@ -9054,10 +10449,14 @@ start_timer_from_zero (timers, 0);
 
 // Open file for saving up to two Ftree rows
 
-	int	fd;
 	if (ecmdata.Ftree_polys_in_mem < 2) {
-		fd = _open (ftree_filename, _O_CREAT | _O_TRUNC | _O_BINARY | _O_RDWR, CREATE_FILE_ACCESS);
-//GW				if (fd < 0) goto ???  switch to memory with smaller poly??? 
+		int array_size = divide_rounding_up ((int) ceil (ecmdata.gwdata.bit_length), 32);
+		if (!ftree_io_open (&ecmdata.ftree_io, ftree_filename, array_size * sizeof (uint32_t))) {
+			sprintf (buf, "Error creating file %s.\n", ftree_filename);
+			OutputStr (thread_num, buf);
+			stop_reason = STOP_FILE_IO_ERROR;
+			goto exit;
+		}
 	}
 
 // Multiply small monic polys into one big monic poly.  This is done mostly in-place in polyF, but initial data comes from nQx.
@@ -9087,27 +10486,20 @@ start_timer_from_zero (timers, 0);
 
 			// Save an Ftree "row" to disk
 			if (ecmdata.Ftree_polys_in_mem == 0 || (ecmdata.Ftree_polys_in_mem == 1 && tree_level == 0)) {
-				int array_size = (int) ceil (ecmdata.gwdata.bit_length);
-				array_size = divide_rounding_up (array_size, 32);
-				uint32_t *array = (uint32_t *) malloc (array_size * sizeof (uint32_t));
-				if (array == NULL) goto lowmem;
-				gwnum tmp = gwalloc (&ecmdata.gwdata);
-				if (tmp == NULL) { free (array); goto lowmem; }
-				for (int i = 0; i < ecmdata.poly_size; i++) {
-					long	size;
-//GW: if poly is already FFTed then we are wasting some CPU cylces here.  We could alloc a gwnum and unFFT into that before gwtobinary (wasteful if gwnum is not ffted)
-//	hmmm,  F or nQx may be FFTed - that would be unfortunate.  Need option to save it raw/binary? or maybe even preprocessed (slicing is an issue)?
-					gwunfft (&ecmdata.gwdata, source_poly[i], tmp);
-					size = gwtobinary (&ecmdata.gwdata, tmp, array, array_size);
-//GW: if (size <0) ???
-					memset (array + size, 0, (array_size - size) * sizeof (uint32_t));
-					_write (fd, array, array_size * sizeof (uint32_t));
+				// Helper threads convert a buffer full of coefficients to binary, then write-behind sends it to disk
+				ecmdata.polydata.helper_callback = &ecm_helper;
+				ecmdata.polydata.helper_callback_data = &ecmdata;
+				ecmdata.helper_work = ECM_FTREE_TO_BINARY;
+				ecmdata.poly1 = source_poly;
+				for (uint64_t i = 0; i < ecmdata.poly_size; i += ecmdata.ftree_io.batch_count) {
+					ecmdata.ftree_io.batch = ftree_io_write_buffer (&ecmdata.ftree_io);
+					ecmdata.ftree_io.batch_first = i;
+					ecmdata.ftree_io.batch_count = (uint32_t) (ecmdata.poly_size - i < ecmdata.ftree_io.coeffs_per_buf ? ecmdata.poly_size - i : ecmdata.ftree_io.coeffs_per_buf);
+					ecmdata.ftree_io.batch_failed = FALSE;
+					polymult_launch_helpers (&ecmdata.polydata);
+					if (ecmdata.ftree_io.batch_failed) goto lowmem;
+					if (!ftree_io_write_commit (&ecmdata.ftree_io, ecmdata.ftree_io.batch_count)) goto ftree_io_error;
 				}
-				free (array);
-				gwfree (&ecmdata.gwdata, tmp);
-//explore whether multithreaded version would have cloned gwdata memory allocation issues in gwtobinary						
-//   must deal with i/o errors
-//gw:   unlink on exit/error
 			}
 
 			// Save an Ftree row to memory
@@ -9197,6 +10589,15 @@ start_timer_from_zero (timers, 0);
 		gwfree_array (&ecmdata.gwdata, ecmdata.nQx); ecmdata.nQx = NULL;
 	}
 
+// Schedule reading the Ftree rows saved to disk in the order they are needed working down the tree.  Pass 1 reads the row saved at
+// log2_num_polys == 3, pass 2 reads the base row in slices.  Starting now lets the OS read ahead while we compute 1/F(X), G(X), and H(X).
+
+	if (ecmdata.Ftree_polys_in_mem < 2) {
+		if (ecmdata.Ftree_polys_in_mem == 0) ftree_io_schedule_read (&ecmdata.ftree_io, ecmdata.poly_size, ecmdata.poly_size);
+		ftree_io_schedule_read (&ecmdata.ftree_io, 0, ecmdata.poly_size);
+		if (!ftree_io_start_reads (&ecmdata.ftree_io)) goto ftree_io_error;
+	}
+
 // Use Newton's method to compute 1/F(X), starting with an initial estimate of 1 - first_non_monic_term_of_F(X).
 
 	// Allocate reciprocal of F(X) poly in one big array.
@@ -9252,7 +10653,14 @@ start_timer_from_zero (timers, 0);
 		if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == -1) options |= POLYMULT_PRE_FFT;			// Hidden option (uses more memory)
 		if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == -2) options |= POLYMULT_PRE_FFT | POLYMULT_PRE_COMPRESS;// Hidden option (uses more memory)
 		if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == 2) options |= POLYMULT_PRE_COMPRESS;
+		if (IniGetInt (INI_FILE, "ECMPolyOutOfCore", 0) && !ecmdata.poly_in_core_only) options |= POLYMULT_PRE_FILE_BACKED;
 		gwarray tmp = polymult_preprocess (&ecmdata.polydata, ecmdata.polyF, ecmdata.poly_size, ecmdata.poly_size, ecmdata.poly_size*2, options);
+		if (tmp == NULL) {
+			if (!(options & POLYMULT_PRE_FILE_BACKED)) goto lowmem;
+			ecmdata.poly_file_failed = TRUE;
+			stop_reason = STOP_OUT_OF_MEM;
+			goto possible_lowmem;
+		}
 		gwfree_array (&ecmdata.gwdata, ecmdata.polyF);
 		ecmdata.polyF = tmp;
 	}
@@ -9267,7 +10675,14 @@ start_timer_from_zero (timers, 0);
 		if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == -1) options |= POLYMULT_PRE_FFT;			// Hidden option (uses more memory)
 		if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == -2) options |= POLYMULT_PRE_FFT | POLYMULT_PRE_COMPRESS;// Hidden option (uses more memory)
 		if (IniGetInt (INI_FILE, "ECMPolyCompress", 1) == 2) options |= POLYMULT_PRE_COMPRESS;
+		if (IniGetInt (INI_FILE, "ECMPolyOutOfCore", 0) && !ecmdata.poly_in_core_only) options |= POLYMULT_PRE_FILE_BACKED;
 		gwarray tmp = polymult_preprocess (&ecmdata.polydata, ecmdata.polyR, ecmdata.poly_size, ecmdata.poly_size, ecmdata.poly_size*2, options);
+		if (tmp == NULL) {
+			if (!(options & POLYMULT_PRE_FILE_BACKED)) goto lowmem;
+			ecmdata.poly_file_failed = TRUE;
+			stop_reason = STOP_OUT_OF_MEM;
+			goto possible_lowmem;
+		}
 		gwfree_array (&ecmdata.gwdata, ecmdata.polyR);
 		ecmdata.polyR = tmp;
 	}
@@ -9564,25 +10979,18 @@ start_timer_from_zero (timers, 0);
 //GW: Problem? the len1-or-len2 Ftree level was not saved
 			if (level == 0 || (ecmdata.Ftree_polys_in_mem >= 3 && tree_level >= num_tree_levels - ecmdata.Ftree_polys_in_mem + 2) ||
 					  (ecmdata.Ftree_polys_in_mem >= 5 && tree_level >= num_tree_levels - ecmdata.Ftree_polys_in_mem + 1)) {
-				// Read base level polyF from disk
+				// Read base level polyF from disk.  Read-ahead has been fetching these coefficients in the order we consume them.
 				if (ecmdata.Ftree_polys_in_mem == 0 || (ecmdata.Ftree_polys_in_mem == 1 && tree_level == 0)) {
-					int	array_size;
-					uint32_t *array;
-					int64_t	offset;
-					array_size = (int) ceil (ecmdata.gwdata.bit_length);
-					array_size = divide_rounding_up (array_size, 32);
-					array = (uint32_t *) malloc (array_size * sizeof (uint32_t));
-					if (array == NULL) goto lowmem;
-					offset = (pass == 1 ? (int64_t) ecmdata.poly_size * array_size * sizeof (uint32_t) : 0);
-					_lseeki64 (fd, offset + (int64_t) slice * slice_size * array_size * sizeof (uint32_t), SEEK_SET);
-					for (int i = 0; i < slice_size; i++) {
-						_read (fd, array, array_size * sizeof (uint32_t));
-						binarytogw (&ecmdata.gwdata, array, array_size, polyF[i]);
+					ecmdata.polydata.helper_callback = &ecm_helper;
+					ecmdata.polydata.helper_callback_data = &ecmdata;
+					ecmdata.helper_work = ECM_FTREE_FROM_BINARY;
+					ecmdata.poly1 = polyF;
+					for (int i = 0; i < slice_size; i += ecmdata.ftree_io.batch_count) {
+						ecmdata.ftree_io.batch = ftree_io_read (&ecmdata.ftree_io, slice_size - i, &ecmdata.ftree_io.batch_count);
+						if (ecmdata.ftree_io.batch == NULL) goto ftree_io_error;
+						ecmdata.ftree_io.batch_first = i;
+						polymult_launch_helpers (&ecmdata.polydata);
 					}
-					free (array);
-//explore whether multithreaded version would have cloned gwdata memory allocation issues in binarytogw						
-//   must deal with i/o errors
-//gw:   unlink on exit/error
 				}
 				// Copy polyF from memory
 				else {
@@ -9717,12 +11125,7 @@ start_timer_from_zero (timers, 0);
 	    }
 	}
 
-//GW: Make sure error paths close fd, free Ftree
-	if (ecmdata.Ftree_polys_in_mem < 2) {
-		_chsize_s (fd, 0);		// On a google drive, deleting a big file does not free disk space.  So truncate it before deleting.
-		_close (fd);
-		_unlink (ftree_filename);
-	}
+	ftree_io_close (&ecmdata.ftree_io);
 	free (ecmdata.Ftree), ecmdata.Ftree = NULL;
 
 // Multiply the coefficients in polyH together for a later GCD.  We launch single-threaded helpers to do this because the gwnum FFT size may not be
@@ -9781,6 +11184,11 @@ start_timer_from_zero (timers, 0);
 
 /* Cleanup and free poly gwnums before GCD.  GCD can use significant amounts of memory. */
 
+if (IniGetInt (INI_FILE, "PolyVerbose", 0)) {
+sprintf (buf, "Polymult plan cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions\n",
+	 ecmdata.polydata.plan_cache_hits, ecmdata.polydata.plan_cache_misses, ecmdata.polydata.plan_cache_evictions);
+OutputStr (thread_num, buf);
+}
 	polymult_done (&ecmdata.polydata);
 	gwfree_array (&ecmdata.gwdata, ecmdata.polyF), ecmdata.polyF = NULL;
 	gwfree_array (&ecmdata.gwdata, ecmdata.polyR), ecmdata.polyR = NULL;
@@ -9812,6 +11220,7 @@ stage2_done:
 	sprintf (buf, "Stage 2 complete. %" PRIu64 " transforms, %lu modular inverses. Total time: ", gw_get_fft_count (&ecmdata.gwdata), ecmdata.modinv_count);
 	print_timer (timers, 1, buf, TIMER_NL | TIMER_CLR);
 	OutputStr (thread_num, buf);
+	report_pairmap_wait (thread_num, &ecmdata.bg_pairmap);
 	last_output = last_output_t = ecmdata.modinv_count = 0;
 	gw_clear_fft_count (&ecmdata.gwdata);
 
@@ -9839,9 +11248,23 @@ stage2_done:
 /* See if we got lucky! */
 
 restart4:
+	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;	// GMP-ECM resume files skip stage 1
 	ecmdata.state = ECM_STATE_GCD;
 	sprintf (w->stage, "C%" PRIu32 "S2", ecmdata.curve);
 	w->pct_complete = 1.0;
+
+/* Unless this is the last curve, do the GCD in the background while stage 1 of the next curve runs */
+
+	if ((w->curves_to_do == 0 || ecmdata.curve < w->curves_to_do) &&
+	    start_background_gcd (&ecmdata.bg_gcd, &ecmdata.gwdata, thread_num, ecmdata.gg, ecmdata.N)) {
+		ecmdata.bg_gcd_curve = ecmdata.curve;
+		ecmdata.bg_gcd_sigma = ecmdata.sigma;
+		ecmdata.bg_gcd_sigma_type = ecmdata.sigma_type;
+		ecmdata.bg_gcd_C = ecmdata.C;
+		OutputStr (thread_num, "Stage 2 GCD running in the background.\n");
+		goto more_curves;
+	}
+
 	start_timer_from_zero (timers, 0);
 	stop_reason = gcd (&ecmdata.gwdata, thread_num, ecmdata.gg, ecmdata.N, &ecmdata.factor);
 	if (stop_reason) {
@@ -9859,6 +11282,7 @@ restart4:
 more_curves:
 	ecm_mini_cleanup (&ecmdata);		// Free all memory except N and gwdata
 	mallocFreeForOS ();
+	ecm_batch_unlink (&ecmdata, ecmdata.curve, ecmdata.curve);	// Delete the save file from a stage 1 batch, if any
 	ecmdata.curve++;
 	if (w->curves_to_do == 0 || ecmdata.curve <= w->curves_to_do) {
 		// If necessary, switch back to the stage 1 FFT length
@@ -9873,6 +11297,8 @@ more_curves:
 			if (ERRCHK) gwset_will_error_check (&ecmdata.gwdata);
 			gwset_num_threads (&ecmdata.gwdata, ecmdata.stage1_threads);
 			gwset_thread_callback (&ecmdata.gwdata, SetAuxThreadPriority);
+			SetGwnumNumaPolicy (&ecmdata.gwdata);
+			SetGwnumTableCache (&ecmdata.gwdata);
 			gwset_thread_callback_data (&ecmdata.gwdata, sp_info);
 			gwset_safety_margin (&ecmdata.gwdata, IniGetFloat (INI_FILE, "ExtraSafetyMargin", 0.0));
 			gwset_minimum_fftlen (&ecmdata.gwdata, w->minimum_fftlen);
@@ -9884,6 +11310,9 @@ more_curves:
 				sprintf (buf, "Cannot initialize FFT code, errcode=%d\n", res);
 				OutputBoth (thread_num, buf);
 				stop_reason = STOP_FATAL_ERROR;
+				// Report a factor found by the previous curve's background GCD.  The factor reporting code avoids the unusable gwdata.
+				gwsetup_failed = TRUE;
+				if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 				goto exit;
 			}
 			gwerror_checking (&ecmdata.gwdata, ERRCHK || near_fft_limit);
@@ -9898,6 +11327,7 @@ more_curves:
 /* If we've finished processing an unlimited number of curves from a GMP-ECM resume file, set the number of curves we actually processed */
 
 no_more_curves:
+	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 	if (w->curves_to_do == 0) w->curves_to_do = ecmdata.curve - 1;
 
 /* Output line to results file indicating the number of curves run */
@@ -9958,11 +11388,13 @@ no_more_curves:
 /* Delete the save file */
 
 	unlinkSaveFiles (&ecmdata.write_save_file_state);
+	ecm_batch_unlink (&ecmdata, ecmdata.curve, ecmdata.curve + 2 * ecmdata.stage1_threads);
 
 /* Free memory and return */
 
 	stop_reason = STOP_WORK_UNIT_COMPLETE;
-exit:	Dmultiple_map.clear ();
+exit:	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
+	Dmultiple_map.clear ();
 	relp_set_map.clear ();
 	ecm_cleanup (&ecmdata);
 	free (str);
@@ -9975,9 +11407,16 @@ lowmem:	stop_reason = OutOfMemory (thread_num);
 possible_lowmem:
 	if (ecmdata.state == ECM_STATE_MIDSTAGE) ecm_save (&ecmdata);
 	if (stop_reason != STOP_OUT_OF_MEM) goto exit;
+	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 	Dmultiple_map.clear ();
 	relp_set_map.clear ();
 	ecm_cleanup (&ecmdata);
+	if (ecmdata.poly_file_failed) {
+		OutputBoth (thread_num, "Could not create out-of-core poly file.  Trying again with polys in memory.\n");
+		ecmdata.poly_file_failed = FALSE;
+		ecmdata.poly_in_core_only = TRUE;
+		goto restart;
+	}
 	OutputBoth (thread_num, "Memory allocation error.  Trying again using less memory.\n");
 	ecmdata.pct_mem_to_use *= 0.8;
 	goto restart;
@@ -9987,9 +11426,29 @@ possible_lowmem:
 oom:	stop_reason = OutOfMemory (thread_num);
 	goto exit;
 
+/* Reading or writing the Ftree file failed.  Print error message and exit. */
+
+ftree_io_error:
+	sprintf (buf, "Error reading or writing file %s.\n", ftree_filename);
+	OutputStr (thread_num, buf);
+	stop_reason = STOP_FILE_IO_ERROR;
+	goto exit;
+
+/* The previous curve's background stage 2 GCD found a factor.  Abandon the current curve and report the factor as found by the previous curve. */
+
+background_bingo:
+	free (ecmdata.factor);
+	ecmdata.factor = bg_factor;
+	ecmdata.curve = ecmdata.bg_gcd_curve;
+	ecmdata.sigma = ecmdata.bg_gcd_sigma;
+	ecmdata.sigma_type = ecmdata.bg_gcd_sigma_type;
+	ecmdata.C = ecmdata.bg_gcd_C;
+	ecmdata.state = ECM_STATE_GCD;
+
 /* Print a message, we found a factor! */
 
-bingo:	stage = (ecmdata.state > ECM_STATE_MIDSTAGE) ? 2 : (ecmdata.state > ECM_STATE_STAGE1_INIT) ? 1 : 0;
+bingo:	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
+	stage = (ecmdata.state > ECM_STATE_MIDSTAGE) ? 2 : (ecmdata.state > ECM_STATE_STAGE1_INIT) ? 1 : 0;
 	sprintf (buf, "ECM found a factor in curve #%" PRIu32 ", stage #%d\n", ecmdata.curve, stage);
 	writeResults (buf);
 	sprintf (buf, "Sigma=%" PRIu64 ", B1=%" PRIu64 ", B2=%" PRIu64 ".\n", ecmdata.sigma, ecmdata.B, ecmdata.C);
@@ -10007,9 +11466,13 @@ bingo:	stage = (ecmdata.state > ECM_STATE_MIDSTAGE) ? 2 : (ecmdata.state > ECM_S
 
 /* Validate the factor we just found */
 
-	if (!testFactor (&ecmdata.gwdata, w, ecmdata.factor)) {
+	if (!testFactor (gwsetup_failed ? NULL : &ecmdata.gwdata, w, ecmdata.factor)) {
 		sprintf (msg, "ERROR: Bad factor for %s found: %s\n", ecmdata.N_short_string_rep, str);
 		OutputBoth (thread_num, msg);
+		if (gwsetup_failed) {
+			stop_reason = STOP_FATAL_ERROR;
+			goto exit;
+		}
 		OutputStr (thread_num, "Restarting ECM curve from scratch.\n");
 		continueECM = TRUE;
 		ecmdata.curve--;
@@ -10056,7 +11519,7 @@ bingo:	stage = (ecmdata.state > ECM_STATE_MIDSTAGE) ? 2 : (ecmdata.state > ECM_S
 	if (ecmdata.curve == w->curves_to_do) continueECM = FALSE;
 	prpAfterEcmFactor = IniGetInt (INI_FILE, "PRPAfterECMFactor", bitlen (ecmdata.N) < 100000 && w->n && (w->k != 1.0 || w->b != 2 || w->c != -1));
 	if (prpAfterEcmFactor || continueECM) divg (ecmdata.factor, ecmdata.N);
-	if (prpAfterEcmFactor && isProbablePrime (&ecmdata.gwdata, ecmdata.N)) {
+	if (prpAfterEcmFactor && !gwsetup_failed && isProbablePrime (&ecmdata.gwdata, ecmdata.N)) {
 		OutputBoth (thread_num, "Cofactor is a probable prime!\n");
 		continueECM = FALSE;
 	}
@@ -10098,6 +11561,7 @@ bingo:	stage = (ecmdata.state > ECM_STATE_MIDSTAGE) ? 2 : (ecmdata.state > ECM_S
 		stop_reason = updateWorkToDoLine (thread_num, w);
 		if (stop_reason) goto exit;
 		unlinkSaveFiles (&ecmdata.write_save_file_state);
+		ecm_batch_unlink (&ecmdata, ecmdata.curve, ecmdata.curve + 2 * ecmdata.stage1_threads);
 		ecmdata.curve = 0;
 		ecmdata.average_B2 = 0;
 	}
@@ -10130,13 +11594,18 @@ bingo:	stage = (ecmdata.state > ECM_STATE_MIDSTAGE) ? 2 : (ecmdata.state > ECM_S
 
 	if (!continueECM) {
 		unlinkSaveFiles (&ecmdata.write_save_file_state);
+		ecm_batch_unlink (&ecmdata, ecmdata.curve, ecmdata.curve + 2 * ecmdata.stage1_threads);
 		stop_reason = STOP_WORK_UNIT_COMPLETE;
 		invalidateNextRollingAverageUpdate ();
 		goto exit;
 	}
 
-/* Do more curves despite finding a factor */
+/* Do more curves despite finding a factor.  Not possible if we could not set up the FFT code. */
 
+	if (gwsetup_failed) {
+		stop_reason = STOP_FATAL_ERROR;
+		goto exit;
+	}
 	goto more_curves;
 
 /* Output an error message saying we are restarting.  Sleep five minutes before restarting from last save file. */
@@ -10159,6 +11628,7 @@ err:	if (gw_get_maxerr (&ecmdata.gwdata) > allowable_maxerr) {
 
 	// Restart
 error_restart:
+	if (finish_background_gcd (&ecmdata.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 	Dmultiple_map.clear ();
 	relp_set_map.clear ();
 	ecm_cleanup (&ecmdata);
@@ -10312,6 +11782,9 @@ typedef struct {
 	gwnum	*nQx;		/* Array of relprime data or polymult coefficients used in stage 2 */
 	double	est_stage2_stage1_ratio; /* Estimated stage 2 runtime / stage 1 runtime ratio */
 	double	pct_mem_to_use;	/* If we get memory allocation errors in stage 2 init, we progressively try using less and less memory. */
+	int	poly_file_failed; /* TRUE if the temporary file for out-of-core polys could not be created */
+	int	poly_in_core_only; /* TRUE if polys must be kept in memory because an out-of-core poly file could not be created */
+	char	poly_file_dir[260]; /* Directory for out-of-core poly files (OutOfCoreDir in prime.txt) */
 	uint64_t B2_start;	/* Starting point of first D section to be processed in stage 2 (an odd multiple of D/2) */
 	uint64_t numDsections;	/* Number of D sections to process in stage 2 */
 	uint64_t Dsection;	/* Current D section being processed in stage 2 */
@@ -10326,6 +11799,7 @@ typedef struct {
 	uint64_t max_pairmap_Dsections;	/* Number of D sections that can fit in a pairing map */
 	uint8_t	*pairmap;	/* Pairing map for prime pairings in each D section */
 	uint64_t pairmap_size;	/* Size of the pairing map */
+	pairmap_producer bg_pairmap; /* Builds the next pairing map in the background */
 	uint8_t *pairmap_ptr;	/* Pointer to the next byte to process in the pairing map */
 	int16_t relp_sets[32];	/* The relp sets we are using in stage 2 */
 	int	relp;		/* Last relative prime processed in the current D section */
@@ -10360,6 +11834,7 @@ void pm1_cleanup (
 	free (pm1data->invx_binary), pm1data->invx_binary = NULL;
 	free (pm1data->gg_binary), pm1data->gg_binary = NULL;
 	free (pm1data->nQx), pm1data->nQx = NULL;
+	cancel_pairmap_producer (&pm1data->bg_pairmap);
 	free (pm1data->pairmap), pm1data->pairmap = NULL;
 	polymult_done (&pm1data->polydata);
 	gwdone (&pm1data->gwdata);
@@ -11152,6 +12627,8 @@ double pm1_stage2_impl_given_numvals (
 	cost_data.c.poly_compression = (double) gwfftlen (&pm1data->gwdata) * (double) sizeof (double) / (double) array_gwnum_size (&pm1data->gwdata);
 	if (IniGetInt (INI_FILE, "Poly1Compress", 2) == 2) cost_data.c.poly_compression *= 0.875;
 	if (IniGetInt (INI_FILE, "Poly1Compress", 2) == 0) cost_data.c.poly_compression = 1.0;
+	// A poly #1 stored out-of-core does not use any of our memory
+	else if (IniGetInt (INI_FILE, "Poly1OutOfCore", 0) && !pm1data->poly_in_core_only) cost_data.c.poly_compression = 0.0;
 
 /* Find the most efficienct stage 2 plan looking at the two available algorithms */
 
@@ -11405,6 +12882,7 @@ double pm1_stage2_impl (
 /* If we are continuing from a save file that was in stage 2, toss the save file's pairing map. */
 
 	if (pm1data->state >= PM1_STATE_STAGE2) {
+		cancel_pairmap_producer (&pm1data->bg_pairmap);
 		free (pm1data->pairmap);
 		pm1data->pairmap = NULL;
 		pm1data->pairmap_size = 0;
@@ -11753,6 +13231,8 @@ restart:
 	else gwset_will_error_check_near_limit (&pm1data.gwdata);
 	gwset_num_threads (&pm1data.gwdata, pm1data.stage1_threads);
 	gwset_thread_callback (&pm1data.gwdata, SetAuxThreadPriority);
+	SetGwnumNumaPolicy (&pm1data.gwdata);
+	SetGwnumTableCache (&pm1data.gwdata);
 	gwset_thread_callback_data (&pm1data.gwdata, sp_info);
 	gwset_safety_margin (&pm1data.gwdata, IniGetFloat (INI_FILE, "ExtraSafetyMargin", 0.0));
 	gwset_larger_fftlen_count (&pm1data.gwdata, maxerr_restart_count < 3 ? maxerr_restart_count : 3);
@@ -11861,6 +13341,7 @@ restart:
 
 			if (pm1data.B > pm1data.B_done && w->work_type == WORK_PMINUS1) {
 				free (pm1data.gg_binary), pm1data.gg_binary = NULL;
+				cancel_pairmap_producer (&pm1data.bg_pairmap);
 				free (pm1data.pairmap), pm1data.pairmap = NULL;
 				goto more_B;
 			}
@@ -12357,6 +13838,8 @@ replan:	unsigned long best_fftlen;
 
 		polymult_init (&pm1data.polydata, &pm1data.gwdata);
 		polymult_set_cpu_flags (&pm1data.polydata, CPU_FLAGS);		// Allow AVX-512 polymults on FMA3 FFTs
+		IniGetString (INI_FILE, "OutOfCoreDir", pm1data.poly_file_dir, sizeof (pm1data.poly_file_dir), NULL);
+		if (pm1data.poly_file_dir[0]) pm1data.polydata.file_backed_dir = pm1data.poly_file_dir;
 		polymult_set_max_num_threads (&pm1data.polydata, pm1data.stage2_threads);
 		polymult_default_tuning (&pm1data.polydata,
 					 IniGetInt (INI_FILE, "PolymultCacheSize", CPU_NUM_L2_CACHES > 0 ? CPU_TOTAL_L2_CACHE_SIZE / CPU_NUM_L2_CACHES : 256),
@@ -12472,6 +13955,8 @@ OutputStr (thread_num, buf); }
 			else gwset_will_error_check_near_limit (&pm1data.gwdata);
 			gwset_num_threads (&pm1data.gwdata, pm1data.stage2_threads);
 			gwset_thread_callback (&pm1data.gwdata, SetAuxThreadPriority);
+			SetGwnumNumaPolicy (&pm1data.gwdata);
+			SetGwnumTableCache (&pm1data.gwdata);
 			gwset_thread_callback_data (&pm1data.gwdata, sp_info);
 			gwset_minimum_fftlen (&pm1data.gwdata, next_fftlen);
 			gwset_using_polymult (&pm1data.gwdata);
@@ -12533,6 +14018,7 @@ OutputStr (thread_num, buf); }
 	// Beware that replaning may allocate a larger pairing map
 	if (set_memory_usage (thread_num, MEM_VARIABLE_USAGE, memused)) {
 		pm1data.pct_mem_to_use *= 0.99;
+		cancel_pairmap_producer (&pm1data.bg_pairmap);
 		free (pm1data.pairmap); pm1data.pairmap = NULL;
 		goto replan;
 	}
@@ -12562,11 +14048,9 @@ OutputStr (thread_num, buf); }
 /* Create a new map of (hopefully) close-to-optimal prime pairings */
 
 	if (pm1data.pairmap == NULL) {
-		int fill_window = pair_window_size (pm1data.gwdata.bit_length, pm1data.relp_sets);
-		gwfree_internal_memory (&pm1data.gwdata);
-		stop_reason = fill_pairmap (pm1data.thread_num, &pm1data.sieve_info, pm1data.D, fill_window,0,0,0,
-					    pm1data.totrels, pm1data.relp_sets+3, pm1data.first_relocatable, pm1data.last_relocatable,
-					    pm1data.B2_start, pm1data.C, pm1data.max_pairmap_Dsections, &pm1data.pairmap, &pm1data.pairmap_size);
+		stop_reason = next_pairmap (&pm1data.bg_pairmap, &pm1data.gwdata, pm1data.thread_num, pm1data.D, pm1data.totrels, pm1data.relp_sets,
+					    pm1data.first_relocatable, pm1data.last_relocatable, pm1data.B2_start, pm1data.C,
+					    pm1data.max_pairmap_Dsections, &pm1data.pairmap, &pm1data.pairmap_size);
 		if (stop_reason) goto exit;
 		pm1data.pairmap_ptr = pm1data.pairmap;
 		pm1data.Dsection = 0;
@@ -12960,11 +14444,9 @@ OutputStr (thread_num, buf); }
 			ASSERTG (pm1data.relp == 0);
 			pm1data.C_done = pm1data.B2_start + pm1data.Dsection * pm1data.D;
 			pm1data.first_relocatable = calc_new_first_relocatable (pm1data.D, pm1data.C_done);
-			int fill_window = pair_window_size (pm1data.gwdata.bit_length, pm1data.relp_sets);
-			gwfree_internal_memory (&pm1data.gwdata);
-			stop_reason = fill_pairmap (pm1data.thread_num, &pm1data.sieve_info, pm1data.D, fill_window,0,0,0,
-						    pm1data.totrels, pm1data.relp_sets+3, pm1data.first_relocatable, pm1data.last_relocatable,
-						    pm1data.C_done, pm1data.C, pm1data.max_pairmap_Dsections, &pm1data.pairmap, &pm1data.pairmap_size);
+			stop_reason = next_pairmap (&pm1data.bg_pairmap, &pm1data.gwdata, pm1data.thread_num, pm1data.D, pm1data.totrels, pm1data.relp_sets,
+						    pm1data.first_relocatable, pm1data.last_relocatable, pm1data.C_done, pm1data.C,
+						    pm1data.max_pairmap_Dsections, &pm1data.pairmap, &pm1data.pairmap_size);
 			if (stop_reason) {
 //GW:				is save possible here with no pairmap generated?
 				pm1_save (&pm1data);
@@ -13041,6 +14523,7 @@ OutputStr (thread_num, buf); }
 
 	for (i = 0; i < pm1data.totrels; i++) gwfree (&pm1data.gwdata, pm1data.nQx[i]);
 	free (pm1data.nQx), pm1data.nQx = NULL;
+	cancel_pairmap_producer (&pm1data.bg_pairmap);
 	free (pm1data.pairmap), pm1data.pairmap = NULL;
 
 /* Check for the rare cases where we need to do even more stage 2.  This happens when continuing a save file in the middle of stage 2 and */
@@ -13307,7 +14790,14 @@ OutputStr (thread_num, buf); gw_clear_maxerr (&pm1data.gwdata);
 		if (IniGetInt (INI_FILE, "Poly1Compress", 2) == -1) options |= POLYMULT_PRE_FFT;				// Hidden option (uses lots of memory)
 		if (IniGetInt (INI_FILE, "Poly1Compress", 2) == -2) options |= POLYMULT_PRE_FFT | POLYMULT_PRE_COMPRESS;	// Hidden option (uses lots of memory)
 		if (IniGetInt (INI_FILE, "Poly1Compress", 2) == 2) options |= POLYMULT_PRE_COMPRESS;
+		if (IniGetInt (INI_FILE, "Poly1OutOfCore", 0) && !pm1data.poly_in_core_only) options |= POLYMULT_PRE_FILE_BACKED;
 		gwarray tmp = polymult_preprocess (&pm1data.polydata, poly1, pm1data.poly1_size, pm1data.poly2_size, outpoly_size, options);
+		if (tmp == NULL) {
+			if (!(options & POLYMULT_PRE_FILE_BACKED)) goto lowmem;
+			pm1data.poly_file_failed = TRUE;
+			stop_reason = STOP_OUT_OF_MEM;
+			goto possible_lowmem;
+		}
 		gwfree_array (&pm1data.gwdata, poly1);
 		poly1 = tmp;
 //		sprintf (buf, "Gwnum size: %lu, unpadded gwnum size: %lu, est. compressed size: %6.4f, act. compressed size: %6.4f, excess: %6.4f\n",
@@ -13605,6 +15095,11 @@ OutputStr (thread_num, buf); gw_clear_maxerr (&pm1data.gwdata);}
 
 	gwfree (&pm1data.gwdata, pm1data.r_squared), pm1data.r_squared = NULL;
 	gwfree (&pm1data.gwdata, pm1data.diff1), pm1data.diff1 = NULL;
+if (IniGetInt (INI_FILE, "PolyVerbose", 0)) {
+sprintf (buf, "Polymult plan cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions\n",
+	 pm1data.polydata.plan_cache_hits, pm1data.polydata.plan_cache_misses, pm1data.polydata.plan_cache_evictions);
+OutputStr (thread_num, buf);
+}
 	polymult_done (&pm1data.polydata);
 	gwfree_array (&pm1data.gwdata, poly1);
 	gwfree_array (&pm1data.gwdata, poly2);
@@ -13620,6 +15115,7 @@ stage2_done:
 	sprintf (buf, "%s stage 2 complete. %" PRIu64 " transforms. Total time: ", gwmodulo_as_string (&pm1data.gwdata), gw_get_fft_count (&pm1data.gwdata));
 	print_timer (timers, 1, buf, TIMER_NL | TIMER_CLR);
 	OutputStr (thread_num, buf);
+	report_pairmap_wait (thread_num, &pm1data.bg_pairmap);
 
 /* Adjust fudge factor for stage2 vs. stage1 runtime ratio.  We use a rolling average. */
 
@@ -13767,6 +15263,12 @@ possible_lowmem:
 	Dmultiple_map.clear ();
 	relp_set_map.clear ();
 	pm1_cleanup (&pm1data);
+	if (pm1data.poly_file_failed) {
+		OutputBoth (thread_num, "Could not create out-of-core poly file.  Trying again with polys in memory.\n");
+		pm1data.poly_file_failed = FALSE;
+		pm1data.poly_in_core_only = TRUE;
+		goto restart;
+	}
 	OutputBoth (thread_num, "Memory allocation error.  Trying again using less memory.\n");
 	pm1data.pct_mem_to_use *= 0.8;
 	goto restart;
@@ -14474,6 +15976,7 @@ typedef struct {
 	uint64_t max_pairmap_Dsections;	/* Number of D sections that can fit in a pairing map */
 	uint8_t	*pairmap;	/* Pairing map for prime pairings and singles in each D section */
 	uint64_t pairmap_size;	/* Size of the pairing map */
+	pairmap_producer bg_pairmap; /* Builds the next pairing map in the background */
 	uint8_t *pairmap_ptr;	/* Pointer to the next byte to process in the pairing map */
 	uint64_t first_relocatable; /* First relocatable prime (same as B1 unless pairmaps must be split or mem change caused a replan) */
 	uint64_t last_relocatable; /* Last relocatable prime for filling pairmaps (unless mem change causes a replan) */
@@ -14489,6 +15992,7 @@ typedef struct {
 	gwnum	Vn;		/* V_n in a Lucas sequence */
 	gwnum	Vn1;		/* V_{n+1} in a Lucas sequence */
 	gwnum	gg;		/* An accumulator in stage 2 */
+	struct background_gcd bg_gcd; /* Stage 1 GCD running while we do stage 2 */
 } pp1handle;
 
 /* Perform cleanup functions. */
@@ -14496,10 +16000,17 @@ typedef struct {
 void pp1_cleanup (
 	pp1handle *pp1data)
 {
+	giant	bg_factor;
+
+/* Wait for any background GCD, the caller has already collected any interesting result */
+
+	finish_background_gcd (&pp1data->bg_gcd, TRUE, &bg_factor);
+	free (bg_factor);
 
 /* Free memory */
 
 	free (pp1data->nQx), pp1data->nQx = NULL;
+	cancel_pairmap_producer (&pp1data->bg_pairmap);
 	free (pp1data->pairmap), pp1data->pairmap = NULL;
 	gwdone (&pp1data->gwdata);
 	end_sieve (pp1data->sieve_info), pp1data->sieve_info = NULL;
@@ -15019,6 +16530,7 @@ int pp1_stage2_impl (
 /* If are continuing from a save file that was in stage 2, toss the save file's pair map. */
 
 	if (pp1data->state >= PP1_STATE_STAGE2) {
+		cancel_pairmap_producer (&pp1data->bg_pairmap);
 		free (pp1data->pairmap);
 		pp1data->pairmap = NULL;
 	}
@@ -15047,11 +16559,9 @@ int pp1_stage2_impl (
 
 /* Create a map of (hopefully) close-to-optimal prime pairings */
 
-	int fill_window = pair_window_size (pp1data->gwdata.bit_length, pp1data->relp_sets);
-	gwfree_internal_memory (&pp1data->gwdata);
-	stop_reason = fill_pairmap (pp1data->thread_num, &pp1data->sieve_info, pp1data->D, fill_window,0,0,0,
-				    pp1data->totrels, pp1data->relp_sets+3, pp1data->first_relocatable, pp1data->last_relocatable,
-				    pp1data->B2_start, pp1data->C, pp1data->max_pairmap_Dsections, &pp1data->pairmap, &pp1data->pairmap_size);
+	stop_reason = next_pairmap (&pp1data->bg_pairmap, &pp1data->gwdata, pp1data->thread_num, pp1data->D, pp1data->totrels, pp1data->relp_sets,
+				    pp1data->first_relocatable, pp1data->last_relocatable, pp1data->B2_start, pp1data->C,
+				    pp1data->max_pairmap_Dsections, &pp1data->pairmap, &pp1data->pairmap_size);
 	if (stop_reason) return (stop_reason);
 	pp1data->pairmap_ptr = pp1data->pairmap;
 	pp1data->Dsection = 0;
@@ -15393,6 +16903,7 @@ int pplus1 (
 	pp1handle pp1data;
 	giant	N;		/* Number being factored */
 	giant	factor;		/* Factor found, if any */
+	giant	bg_factor;	/* Factor found by a background GCD, if any */
 	unsigned int memused;
 	int	i, res, stop_reason, first_iter_msg, saving, near_fft_limit, echk;
 	char	filename[32], buf[255], JSONbuf[4000], testnum[100];
@@ -15513,6 +17024,8 @@ restart:
 	else gwset_will_error_check_near_limit (&pp1data.gwdata);
 	gwset_num_threads (&pp1data.gwdata, pp1data.stage1_threads);
 	gwset_thread_callback (&pp1data.gwdata, SetAuxThreadPriority);
+	SetGwnumNumaPolicy (&pp1data.gwdata);
+	SetGwnumTableCache (&pp1data.gwdata);
 	gwset_thread_callback_data (&pp1data.gwdata, sp_info);
 	gwset_safety_margin (&pp1data.gwdata, IniGetFloat (INI_FILE, "ExtraSafetyMargin", 0.0));
 	gwset_larger_fftlen_count (&pp1data.gwdata, maxerr_restart_count < 3 ? maxerr_restart_count : 3);
@@ -15615,6 +17128,7 @@ restart:
 
 			if (pp1data.B > pp1data.B_done) {
 				gwfree (&pp1data.gwdata, pp1data.gg), pp1data.gg = NULL;
+				cancel_pairmap_producer (&pp1data.bg_pairmap);
 				free (pp1data.pairmap), pp1data.pairmap = NULL;
 				goto more_B;
 			}
@@ -15837,17 +17351,23 @@ more_B:		pp1data.interim_B = pp1data.B;
 	if (pp1data.C <= pp1data.B || (!QA_IN_PROGRESS && IniGetInt (INI_FILE, "Stage1GCD", 1))) {
 		start_timer_from_zero (timers, 0);
 		gwsmalladd (&pp1data.gwdata, -2, pp1data.V);
-		stop_reason = gcd (&pp1data.gwdata, thread_num, pp1data.V, N, &factor);
-		gwsmalladd (&pp1data.gwdata, 2, pp1data.V);
-		if (stop_reason) {
-			pp1_save (&pp1data);
-			goto exit;
+		// When a stage 2 follows, overlap the GCD with stage 2
+		if (pp1data.C > pp1data.B && start_background_gcd (&pp1data.bg_gcd, &pp1data.gwdata, thread_num, pp1data.V, N)) {
+			gwsmalladd (&pp1data.gwdata, 2, pp1data.V);
+			OutputStr (thread_num, "Stage 1 GCD running in the background.\n");
+		} else {
+			stop_reason = gcd (&pp1data.gwdata, thread_num, pp1data.V, N, &factor);
+			gwsmalladd (&pp1data.gwdata, 2, pp1data.V);
+			if (stop_reason) {
+				pp1_save (&pp1data);
+				goto exit;
+			}
+			end_timer (timers, 0);
+			strcpy (buf, "Stage 1 GCD complete. Time: ");
+			print_timer (timers, 0, buf, TIMER_NL);
+			OutputStr (thread_num, buf);
+			if (factor != NULL) goto bingo;
 		}
-		end_timer (timers, 0);
-		strcpy (buf, "Stage 1 GCD complete. Time: ");
-		print_timer (timers, 0, buf, TIMER_NL);
-		OutputStr (thread_num, buf);
-		if (factor != NULL) goto bingo;
 	}
 
 /* Skip second stage if so requested */
@@ -15920,6 +17440,7 @@ replan:	{
 	// Beware that replaning may allocate a larger pairmap
 	if (set_memory_usage (thread_num, MEM_VARIABLE_USAGE, memused)) {
 		pp1data.pct_mem_to_use *= 0.99;
+		cancel_pairmap_producer (&pp1data.bg_pairmap);
 		free (pp1data.pairmap); pp1data.pairmap = NULL;
 		goto replan;
 	}
@@ -16311,10 +17832,9 @@ replan:	{
 			ASSERTG (pp1data.relp == 0);
 			pp1data.C_done = pp1data.B2_start + pp1data.Dsection * pp1data.D;
 			pp1data.first_relocatable = calc_new_first_relocatable (pp1data.D, pp1data.C_done);
-			int fill_window = pair_window_size (pp1data.gwdata.bit_length, pp1data.relp_sets);
-			stop_reason = fill_pairmap (pp1data.thread_num, &pp1data.sieve_info, pp1data.D, fill_window,0,0,0,
-						    pp1data.totrels, pp1data.relp_sets+3, pp1data.first_relocatable, pp1data.last_relocatable,
-						    pp1data.C_done, pp1data.C, pp1data.max_pairmap_Dsections, &pp1data.pairmap, &pp1data.pairmap_size);
+			stop_reason = next_pairmap (&pp1data.bg_pairmap, &pp1data.gwdata, pp1data.thread_num, pp1data.D, pp1data.totrels, pp1data.relp_sets,
+						    pp1data.first_relocatable, pp1data.last_relocatable, pp1data.C_done, pp1data.C,
+						    pp1data.max_pairmap_Dsections, &pp1data.pairmap, &pp1data.pairmap_size);
 			if (stop_reason) {
 //GW:				is save possible here with no pairmap generated?
 				pp1_save (&pp1data);
@@ -16325,6 +17845,10 @@ replan:	{
 			continue;
 		}
 
+/* Check if the background stage 1 GCD found a factor */
+
+		if (finish_background_gcd (&pp1data.bg_gcd, FALSE, &bg_factor)) goto background_bingo;
+
 /* Multiply this Vn1 - nQx value into the gg accumulator */
 
 		saving = testSaveFilesFlag (thread_num);
@@ -16391,6 +17915,7 @@ replan:	{
 
 	for (i = 0; i < pp1data.totrels; i++) gwfree (&pp1data.gwdata, pp1data.nQx[i]);
 	free (pp1data.nQx), pp1data.nQx = NULL;
+	cancel_pairmap_producer (&pp1data.bg_pairmap);
 	free (pp1data.pairmap), pp1data.pairmap = NULL;
 
 /* Check for the rare cases where we need to do even more stage 2.  This happens when continuing a save file in the middle of stage 2 and */
@@ -16413,6 +17938,7 @@ replan:	{
 	sprintf (buf, "%s stage 2 complete. %" PRIu64 " transforms. Total time: ", gwmodulo_as_string (&pp1data.gwdata), gw_get_fft_count (&pp1data.gwdata));
 	print_timer (timers, 1, buf, TIMER_NL | TIMER_CLR);
 	OutputStr (thread_num, buf);
+	report_pairmap_wait (thread_num, &pp1data.bg_pairmap);
 
 /* Print out round off error */
 
@@ -16425,6 +17951,7 @@ replan:	{
 /* See if we got lucky! */
 
 restart4:
+	if (finish_background_gcd (&pp1data.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 	pp1data.state = PP1_STATE_GCD;
 	strcpy (w->stage, "S2");
 	w->pct_complete = 1.0;
@@ -16508,7 +18035,8 @@ done:	stop_reason = STOP_WORK_UNIT_COMPLETE;
 
 /* Free memory and return */
 
-exit:	Dmultiple_map.clear ();
+exit:	if (finish_background_gcd (&pp1data.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
+	Dmultiple_map.clear ();
 	relp_set_map.clear ();
 	pp1_cleanup (&pp1data);
 	free (N);
@@ -16525,6 +18053,7 @@ possible_lowmem:
 	if (stop_reason != STOP_OUT_OF_MEM) goto exit;
 //GW: saving file twice?
 	pp1_save (&pp1data);
+	if (finish_background_gcd (&pp1data.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
 	Dmultiple_map.clear ();
 	relp_set_map.clear ();
 	pp1_cleanup (&pp1data);
@@ -16537,9 +18066,17 @@ possible_lowmem:
 oom:	stop_reason = OutOfMemory (thread_num);
 	goto exit;
 
+/* The background stage 1 GCD found a factor */
+
+background_bingo:
+	free (factor);
+	factor = bg_factor;
+	pp1data.state = PP1_STATE_STAGE1;
+
 /* Print a message if we found a factor! */
 
-bingo:	if (pp1data.state < PP1_STATE_MIDSTAGE)
+bingo:	if (finish_background_gcd (&pp1data.bg_gcd, TRUE, &bg_factor)) goto background_bingo;
+	if (pp1data.state < PP1_STATE_MIDSTAGE)
 		sprintf (buf, "P+1 found a factor in stage #1, B1=%" PRIu64 ".\n", pp1data.B);
 	else
 		sprintf (buf, "P+1 found a factor in stage #2, B1=%" PRIu64 ", B2=%" PRIu64 ".\n", pp1data.B, pp1data.C);
@@ -113,6 +113,7 @@ int 		mulmMsp (ghandle *, gmatrix, gmatrix, int);
 void		punch (ghandle *, giant, gmatrix);
 int		hgcd (ghandle *, int, giant *, giant *, gmatrix, int);
 int		rhgcd (ghandle *, giant *, giant *, gmatrix, int);
+int		jacobig_common (ghandle *, giant, giant, int *, int);
 
 #define sintstackg(i,g) if(i<0){i=-i;g.sign=-1;}else g.sign=1;g.n=(uint32_t*)&i;setmaxsize(&g,1);
 #define uintstackg(i,g) g.sign=1;g.n=(uint32_t*)&i;setmaxsize(&g,1);
@@ -2837,3 +2838,658 @@ free (t2);
 
 	return (0);
 }
+
+
+/**************************************************************
+ *
+ * Jacobi symbol
+ *
+ **************************************************************/
+
+/* The Jacobi symbol (a|b) follows the same remainder sequence as gcd(a,b).  Each step replaces one operand x with */
+/* r = x - q*y.  If y is the (odd) denominator, then (x|y) = (r|y).  If x is the denominator and y is odd, then reciprocity */
+/* makes y the denominator.  If x is the denominator and y is even, then (y|x) = (y|r) when 4 divides y.  Otherwise the two */
+/* symbols differ by factors that depend only on x, r, and y mod 8.  Thus the symbol can be tracked from the low three bits of */
+/* the full operands and of each quotient.  This lets a half GCD working on only the high words of a and b discover the steps. */
+/* Every step must leave both full operands positive.  The half GCD's reduction condition (operands never drop below */
+/* 2^(32*s)) guarantees this.  See Niels Moller, "On Schonhage's algorithm and subquadratic integer GCD computation". */
+
+typedef struct {
+	int	sign;		/* Sign of the symbol accumulated so far */
+	int	den;		/* 0 if a is the denominator, 1 if b is the denominator */
+	int	a8;		/* Full a mod 8 */
+	int	b8;		/* Full b mod 8 */
+} jacstate;
+
+/* Size (in 32-bit words) below which jachgcd makes no recursive calls */
+#define JACHGCD_BREAK	250
+
+/* Size (in 32-bit words) below which jacobig no longer calls jachgcd */
+#define JACGCD_BREAK	400
+
+/* Lehmer steps keep the 64-bit approximations of the operands above this value */
+#define JAC_LEHMER_MIN	((uint64_t) 1 << 33)
+
+/* Update the Jacobi state for the step a -= q*b (which = 0) or b -= q*a (which = 1) */
+
+void jac_update (
+	jacstate *js,
+	int	which,
+	uint32_t q)
+{
+	int	x8, y8, r8;
+
+	x8 = which ? js->b8 : js->a8;
+	y8 = which ? js->a8 : js->b8;
+	r8 = (x8 - (int) (q & 7) * y8) & 7;
+
+/* If y is the denominator, (x|y) = (r|y) and nothing changes */
+
+	if (js->den == which) {
+
+/* If y is odd, then (y|x) = (x|y) = (r|y) with a sign change if x and y are both 3 mod 4 */
+
+		if (y8 & 1) {
+			if ((x8 & 3) == 3 && (y8 & 3) == 3) js->sign = -js->sign;
+			js->den = !which;
+		}
+
+/* If y = 2h with h odd, then (y|x) = (y|r) * (2|x) * (2|r) * (h|x) / (h|r).  Using reciprocity and x = r mod h, */
+/* (h|x) / (h|r) is -1 only if h is 3 mod 4 and exactly one of x and r is 3 mod 4.  If 4 divides y, (y|x) = (y|r). */
+
+		else if (y8 & 2) {
+			if ((x8 == 3 || x8 == 5) != (r8 == 3 || r8 == 5)) js->sign = -js->sign;
+			if (y8 == 6 && (x8 & 3) != (r8 & 3)) js->sign = -js->sign;
+		}
+	}
+
+	if (which) js->b8 = r8;
+	else js->a8 = r8;
+}
+
+/* Return 64 bits of g starting at bit number shift */
+
+uint64_t jac_bits64 (
+	giant	g,
+	int	shift)
+{
+	int	i, bits;
+	uint64_t result;
+
+	i = shift >> 5;
+	bits = shift & 31;
+	result = (i < g->sign) ? g->n[i] : 0;
+	if (i + 1 < g->sign) result += (uint64_t) g->n[i+1] << 32;
+	if (bits) {
+		result >>= bits;
+		if (i + 2 < g->sign) result += (uint64_t) g->n[i+2] << (64 - bits);
+	}
+	return (result);
+}
+
+/* Apply the inverse of a single word matrix to x and y.  That is, x = m22*x - m12*y and y = m11*y - m21*x. */
+/* The caller guarantees both results are non-negative.  Done in one pass without temporaries. */
+
+void jac_lincomb_sub (
+	giant	x,
+	giant	y,
+	uint64_t m11,
+	uint64_t m12,
+	uint64_t m21,
+	uint64_t m22)
+{
+	int	i, n;
+	uint64_t xi, yi, t1, t2, d, cx1, cx2, cy1, cy2, bx, by;
+
+	n = intmax (x->sign, y->sign);
+	cx1 = cx2 = cy1 = cy2 = bx = by = 0;
+	for (i = 0; i < n; i++) {
+		xi = (i < x->sign) ? x->n[i] : 0;
+		yi = (i < y->sign) ? y->n[i] : 0;
+		t1 = m22 * xi + cx1;  cx1 = t1 >> 32;
+		t2 = m12 * yi + cx2;  cx2 = t2 >> 32;
+		d = (t1 & 0xFFFFFFFF) - (t2 & 0xFFFFFFFF) - bx;
+		bx = d >> 63;
+		x->n[i] = (uint32_t) d;
+		t1 = m11 * yi + cy1;  cy1 = t1 >> 32;
+		t2 = m21 * xi + cy2;  cy2 = t2 >> 32;
+		d = (t1 & 0xFFFFFFFF) - (t2 & 0xFFFFFFFF) - by;
+		by = d >> 63;
+		y->n[i] = (uint32_t) d;
+	}
+	ASSERTG (cx1 == cx2 + bx && cy1 == cy2 + by);
+	for (i = n; i > 0 && x->n[i-1] == 0; i--);
+	x->sign = i;
+	for (i = n; i > 0 && y->n[i-1] == 0; i--);
+	y->sign = i;
+}
+
+/* Multiply the row vector x,y by a single word matrix.  That is, x = m11*x + m21*y and y = m12*x + m22*y. */
+
+void jac_lincomb_add (
+	giant	x,
+	giant	y,
+	uint64_t m11,
+	uint64_t m12,
+	uint64_t m21,
+	uint64_t m22)
+{
+	int	i, n;
+	uint64_t xi, yi, t1, t2, s, cx1, cx2, cy1, cy2, sx, sy;
+
+	n = intmax (x->sign, y->sign);
+	cx1 = cx2 = cy1 = cy2 = sx = sy = 0;
+	for (i = 0; i < n; i++) {
+		xi = (i < x->sign) ? x->n[i] : 0;
+		yi = (i < y->sign) ? y->n[i] : 0;
+		t1 = m11 * xi + cx1;  cx1 = t1 >> 32;
+		t2 = m21 * yi + cx2;  cx2 = t2 >> 32;
+		s = (t1 & 0xFFFFFFFF) + (t2 & 0xFFFFFFFF) + sx;
+		sx = s >> 32;
+		x->n[i] = (uint32_t) s;
+		t1 = m12 * xi + cy1;  cy1 = t1 >> 32;
+		t2 = m22 * yi + cy2;  cy2 = t2 >> 32;
+		s = (t1 & 0xFFFFFFFF) + (t2 & 0xFFFFFFFF) + sy;
+		sy = s >> 32;
+		y->n[i] = (uint32_t) s;
+	}
+	for (s = cx1 + cx2 + sx, i = n; s; s >>= 32) x->n[i++] = (uint32_t) s;
+	for ( ; i > 0 && x->n[i-1] == 0; i--);
+	x->sign = i;
+	for (s = cy1 + cy2 + sy, i = n; s; s >>= 32) y->n[i++] = (uint32_t) s;
+	for ( ; i > 0 && y->n[i-1] == 0; i--);
+	y->sign = i;
+	ASSERTG (x->sign <= x->maxsize && y->sign <= y->maxsize);
+}
+
+/* Dest += q * src */
+
+int jac_addmul (
+	ghandle *gdata,		/* Free memory blocks for temporaries */
+	giant	src,
+	giant	q,
+	giant	dest)
+{
+	giant	t;
+	int	stop_reason;
+
+	if (isZero (src)) return (0);
+	t = popg (gdata, src->sign + q->sign + 1);
+	if (t == NULL) return (GIANT_OUT_OF_MEMORY);
+	gtog (src, t);
+	stop_reason = mulgi (gdata, q, t);
+	if (!stop_reason) addg (t, dest);
+	pushg (gdata, 1);
+	return (stop_reason);
+}
+
+/* M = M * M1 */
+
+int jac_matmul (
+	ghandle *gdata,		/* Free memory blocks for temporaries */
+	gmatrix	M,
+	gmatrix	M1)
+{
+	giant	*row[2][2], t1, t2, t3;
+	int	i, size, ss, stop_reason;
+
+	ss = stackstart (gdata);
+	row[0][0] = &M->ul; row[0][1] = &M->ur;
+	row[1][0] = &M->ll; row[1][1] = &M->lr;
+	size = intmax (intmax (M->ul->sign, M->ur->sign), intmax (M->ll->sign, M->lr->sign)) +
+	       intmax (intmax (M1->ul->sign, M1->ur->sign), intmax (M1->ll->sign, M1->lr->sign)) + 2;
+	t1 = popg (gdata, size);
+	if (t1 == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	t2 = popg (gdata, size);
+	if (t2 == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	t3 = popg (gdata, size);
+	if (t3 == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+
+/* For each row x,y: x = x*m11 + y*m21, y = x*m12 + y*m22 */
+
+	for (i = 0; i < 2; i++) {
+		giant	x = *row[i][0];
+		giant	y = *row[i][1];
+		gtog (x, t1);
+		stop_reason = mulgi (gdata, M1->ul, t1);
+		if (stop_reason) goto done;
+		gtog (y, t2);
+		stop_reason = mulgi (gdata, M1->ll, t2);
+		if (stop_reason) goto done;
+		addg (t2, t1);
+		gtog (x, t3);
+		stop_reason = mulgi (gdata, M1->ur, t3);
+		if (stop_reason) goto done;
+		gtog (y, t2);
+		stop_reason = mulgi (gdata, M1->lr, t2);
+		if (stop_reason) goto done;
+		addg (t2, t3);
+		gtog (t1, x);
+		gtog (t3, y);
+	}
+	stop_reason = 0;
+
+done:	pushall (gdata, ss);
+	return (stop_reason);
+}
+
+/* A Lehmer step.  Run single precision reduction steps on the top 64 bits of a and b, then apply them to a, b, and M in */
+/* one pass.  The results are at least 2^(32*s).  Returns TRUE if any progress was made. */
+
+int jac_lehmer (
+	giant	a,
+	giant	b,
+	int	s,		/* Reduction threshold in words */
+	gmatrix	M,		/* Matrix to update or NULL */
+	jacstate *js)
+{
+	uint64_t A, B, q, m11, m12, m21, m22;
+	int	k, progress;
+
+/* Take 64 bits from both operands starting at the same bit.  When the high 64 bits of the larger operand start below */
+/* word s-1, start at word s-1 instead -- the reduced operands are then still at least 2^(32*s). */
+
+	if (isZero (a) || isZero (b)) return (FALSE);
+	k = intmax (bitlen (a), bitlen (b)) - 64;
+	if (k < 32 * (s - 1)) k = 32 * (s - 1);
+	if (k < 0) k = 0;
+	A = jac_bits64 (a, k);
+	B = jac_bits64 (b, k);
+	if (A < JAC_LEHMER_MIN || B < JAC_LEHMER_MIN) return (FALSE);
+
+/* Reduce while both values stay at least 2^33.  This keeps the matrix entries below 2^31 and guarantees the full */
+/* reduced operands are at least 2^(32+k). */
+
+	m11 = m22 = 1;
+	m12 = m21 = 0;
+	for (progress = FALSE; ; progress = TRUE) {
+		if (A >= B) {
+			if (A - B < JAC_LEHMER_MIN) break;
+			q = (A - JAC_LEHMER_MIN) / B;
+			A -= q * B;
+			m12 += q * m11;
+			m22 += q * m21;
+			jac_update (js, 0, (uint32_t) q);
+		} else {
+			if (B - A < JAC_LEHMER_MIN) break;
+			q = (B - JAC_LEHMER_MIN) / A;
+			B -= q * A;
+			m11 += q * m12;
+			m21 += q * m22;
+			jac_update (js, 1, (uint32_t) q);
+		}
+	}
+	if (!progress) return (FALSE);
+
+/* Apply the steps to the full operands and the matrix */
+
+	jac_lincomb_sub (a, b, m11, m12, m21, m22);
+	if (M != NULL) {
+		jac_lincomb_add (M->ul, M->ur, m11, m12, m21, m22);
+		jac_lincomb_add (M->ll, M->lr, m11, m12, m21, m22);
+	}
+	return (TRUE);
+}
+
+/* Reduce the larger of a and b by a multiple of the smaller using a full division.  If s >= 0, the result is at least */
+/* 2^(32*s) and no progress is made if that is not possible.  If s < 0, this is an ordinary Euclidean step. */
+
+int jac_subdiv (
+	ghandle *gdata,		/* Free memory blocks for temporaries */
+	giant	a,
+	giant	b,
+	int	s,		/* Reduction threshold in words, -1 for none */
+	gmatrix	M,		/* Matrix to update or NULL */
+	jacstate *js,
+	int	*progress)	/* Returned TRUE if a step was taken */
+{
+	giant	x, y, q, r;
+	int	which, ss, stop_reason;
+
+	*progress = FALSE;
+	which = (gcompg (a, b) < 0);
+	x = which ? b : a;
+	y = which ? a : b;
+	if (isZero (y)) return (0);
+
+	ss = stackstart (gdata);
+	q = popg (gdata, x->sign + 2);
+	if (q == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	r = popg (gdata, x->sign + 2);
+	if (r == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+
+/* See if there is room to reduce x above the threshold */
+
+	if (s >= 0) {
+		gtog (x, r);
+		subg (y, r);
+		if (r->sign <= s) { stop_reason = 0; goto done; }
+	}
+
+/* Compute the quotient and remainder.  If the remainder is below the threshold, use one less quotient. */
+
+	gtog (x, q);
+	divgi (gdata, y, q);
+	gtog (q, r);
+	stop_reason = mulgi (gdata, y, r);
+	if (stop_reason) goto done;
+	negg (r);
+	addg (x, r);
+	if (s >= 0 && r->sign <= s) {
+		ulsubg (1, q);
+		addg (y, r);
+	}
+	gtog (r, x);
+	jac_update (js, which, isZero (q) ? 0 : q->n[0]);
+
+/* Update the matrix */
+
+	if (M != NULL) {
+		if (which == 0) {
+			stop_reason = jac_addmul (gdata, M->ul, q, M->ur);
+			if (!stop_reason) stop_reason = jac_addmul (gdata, M->ll, q, M->lr);
+		} else {
+			stop_reason = jac_addmul (gdata, M->ur, q, M->ul);
+			if (!stop_reason) stop_reason = jac_addmul (gdata, M->lr, q, M->ll);
+		}
+		if (stop_reason) goto done;
+	}
+	*progress = TRUE;
+
+done:	pushall (gdata, ss);
+	return (stop_reason);
+}
+
+/* One reduction step keeping both operands at least 2^(32*s).  Try a Lehmer step, then fall back to a division. */
+
+int jac_step (
+	ghandle *gdata,		/* Free memory blocks for temporaries */
+	giant	a,
+	giant	b,
+	int	s,		/* Reduction threshold in words */
+	gmatrix	M,		/* Matrix to update or NULL */
+	jacstate *js,
+	int	*progress)	/* Returned TRUE if a step was taken */
+{
+	if (jac_lehmer (a, b, s, M, js)) {
+		*progress = TRUE;
+		return (0);
+	}
+	return (jac_subdiv (gdata, a, b, s, M, js, progress));
+}
+
+int jachgcd (ghandle *, giant, giant, gmatrix, jacstate *, int, int *);
+
+/* Run jachgcd on the words of a and b above word p, then apply the resulting matrix M1 to the full a and b. */
+/* If M is not NULL, it becomes M * M1. */
+
+int jac_reduce (
+	ghandle *gdata,		/* Free memory blocks for temporaries */
+	giant	a,
+	giant	b,
+	int	p,		/* Number of low words to leave out of the half GCD */
+	gmatrix	M,		/* Matrix to update or NULL */
+	jacstate *js,
+	int	interruptable,
+	int	*progress)	/* Returned TRUE if any steps were taken */
+{
+	giantstruct ahi, bhi;
+	gmatrixstruct M1;
+	giant	alo, blo, t1, t2;
+	int	n, ss, stop_reason;
+
+	*progress = FALSE;
+	if (a->sign <= p || b->sign <= p) return (0);
+	ss = stackstart (gdata);
+	n = intmax (a->sign, b->sign) - p;
+
+/* Save the low words of a and b */
+
+	alo = popg (gdata, p);
+	if (alo == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	blo = popg (gdata, p);
+	if (blo == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	memcpy (alo->n, a->n, p * sizeof (uint32_t));
+	for (alo->sign = p; alo->sign > 0 && alo->n[alo->sign-1] == 0; alo->sign--);
+	memcpy (blo->n, b->n, p * sizeof (uint32_t));
+	for (blo->sign = p; blo->sign > 0 && blo->n[blo->sign-1] == 0; blo->sign--);
+
+/* Emulate a shift right of p words */
+
+	ahi.n = a->n + p;
+	ahi.sign = a->sign - p;
+	setmaxsize (&ahi, a->maxsize - p);
+	bhi.n = b->n + p;
+	bhi.sign = b->sign - p;
+	setmaxsize (&bhi, b->maxsize - p);
+
+/* Compute the half GCD of the high words */
+
+	M1.ul = popg (gdata, n + 2);
+	if (M1.ul == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	M1.ur = popg (gdata, n + 2);
+	if (M1.ur == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	M1.ll = popg (gdata, n + 2);
+	if (M1.ll == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	M1.lr = popg (gdata, n + 2);
+	if (M1.lr == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	stop_reason = jachgcd (gdata, &ahi, &bhi, &M1, js, interruptable, progress);
+	if (stop_reason || !*progress) goto done;
+
+/* a = ahi * 2^(32*p) + m22 * alo - m12 * blo, b = bhi * 2^(32*p) + m11 * blo - m21 * alo */
+
+	t1 = popg (gdata, p + n + 3);
+	if (t1 == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	t2 = popg (gdata, p + n + 3);
+	if (t2 == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+
+	gtog (alo, t1);
+	stop_reason = mulgi (gdata, M1.lr, t1);
+	if (stop_reason) goto done;
+	gtog (blo, t2);
+	stop_reason = mulgi (gdata, M1.ur, t2);
+	if (stop_reason) goto done;
+	subg (t2, t1);
+	memset (a->n, 0, p * sizeof (uint32_t));
+	a->sign = ahi.sign + p;
+	addg (t1, a);
+
+	gtog (blo, t1);
+	stop_reason = mulgi (gdata, M1.ul, t1);
+	if (stop_reason) goto done;
+	gtog (alo, t2);
+	stop_reason = mulgi (gdata, M1.ll, t2);
+	if (stop_reason) goto done;
+	subg (t2, t1);
+	memset (b->n, 0, p * sizeof (uint32_t));
+	b->sign = bhi.sign + p;
+	addg (t1, b);
+	ASSERTG (a->sign > 0 && b->sign > 0);
+
+/* Accumulate the matrix */
+
+	if (M != NULL) stop_reason = jac_matmul (gdata, M, &M1);
+
+done:	pushall (gdata, ss);
+	return (stop_reason);
+}
+
+/* Half GCD with Jacobi tracking.  Reduces a and b (of n words) as far as possible while keeping both at least 2^(32*s) */
+/* where s = n/2+1.  Sets M such that the original [a b] = M [a b].  The structure follows GMP's mpn_hgcd. */
+
+int jachgcd (
+	ghandle *gdata,		/* Free memory blocks for temporaries */
+	giant	a,
+	giant	b,
+	gmatrix	M,		/* Returned matrix */
+	jacstate *js,
+	int	interruptable,
+	int	*progress)	/* Returned TRUE if any steps were taken */
+{
+	int	n, s, did, stop_reason;
+
+	*progress = FALSE;
+	setone (M->ul); setzero (M->ur);
+	setzero (M->ll); setone (M->lr);
+	n = intmax (a->sign, b->sign);
+	s = n / 2 + 1;
+	if (a->sign <= s || b->sign <= s) return (0);
+
+/* For large numbers, recursively reduce the top half, then reduce what remains to half its size */
+
+	if (n > JACHGCD_BREAK) {
+		if (interruptable && StopCheckRoutine != NULL) {
+			stop_reason = stopCheck (interruptable);
+			if (stop_reason) return (stop_reason);
+		}
+
+		stop_reason = jac_reduce (gdata, a, b, n / 2, M, js, interruptable, &did);
+		if (stop_reason) return (stop_reason);
+		if (did) *progress = TRUE;
+
+		while (intmax (a->sign, b->sign) > (3 * n) / 4 + 1) {
+			stop_reason = jac_step (gdata, a, b, s, M, js, &did);
+			if (stop_reason) return (stop_reason);
+			if (!did) return (0);
+			*progress = TRUE;
+		}
+
+		n = intmax (a->sign, b->sign);
+		if (n > s + 2) {
+			stop_reason = jac_reduce (gdata, a, b, 2 * s - n + 1, M, js, interruptable, &did);
+			if (stop_reason) return (stop_reason);
+			if (did) *progress = TRUE;
+		}
+	}
+
+/* Finish with single steps */
+
+	for ( ; ; ) {
+		stop_reason = jac_step (gdata, a, b, s, M, js, &did);
+		if (stop_reason) return (stop_reason);
+		if (!did) return (0);
+		*progress = TRUE;
+	}
+}
+
+/* Finish a Jacobi symbol computation when both operands fit in 64 bits */
+
+void jac_small (
+	giant	a,
+	giant	b,
+	jacstate *js)
+{
+	uint64_t A, B, q;
+
+	A = jac_bits64 (a, 0);
+	B = jac_bits64 (b, 0);
+	while (A && B) {
+		if (A >= B) {
+			q = A / B;
+			A -= q * B;
+			jac_update (js, 0, (uint32_t) q);
+		} else {
+			q = B / A;
+			B -= q * A;
+			jac_update (js, 1, (uint32_t) q);
+		}
+	}
+	ulltog (A, a);
+	ulltog (B, b);
+}
+
+int jacobig (		/* Returns the Jacobi symbol (a|b).  b must be odd and positive, a non-negative. */
+			/* Neither argument is destroyed. */
+	giant	a,
+	giant	b)
+{
+	ghandle gdata;
+	int	symbol;
+
+	init_ghandle (&gdata);
+	if (jacobig_common (&gdata, a, b, &symbol, 0)) symbol = 0;
+	term_ghandle (&gdata);
+	return (symbol);
+}
+
+int jacobigi (		/* Interruptable version of the above */
+	ghandle *gdata,	/* Free memory blocks for temporaries */
+	int	thread_num,
+	giant	a,
+	giant	b,
+	int	*symbol)
+{
+	return (jacobig_common (gdata, a, b, symbol, 0x80000000 + thread_num));
+}
+
+int jacobig_common (	/* Common code for above */
+	ghandle *gdata,	/* Free memory blocks for temporaries */
+	giant	aa,
+	giant	bb,
+	int	*symbol,
+	int	interruptable)
+{
+	giant	a, b;
+	jacstate js;
+	int	n, ss, did, stop_reason;
+
+	ASSERTG (aa->sign >= 0);
+	ASSERTG (bb->sign > 0 && (bb->n[0] & 1));
+
+/* Copy the arguments, reduce a mod b */
+
+	ss = stackstart (gdata);
+	n = intmax (aa->sign, bb->sign) + 2;
+	a = popg (gdata, n);
+	if (a == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	b = popg (gdata, n);
+	if (b == NULL) { stop_reason = GIANT_OUT_OF_MEMORY; goto done; }
+	gtog (aa, a);
+	gtog (bb, b);
+	modgi (gdata, b, a);
+
+/* To avoid continually expanding the sincos array, allocate the largest table we will need now */
+
+	if (b->sign > FFT_BREAK_MULT1) {
+		stop_reason = init_sincos (gdata, lpt (b->sign) << 1);
+		if (stop_reason) goto done;
+	}
+
+/* Symbol is (a|b) */
+
+	js.sign = 1;
+	js.den = 1;
+	js.a8 = isZero (a) ? 0 : a->n[0] & 7;
+	js.b8 = b->n[0] & 7;
+
+/* Use half GCDs on the top third of the operands until they get pretty small, then use Lehmer steps and divisions */
+
+	while (!isZero (a) && !isZero (b)) {
+		n = intmax (a->sign, b->sign);
+		if (n > JACGCD_BREAK) {
+			if (interruptable && StopCheckRoutine != NULL) {
+				stop_reason = stopCheck (interruptable);
+				if (stop_reason) goto done;
+			}
+			stop_reason = jac_reduce (gdata, a, b, (2 * n) / 3, NULL, &js, interruptable, &did);
+			if (stop_reason) goto done;
+			if (did) continue;
+		}
+		if (n <= 2) {
+			jac_small (a, b, &js);
+			break;
+		}
+		if (jac_lehmer (a, b, 0, NULL, &js)) continue;
+		stop_reason = jac_subdiv (gdata, a, b, -1, NULL, &js, &did);
+		if (stop_reason) goto done;
+	}
+
+/* The remaining operand is the GCD.  The symbol is zero unless it is one. */
+
+	if (isZero (a)) *symbol = isone (b) ? js.sign : 0;
+	else *symbol = isone (a) ? js.sign : 0;
+	stop_reason = 0;
+
+done:	pushall (gdata, ss);
+	return (stop_reason);
+}
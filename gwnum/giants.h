@@ -199,6 +199,9 @@ int 	invg(giant n, giant x);
 /* General GCD, x:= GCD(n, x). */
 int 	gcdg(giant n, giant x);
 
+/* Jacobi symbol (a|b) for odd positive b and non-negative a.  Uses a subquadratic half GCD. */
+int 	jacobig(giant a, giant b);
+
 /* x becomes x^n, NO mod performed. */
 void power (giant x, int n);
 void powerg (giant x, giant n);
@@ -252,6 +255,7 @@ void 	modgi(ghandle *, giant den, giant num);
 void 	divgi(ghandle *, giant den, giant num);
 int 	invgi(ghandle *, int, giant n, giant x);
 int 	gcdgi(ghandle *, int, giant n, giant x);
+int 	jacobigi(ghandle *, int, giant a, giant b, int *symbol);
 
 
 /* Low-level math routines the caller can use for multi-precision */
@@ -16,6 +16,7 @@
 #ifdef _WIN32
 #include <io.h>
 #include <malloc.h>
+#include "windows.h"
 #else
 #include <unistd.h>
 #include <strings.h>
@@ -85,12 +86,42 @@ struct IniCache {
 	unsigned int num_lines;
 	unsigned int array_size;
 	struct IniLine **lines;
+	gwatomic snapshot;		/* Pointer to the current struct IniSnapshot */
+};
+
+/* Lookups do not read the IniCache lines.  Instead, whenever an INI file is read or changed we build an immutable hash table */
+/* of its keyword=value lines and publish it with a release store.  Readers find the snapshot with an acquire load and never */
+/* take INI_MUTEX, so workers reading options in their inner loops do not contend.  A replaced snapshot is freed once it has */
+/* been retired for INI_SNAPSHOT_GRACE seconds, long after any reader could still be looking at it.  The grace period is */
+/* measured with a monotonic clock so that setting the system clock back cannot free a snapshot early. */
+
+#define INI_SNAPSHOT_GRACE	60
+
+struct IniSnapEntry {
+	const char *section;		/* Section name, NULL for the global section */
+	const char *keyword;
+	const char *value;
+	unsigned int hash;		/* Hash of the section and keyword */
+	int	nth;			/* Occurrence of this keyword within the section (starts at 1) */
+	int	timed;			/* TRUE if value has a "during" clause.  Typed values must then be parsed at lookup time. */
+	long	int_val;		/* Value parsed as a long */
+	int64_t	int64_val;		/* Value parsed as an int64_t */
+	float	float_val;		/* Value parsed as a float */
+};
+
+struct IniSnapshot {
+	unsigned int mask;		/* Hash table size minus one */
+	struct IniSnapEntry **table;	/* Open addressing hash table of entries */
+	int64_t	retired;		/* Monotonic time this snapshot was replaced */
+	struct IniSnapshot *next;	/* Next snapshot in the retired list */
 };
 
 /* Global variables */
 
 gwmutex	INI_MUTEX = NULL;		/* Lock for accessing INI files */
 gwmutex	INI_ADD_MUTEX = NULL;		/* Lock for accessing INI add-in files */
+gwatomic INI_CACHE[10] = {0};		/* Pointers to each cached struct IniCache.  Entries are never removed. */
+struct IniSnapshot *INI_RETIRED_SNAPSHOTS = NULL; /* Replaced snapshots waiting to be freed */
 void (*INI_ERROR_CALLBACK)(const char *, int, const char *);	/* Callback routine when illegal line read from INI file. */
 								/* Arguments are file name, line number, text on the line */
 
@@ -99,6 +130,9 @@ void (*INI_ERROR_CALLBACK)(const char *, int, const char *);	/* Callback routine
 struct IniCache *openIniFile (const char *, int);
 void growIniLineArray (struct IniCache *);
 void parse_timed_ini_value (const char *, unsigned int *, unsigned int *, unsigned int *);
+void iniPublishSnapshot (struct IniCache *);
+int64_t iniMonotonicTime (void);
+const struct IniSnapEntry *iniSnapshotLookup (const char *, const char *, const char *, int);
 
 
 /****************************************************************************/
@@ -160,8 +194,11 @@ void IniDelayWrites (
 	const char *filename)
 {
 	struct IniCache *p;
+	if (INI_MUTEX == NULL) gwmutex_init (&INI_MUTEX);
+	gwmutex_lock (&INI_MUTEX);
 	p = openIniFile (filename, 0);
 	p->immediate_writes = FALSE;
+	gwmutex_unlock (&INI_MUTEX);
 }
 
 /* Resume immediately writing changes to the INI file */
@@ -170,9 +207,12 @@ void IniResumeImmediateWrites (
 	const char *filename)
 {
 	struct IniCache *p;
+	if (INI_MUTEX == NULL) gwmutex_init (&INI_MUTEX);
+	gwmutex_lock (&INI_MUTEX);
 	p = openIniFile (filename, 0);
 	p->immediate_writes = TRUE;
 	if (p->dirty) writeIniFile (p);
+	gwmutex_unlock (&INI_MUTEX);
 }
 
 /* Merge one "add file" into an ini file.  Assumes the ini file has been */
@@ -196,12 +236,15 @@ void IniAddFileMerge (
 
 /* Open ini files */
 
+	if (INI_MUTEX == NULL) gwmutex_init (&INI_MUTEX);
+	gwmutex_lock (&INI_MUTEX);
 	p = openIniFile (ini_filename, 0);
 	q = openIniFile (add_filename, 1);
 
 /* Save up all the writes */
 
 	p->immediate_writes = FALSE;
+	gwmutex_unlock (&INI_MUTEX);
 
 /* Loop through all the lines in the add file, adding them to the */
 /* base ini file */
@@ -218,8 +261,10 @@ void IniAddFileMerge (
 
 /* Output all the saved up writes */
 
+	gwmutex_lock (&INI_MUTEX);
 	p->immediate_writes = TRUE;
 	writeIniFile (p);
+	gwmutex_unlock (&INI_MUTEX);
 
 /* Delete the add file */
 
@@ -312,24 +357,30 @@ void IniSectionGetNthTimedString (	/* Get keyword's Nth time-sensitive string va
 	const char *default_val,
 	unsigned int *seconds)		/* Return length of time this timed INI setting is good for. */
 {
-	const char *p;
+	const struct IniSnapEntry *e;
 	unsigned int start, len;
 
 /* Lookup the keyword */
 
-	p = IniSectionGetNthStringRaw (filename, section, keyword, nth);
+	e = iniSnapshotLookup (filename, section, keyword, nth);
 
 /* If we found the keyword in the INI file, then */
 /* support different return values based on the time of day. */
 
-	if (p != NULL) {
-		parse_timed_ini_value (p, &start, &len, seconds);
-		if (len) {
-			truncated_strcpy_with_len (val, val_bufsize, p+start, len);
+	if (e == NULL) {
+		*seconds = 0;
+	} else if (!e->timed) {
+		*seconds = 0;
+		if (e->value[0]) {
+			truncated_strcpy (val, val_bufsize, e->value);
 			return;
 		}
 	} else {
-		*seconds = 0;
+		parse_timed_ini_value (e->value, &start, &len, seconds);
+		if (len) {
+			truncated_strcpy_with_len (val, val_bufsize, e->value+start, len);
+			return;
+		}
 	}
 
 /* Copy the default value to the caller's buffer */
@@ -354,49 +405,13 @@ const char *IniSectionGetNthStringRaw (	/* Return keyword's Nth raw string value
 	const char *keyword,
 	int	nth)			/* Nth occurrence of the keyword (nth starts at 1) */
 {
-	struct IniCache *p;
-	unsigned int i;
-	const char *retval;
+	const struct IniSnapEntry *e;
 
-/* Open ini file */
-
-	if (INI_MUTEX == NULL) gwmutex_init (&INI_MUTEX);
-	gwmutex_lock (&INI_MUTEX);
-	p = openIniFile (filename, 0);
-
-/* Skip to the correct section */
+/* The returned string lives in an INI snapshot.  It remains valid for at least INI_SNAPSHOT_GRACE seconds after */
+/* the INI file changes. */
 
-	i = 0;
-	if (section != NULL) {
-		for ( ; i < p->num_lines; i++) {
-			if (p->lines[i]->line_type == INI_LINE_HEADER &&
-			    _stricmp (section, p->lines[i]->keyword) == 0) {
-				i++;
-				break;
-			}
-		}
-	}
-
-/* Look for the keyword within this section */
-
-	for ( ; ; i++) {
-		if (i == p->num_lines ||
-		    p->lines[i]->line_type == INI_LINE_HEADER) {
-			retval = NULL;
-			break;
-		}
-		if (p->lines[i]->line_type == INI_LINE_NORMAL &&
-		    _stricmp (keyword, p->lines[i]->keyword) == 0 &&
-		    --nth == 0) {
-			retval = p->lines[i]->value;
-			break;
-		}
-	}
-
-/* Unlock and return */
-
-	gwmutex_unlock (&INI_MUTEX);
-	return (retval);
+	e = iniSnapshotLookup (filename, section, keyword, nth);
+	return (e == NULL ? NULL : e->value);
 }
 
 void IniWriteString (			/* Write a string value to the global section of the INI file. */
@@ -561,9 +576,10 @@ void IniSectionWriteNthString (		/* Write keyword's Nth string value to a specif
 		strcpy (p->lines[i]->value, val);
 	}
 
-/* Write the INI file back to disk */
+/* Publish the changed INI file to readers and write it back to disk */
 
 write_done:
+	iniPublishSnapshot (p);
 	writeIniFile (p);
 
 /* Unlock and return */
@@ -610,7 +626,19 @@ long IniSectionGetTimedInt (		/* Get a time-sensitive integer value from specifi
 	long	default_val,
 	unsigned int *seconds)		/* Return length of time this timed INI setting is good for. */
 {
+	const struct IniSnapEntry *e;
 	char	buf[20], defval[20];
+
+/* Unless the value depends on the time of day, return the value parsed when the snapshot was built */
+
+	e = iniSnapshotLookup (filename, section, keyword, 1);
+	if (e == NULL || !e->timed) {
+		*seconds = 0;
+		return (e != NULL && e->value[0] ? e->int_val : default_val);
+	}
+
+/* Parse the timed value */
+
 	sprintf (defval, "%ld", default_val);
 	IniSectionGetTimedString (filename, section, keyword, buf, 20, defval, seconds);
 	return (atol (buf));
@@ -669,7 +697,19 @@ int64_t IniSectionGetTimedInt64 (	/* Get a time-sensitive integer value from spe
 	int64_t	default_val,
 	unsigned int *seconds)		/* Return length of time this timed INI setting is good for. */
 {
+	const struct IniSnapEntry *e;
 	char	buf[30], defval[30];
+
+/* Unless the value depends on the time of day, return the value parsed when the snapshot was built */
+
+	e = iniSnapshotLookup (filename, section, keyword, 1);
+	if (e == NULL || !e->timed) {
+		*seconds = 0;
+		return (e != NULL && e->value[0] ? e->int64_val : default_val);
+	}
+
+/* Parse the timed value */
+
 	sprintf (defval, "%" PRIi64, default_val);
 	IniSectionGetTimedString (filename, section, keyword, buf, 30, defval, seconds);
 	return (atoll (buf));
@@ -732,7 +772,19 @@ float IniSectionGetTimedFloat (		/* Get a time-sensitive floating point value fr
 	float	default_val,
 	unsigned int *seconds)		/* Return length of time this timed INI setting is good for. */
 {
+	const struct IniSnapEntry *e;
 	char	buf[20], defval[20];
+
+/* Unless the value depends on the time of day, return the value parsed when the snapshot was built */
+
+	e = iniSnapshotLookup (filename, section, keyword, 1);
+	if (e == NULL || !e->timed) {
+		*seconds = 0;
+		return (e != NULL && e->value[0] ? e->float_val : default_val);
+	}
+
+/* Parse the timed value */
+
 	sprintf (defval, "%f", default_val);
 	IniSectionGetTimedString (filename, section, keyword, buf, 20, defval, seconds);
 	return ((float) atof (buf));
@@ -769,7 +821,6 @@ struct IniCache *openIniFile (
 	const char *filename,
 	int	forced_read)
 {
-static	struct IniCache *cache[10] = {0};
 	struct IniCache *p;
 	FILE	*fd;
 	unsigned int i;
@@ -779,7 +830,7 @@ static	struct IniCache *cache[10] = {0};
 /* See if file is cached */
 
 	for (i = 0; i < 10; i++) {
-		p = cache[i];
+		p = (struct IniCache *) (intptr_t) atomic_get_acquire (INI_CACHE[i]);
 		if (p == NULL) {
 			p = (struct IniCache *) malloc (sizeof (struct IniCache));
 			p->filename = (char *) malloc (strlen (filename) + 1);
@@ -789,8 +840,9 @@ static	struct IniCache *cache[10] = {0};
 			p->num_lines = 0;
 			p->array_size = 0;
 			p->lines = NULL;
+			p->snapshot = 0;
 			forced_read = 1;
-			cache[i] = p;
+			atomic_set_release (INI_CACHE[i], (intptr_t) p);
 			break;
 		}
 		if (strcmp (filename, p->filename) == 0)
@@ -814,7 +866,10 @@ static	struct IniCache *cache[10] = {0};
 /* Read the IniFile */
 
 	fd = fopen (filename, "r");
-	if (fd == NULL) return (p);
+	if (fd == NULL) {
+		iniPublishSnapshot (p);
+		return (p);
+	}
 
 	while (fgets (line, sizeof (line), fd)) {
 		if (line[strlen(line)-1] == '\n') line[strlen(line)-1] = 0;
@@ -877,6 +932,9 @@ static	struct IniCache *cache[10] = {0};
 	}
 	fclose (fd);
 
+/* Make the new contents visible to lock-free readers */
+
+	iniPublishSnapshot (p);
 	return (p);
 }
 
@@ -896,6 +954,204 @@ void growIniLineArray (
 	p->array_size = p->num_lines + 100;
 }
 
+/* Routines to build and search INI file snapshots */
+
+unsigned int iniHash (			/* Case-insensitive FNV-1a hash of a section and keyword */
+	const char *section,
+	const char *keyword)
+{
+	unsigned int h = 2166136261U;
+
+	if (section != NULL) {
+		for ( ; *section; section++) h = (h ^ (unsigned int) tolower ((unsigned char) *section)) * 16777619U;
+		h = (h ^ '[') * 16777619U;
+	}
+	for ( ; *keyword; keyword++) h = (h ^ (unsigned int) tolower ((unsigned char) *keyword)) * 16777619U;
+	return (h);
+}
+
+int iniSameSection (
+	const char *a,
+	const char *b)
+{
+	if (a == NULL || b == NULL) return (a == b);
+	return (_stricmp (a, b) == 0);
+}
+
+/* Build a snapshot of an INI file's lines and publish it.  Caller must hold INI_MUTEX.  Only the first section with a */
+/* given name is searched by lookups, so keywords in later sections with the same name are left out of the snapshot. */
+
+void iniPublishSnapshot (
+	struct IniCache *p)
+{
+	struct IniSnapshot *s, *old, **prev;
+	struct IniSnapEntry *entries, *e;
+	const char *section;
+	char	*strings;
+	unsigned int i, j, k, num_entries, size;
+	size_t	string_bytes;
+	int	section_is_live;
+	int64_t	now;
+	char	buf[30];
+
+/* Count the lines and string bytes that will go in the snapshot */
+
+	num_entries = 0;
+	string_bytes = 0;
+	section_is_live = TRUE;
+	for (i = 0; i < p->num_lines; i++) {
+		if (p->lines[i]->line_type == INI_LINE_HEADER) {
+			for (j = 0; j < i; j++)
+				if (p->lines[j]->line_type == INI_LINE_HEADER && _stricmp (p->lines[i]->keyword, p->lines[j]->keyword) == 0) break;
+			section_is_live = (j == i);
+			if (section_is_live) string_bytes += strlen (p->lines[i]->keyword) + 1;
+		} else if (p->lines[i]->line_type == INI_LINE_NORMAL && section_is_live) {
+			num_entries++;
+			string_bytes += strlen (p->lines[i]->keyword) + strlen (p->lines[i]->value) + 2;
+		}
+	}
+	for (size = 16; size < 2 * num_entries; size <<= 1);
+
+/* Allocate the snapshot, its entries, hash table, and strings in one block */
+
+	s = (struct IniSnapshot *) malloc (sizeof (struct IniSnapshot) + num_entries * sizeof (struct IniSnapEntry) +
+					   size * sizeof (struct IniSnapEntry *) + string_bytes);
+	if (s != NULL) {
+		entries = (struct IniSnapEntry *) (s + 1);
+		s->table = (struct IniSnapEntry **) (entries + num_entries);
+		strings = (char *) (s->table + size);
+		s->mask = size - 1;
+		memset (s->table, 0, size * sizeof (struct IniSnapEntry *));
+
+/* Copy the live keyword=value lines into the hash table.  Duplicate keywords are numbered in the order they appear. */
+
+		e = entries;
+		section = NULL;
+		section_is_live = TRUE;
+		for (i = 0; i < p->num_lines; i++) {
+			if (p->lines[i]->line_type == INI_LINE_HEADER) {
+				for (j = 0; j < i; j++)
+					if (p->lines[j]->line_type == INI_LINE_HEADER && _stricmp (p->lines[i]->keyword, p->lines[j]->keyword) == 0) break;
+				section_is_live = (j == i);
+				if (section_is_live) {
+					strcpy (strings, p->lines[i]->keyword);
+					section = strings;
+					strings += strlen (strings) + 1;
+				}
+				continue;
+			}
+			if (p->lines[i]->line_type != INI_LINE_NORMAL || !section_is_live) continue;
+			e->section = section;
+			strcpy (strings, p->lines[i]->keyword);
+			e->keyword = strings;
+			strings += strlen (strings) + 1;
+			strcpy (strings, p->lines[i]->value);
+			e->value = strings;
+			strings += strlen (strings) + 1;
+			e->hash = iniHash (section, e->keyword);
+			e->nth = 1;
+			for (k = e->hash & s->mask; s->table[k] != NULL; k = (k + 1) & s->mask)
+				if (s->table[k]->hash == e->hash && iniSameSection (s->table[k]->section, section) &&
+				    _stricmp (s->table[k]->keyword, e->keyword) == 0) e->nth++;
+			s->table[k] = e;
+
+/* Parse typed values the same way the typed get routines do */
+
+			e->timed = (strstr (e->value, " during ") != NULL);
+			truncated_strcpy (buf, 20, e->value);
+			e->int_val = atol (buf);
+			e->float_val = (float) atof (buf);
+			truncated_strcpy (buf, 30, e->value);
+			e->int64_val = atoll (buf);
+			e++;
+		}
+	}
+
+/* Publish the new snapshot.  If we ran out of memory, publish NULL so that the next lookup tries again. */
+
+	old = (struct IniSnapshot *) (intptr_t) atomic_get (p->snapshot);
+	atomic_set_release (p->snapshot, (intptr_t) s);
+
+/* Retire the old snapshot and free any that have been retired long enough */
+
+	now = iniMonotonicTime ();
+	if (old != NULL) {
+		old->retired = now;
+		old->next = INI_RETIRED_SNAPSHOTS;
+		INI_RETIRED_SNAPSHOTS = old;
+	}
+	for (prev = &INI_RETIRED_SNAPSHOTS; *prev != NULL; ) {
+		old = *prev;
+		if (now < old->retired) old->retired = now;	/* Should the clock ever go backwards, restart the grace period */
+		if (now - old->retired >= INI_SNAPSHOT_GRACE) {
+			*prev = old->next;
+			free (old);
+		} else
+			prev = &old->next;
+	}
+}
+
+/* Return the time in seconds from a clock that is not affected by changes to the system time */
+
+int64_t iniMonotonicTime (void)
+{
+#if defined (_WIN32)
+	return ((int64_t) (GetTickCount64 () / 1000));
+#elif defined (CLOCK_MONOTONIC)
+	struct timespec ts;
+	if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0) return ((int64_t) ts.tv_sec);
+	return ((int64_t) time (NULL));
+#else
+	return ((int64_t) time (NULL));
+#endif
+}
+
+/* Find the Nth occurrence of a keyword in a section of an INI file.  The common case takes no locks. */
+
+const struct IniSnapEntry *iniSnapshotLookup (
+	const char *filename,
+	const char *section,
+	const char *keyword,
+	int	nth)
+{
+	struct IniCache *p;
+	struct IniSnapshot *s;
+	struct IniSnapEntry *e;
+	unsigned int i, h;
+
+/* Find the INI file's current snapshot.  Cached INI files are never removed and their filename never changes. */
+
+	s = NULL;
+	for (i = 0; i < 10; i++) {
+		p = (struct IniCache *) (intptr_t) atomic_get_acquire (INI_CACHE[i]);
+		if (p == NULL) break;
+		if (strcmp (filename, p->filename) == 0) {
+			s = (struct IniSnapshot *) (intptr_t) atomic_get_acquire (p->snapshot);
+			break;
+		}
+	}
+
+/* If this is the first access to the INI file (or building the last snapshot failed), then read it while holding the lock */
+
+	if (s == NULL) {
+		if (INI_MUTEX == NULL) gwmutex_init (&INI_MUTEX);
+		gwmutex_lock (&INI_MUTEX);
+		p = openIniFile (filename, 0);
+		if (atomic_get (p->snapshot) == 0) iniPublishSnapshot (p);
+		s = (struct IniSnapshot *) (intptr_t) atomic_get (p->snapshot);
+		gwmutex_unlock (&INI_MUTEX);
+		if (s == NULL) return (NULL);
+	}
+
+/* Search the hash table */
+
+	h = iniHash (section, keyword);
+	for (i = h & s->mask; (e = s->table[i]) != NULL; i = (i + 1) & s->mask)
+		if (e->hash == h && e->nth == nth && iniSameSection (e->section, section) && _stricmp (e->keyword, keyword) == 0)
+			return (e);
+	return (NULL);
+}
+
 /* Routines to help analyze a timed line in an INI file */
 
 void parseTimeLine (
@@ -77,6 +77,8 @@ extern void (*INI_ERROR_CALLBACK)(const char *, int, const char *);	/* Callback
 void IniFileReread (const char *);					/* Force the INI file to be re-read from disk */
 void IniAddFileMerge (const char *, const char *, const char *);	/* Merge one INI file into another.  Prime95 calls these .add files */
 
+/* Raw lookups return a pointer into a read-only snapshot of the INI file.  It stays valid for at least a minute after the INI file changes. */
+
 const char *IniSectionGetStringRaw (const char *, const char *, const char *);
 const char *IniSectionGetNthStringRaw (const char *, const char *, const char *, int);
 
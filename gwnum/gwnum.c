@@ -418,6 +418,28 @@ inline int is_valid_double (double x) {
 #define GWFREE_LARGE_PAGES	0x20000000	/* Flag set if gwnum was allocated using large pages */
 #define GWFREEALLOC_INDEX	0x1FFFFFFF	/* Remainder of the freeable field -- index into the gwnum_alloc array */
 
+/* Apply the NUMA memory placement policy to a newly allocated block of memory.  Clones use their parent's policy and callback data. */
+/* Only the whole pages inside the block are bound.  Binding a partial page would also rebind the neighboring heap memory on that page. */
+/* Small blocks are left to the OS's first touch policy, they are not worth the cost of the callback. */
+
+#define GWNUMA_MIN_BIND_SIZE	(1 << 20)
+
+static void gwnuma_bind (
+	gwhandle *gwdata,	/* Handle initialized by gwsetup */
+	void	*addr,		/* Address of newly allocated memory */
+	size_t	size)		/* Size of newly allocated memory */
+{
+	char	*start, *end;
+
+	if (gwdata->clone_of != NULL) gwdata = gwdata->clone_of;
+	if (gwdata->numa_policy == GWNUMA_NONE || gwdata->numa_callback == NULL) return;
+	start = (char *) round_up_to_multiple_of ((intptr_t) addr, 4096);
+	end = (char *) round_down_to_multiple_of ((intptr_t) addr + (intptr_t) size, 4096);
+	if (end - start < GWNUMA_MIN_BIND_SIZE) return;
+	int node = (*gwdata->numa_callback) (start, end - start, gwdata->thread_callback_data);
+	if (node >= 0) gwdata->numa_node = node;
+}
+
 /* Forward declarations */
 
 int convert_giant_to_k2ncd (
@@ -435,7 +457,10 @@ int internal_gwsetup (
 void raw_gwsetaddin (gwhandle *gwdata, unsigned long word, double *ptr, double val);
 int multithread_init (gwhandle *gwdata);
 void multithread_term (gwhandle *gwdata);
+void gwarena_done (gwhandle *gwdata);
 void do_multithread_op_work (gwhandle *gwdata, struct gwasm_data *asm_data);
+void do_multithread_conv_work (gwhandle *gwdata);
+void do_multithread_touch_work (gwhandle *gwdata, int thread_num);
 void pass1_aux_entry_point (void*);
 void pass2_aux_entry_point (void*);
 void gw_fixed_random_number (gwhandle *gwdata, gwnum x);
@@ -1955,22 +1980,56 @@ next3:		prev_proc_ptrs[4] = prev_proc_ptrs[3];
 	return (0);
 }
 
-/* Code to manage sharing sin/cos data where possible amongst several gwnum callers */
+/* Code to manage sharing sin/cos data where possible amongst several gwnum callers.  Several workers running the same FFT on the */
+/* same k,b,n,c (e.g. first-time PRP tests in the same exponent range) can also share their read-only weights and premultipliers. */
+/* Carries and scratch areas are written during every FFT and are never shared. */
 
 #define FIXED_PASS1_SINCOS_DATA			1
 #define PASS2_REAL_SINCOS_DATA			2
 #define PASS2_COMPLEX_SINCOS_DATA		3
+#define PASS1_PREMULT_DATA			4	/* Pass 1 variable data: premultipliers, weights, and (AVX-512) big/lit flags */
+#define NORM_GRP_MULTS_DATA			5	/* Group weights and inverse weights */
+#define NORM_COL_MULTS_DATA			6	/* Column weights and inverse weights */
 
 struct shareable_sincos_data {
 	struct shareable_sincos_data *next;	/* Next in linked list of shareable data blocks */
 	double	*data;				/* Shareable data */
 	size_t	data_size;			/* Size of the shareable data */
+	uint64_t key;				/* Hash of FFT implementation and k,b,n,c for weight tables, zero for sin/cos tables */
 	int	use_count;			/* Count of times data is shared */
 };
 struct shareable_sincos_data *shareable_data = NULL;  /* Linked list of shareable data blocks */
 gwmutex	shareable_lock;				/* This mutex limits one caller into sharing routines */
 int	shareable_lock_initialized = FALSE;	/* Whether shareable mutex is initialized */
 
+/* Generate the registry key for a table.  Sin/cos tables depend only on the FFT sizes, so they are matched on contents alone (a pass 2 */
+/* table can be shared by several FFT lengths).  Weight tables also depend on k,b,n,c and the exact FFT implementation selected. */
+
+static uint64_t shareable_table_key (
+	gwhandle *gwdata,	/* Handle of the gwnum caller */
+	int	table_type)	/* Type of the table defined above */
+{
+	uint64_t key;
+
+	if (table_type < PASS1_PREMULT_DATA) return (0);
+#define KEYMIX(v)	key = (key ^ (uint64_t) (v)) * 0x100000001B3ULL
+	key = 0xCBF29CE484222325ULL;
+	KEYMIX (table_type);
+	KEYMIX (gwdata->k);
+	KEYMIX (gwdata->b);
+	KEYMIX (gwdata->n);
+	KEYMIX (gwdata->c);
+	KEYMIX (gwdata->FFTLEN);
+	KEYMIX (gwdata->PASS1_SIZE);
+	KEYMIX (gwdata->PASS2_SIZE);
+	KEYMIX (gwdata->FFT_TYPE);
+	KEYMIX ((intptr_t) gwdata->jmptab);
+	KEYMIX (gwdata->cpu_flags);
+	KEYMIX ((gwdata->ZERO_PADDED_FFT << 3) + (gwdata->NEGACYCLIC_FFT << 2) + (gwdata->RATIONAL_FFT << 1) + gwdata->GENERAL_MOD);
+#undef KEYMIX
+	return (key | 1);
+}
+
 /* Share sin/cos data where possible amongst several gwnum callers */
 
 double *share_sincos_data (
@@ -1981,10 +2040,12 @@ double *share_sincos_data (
 {
 #ifdef SHARE_SINCOS_DATA
 	struct shareable_sincos_data *p;	/* Ptr to a shareable data block */
+	uint64_t key;				/* Registry key for this table */
 
 /* No need to share zero-sized tables */
 
 	if (table_size == 0) return (table);
+	key = shareable_table_key (gwdata, table_type);
 
 /* Initialize the mutex if necessary, then grab the lock */
 
@@ -1997,7 +2058,7 @@ double *share_sincos_data (
 /* Look through the list of shareable blocks looking for a match.  If we find a match, use it! */
 
 	for (p = shareable_data; p != NULL; p = p->next) {
-		if (p->data_size == table_size && !memcmp (p->data, table, table_size)) {
+		if (p->key == key && p->data_size == table_size && !memcmp (p->data, table, table_size)) {
 			p->use_count++;
 			gwmutex_unlock (&shareable_lock);
 			return (p->data);
@@ -2011,7 +2072,7 @@ double *share_sincos_data (
 		gwmutex_unlock (&shareable_lock);
 		return (table);
 	}
-	p->data = (double *) aligned_malloc (table_size, 4096);
+	p->data = (double *) aligned_malloc (table_size + 128, 4096);	/* Pad in case the FFT code prefetches past the end of the table */
 	if (p->data == NULL) {
 		free (p);
 		gwmutex_unlock (&shareable_lock);
@@ -2019,6 +2080,7 @@ double *share_sincos_data (
 	}
 	memcpy (p->data, table, table_size);
 	p->data_size = table_size;
+	p->key = key;
 	p->use_count = 1;
 	p->next = shareable_data;
 	shareable_data = p;
@@ -2066,6 +2128,241 @@ void unshare_sincos_data (
 #endif
 }
 
+/* Code to manage an on-disk cache of FFT tables.  Only AVX-512 radix-4 DWPN FFTs are cached.  Their table builders are the most expensive, */
+/* and the only side effects of the builders are a handful of pointers and offsets that are saved alongside the tables. */
+
+#define TABLE_CACHE_MAGIC		0x43545747	/* "GWTC" */
+#define TABLE_CACHE_MIN_FFTLEN		65536		/* Smaller FFTs build their tables quickly */
+#define TABLE_CACHE_NULL		0xFFFFFFFFFFFFFFFFULL	/* Offset used for NULL pointers */
+#define TABLE_CACHE_DEFAULT_MAX_SIZE	((uint64_t) 2 << 30)	/* Default limit on the total size of the cache files */
+#define TABLE_CACHE_TEMP_AGE		3600			/* Seconds before an unrenamed temporary cache file is considered abandoned */
+
+struct table_cache_params {		/* Everything the cached tables depend on.  Compared byte-for-byte on load. */
+	char	version[16];		/* GWNUM_VERSION */
+	double	k;
+	uint64_t b, n;
+	int64_t	c;
+	uint64_t FFTLEN, PASS1_SIZE, PASS2_SIZE, PASS1_CACHE_LINES, SCRATCH_SIZE;
+	int64_t	FOURKBGAPSIZE;
+	int32_t	FFT_TYPE, ARCH, cpu_flags;
+	uint32_t jmptab_flags, jmptab_fftlen, jmptab_mem_needed;
+	int32_t	jmptab_counts[8];
+	int32_t	fft_options;		/* ZERO_PADDED_FFT, NEGACYCLIC_FFT, RATIONAL_FFT, GENERAL_MOD */
+	uint32_t asm_data_size;		/* sizeof (struct gwasm_data) */
+};
+
+struct table_cache_layout {		/* Where the tables are, as byte offsets from the start of the table area */
+	uint64_t end;			/* Offset of the end of the table area */
+	uint64_t pass1_var_data, pass1_var_data_bytes;
+	uint64_t sincos2, sincos2_bytes;
+	uint64_t xsincos_complex, xsincos_complex_bytes;
+	uint64_t sincos3, sincos3_bytes;
+	uint64_t carries;
+	uint64_t norm_grp_mults, norm_grp_mults_bytes;
+	uint64_t scratch_area;
+	uint64_t skip_start, skip_end;	/* Part of the table area not saved in the cache (the pass 1 scratch area) */
+	uint64_t compressed_biglits;
+	uint64_t compressed_fudges;
+	uint64_t biglit_data_offset;	/* Copies of gwdata fields set by the table builders */
+	uint64_t pass1_var_data_size;
+};
+
+struct table_cache_header {
+	uint32_t magic;			/* TABLE_CACHE_MAGIC */
+	uint32_t header_size;		/* sizeof (struct table_cache_header) */
+	struct table_cache_params params;
+	struct table_cache_layout layout;
+	uint64_t checksum;		/* Checksum of the table area */
+};
+
+/* Convert between table pointers and cache offsets */
+
+static uint64_t table_cache_offset (
+	void	*start,
+	void	*ptr)
+{
+	return (ptr == NULL ? TABLE_CACHE_NULL : (uint64_t) ((char *) ptr - (char *) start));
+}
+
+static void *table_cache_ptr (
+	void	*start,
+	uint64_t offset)
+{
+	return (offset == TABLE_CACHE_NULL ? NULL : (char *) start + offset);
+}
+
+/* Set the directory for the table cache.  The library keeps its own copy of the string. */
+
+void gwset_table_cache_dir (
+	gwhandle *gwdata,	/* Handle initialized by gwinit */
+	const char *dir)	/* Directory for the cache files or NULL */
+{
+	free (gwdata->table_cache_dir);
+	gwdata->table_cache_dir = (dir == NULL || *dir == 0) ? NULL : strdup (dir);
+}
+
+/* Fill in the parameters that identify a cacheable set of tables.  Returns FALSE if this FFT is not cached. */
+
+static int table_cache_params (
+	gwhandle *gwdata,
+	struct table_cache_params *params)
+{
+	const struct gwasm_jmptab *jmptab = gwdata->jmptab;
+
+	if (gwdata->table_cache_dir == NULL || gwdata->FFTLEN < TABLE_CACHE_MIN_FFTLEN) return (FALSE);
+	memset (params, 0, sizeof (struct table_cache_params));	// Clear any padding so memcmp works
+	strncpy (params->version, GWNUM_VERSION, sizeof (params->version) - 1);
+	params->k = gwdata->k;
+	params->b = gwdata->b;
+	params->n = gwdata->n;
+	params->c = gwdata->c;
+	params->FFTLEN = gwdata->FFTLEN;
+	params->PASS1_SIZE = gwdata->PASS1_SIZE;
+	params->PASS2_SIZE = gwdata->PASS2_SIZE;
+	params->PASS1_CACHE_LINES = gwdata->PASS1_CACHE_LINES;
+	params->SCRATCH_SIZE = gwdata->SCRATCH_SIZE;
+	params->FOURKBGAPSIZE = gwdata->FOURKBGAPSIZE;
+	params->FFT_TYPE = gwdata->FFT_TYPE;
+	params->ARCH = gwdata->ARCH;
+	params->cpu_flags = gwdata->cpu_flags;
+	params->jmptab_flags = jmptab->flags;
+	params->jmptab_fftlen = jmptab->fftlen;
+	params->jmptab_mem_needed = jmptab->mem_needed;
+	memcpy (params->jmptab_counts, jmptab->counts, sizeof (params->jmptab_counts));
+	params->fft_options = (gwdata->ZERO_PADDED_FFT << 3) + (gwdata->NEGACYCLIC_FFT << 2) + (gwdata->RATIONAL_FFT << 1) + gwdata->GENERAL_MOD;
+	params->asm_data_size = sizeof (struct gwasm_data);
+	return (TRUE);
+}
+
+/* Generate the cache file name from a hash of the parameters */
+
+static void table_cache_filename (
+	gwhandle *gwdata,
+	struct table_cache_params *params,
+	char	*filename)	/* Output buffer, at least strlen (table_cache_dir) + 40 bytes */
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	unsigned char *p;
+	size_t	i;
+
+	for (p = (unsigned char *) params, i = 0; i < sizeof (struct table_cache_params); i++) hash = (hash ^ p[i]) * 0x100000001B3ULL;
+	sprintf (filename, "%s/gwtab%08lX%08lX.bin", gwdata->table_cache_dir, (unsigned long) (hash >> 32), (unsigned long) (hash & 0xFFFFFFFF));
+}
+
+/* Set the maximum total size of the cache files.  Least recently used files are deleted when a new file pushes the cache over the limit. */
+
+void gwset_table_cache_max_size (
+	gwhandle *gwdata,	/* Handle initialized by gwinit */
+	uint64_t max_size)	/* Maximum bytes, 0 means use the default */
+{
+	gwdata->table_cache_max_size = max_size;
+}
+
+/* Checksum the table area */
+
+static uint64_t table_cache_checksum (
+	const void *tables,
+	const struct table_cache_layout *layout)
+{
+	const uint64_t *p = (const uint64_t *) tables;
+	uint64_t sum1 = 0, sum2 = 0;
+	uint64_t i;
+
+	for (i = 0; i < layout->end / sizeof (uint64_t); i++) {
+		if (i == layout->skip_start / sizeof (uint64_t)) i = layout->skip_end / sizeof (uint64_t);
+		if (i >= layout->end / sizeof (uint64_t)) break;
+		sum1 += p[i];
+		sum2 += sum1 ^ (p[i] >> 7);
+	}
+	return (sum1 ^ (sum2 << 1) ^ (sum2 >> 63));
+}
+
+/* Try to read previously built tables from the cache.  Returns TRUE if the tables and their layout were read in. */
+
+static int table_cache_read (
+	gwhandle *gwdata,
+	double	*tables,		/* Start of the table area */
+	size_t	max_size,		/* Maximum size of the table area */
+	struct table_cache_layout *layout)
+{
+	struct table_cache_params params;
+	struct table_cache_header header;
+	char	*filename;
+	FILE	*fd;
+	int	success = FALSE;
+
+	if (!table_cache_params (gwdata, &params)) return (FALSE);
+	filename = (char *) malloc (strlen (gwdata->table_cache_dir) + 40);
+	if (filename == NULL) return (FALSE);
+	table_cache_filename (gwdata, &params, filename);
+	fd = fopen (filename, "rb");
+	if (fd == NULL) {
+		free (filename);
+		return (FALSE);
+	}
+	if (fread (&header, sizeof (header), 1, fd) == 1 &&
+	    header.magic == TABLE_CACHE_MAGIC &&
+	    header.header_size == sizeof (header) &&
+	    !memcmp (&header.params, &params, sizeof (params)) &&
+	    header.layout.end <= max_size &&
+	    header.layout.skip_start <= header.layout.skip_end &&
+	    header.layout.skip_end <= header.layout.end &&
+	    fread (tables, 1, (size_t) header.layout.skip_start, fd) == header.layout.skip_start &&
+	    fread ((char *) tables + header.layout.skip_end, 1, (size_t) (header.layout.end - header.layout.skip_end), fd) == header.layout.end - header.layout.skip_end &&
+	    table_cache_checksum (tables, &header.layout) == header.checksum) {
+		*layout = header.layout;
+		success = TRUE;
+	}
+	fclose (fd);
+
+/* Mark the file as recently used so that trimming the cache deletes it last */
+
+	if (success) touch_file (filename);
+	free (filename);
+	return (success);
+}
+
+/* Write freshly built tables to the cache.  Write to a temporary file and rename it so that workers racing to build the same tables */
+/* never see a partial file.  The temporary name includes the process ID and a counter so that neither other processes nor other threads */
+/* can collide with it.  Then delete the least recently used files if the cache has grown too big.  Errors are ignored, the cache is only */
+/* an optimization. */
+
+static void table_cache_write (
+	gwhandle *gwdata,
+	double	*tables,		/* Start of the table area */
+	struct table_cache_layout *layout)
+{
+	static gwatomic tmp_counter = 0;
+	struct table_cache_header header;
+	char	*filename, *tmpname;
+	FILE	*fd;
+	int	ok;
+
+	if (!table_cache_params (gwdata, &header.params)) return;
+	filename = (char *) malloc (2 * (strlen (gwdata->table_cache_dir) + 40) + 20);
+	if (filename == NULL) return;
+	tmpname = filename + strlen (gwdata->table_cache_dir) + 40;
+	table_cache_filename (gwdata, &header.params, filename);
+	strcpy (tmpname, filename);
+	sprintf (tmpname + strlen (tmpname), ".%lu.%lu", process_id (), (unsigned long) atomic_fetch_incr (tmp_counter));
+	header.magic = TABLE_CACHE_MAGIC;
+	header.header_size = sizeof (header);
+	header.layout = *layout;
+	header.checksum = table_cache_checksum (tables, layout);
+	fd = fopen (tmpname, "wb");
+	if (fd != NULL) {
+		ok = (fwrite (&header, sizeof (header), 1, fd) == 1 &&
+		      fwrite (tables, 1, (size_t) layout->skip_start, fd) == layout->skip_start &&
+		      fwrite ((char *) tables + layout->skip_end, 1, (size_t) (layout->end - layout->skip_end), fd) == layout->end - layout->skip_end);
+		ok = (fclose (fd) == 0) && ok;
+		if (!ok || rename (tmpname, filename)) remove (tmpname);
+		else trim_directory_files (gwdata->table_cache_dir, "gwtab", ".bin",
+					   gwdata->table_cache_max_size ? gwdata->table_cache_max_size : TABLE_CACHE_DEFAULT_MAX_SIZE,
+					   TABLE_CACHE_TEMP_AGE);
+	}
+	free (filename);
+}
+
 /* Initialize gwhandle for a future gwsetup call. */
 /* The gwinit function has been superceeded by gwinit2.  By passing in the */
 /* version number we can verify the caller used the same gwnum.h file as the */
@@ -2108,6 +2405,7 @@ void gwinit2 (
 	gwdata->use_benchmarks = 1;
 	gwdata->gwnum_max_free_count = 10;
 	gwdata->scramble_arrays = 1;
+	gwdata->numa_node = -1;
 	gwdata->mem_needed = GWINIT_WAS_CALLED_VALUE;	/* Special code checked by gwsetup to ensure gwinit was called */
 
 /* Init structure that allows giants and gwnum code to share allocated memory */
@@ -3017,6 +3315,7 @@ int gwclone (
 				gwdone (cloned_gwdata);
 				return (GWERROR_MALLOC);
 			}
+			gwnuma_bind (gwdata, cloned_asm_data->scratch_area, gwdata->SCRATCH_SIZE);
 		}
 		if (gwdata->PASS2_SIZE) {
 			cloned_asm_data->carries = (double *) aligned_malloc (asm_data_carries_size (gwdata) * sizeof (double), 64);
@@ -3024,6 +3323,7 @@ int gwclone (
 				gwdone (cloned_gwdata);
 				return (GWERROR_MALLOC);
 			}
+			gwnuma_bind (gwdata, cloned_asm_data->carries, asm_data_carries_size (gwdata) * sizeof (double));
 			init_asm_data_carries (gwdata, cloned_asm_data);
 		}
 		cloned_asm_data->MAXERR = 0.0;
@@ -3207,7 +3507,7 @@ int internal_gwsetup (
 	void	*asm_data_alloc;
 	struct gwasm_data *asm_data;
 	int	error_code;
-	unsigned long mem_needed;
+	unsigned long mem_needed = 0;
 	double	*tables;		/* Pointer tables we are building */
 	unsigned long pass1_size;
 	double	small_word, big_word, temp, asm_values[50];
@@ -3281,6 +3581,10 @@ int internal_gwsetup (
 		}
 		gwdata->gwnum_memory = tables;
 
+/* Apply the NUMA policy to the sin/cos tables, carries, and scratch area before the memset first touches them */
+
+		gwnuma_bind (gwdata, tables, mem_needed);
+
 /* Do a seemingly pointless memset! */
 /* The memset will walk through the allocated memory sequentially, which */
 /* increases the likelihood that contiguous virtual memory will map to */
@@ -3421,11 +3725,13 @@ int internal_gwsetup (
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->norm_col_mults = tables;
 			tables = zr4_build_onepass_weights_table (gwdata, tables);
+			asm_data->norm_col_mults = share_sincos_data (gwdata, NORM_COL_MULTS_DATA, (double *) asm_data->norm_col_mults, (char *) tables - (char *) asm_data->norm_col_mults);
 			tables = round_to_cache_line (tables);
 
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->norm_grp_mults = tables;
 			tables = zr4_build_onepass_inverse_weights_table (gwdata, tables);
+			asm_data->norm_grp_mults = share_sincos_data (gwdata, NORM_GRP_MULTS_DATA, (double *) asm_data->norm_grp_mults, (char *) tables - (char *) asm_data->norm_grp_mults);
 			tables = round_to_cache_line (tables);
 
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
@@ -3447,6 +3753,25 @@ int internal_gwsetup (
 /* Initialize tables for one pass FFTs that use a wrapper as well as two pass FFTs */
 
 		else {
+			struct table_cache_layout layout;
+			double	*tables_start = tables;
+
+/* Try reading the tables from the on-disk cache */
+
+		    if (table_cache_read (gwdata, tables, mem_needed - ((char *) tables - (char *) gwdata->gwnum_memory), &layout)) {
+			gwdata->pass1_var_data = table_cache_ptr (tables_start, layout.pass1_var_data);
+			asm_data->sincos2 = (double *) table_cache_ptr (tables_start, layout.sincos2);
+			asm_data->xsincos_complex = (double *) table_cache_ptr (tables_start, layout.xsincos_complex);
+			asm_data->sincos3 = (double *) table_cache_ptr (tables_start, layout.sincos3);
+			asm_data->carries = (double *) table_cache_ptr (tables_start, layout.carries);
+			asm_data->norm_grp_mults = table_cache_ptr (tables_start, layout.norm_grp_mults);
+			asm_data->scratch_area = table_cache_ptr (tables_start, layout.scratch_area);
+			asm_data->compressed_biglits = table_cache_ptr (tables_start, layout.compressed_biglits);
+			asm_data->compressed_fudges = table_cache_ptr (tables_start, layout.compressed_fudges);
+			gwdata->biglit_data_offset = (unsigned long) layout.biglit_data_offset;
+			gwdata->pass1_var_data_size = (unsigned long) layout.pass1_var_data_size;
+			tables = (double *) table_cache_ptr (tables_start, layout.end);
+		    } else {
 
 /* Build sin/cos and premultiplier tables used in pass 1 of two pass FFTs. */
 /* For best prefetching, make sure tables remain on 64-byte boundaries */
@@ -3454,15 +3779,17 @@ int internal_gwsetup (
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			gwdata->pass1_var_data = tables;
 			tables = zr4dwpn_build_pass1_table (gwdata, tables);
+			layout.pass1_var_data_bytes = (char *) tables - (char *) gwdata->pass1_var_data;
 			tables = round_to_cache_line (tables);
 			/* The wrapper for "one-pass" FFTs does not use a fixed sin/cos table, but it does access the variable data using sincos2 */
 			if (gwdata->PASS1_SIZE == 0) {
 				asm_data->sincos2 = gwdata->pass1_var_data;
+				layout.sincos2_bytes = 0;
 			} else {
 				ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 				asm_data->sincos2 = tables;
 				tables = zr4dwpn_build_fixed_pass1_table (gwdata, tables);
-				asm_data->sincos2 = share_sincos_data (gwdata, FIXED_PASS1_SINCOS_DATA, asm_data->sincos2, (char *) tables - (char *) asm_data->sincos2);
+				layout.sincos2_bytes = (char *) tables - (char *) asm_data->sincos2;
 				tables = round_to_cache_line (tables);
 			}
 
@@ -3472,12 +3799,12 @@ int internal_gwsetup (
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->xsincos_complex = tables;
 			tables = zr4_build_pass2_complex_table (gwdata, tables);
-			asm_data->xsincos_complex = share_sincos_data (gwdata, PASS2_COMPLEX_SINCOS_DATA, asm_data->xsincos_complex, (char *) tables - (char *) asm_data->xsincos_complex);
+			layout.xsincos_complex_bytes = (char *) tables - (char *) asm_data->xsincos_complex;
 			tables = round_to_cache_line (tables);
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->sincos3 = tables;
 			tables = zr4_build_pass2_real_table (gwdata, tables);
-			asm_data->sincos3 = share_sincos_data (gwdata, PASS2_REAL_SINCOS_DATA, asm_data->sincos3, (char *) tables - (char *) asm_data->sincos3);
+			layout.sincos3_bytes = (char *) tables - (char *) asm_data->sincos3;
 			tables = round_to_cache_line (tables);
 
 /* Allocate a table for carries.  For better distribution of data in the caches, make this table contiguous with all */
@@ -3495,15 +3822,19 @@ int internal_gwsetup (
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->norm_grp_mults = tables;
 			tables = zr4dwpn_build_norm_table (gwdata, tables);
+			layout.norm_grp_mults_bytes = (char *) tables - (char *) asm_data->norm_grp_mults;
 			tables = round_to_cache_line (tables);
 
 /* Reserve room for the pass 1 scratch area. */
 
+			layout.skip_start = layout.skip_end = 0;
 			if (gwdata->SCRATCH_SIZE) {
 				ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 				asm_data->scratch_area = tables;
 				tables = (double *) ((char *) tables + gwdata->SCRATCH_SIZE);
 				tables = round_to_cache_line (tables);
+				layout.skip_start = table_cache_offset (tables_start, asm_data->scratch_area);
+				layout.skip_end = table_cache_offset (tables_start, tables);
 			}
 
 /* Build the table of big vs. little flags.  Build the table of fudge factor flags */
@@ -3514,6 +3845,33 @@ int internal_gwsetup (
 			tables = zr4dwpn_build_fudge_table (gwdata, tables);
 			tables = round_to_cache_line (tables);
 
+/* Save the tables and their layout in the on-disk cache */
+
+			layout.end = (char *) tables - (char *) tables_start;
+			layout.pass1_var_data = table_cache_offset (tables_start, gwdata->pass1_var_data);
+			layout.sincos2 = table_cache_offset (tables_start, asm_data->sincos2);
+			layout.xsincos_complex = table_cache_offset (tables_start, asm_data->xsincos_complex);
+			layout.sincos3 = table_cache_offset (tables_start, asm_data->sincos3);
+			layout.carries = table_cache_offset (tables_start, asm_data->carries);
+			layout.norm_grp_mults = table_cache_offset (tables_start, asm_data->norm_grp_mults);
+			layout.scratch_area = table_cache_offset (tables_start, asm_data->scratch_area);
+			layout.compressed_biglits = table_cache_offset (tables_start, asm_data->compressed_biglits);
+			layout.compressed_fudges = table_cache_offset (tables_start, asm_data->compressed_fudges);
+			layout.biglit_data_offset = gwdata->biglit_data_offset;
+			layout.pass1_var_data_size = gwdata->pass1_var_data_size;
+			table_cache_write (gwdata, tables_start, &layout);
+		    }
+
+/* Share the read-only tables with other gwnum callers.  The big/lit and fudge builders write into the pass 1 variable data and rebuild */
+/* the group multipliers, so sharing must wait until all tables are final. */
+
+			if (gwdata->PASS1_SIZE) asm_data->sincos2 = share_sincos_data (gwdata, FIXED_PASS1_SINCOS_DATA, asm_data->sincos2, (size_t) layout.sincos2_bytes);
+			asm_data->xsincos_complex = share_sincos_data (gwdata, PASS2_COMPLEX_SINCOS_DATA, asm_data->xsincos_complex, (size_t) layout.xsincos_complex_bytes);
+			asm_data->sincos3 = share_sincos_data (gwdata, PASS2_REAL_SINCOS_DATA, asm_data->sincos3, (size_t) layout.sincos3_bytes);
+			gwdata->pass1_var_data = share_sincos_data (gwdata, PASS1_PREMULT_DATA, (double *) gwdata->pass1_var_data, (size_t) layout.pass1_var_data_bytes);
+			if (gwdata->PASS1_SIZE == 0) asm_data->sincos2 = gwdata->pass1_var_data;
+			asm_data->norm_grp_mults = share_sincos_data (gwdata, NORM_GRP_MULTS_DATA, (double *) asm_data->norm_grp_mults, (size_t) layout.norm_grp_mults_bytes);
+
 #ifdef GDEBUG_MEM
 			{
 			char buf[80];
@@ -3570,6 +3928,7 @@ int internal_gwsetup (
 
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			tables = yr4dwpn_build_pass1_table (gwdata, tables);
+			gwdata->pass1_var_data = share_sincos_data (gwdata, PASS1_PREMULT_DATA, (double *) gwdata->pass1_var_data, (char *) tables - (char *) gwdata->pass1_var_data);
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->sincos2 = tables;
 			tables = yr4dwpn_build_fixed_pass1_table (gwdata, tables);
@@ -3604,6 +3963,7 @@ int internal_gwsetup (
 			ASSERTG (((tables - gwdata->gwnum_memory) & 7) == 0);
 			asm_data->norm_grp_mults = tables;
 			tables = yr4dwpn_build_norm_table (gwdata, tables);
+			asm_data->norm_grp_mults = share_sincos_data (gwdata, NORM_GRP_MULTS_DATA, (double *) asm_data->norm_grp_mults, (char *) tables - (char *) asm_data->norm_grp_mults);
 
 /* Reserve room for the pass 1 scratch area. */
 
@@ -5384,6 +5744,8 @@ void xcopy_3_words_after_gwcarries (
 /* 1 = pass 1 inverse fft */
 #define	PASS1_STATE_PASS2		999		/* Auxiliary thread is doing pass 2 work */
 #define	PASS1_STATE_MULTITHREAD_OP	4000		/* Auxiliary thread is doing add/sub/addsub/smallmul work */
+#define	PASS1_STATE_MULTITHREAD_CONV	4001		/* Auxiliary thread is doing gwtogiant/gianttogw work */
+#define	PASS1_STATE_MULTITHREAD_TOUCH	4002		/* Auxiliary thread is first touching newly allocated memory */
 
 /* Inline routines for the processing blocks in multi-thread code below */
 
@@ -5843,6 +6205,20 @@ void auxiliary_thread (void *arg)
 			goto aux_out_of_work;
 		}
 
+/* If we are to do gwtogiant/gianttogw work, go do the work.  No asm_data state is needed. */
+
+		if (gwdata->pass1_state == PASS1_STATE_MULTITHREAD_CONV) {
+			do_multithread_conv_work (gwdata);
+			goto aux_out_of_work;
+		}
+
+/* If we are to first touch newly allocated memory, go do the work.  No asm_data state is needed. */
+
+		if (gwdata->pass1_state == PASS1_STATE_MULTITHREAD_TOUCH) {
+			do_multithread_touch_work (gwdata, thread_num);
+			goto aux_out_of_work;
+		}
+
 /* Copy the main thread's asm_data's DESTARG for proper next_block address calculations.  We'll copy more asm_data later. */
 
 		asm_data->DESTARG = main_thread_asm_data->DESTARG;
@@ -6740,13 +7116,11 @@ void gwdone (
 				int32_t	freeable;
 				p = (char *) gwdata->gwnum_alloc[i];
 				freeable = * (int32_t *) (p - 32);
-				if (freeable & GWFREEABLE) {
-					if (freeable & GWFREE_LARGE_PAGES) aligned_large_pages_free ((char *) p - GW_HEADER_SIZE (gwdata));
-					else aligned_free ((char *) p - GW_HEADER_SIZE (gwdata));
-				}
+				if ((freeable & GWFREEABLE) && !(freeable & GWFREE_LARGE_PAGES)) aligned_free ((char *) p - GW_HEADER_SIZE (gwdata));
 			}
 			free (gwdata->gwnum_alloc); gwdata->gwnum_alloc = NULL;
 		}
+		gwarena_done (gwdata);
 		while (gwdata->array_list != NULL) gwfree_array (gwdata, (gwnum *) gwdata->array_list);
 		if (gwdata->large_pages_ptr != NULL) large_pages_free (gwdata->large_pages_ptr), gwdata->large_pages_ptr = NULL;
 		else aligned_free (gwdata->gwnum_memory), gwdata->gwnum_memory = NULL;
@@ -6759,6 +7133,7 @@ void gwdone (
 	if (gwdata->clone_of == NULL) {
 		free (gwdata->GW_MODULUS); gwdata->GW_MODULUS = NULL;
 		free (gwdata->dd_data); gwdata->dd_data = NULL;
+		free (gwdata->table_cache_dir); gwdata->table_cache_dir = NULL;
 		gwmutex_destroy (&gwdata->alloc_lock);
 	}
 
@@ -6770,6 +7145,10 @@ void gwdone (
 			unshare_sincos_data (asm_data->sincos2);			// SSE2 & AVX & AVX512
 			unshare_sincos_data (asm_data->xsincos_complex);		// SSE2 & AVX & AVX512
 			unshare_sincos_data (asm_data->sincos3);			// SSE2 & AVX & AVX512
+			if (gwdata->pass1_var_data != asm_data->sincos1 && gwdata->pass1_var_data != asm_data->sincos2)	// One pass wrapper FFTs point sincos2 at pass1_var_data
+				unshare_sincos_data ((double *) gwdata->pass1_var_data);	// AVX & AVX512
+			unshare_sincos_data ((double *) asm_data->norm_grp_mults);	// AVX & AVX512
+			unshare_sincos_data ((double *) asm_data->norm_col_mults);	// AVX512
 			aligned_free ((char *) gwdata->asm_data - NEW_STACK_SIZE), gwdata->asm_data = NULL;
 		}
 		// Check that all clones have been terminated
@@ -6808,6 +7187,237 @@ void gwdone (
 	}
 }
 
+/* Parallel first touch.  The first thread to write to a page decides which NUMA node the page lives on.  Rather than have the allocating thread */
+/* touch all of a large allocation, each compute thread touches the slice of every gwnum that it would process in a multithreaded FFT or polymult. */
+
+#define FIRST_TOUCH_MIN_SIZE	(1 << 20)	/* Smaller allocations are not worth waking the auxiliary threads for */
+
+struct multithread_touch_data {
+	gwnum	*gwnums;		/* Gwnums to touch */
+	uint64_t num_gwnums;		/* Number of gwnums */
+	size_t	header_size;		/* Bytes of header preceding each gwnum.  Headers are always zeroed. */
+	size_t	size;			/* Bytes to touch in each gwnum */
+	int	zero;			/* TRUE if the memory must be zeroed, FALSE if writing one byte per page will do */
+	gwatomic *slice_claimed;	/* One flag per thread, set when the slice has been claimed by a thread */
+};
+
+/* Return TRUE if an allocation of the given size should be first touched by the auxiliary threads */
+
+int use_parallel_first_touch (
+	gwhandle *gwdata,		/* Handle the caller passed to gwalloc (possibly a clone) */
+	uint64_t size)			/* Total bytes to touch */
+{
+	return (gwdata->parallel_first_touch && gwdata->clone_of == NULL && gwdata->parent_gwdata == NULL && !gwdata->GENERAL_MMGW_MOD &&
+		gwdata->num_threads > 1 && gwdata->thread_ids != NULL && size >= FIRST_TOUCH_MIN_SIZE);
+}
+
+/* Touch one slice of every gwnum and its header.  Slice boundaries are rounded to 4KB so that each page is touched by exactly one thread. */
+
+void touch_gwnum_slice (
+	struct multithread_touch_data *data,
+	int	slice,			/* Slice to touch */
+	int	num_slices)		/* Total number of slices */
+{
+	for (uint64_t i = 0; i < data->num_gwnums; i++) {
+		char	*start, *data_start, *end, *lo, *hi, *p;
+		size_t	total = data->header_size + data->size;
+		data_start = (char *) data->gwnums[i];
+		start = data_start - data->header_size;
+		end = data_start + data->size;
+		lo = (slice == 0) ? start : (char *) round_up_to_multiple_of ((intptr_t) (start + total * slice / num_slices), 4096);
+		hi = (slice == num_slices - 1) ? end : (char *) round_up_to_multiple_of ((intptr_t) (start + total * (slice + 1) / num_slices), 4096);
+		if (hi > end) hi = end;
+		if (lo >= hi) continue;
+		if (lo < data_start) memset (lo, 0, (hi < data_start ? hi : data_start) - lo);
+		if (data->zero) memset (lo, 0, hi - lo);
+		else for (p = lo; p < hi; p = (char *) round_down_to_multiple_of ((intptr_t) p + 4096, 4096)) *p = 0;
+	}
+}
+
+/* Routine for the main thread and auxiliary threads to do first touch work.  Each auxiliary thread touches only its own slice.  After */
+/* touching its own slice, the main thread touches any slices not yet claimed by a (perhaps late to wake up) auxiliary thread. */
+
+void do_multithread_touch_work (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	int	thread_num)		/* Thread number, zero is the main thread */
+{
+	struct multithread_touch_data *data = (struct multithread_touch_data *) gwdata->multithread_op_data;
+	int	slice;
+
+	if (atomic_compare_exchange (data->slice_claimed[thread_num], 0, 1)) touch_gwnum_slice (data, thread_num, gwdata->num_threads);
+	if (thread_num != 0) return;
+	for (slice = 1; slice < (int) gwdata->num_threads; slice++)
+		if (atomic_compare_exchange (data->slice_claimed[slice], 0, 1)) touch_gwnum_slice (data, slice, gwdata->num_threads);
+}
+
+/* Have the main thread and the auxiliary threads first touch a set of gwnums */
+
+void parallel_first_touch (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	gwnum	*gwnums,		/* Gwnums to touch */
+	uint64_t num_gwnums,		/* Number of gwnums */
+	size_t	header_size,		/* Bytes of header preceding each gwnum to zero */
+	size_t	size,			/* Bytes to touch in each gwnum */
+	int	zero)			/* TRUE if the memory must be zeroed */
+{
+	struct multithread_touch_data data;
+
+	data.gwnums = gwnums;
+	data.num_gwnums = num_gwnums;
+	data.header_size = header_size;
+	data.size = size;
+	data.zero = zero;
+	data.slice_claimed = (gwatomic *) calloc (gwdata->num_threads, sizeof (gwatomic));
+
+/* If we can't allocate the claim flags, touch all the memory ourselves */
+
+	if (data.slice_claimed == NULL) {
+		touch_gwnum_slice (&data, 0, 1);
+		return;
+	}
+
+/* Wake up the auxiliary threads, do our share of the work, and wait for the auxiliary threads to finish */
+
+	gwdata->pass1_state = PASS1_STATE_MULTITHREAD_TOUCH;
+	gwdata->multithread_op_data = &data;
+	signal_auxiliary_threads (gwdata);
+	do_multithread_touch_work (gwdata, 0);
+	wait_on_auxiliary_threads (gwdata);
+	free (data.slice_claimed);
+}
+
+/* Huge page slab arena.  Allocating each large pages gwnum with its own mmap wastes up to 2MB per gwnum, which adds up when */
+/* ECM or P-1 stage 2 allocates thousands of small gwnums.  Instead, we carve large pages gwnums out of big slabs of huge */
+/* pages -- or transparent huge pages if no huge pages have been reserved.  A freed gwnum goes on its slab's free list for */
+/* reuse.  A slab is returned to the OS when its last gwnum is freed (unless it is the only slab).  Caller must hold alloc_lock. */
+
+#define GWARENA_MIN_SLAB_SIZE	((size_t) 32 << 20)	/* Smallest huge page slab to allocate */
+
+struct gwarena_slab {
+	char	*base;			/* Slab memory as returned by large_pages_malloc or thp_malloc */
+	char	*end;			/* End of the usable slab memory */
+	char	*cursor;		/* Memory from here on has not yet been carved into gwnums */
+	gwnum	free_list;		/* Linked list of freed gwnums in this slab */
+	size_t	size;			/* Size of the slab including the large_pages_malloc overhead */
+	unsigned int live;		/* Count of allocated gwnums in this slab */
+};
+
+/* Return the first properly aligned gwnum address with its header at or after p */
+
+#define gwarena_align(h,p)	((char *) (round_up_to_multiple_of ((intptr_t) (p) + GW_HEADER_SIZE (h) - (h)->GW_ALIGNMENT_MOD, (h)->GW_ALIGNMENT) + (h)->GW_ALIGNMENT_MOD))
+
+char *gwarena_alloc (		/* Returns pointer to the gwnum header or NULL */
+	gwhandle *gwdata)	/* Handle initialized by gwsetup (not a clone) */
+{
+	unsigned long header_size = GW_HEADER_SIZE (gwdata);
+	unsigned long size = gwnum_datasize (gwdata);
+	struct gwarena_slab *slab;
+	char	*q;
+	unsigned int i, stagger;
+
+/* Randomize the starting cache line in 64KB blocks.  Perhaps that will help with potential 64KB cache collisions. */
+/* Small gwnums are not staggered, the gap would waste several times the gwnum's size. */
+
+	stagger = 0;
+	if (size >= 65536 && gwdata->GW_ALIGNMENT < 65536 && 65536 % gwdata->GW_ALIGNMENT == 0)
+		stagger = (rand () % (65536 / gwdata->GW_ALIGNMENT)) * gwdata->GW_ALIGNMENT;
+
+/* Reuse a freed gwnum or carve a new gwnum out of an existing slab */
+
+	for (i = 0; i < gwdata->arena_num_slabs; i++) {
+		slab = &gwdata->arena_slabs[i];
+		if (slab->free_list != NULL) {
+			q = (char *) slab->free_list;
+			slab->free_list = * (gwnum *) q;
+			goto carved;
+		}
+		q = gwarena_align (gwdata, slab->cursor + stagger);
+		if (q + size <= slab->end) {
+			slab->cursor = q + size;
+			goto carved;
+		}
+	}
+
+/* Allocate a new slab big enough for at least 8 gwnums.  Try huge pages, then transparent huge pages. */
+
+	{
+		struct gwarena_slab *new_slabs;
+		size_t	slab_size;
+		char	*base;
+
+		new_slabs = (struct gwarena_slab *) realloc (gwdata->arena_slabs, (gwdata->arena_num_slabs + 1) * sizeof (struct gwarena_slab));
+		if (new_slabs == NULL) return (NULL);
+		gwdata->arena_slabs = new_slabs;
+
+		slab_size = round_up_to_multiple_of (8 * ((size_t) header_size + size + gwdata->GW_ALIGNMENT + (size >= 65536 ? 65536 : 0)), (size_t) 2 << 20);
+		if (slab_size < GWARENA_MIN_SLAB_SIZE) slab_size = GWARENA_MIN_SLAB_SIZE;
+		base = (char *) large_pages_malloc (slab_size - 4096);
+		if (base == NULL) base = (char *) thp_malloc (slab_size - 4096);
+		if (base == NULL) return (NULL);
+		gwnuma_bind (gwdata, base, slab_size - 4096);
+
+		slab = &gwdata->arena_slabs[gwdata->arena_num_slabs++];
+		slab->base = base;
+		slab->end = base + slab_size - 4096;
+		slab->free_list = NULL;
+		slab->size = slab_size;
+		slab->live = 0;
+		gwdata->arena_bytes += slab_size;
+		q = gwarena_align (gwdata, base + stagger);
+		slab->cursor = q + size;
+	}
+
+/* Account for the new gwnum and return it */
+
+carved:	slab->live++;
+	gwdata->arena_bytes_in_use += header_size + size;
+	return (q - header_size);
+}
+
+void gwarena_free (
+	gwhandle *gwdata,	/* Handle initialized by gwsetup (not a clone) */
+	gwnum	q)		/* Gwnum carved from a slab */
+{
+	struct gwarena_slab *slab;
+	unsigned int i;
+
+/* Find the slab this gwnum was carved out of.  Should it not be found, leak it rather than corrupt a free list. */
+
+	for (i = 0; ; i++) {
+		if (i == gwdata->arena_num_slabs) {
+			ASSERTG (FALSE);
+			return;
+		}
+		slab = &gwdata->arena_slabs[i];
+		if ((char *) q >= slab->base && (char *) q < slab->end) break;
+	}
+
+/* Put the gwnum on the slab's free list */
+
+	* (gwnum *) q = slab->free_list;
+	slab->free_list = q;
+	slab->live--;
+	gwdata->arena_bytes_in_use -= GW_HEADER_SIZE (gwdata) + gwnum_datasize (gwdata);
+
+/* Return an empty slab to the OS */
+
+	if (slab->live == 0 && gwdata->arena_num_slabs > 1) {
+		gwdata->arena_bytes -= slab->size;
+		large_pages_free (slab->base);
+		*slab = gwdata->arena_slabs[--gwdata->arena_num_slabs];
+	}
+}
+
+void gwarena_done (
+	gwhandle *gwdata)	/* Handle initialized by gwsetup (not a clone) */
+{
+	for (unsigned int i = 0; i < gwdata->arena_num_slabs; i++) large_pages_free (gwdata->arena_slabs[i].base);
+	free (gwdata->arena_slabs), gwdata->arena_slabs = NULL;
+	gwdata->arena_num_slabs = 0;
+	gwdata->arena_bytes = 0;
+	gwdata->arena_bytes_in_use = 0;
+}
+
 /* Routine to allocate aligned memory for our big numbers.  Memory is allocated on 128-byte boundaries, */
 /* with an additional 32 bytes prior to the data for storing useful stuff. */
 
@@ -6818,9 +7428,11 @@ gwnum real_gwalloc (
 	unsigned long header_size, size, aligned_size;
 	char	*p, *q;
 	int32_t	freeable;
+	int	parallel_touch;
 
 /* Feed all allocations through the parent gwdata */
 
+	parallel_touch = use_parallel_first_touch (gwdata, gwnum_datasize (gwdata));
 	if (gwdata->clone_of) gwdata = gwdata->clone_of;
 
 /* Return cached gwnum if possible */
@@ -6872,17 +7484,12 @@ gwnum real_gwalloc (
 		freeable = 0;
 	}
 
-/* Third option is to allocate using large pages */
+/* Third option is to carve the gwnum out of a huge page slab */
 
 	else if (gwdata->use_large_pages) {
-		// Randomize the starting cache line in 64KB blocks.  Perhaps that will help with potential 64KB cache collisions.
-		int	alignment = gwdata->GW_ALIGNMENT;
-		int	alignment_mod = (header_size - gwdata->GW_ALIGNMENT_MOD) & (gwdata->GW_ALIGNMENT - 1);
-		if (alignment < 65536 && 65536 % alignment == 0) {
-			alignment_mod += (rand () % (65536 / alignment)) * alignment;
-			alignment = 65536;
-		}
-		p = (char *) aligned_offset_large_pages_malloc (size + header_size, alignment, alignment_mod);
+		gwmutex_lock (&gwdata->alloc_lock);
+		p = gwarena_alloc (gwdata);
+		gwmutex_unlock (&gwdata->alloc_lock);
 		freeable = GWFREEABLE + GWFREE_LARGE_PAGES;
 	}
 
@@ -6901,21 +7508,31 @@ gwnum real_gwalloc (
 		freeable = GWFREEABLE;
 	}
 
-/* Initialize the gwnum header */
+/* Apply the NUMA policy to freshly allocated memory.  Huge page slabs were bound when they were allocated. */
 
-	q = p + header_size;
-	//* (uint32_t *) (q - 8) = size;				/* Size in bytes -- DEPRECATED (if not, gwarray_alloc is broken!) */
-	* (uint32_t *) (q - 28) = 0;					/* Has-been-pre-ffted flag */
-	* (double *) (q - 16) = 0.0;					/* SUM(INPUTS) */
-	* (double *) (q - 24) = 0.0;					/* SUM(OUTPUTS) */
-	unnorms (q) = 0.0f;						/* Unnormalized adds count */
+	if (freeable == GWFREEABLE && !parallel_touch) gwnuma_bind (gwdata, p, size + header_size);
 
 /* Do a seemingly pointless memset!  This actually is very important.  The memset will walk through the allocated memory sequentially, which */
 /* increases the likelihood that contiguous virtual memory will map to contiguous physical memory.  The FFTs, especially the larger ones, */
 /* optimizes L2 cache line collisions on the assumption that the FFT data is in contiguous physical memory.  Failure to do this results in as */
 /* much as a 30% performance hit in an SSE2 2M FFT.  I've no idea if this is of any benefit in Linux or more modern Windows or more modern CPUs. */
+/* Optionally, spread the zeroing over the compute threads for NUMA placement or skip the zeroing entirely.  When spreading, the header */
+/* is first touched along with the data so that the gwnum's first page is not placed on this thread's NUMA node. */
 
-	memset (q, 0, size);
+	q = p + header_size;
+	if (parallel_touch) {
+		gwnum	g = (gwnum) q;
+		parallel_first_touch (gwdata, &g, 1, header_size, size, !gwdata->skip_zeroing);
+	}
+	else if (!gwdata->skip_zeroing) memset (q, 0, size);
+
+/* Initialize the gwnum header */
+
+	//* (uint32_t *) (q - 8) = size;				/* Size in bytes -- DEPRECATED (if not, gwarray_alloc is broken!) */
+	* (uint32_t *) (q - 28) = 0;					/* Has-been-pre-ffted flag */
+	* (double *) (q - 16) = 0.0;					/* SUM(INPUTS) */
+	* (double *) (q - 24) = 0.0;					/* SUM(OUTPUTS) */
+	unnorms (q) = 0.0f;						/* Unnormalized adds count */
 
 /* Grow arrays if necessary */
 
@@ -6924,9 +7541,9 @@ gwnum real_gwalloc (
 		int new_gwnum_alloc_array_size = gwdata->gwnum_alloc_array_size + (gwdata->gwnum_alloc_array_size >> 1);
 		gwnum *new_gwnum_alloc = (gwnum *) realloc (gwdata->gwnum_alloc, new_gwnum_alloc_array_size * sizeof (gwnum));
 		if (new_gwnum_alloc == NULL) {
+			if (freeable & GWFREE_LARGE_PAGES) gwarena_free (gwdata, (gwnum) q);
 			gwmutex_unlock (&gwdata->alloc_lock);
-			if (freeable & GWFREE_LARGE_PAGES) aligned_large_pages_free (p);
-			else if (freeable & GWFREEABLE) aligned_free (p);
+			if (freeable == GWFREEABLE) aligned_free (p);
 			return (NULL);
 		}
 		gwdata->gwnum_alloc = new_gwnum_alloc;
@@ -6985,7 +7602,7 @@ void gwfree_freeable (
 	moved_freeable |= alloc_index;
 	* (int32_t *) ((char *) moved_gwnum - 32) = moved_freeable;
 	// Free the gwnum
-	if (freeable & GWFREE_LARGE_PAGES) aligned_large_pages_free ((char *) q - GW_HEADER_SIZE (gwdata));
+	if (freeable & GWFREE_LARGE_PAGES) gwarena_free (gwdata, q);
 	else aligned_free ((char *) q - GW_HEADER_SIZE (gwdata));
 }
 
@@ -7077,8 +7694,10 @@ gwarray gwalloc_array (		/* Pointer to an array of gwnums */
 	int	pad_frequency, pad_amount, pad_direction;
 	char	*p = NULL;			// Pointer to the allocated memory
 	int	freeable;			// Flags indicating how memory was allocated
+	int	parallel_touch;			// TRUE if auxiliary threads will first touch the gwnums
 
 	// Feed all allocates through the parent gwdata
+	parallel_touch = use_parallel_first_touch (gwdata, n * gwnum_datasize (gwdata));
 	if (gwdata->clone_of) gwdata = gwdata->clone_of;
 
 	// Calc needed space for each gwnum in the array
@@ -7134,6 +7753,9 @@ gwarray gwalloc_array (		/* Pointer to an array of gwnums */
 	// On failure, return NULL
 	if (p == NULL) return (NULL);
 
+	// Apply the NUMA policy before the gwnum headers are first touched.  Parallel first touch places the memory instead.
+	if (!parallel_touch) gwnuma_bind (gwdata, p, array_size);
+
 	// Create pointers to the array, first gwnum, and array header
 	gwarray array = (gwarray) (p + array_header_size);
 	array = (gwarray) round_up_to_multiple_of ((intptr_t) array, sizeof (gwnum));
@@ -7155,12 +7777,15 @@ gwarray gwalloc_array (		/* Pointer to an array of gwnums */
 				}
 			}
 		}
-		// Set array pointer, clear gwnum header, calc next gwnum pointer assuming no extra padding required
+		// Set array pointer, clear gwnum header (unless the parallel first touch below will), calc next gwnum pointer assuming no extra padding required
 		array[i] = next_gwnum;
-		memset ((char *) next_gwnum - gwnum_header_size, 0, gwnum_header_size);
+		if (!parallel_touch) memset ((char *) next_gwnum - gwnum_header_size, 0, gwnum_header_size);
 		next_gwnum = (gwnum) ((char *) next_gwnum + aligned_gwnum_size);
 	}
 
+	// Optionally spread the first touch of the gwnum headers and data over the compute threads
+	if (parallel_touch) parallel_first_touch (gwdata, array, n, gwnum_header_size, gwnum_datasize (gwdata), FALSE);
+
 	// Clearly we do not fully understand memory accessing.  The above code that makes sure polymult strided accesses have a minimum number of 4KB strides is
 	// often slower than simply randomly placing the gwnum pointers in the gwnum array according to our Advanced/Time 8900 synthetic benchmark.  Until we can
 	// improve the above code, we default to scrambled addresses.  Unfortunately, real world ECM results show that full scrambling is slower.  Instead, I now
@@ -7222,6 +7847,7 @@ void gwfree_array (
 	int freeable = (int) (intptr_t) array[-3];		// Flags
 	size_t array_header_size = 3 * sizeof (void *);
 	if (freeable & GWFREE_LARGE_PAGES) large_pages_free ((char *) array - array_header_size);
+	else if (freeable & GWARRAY_FILE_BACKED) file_backed_free ((char *) array - array_header_size);
 	else free ((char *) array - array_header_size);
 }
 
@@ -7308,6 +7934,7 @@ void gwfreeall (
 		int freeable = (int) (intptr_t) array[-3];		// Flags
 		size_t array_header_size = 3 * sizeof (void *);
 		if (freeable & GWFREE_LARGE_PAGES) large_pages_free ((char *) array - array_header_size);
+		else if (freeable & GWARRAY_FILE_BACKED) file_backed_free ((char *) array - array_header_size);
 		else free ((char *) array - array_header_size);
 	}
 
@@ -7966,8 +8593,20 @@ void gwiter_next (		/* Position to next element */
 unsigned long gwmemused (
 	gwhandle *gwdata)	/* Handle initialized by gwsetup */
 {
-	if (!gwdata->GENERAL_MMGW_MOD) return (gwdata->mem_needed + gwdata->SCRATCH_SIZE);
-	return (gwmemused (gwdata->cyclic_gwdata) + gwmemused (gwdata->negacyclic_gwdata));
+	gwhandle *parent = (gwdata->clone_of != NULL) ? gwdata->clone_of : gwdata;
+	unsigned long arena_slack;
+
+	// Include huge page slab memory that is not holding gwnums.  This is the price of the arena's partially filled and fragmented slabs.
+	// Other threads may be allocating or freeing gwnums, so the arena counters are read under the lock.
+	arena_slack = 0;
+	if (!parent->information_only) {
+		gwmutex_lock (&parent->alloc_lock);
+		arena_slack = (unsigned long) (parent->arena_bytes - parent->arena_bytes_in_use);
+		gwmutex_unlock (&parent->alloc_lock);
+	}
+
+	if (!gwdata->GENERAL_MMGW_MOD) return (gwdata->mem_needed + gwdata->SCRATCH_SIZE + arena_slack);
+	return (gwmemused (gwdata->cyclic_gwdata) + gwmemused (gwdata->negacyclic_gwdata) + arena_slack);
 }
 
 /* Get the amount of memory likely to be allocated for a gwnum.  Looking at the code for aligned_offset_malloc this includes FFT data, header, */
@@ -8284,6 +8923,9 @@ void gwfft_description (
 
 	if (gw_using_large_pages (gwdata))
 		strcat (buf, " using large pages");
+
+	if (gwdata->numa_node >= 0 || fft_gwdata->numa_node >= 0)
+		sprintf (buf + strlen (buf), " on NUMA node %d", gwdata->numa_node >= 0 ? gwdata->numa_node : fft_gwdata->numa_node);
 }
 
 /* Return a string representation of a k/b/n/c combination */
@@ -9290,6 +9932,297 @@ void binarylongstogw (
 	gianttogw (gwdata, &tmp, n);
 }
 
+/* Multithreaded conversions between giants and base-2 gwnums.  The FFT words are split into blocks that the main thread and the auxiliary */
+/* threads convert independently, ignoring the carry coming in from the previous block.  A quick single-threaded fix-up pass then adds each */
+/* block's outgoing carry into the following block. */
+
+#define MT_CONVERSION_MIN_FFTLEN	65536		/* Smaller conversions are not worth waking up the auxiliary threads */
+#define MT_CONVERSION_BLOCKS_PER_THREAD	4		/* More blocks than threads helps balance the load */
+
+struct multithread_conv_data {
+	void	(*proc)(gwhandle *, struct multithread_conv_data *, int); /* Routine to convert one block */
+	gwnum	g;			/* The gwnum to read (gwtogiant) or write (gianttogw) */
+	giant	a;			/* The giant to convert (gianttogw only) */
+	uint32_t *words;		/* Binary output before the fix-up pass (gwtogiant only) */
+	unsigned long limit;		/* Number of FFT words that contain data */
+	int	num_blks;		/* Number of blocks to process */
+	int64_t	*carries;		/* Carry out of each block */
+	unsigned long *blk_start;	/* First FFT word of each block.  There are num_blks+1 entries. */
+	int	*err_codes;		/* Error code for each block (gwtogiant only) */
+};
+
+/* Return TRUE if a conversion is large enough to use the auxiliary threads */
+
+static __inline int use_multithreaded_conversion (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	unsigned long num_words)	/* Number of FFT words to convert */
+{
+	return (gwdata->num_threads > 1 && !gwdata->single_threaded_conversions && gwdata->b == 2 && !gwdata->GENERAL_MOD &&
+		gwdata->NUM_B_PER_SMALL_WORD >= 2 && num_words >= MT_CONVERSION_MIN_FFTLEN);
+}
+
+/* Allocate the per-block arrays and split the FFT words into blocks.  Returns FALSE if memory could not be allocated. */
+
+int multithread_conv_init (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	struct multithread_conv_data *data,
+	unsigned long num_words)	/* Number of FFT words to split into blocks */
+{
+	int	i;
+
+	data->num_blks = gwdata->num_threads * MT_CONVERSION_BLOCKS_PER_THREAD;
+	data->carries = (int64_t *) malloc (data->num_blks * sizeof (int64_t) + (data->num_blks + 1) * sizeof (unsigned long) + data->num_blks * sizeof (int));
+	if (data->carries == NULL) return (FALSE);
+	data->blk_start = (unsigned long *) (data->carries + data->num_blks);
+	data->err_codes = (int *) (data->blk_start + data->num_blks + 1);
+
+	// Start each block on a multiple of 64 FFT words
+	for (i = 0; i < data->num_blks; i++) data->blk_start[i] = (unsigned long) ((uint64_t) num_words * i / data->num_blks) & ~63UL;
+	data->blk_start[data->num_blks] = num_words;
+	for (i = 0; i < data->num_blks; i++) data->err_codes[i] = 0;
+	return (TRUE);
+}
+
+/* Have the main thread and the auxiliary threads convert all the blocks */
+
+void multithread_conv (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	struct multithread_conv_data *data)
+{
+
+/* Wake up the auxiliary threads */
+
+	gwdata->pass1_state = PASS1_STATE_MULTITHREAD_CONV;
+	gwdata->multithread_op_data = data;
+	atomic_set (gwdata->next_block, 0);
+	signal_auxiliary_threads (gwdata);
+
+/* Call subroutine to work on blocks just like the auxiliary threads */
+
+	do_multithread_conv_work (gwdata);
+
+/* Wait for auxiliary threads to finish */
+
+	wait_on_auxiliary_threads (gwdata);
+}
+
+/* Routine for the main thread and auxiliary threads to do gwtogiant/gianttogw work */
+
+void do_multithread_conv_work (
+	gwhandle *gwdata)		/* Handle initialized by gwsetup */
+{
+	struct multithread_conv_data *data = (struct multithread_conv_data *) gwdata->multithread_op_data;
+
+	for ( ; ; ) {
+		int i = (int) atomic_fetch_incr (gwdata->next_block);
+		if (i >= data->num_blks) break;
+		(*data->proc) (gwdata, data, i);
+	}
+}
+
+/* Convert one block of a giant to FFT words.  This is the same algorithm as the single-threaded gianttogw code except that the carry */
+/* is kept separate from the input bits so that the carry into the next block can be handed to the fix-up pass. */
+
+void gianttogw_block (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	struct multithread_conv_data *data,
+	int	blk)			/* Block to convert */
+{
+	giant	a = data->a;
+	unsigned long start = data->blk_start[blk];
+	unsigned long end = data->blk_start[blk+1];
+	unsigned long base = gwfft_base (gwdata->dd_data, start);
+	int	bits, accumbits, e1len;
+	uint32_t *e1;
+	uint64_t accum;
+	int64_t	value, carry;
+	gwiter	iter;
+
+	if (start >= end) {
+		data->carries[blk] = 0;
+		return;
+	}
+
+/* Load the input bits starting with this block's first bit */
+
+	e1len = abs (a->sign) - (int) (base >> 5);
+	e1 = a->n + (base >> 5);
+	accum = 0;
+	if (e1len > 0) accum = *e1 >> (base & 31), e1++, e1len--;
+	accumbits = 32 - (int) (base & 31);
+
+	carry = 0;
+	for (gwiter_init (gwdata, &iter, data->g, start); gwiter_index (&iter) < end; gwiter_next (&iter)) {
+
+		// Zero the FFT words above the converted value
+		if (gwiter_index (&iter) >= data->limit) {
+			gwiter_set_fft_value (&iter, 0);
+			continue;
+		}
+
+		// If needed, add another 32 input bits to accumulator
+		if (accumbits < 28) {
+			if (e1len > 0) accum += ((uint64_t) *e1) << accumbits, e1++, e1len--;
+			accumbits += 32;
+		}
+
+		// Process top word without a balanced representation, otherwise make the value balanced and carry one into the next word
+		if (gwiter_index (&iter) == data->limit - 1) {
+			value = (int32_t) (uint32_t) ((int64_t) (accum & 0xFFFFFFFF) + carry);
+			carry = 0;
+		} else {
+			bits = gwdata->NUM_B_PER_SMALL_WORD;
+			if (gwiter_is_big_word (&iter)) bits++;
+			value = (int64_t) (accum & ((1ULL << bits) - 1)) + carry;
+			carry = 0;
+			if (value >= ((int64_t) 1 << (bits - 1))) value -= (int64_t) 1 << bits, carry = 1;
+			accum >>= bits;
+			accumbits -= bits;
+		}
+		gwiter_set_fft_value (&iter, (int32_t) (a->sign > 0 ? value : -value));
+	}
+	data->carries[blk] = carry;
+}
+
+/* Convert a positive or negative base-2 giant to gwnum FFT format using the auxiliary threads.  Returns FALSE if memory could not be */
+/* allocated, in which case the caller must use the single-threaded code. */
+
+int multithreaded_gianttogw (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	giant	a,
+	gwnum	g,
+	unsigned long limit)		/* Number of FFT words needed to hold the giant */
+{
+	struct multithread_conv_data data;
+	int64_t	carry;
+	int	i;
+
+	if (!multithread_conv_init (gwdata, &data, gwdata->FFTLEN)) return (FALSE);
+	data.proc = &gianttogw_block;
+	data.a = a;
+	data.g = g;
+	data.limit = limit;
+	FFT_state (g) = NOT_FFTed;	// Prevent unfft of g by the gwiter_init calls in the compute threads
+	multithread_conv (gwdata, &data);
+
+/* Fix-up pass.  Add the carry out of each block into the next block.  The carry stops rippling at the first FFT word that does not overflow. */
+
+	carry = 0;
+	for (i = 0; i < data.num_blks; i++) {
+		unsigned long j;
+		for (j = data.blk_start[i]; carry && j < data.blk_start[i+1] && j < limit; j++) {
+			long	value;
+			get_fft_value (gwdata, g, j, &value);
+			if (a->sign < 0) value = -value;
+			value += (long) carry;
+			carry = 0;
+			if (j != limit - 1) {
+				int bits = gwdata->NUM_B_PER_SMALL_WORD;
+				if (is_big_word (gwdata, j)) bits++;
+				if (value >= (1L << (bits - 1))) value -= 1L << bits, carry = 1;
+			}
+			set_fft_value (gwdata, g, j, a->sign > 0 ? value : -value);
+		}
+		carry += data.carries[i];
+	}
+
+	free (data.carries);
+	return (TRUE);
+}
+
+/* Convert one block of FFT words to binary.  This is the same algorithm as the single-threaded gwtogiant code.  The output bits below the */
+/* block's first FFT word are left as zero and the signed bits left over at the end of the block are handed to the fix-up pass. */
+
+void gwtogiant_block (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	struct multithread_conv_data *data,
+	int	blk)			/* Block to convert */
+{
+	unsigned long start = data->blk_start[blk];
+	unsigned long end = data->blk_start[blk+1];
+	unsigned long base = gwfft_base (gwdata->dd_data, start);
+	uint32_t *outptr = data->words + (base >> 5);
+	int64_t	accum;
+	int32_t	val;
+	int	bits, accumbits, err_code;
+	gwiter	iter;
+
+	accum = 0;
+	accumbits = (int) (base & 31);
+	err_code = 0;
+	if (start < end) for (gwiter_init (gwdata, &iter, data->g, start); gwiter_index (&iter) < end; gwiter_next (&iter)) {
+		err_code = gwiter_get_fft_value (&iter, &val);
+		if (err_code) break;
+		bits = gwdata->NUM_B_PER_SMALL_WORD;
+		if (gwiter_is_big_word (&iter)) bits++;
+		accum += ((int64_t) val) << accumbits;
+		accumbits += bits;
+		// See if we have 32-bits to output
+		if (accumbits >= 32) {
+			*outptr++ = (uint32_t) accum;
+			accum >>= 32;
+			accumbits -= 32;
+		}
+	}
+	data->carries[blk] = accum;
+	data->err_codes[blk] = err_code;
+}
+
+/* Convert the first limit FFT words of a base-2 gwnum to binary using the auxiliary threads.  Returns an allocated array of 32-bit words */
+/* and the signed carry out of the top word, or NULL if the caller must use the single-threaded code.  The caller must free the array. */
+
+uint32_t *multithreaded_gwtogiant (
+	gwhandle *gwdata,		/* Handle initialized by gwsetup */
+	gwnum	gg,
+	unsigned long limit,		/* Number of FFT words to convert */
+	unsigned long *num_words,	/* Returned number of 32-bit words */
+	int64_t	*top_carry,		/* Returned carry out of the top word */
+	int	*err_code)		/* Returned error code */
+{
+	struct multithread_conv_data data;
+	uint32_t *words;
+	unsigned long len;
+	int	i;
+
+	*err_code = 0;
+	len = gwfft_base (gwdata->dd_data, limit) >> 5;
+	words = (uint32_t *) calloc (len + 1, sizeof (uint32_t));
+	if (words == NULL) return (NULL);
+	if (!multithread_conv_init (gwdata, &data, limit)) {
+		free (words);
+		return (NULL);
+	}
+	data.proc = &gwtogiant_block;
+	data.g = gg;
+	data.words = words;
+	data.limit = limit;
+	multithread_conv (gwdata, &data);
+
+/* Fix-up pass.  Add each block's left over bits into the words output by the following blocks.  Whatever carries out of the top word */
+/* is returned to the caller. */
+
+	*top_carry = 0;
+	for (i = 0; i < data.num_blks; i++) {
+		unsigned long j;
+		int64_t carry = data.carries[i];
+		if (data.err_codes[i]) *err_code = data.err_codes[i];
+		for (j = gwfft_base (gwdata->dd_data, data.blk_start[i+1]) >> 5; carry && j < len; j++) {
+			int64_t tmp = (int64_t) words[j] + carry;
+			words[j] = (uint32_t) tmp;
+			carry = tmp >> 32;
+		}
+		*top_carry += carry;
+	}
+
+	free (data.carries);
+	if (*err_code) {
+		free (words);
+		return (NULL);
+	}
+	*num_words = len;
+	return (words);
+}
+
 /* Convert a giant to gwnum FFT format */
 
 void gianttogw (
@@ -9478,39 +10411,42 @@ void gianttogw (
 			if (limit > gwdata->FFTLEN) limit = gwdata->FFTLEN;
 			if (gwdata->ZERO_PADDED_FFT && limit > gwdata->FFTLEN / 2 + 4) limit = gwdata->FFTLEN / 2 + 4;
 
-			e1len = abs (a->sign);
-			e1 = a->n;
+			// Large numbers are converted using the auxiliary threads
+			if (!use_multithreaded_conversion (gwdata, gwdata->FFTLEN) || !multithreaded_gianttogw (gwdata, a, g, limit)) {
+				e1len = abs (a->sign);
+				e1 = a->n;
 
-			bits1 = gwdata->NUM_B_PER_SMALL_WORD;
-			bits2 = bits1 + 1;
+				bits1 = gwdata->NUM_B_PER_SMALL_WORD;
+				bits2 = bits1 + 1;
 
-			accum = 0;
-			accumbits = 0;
+				accum = 0;
+				accumbits = 0;
 
-			gwiter iter;
-			for (gwiter_init_write_only (gwdata, &iter, g); gwiter_index (&iter) < limit; gwiter_next (&iter)) {
+				gwiter iter;
+				for (gwiter_init_write_only (gwdata, &iter, g); gwiter_index (&iter) < limit; gwiter_next (&iter)) {
 
-				// If needed, add another 32 input bits to accumulator
-				if (accumbits < 28) {
-					if (e1len > 0) {
-						if (a->sign > 0) accum += ((int64_t) *e1) << accumbits;
-						else accum -= ((int64_t) *e1) << accumbits;
-						e1++, e1len--;
+					// If needed, add another 32 input bits to accumulator
+					if (accumbits < 28) {
+						if (e1len > 0) {
+							if (a->sign > 0) accum += ((int64_t) *e1) << accumbits;
+							else accum -= ((int64_t) *e1) << accumbits;
+							e1++, e1len--;
+						}
+						accumbits += 32;
 					}
-					accumbits += 32;
+
+					// Process top word without sign extension, otherwise grab bits with sign extension.
+					// Special case zero bits as shift left 64 may be undefined.
+					bits = (gwiter_index (&iter) == limit - 1) ? 32 : gwiter_is_big_word (&iter) ? bits2 : bits1;
+					value = bits ? (accum << (64 - bits)) >> (64 - bits) : 0;
+					gwiter_set_fft_value (&iter, (int32_t) value);
+					accum = (accum - value) >> bits;
+					accumbits -= bits;
 				}
 
-				// Process top word without sign extension, otherwise grab bits with sign extension.
-				// Special case zero bits as shift left 64 may be undefined.
-				bits = (gwiter_index (&iter) == limit - 1) ? 32 : gwiter_is_big_word (&iter) ? bits2 : bits1;
-				value = bits ? (accum << (64 - bits)) >> (64 - bits) : 0;
-				gwiter_set_fft_value (&iter, (int32_t) value);
-				accum = (accum - value) >> bits;
-				accumbits -= bits;
+				// Clear the upper words
+				for ( ; gwiter_index (&iter) < gwdata->FFTLEN; gwiter_next (&iter)) gwiter_set_fft_value (&iter, 0);
 			}
-
-			// Clear the upper words
-			for ( ; gwiter_index (&iter) < gwdata->FFTLEN; gwiter_next (&iter)) gwiter_set_fft_value (&iter, 0);
 		}
 
 /* Otherwise (non-base 2), we do a recursive divide and conquer radix conversion. */
@@ -9704,6 +10640,8 @@ int gwtogiant (
 		giant	outgiant;
 		uint32_t *outptr, *outptr_end, outval;
 		uint64_t outcarry;
+		uint32_t *mt_words;					// Binary words output by the auxiliary threads
+		unsigned long mt_num_words, mt_index;
 		uint32_t n_split;					// n at which we should switch output to upper
 		stackgiant(upper,5);					// Upper bits shouldn't be much more than k^2 (100 bits)
 
@@ -9716,24 +10654,40 @@ int gwtogiant (
 		outptr = v->n;
 		n_split = modulus != NULL ? modulus->sign * 32 : gwdata->n;
 		outptr_end = outptr + divide_rounding_up (n_split, 32);
-		for (gwiter_init_zero (gwdata, &iter, gg); ; ) {
-			// Process next FFT word
-			if (gwiter_index (&iter) < limit) {
-				err_code = gwiter_get_fft_value (&iter, &val);
-				if (err_code) return (err_code);
-				bits = gwdata->NUM_B_PER_SMALL_WORD;
-				if (gwiter_is_big_word (&iter)) bits++;
-				accum += ((int64_t) val) << accumbits;
-				accumbits += bits;
-				gwiter_next (&iter);
-				// See if we have 32-bits to output
-				if (accumbits < 32) continue;
-			}
 
-			// Extract the 32 output bits
-			outval = (uint32_t) accum;
-			accum >>= 32;
-			accumbits -= 32;
+/* Large numbers are converted to binary using the auxiliary threads.  The multiplication by k and the splitting are done below. */
+
+		mt_words = NULL;
+		if (use_multithreaded_conversion (gwdata, limit)) {
+			mt_words = multithreaded_gwtogiant (gwdata, gg, limit, &mt_num_words, &accum, &err_code);
+			if (err_code) return (err_code);
+			mt_index = 0;
+		}
+		if (mt_words == NULL) gwiter_init_zero (gwdata, &iter, gg);
+
+		for ( ; ; ) {
+			// Grab the next 32 bits converted by the auxiliary threads
+			if (mt_words != NULL && mt_index < mt_num_words) outval = mt_words[mt_index++];
+
+			else {
+				// Process next FFT word
+				if (mt_words == NULL && gwiter_index (&iter) < limit) {
+					err_code = gwiter_get_fft_value (&iter, &val);
+					if (err_code) return (err_code);
+					bits = gwdata->NUM_B_PER_SMALL_WORD;
+					if (gwiter_is_big_word (&iter)) bits++;
+					accum += ((int64_t) val) << accumbits;
+					accumbits += bits;
+					gwiter_next (&iter);
+					// See if we have 32-bits to output
+					if (accumbits < 32) continue;
+				}
+
+				// Extract the 32 output bits
+				outval = (uint32_t) accum;
+				accum >>= 32;
+				accumbits -= 32;
+			}
 
 			// Now mul by k
 			if (!k_is_one) {
@@ -9766,6 +10720,7 @@ int gwtogiant (
 				outptr_end = outptr + (k_is_one ? 2 : k_is_small ? 3 : 5);
 			}
 		}
+		free (mt_words);
 
 /* Combine upper and lower to later apply the modulus.  Use the caller's buffer if we can. */
 		
@@ -38,6 +38,7 @@ extern "C" {
 /* To support multithreading, callers of the gwnum routines must allocate a gwhandle (on the heap or stack) and pass it to */
 /* all gwnum routines.  gwinit and gwsetup fill this structure up with lots of data that used to be stored in global variables. */
 typedef struct gwhandle_struct gwhandle;
+struct gwarena_slab;
 
 /* The gwnum data type.  A gwnum points to an array of doubles - the FFT data.  In practice, there is */
 /* data stored before the doubles.  See the internals section below if you really must know. */
@@ -142,6 +143,27 @@ void gwdone (
 #define gwset_thread_callback(h,n)		((h)->thread_callback = n)
 #define gwset_thread_callback_data(h,d)		((h)->thread_callback_data = d)
 
+/* Prior to calling one of the gwsetup routines, you can set a NUMA memory placement policy.  The gwnum library knows nothing about the machine's */
+/* topology, so the user of the library supplies a callback routine that binds a block of newly allocated memory.  The callback must be declared as: */
+/*	int callback (void *addr, size_t size, void *data) */
+/* The routine should bind the memory to the NUMA node that owns the threads running this gwdata and return that node number (or -1 if the memory */
+/* was not bound).  Data is the thread_callback_data pointer.  With GWNUMA_LOCAL the sin/cos tables, carry sections, gwnums and gwnum arrays */
+/* are bound before they are first touched.  Only blocks of at least 1MB are bound and addr and size are always page aligned.  The binding should */
+/* be a preference rather than strict, so that a full node does not cause an out-of-memory error.  The chosen node is reported by gwfft_description. */
+#define GWNUMA_NONE		0	/* Default.  Let the OS place memory (usually on the node of the thread that first touches it). */
+#define GWNUMA_LOCAL		1	/* Bind memory to the NUMA node running the worker's threads */
+#define gwset_numa_policy(h,p)			((h)->numa_policy = p)
+#define gwset_numa_callback(h,n)		((h)->numa_callback = n)
+
+/* Prior to calling one of the gwsetup routines, you can name a directory where the library caches the FFT tables it builds.  Building the */
+/* weights, premultipliers and sin/cos tables of a large AVX-512 FFT can take seconds.  A later gwsetup of the same k,b,n,c on the same FFT */
+/* implementation reads the tables back from disk instead.  Cache files are validated with a checksum and are ignored if anything about */
+/* the FFT or the library version differs.  Only AVX-512 radix-4 DWPN FFTs of at least 64K are cached.  NULL (the default) disables the cache. */
+/* The pass 1 scratch area is not saved.  When the cache files total more than the maximum size (default 2GB), the least recently used */
+/* files are deleted. */
+void gwset_table_cache_dir (gwhandle *gwdata, const char *dir);
+void gwset_table_cache_max_size (gwhandle *gwdata, uint64_t max_size);
+
 /* Prior to calling one of the gwsetup routines, you can have the library play it safe" by reducing the maximum allowable bits */
 /* per FFT data word.  For example, the code normally tests a maximum of 22477 bits in a 1024 SSE2 FFT, or 21.95 bits per double. */
 /* If you set the safety margin to 0.5 then the code will only allow 21.45 bits per double, or a maximum of 21965 bits in a 1024 length FFT. */
@@ -212,6 +234,21 @@ void gwdone (
 /* running a program doing multithreaded gwnum work could see a benefit. */
 #define gwset_use_spin_wait(h,n)	((h)->use_spin_wait = (char) (n))
 
+/* By default gwtogiant and gianttogw spread the conversion of large base-2 numbers over the auxiliary compute threads.  Each thread converts */
+/* a block of FFT words, then a quick single-threaded fix-up pass propagates the carries between blocks.  This macro forces the old single-threaded */
+/* conversion code, which is mainly useful for QA and for timing the multithreaded code. */
+#define gwset_single_threaded_conversions(h,n)	((h)->single_threaded_conversions = (char) (n))
+
+/* By default a new gwnum is zeroed and all of a gwalloc_array is first touched by the thread calling gwalloc.  On a NUMA machine the first */
+/* thread to touch a page decides which node the page lives on.  This macro spreads the first touch of large allocations over the auxiliary */
+/* compute threads.  Each thread touches the slice of every gwnum it would process in a multithreaded FFT or polymult.  The gwnum NUMA */
+/* policy callback is not applied to these allocations.  Only gwallocs on the original (not cloned) gwhandle use the auxiliary threads. */
+#define gwset_parallel_first_touch(h)	((h)->parallel_first_touch = 1)
+
+/* Gwalloc zeroes each new gwnum.  If you know the gwnums you are about to allocate will be completely overwritten before they are read, */
+/* this macro lets you skip the zeroing.  Gwnums cached by gwfree are never zeroed. */
+#define gwset_skip_zeroing(h,n)		((h)->skip_zeroing = (char) (n))
+
 /* Prior to calling one of the gwsetup routines, you must tell the gwnum library if the polymult library will also be used.  Using polymult can affect */
 /* how much memory is allocated by each gwalloc call. */
 #define gwset_using_polymult(h)		((h)->polymult = TRUE)
@@ -1056,6 +1093,9 @@ struct gwhandle_struct {
 	char	use_spin_wait;		/* 0 = use mutex, 1 = spin wait, 2+ = ???.  Linus Torvalds hates spinning, see https://www.realworldtech.com/forum/?threadid=189711&curpostid=189723 */
 					/* GWNUM doesn't use a spin lock, rather it can spin wait for an atomic counter of active threads to reach zero. */
 					/* There is likely negligible difference between mutex wait and spin wait. */
+	char	parallel_first_touch;	/* Set if large allocations are first touched by the auxiliary threads */
+	char	skip_zeroing;		/* Set if gwalloc need not zero new gwnums */
+	char	single_threaded_conversions; /* Set if gwtogiant and gianttogw must not use the auxiliary threads */
 	unsigned char scramble_arrays;	/* 0 = no scramble (linear addresses), 1 = light scramble (the default), 2 = full scramble, 3+ = custom (see gwnum.c code) */
 					/* gwalloc_array can scramble allocated gwnums in memory.  Polymult on large polys may be faster with scrambling on. */
 	int	bench_num_cores;	/* Set to expected number of cores that will FFT (affects select fastest FFT implementation) */
@@ -1150,9 +1190,18 @@ struct gwhandle_struct {
 	char	*GW_BIGBUF;		/* Optional buffer to allocate gwnums in */
 	void	*large_pages_ptr;	/* Pointer to the large pages memory block we allocated. */
 	void	*large_pages_gwnum;	/* Pointer to the one large pages gwnum */
+	struct gwarena_slab *arena_slabs; /* Huge page slabs that large pages gwnums are carved out of */
+	unsigned int arena_num_slabs;	/* Number of huge page slabs */
+	size_t	arena_bytes;		/* Total size of the huge page slabs */
+	size_t	arena_bytes_in_use;	/* Bytes of the huge page slabs holding allocated gwnums */
 	void	(*thread_callback)(int, int, void *); /* Auxiliary thread callback routine letting */
 					/* the gwnum library user set auxiliary thread priority and affinity */
 	void	*thread_callback_data;	/* User-supplied data to pass to the auxiliary thread callback routine */
+	int	numa_policy;		/* NUMA memory placement policy (GWNUMA_NONE or GWNUMA_LOCAL) */
+	int	(*numa_callback)(void *, size_t, void *); /* User-supplied routine to bind memory to a NUMA node */
+	int	numa_node;		/* NUMA node the callback bound memory to, -1 if none */
+	char	*table_cache_dir;	/* Directory for the on-disk FFT table cache (NULL = no cache) */
+	uint64_t table_cache_max_size;	/* Maximum total bytes of FFT table cache files (0 = default) */
 	gwmutex alloc_lock;		/* Mutex to allow parent and clones to allocate/free gwnums in a thread-safe manner */
 	gwmutex	thread_lock;		/* This mutex limits one thread at a time in critical sections. */
 	gwevent	work_to_do;		/* Event (if not spin waiting) to signal auxiliary threads there is work to do */
@@ -1179,7 +1228,7 @@ struct gwhandle_struct {
 	void	**thread_allocs;	/* Array of ptrs to memory allocated for each auxiliary thread */
 	struct pass1_carry_sections *pass1_carry_sections; /* Array of pass1 sections for carry propagation */
 	int	pass1_carry_sections_unallocated; /* Count of auxiliary threads that have not yet been assigned block to work on */
-	void	*multithread_op_data;	/* Data shared amongst add/sub/addsub/smallmul compute threads */
+	void	*multithread_op_data;	/* Data shared amongst add/sub/addsub/smallmul and gwtogiant/gianttogw compute threads */
 	uint32_t ASM_TIMERS[32];	/* Internal timers used by me to optimize code */
 	int	bench_pick_nth_fft;	/* DO NOT set this variable.  Internal hack to force the FFT selection code to */
 					/* pick the n-th possible implementation instead of the best one.  The prime95 */
@@ -1226,6 +1275,7 @@ typedef struct {
 	gwarray *prev;		// Prev pointer in doubly linked list
 	gwarray next;		// Next pointer in doubly linked list
 } gwarray_header;
+#define GWARRAY_FILE_BACKED	0x10000000	/* Flag set if array was allocated using file_backed_malloc */
 
 /* Some mis-named #defines that describe the maximum Mersenne number exponent that the gwnum routines can process. */
 #define MAX_PRIME	79300000L	/* Maximum number of x87 bits */
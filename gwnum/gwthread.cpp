@@ -76,6 +76,27 @@ void	gwatomic_spinwait (gwatomic *x, int64_t val) {
 	}
 }
 
+// Unlike the other atomic routines, compare-and-exchange is sequentially consistent.  Callers use it to hand off
+// ownership of data between threads (e.g. lock-free work queues), so prior writes must be visible to the new owner.
+
+extern "C"
+int	gwatomic_compare_exchange (gwatomic *x, int64_t expected, int64_t val) {
+	return (cast_as_atomic_int(x)->compare_exchange_strong (expected, val, std::memory_order_seq_cst));
+}
+
+// Release/acquire store and load.  Used to publish a pointer to fully built read-only data (e.g. an INI file snapshot)
+// that other threads then read without taking a lock.
+
+extern "C"
+void	gwatomic_set_release (gwatomic *x, int64_t val) {
+	cast_as_atomic_int(x)->store (val, std::memory_order_release);
+}
+
+extern "C"
+int64_t	gwatomic_get_acquire (gwatomic *x) {
+	return (cast_as_atomic_int(x)->load (std::memory_order_acquire));
+}
+
 
 
 /******************************************************************************
@@ -43,6 +43,9 @@ typedef int64_t gwatomic;	/* Definition of an atomic int */
 #define atomic_decr_fetch(x)	(gwatomic_fetch_decrement(&(x)) - 1)		// Equivalent to --x
 #define atomic_fetch_addin(x,v)	(gwatomic_fetch_add(&(x), v))			// Equivalent to { tmp = x; x += v; return (x); }
 #define atomic_spinwait(x,v)	gwatomic_spinwait(&(x), v)			// Equivalent to while (x != v)
+#define atomic_compare_exchange(x,e,v) gwatomic_compare_exchange(&(x), e, v)	// Equivalent to { if (x != e) return (FALSE); x = v; return (TRUE); }
+#define atomic_set_release(x,v)	gwatomic_set_release(&(x), v)			// Equivalent to x = v, prior writes are visible to an acquiring reader
+#define atomic_get_acquire(x)	gwatomic_get_acquire(&(x))			// Equivalent to x, sees all writes made before the releasing store
 
 void gwatomic_set (gwatomic *x, int64_t val);
 int64_t gwatomic_get (gwatomic *x);
@@ -50,6 +53,9 @@ int64_t gwatomic_fetch_increment (gwatomic *x);
 int64_t gwatomic_fetch_decrement (gwatomic *x);
 int64_t gwatomic_fetch_add (gwatomic *x, int64_t val);
 void gwatomic_spinwait (gwatomic *x, int64_t val);
+int gwatomic_compare_exchange (gwatomic *x, int64_t expected, int64_t val);
+void gwatomic_set_release (gwatomic *x, int64_t val);
+int64_t gwatomic_get_acquire (gwatomic *x);
 
 /******************************************************************************
 *                         Mutex and Events Routines                           *
@@ -12,14 +12,21 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
+#include <time.h>
 #ifdef _WIN32
 #include "windows.h"
 #endif
 #include <stdlib.h>
+#include <stdio.h>
 #if defined (__linux__) || defined (__HAIKU__)
 #include <malloc.h>
 #include <sys/mman.h>
 #endif
+#if defined (__linux__) || defined (__APPLE__) || defined (__FreeBSD__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+#endif
 #if defined (__APPLE__)
 #include <sys/mman.h>
 #include <mach/vm_statistics.h>
@@ -27,6 +34,15 @@
 #if defined (__FreeBSD__)
 #include <sys/mman.h>
 #endif
+#ifdef _WIN32
+#include <process.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#endif
 #include "gwcommon.h"
 #include "gwutil.h"
 
@@ -72,7 +88,7 @@ void aligned_free (
 //           Large/Huge/Super Page routines
 //*******************************************************
 
-#define TWO_MEGABYTES	2*1024*1024
+#define TWO_MEGABYTES	(2*1024*1024)
 
 static int large_pages_are_supported = 0;
 #if defined (_WIN32)
@@ -247,6 +263,309 @@ void aligned_large_pages_free (
 	large_pages_free (* (void **) ((char *) ptr - sizeof (void *)));
 }
 
+/* Allocate a block of memory that the OS is asked to back with transparent huge pages.  This is a fallback for when no */
+/* huge pages have been reserved for large_pages_malloc.  The block is 2MB aligned so that it can be backed entirely */
+/* by huge pages.  Free the block with large_pages_free. */
+
+void * thp_malloc (
+	size_t	size)
+{
+#if defined (__linux__) && defined (MADV_HUGEPAGE)
+	char	*p, *aligned;
+	uint64_t *q;
+
+// Like large_pages_malloc, allocate an extra 4KB and write the length before the returned address.  Map an extra 2MB
+// so that we can trim the mapping to a 2MB boundary.
+
+	size = round_up_to_multiple_of (size + 4096, TWO_MEGABYTES);
+	p = (char *) mmap (NULL, size + TWO_MEGABYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) return (NULL);
+	aligned = (char *) round_up_to_multiple_of ((intptr_t) p, TWO_MEGABYTES);
+	if (aligned != p) munmap (p, aligned - p);
+	munmap (aligned + size, p + TWO_MEGABYTES - aligned);
+	madvise (aligned, size, MADV_HUGEPAGE);
+
+	q = (uint64_t *) aligned;
+	*q++ = size;
+	return (q);
+#else
+	return (NULL);
+#endif
+}
+
+/* File-backed memory.  The memory is a shared mapping of a temporary file that is deleted when the memory is freed.  The OS writes pages */
+/* to disk and reads them back as needed, letting a program work on data larger than physical memory.  The file's disk blocks are allocated */
+/* up front.  A sparse file would raise SIGBUS (or an access violation) when the disk fills up. */
+
+#define FILE_BACKED_DISK_RESERVE	(100 << 20)	// Leave at least 100MB free on the disk for save files and the like
+
+void * file_backed_malloc (
+	size_t	size,
+	const char *dir)		// Directory for the temporary file (NULL means the current directory)
+{
+	char	*p;
+
+// We need to write the length (and on Windows the handles) before the returned address for free to work.  Use 64 bytes to keep
+// the returned address 64-byte aligned.
+
+	size += 64;
+
+// Create the temporary file and map it into memory
+
+#ifdef _WIN32
+	{
+	char	filename[MAX_PATH];
+	HANDLE	hFile, hMap;
+	ULARGE_INTEGER free_bytes;
+	if (!GetDiskFreeSpaceExA (dir != NULL ? dir : ".", &free_bytes, NULL, NULL) || free_bytes.QuadPart < (uint64_t) size + FILE_BACKED_DISK_RESERVE) return (NULL);
+	if (!GetTempFileNameA (dir != NULL ? dir : ".", "gwf", 0, filename)) return (NULL);
+	hFile = CreateFileA (filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		DeleteFileA (filename);
+		return (NULL);
+	}
+	hMap = CreateFileMappingA (hFile, NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32), (DWORD) size, NULL);
+	if (hMap == NULL) {
+		CloseHandle (hFile);
+		return (NULL);
+	}
+	p = (char *) MapViewOfFile (hMap, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (p == NULL) {
+		CloseHandle (hMap);
+		CloseHandle (hFile);
+		return (NULL);
+	}
+	* (HANDLE *) (p + 8) = hMap;
+	* (HANDLE *) (p + 16) = hFile;
+	}
+#elif defined (__linux__) || defined (__APPLE__) || defined (__FreeBSD__)
+	{
+	char	filename[1024];
+	struct statvfs fs;
+	int	fd, err;
+	if (statvfs (dir != NULL ? dir : ".", &fs) != 0 || (uint64_t) fs.f_bavail * fs.f_frsize < (uint64_t) size + FILE_BACKED_DISK_RESERVE) return (NULL);
+	if (snprintf (filename, sizeof (filename), "%s/gwfXXXXXX", dir != NULL ? dir : ".") >= (int) sizeof (filename)) return (NULL);
+	fd = mkstemp (filename);
+	if (fd < 0) return (NULL);
+	unlink (filename);		// The disk space is released when the mapping is removed
+#if defined (__APPLE__)
+	{
+	fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t) size, 0};
+	err = (fcntl (fd, F_PREALLOCATE, &store) == -1);
+	if (err) {
+		store.fst_flags = F_ALLOCATEALL;
+		err = (fcntl (fd, F_PREALLOCATE, &store) == -1);
+	}
+	if (!err) err = ftruncate (fd, (off_t) size);
+	}
+#else
+	err = posix_fallocate (fd, 0, (off_t) size);	// Reserve the disk blocks now
+#endif
+	if (err) {
+		close (fd);
+		return (NULL);
+	}
+	p = (char *) mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+	if (p == MAP_FAILED) return (NULL);
+	}
+#else
+	return (NULL);
+#endif
+
+// Write the length before the pointer we are returning
+
+	* (uint64_t *) p = size;
+	return (p + 64);
+}
+
+void file_backed_free (
+	void	*ptr)
+{
+	char	*p;
+
+// Ignore NULL frees
+
+	if (ptr == NULL) return;
+
+// Unmap the memory.  This deletes the temporary file.
+
+	p = (char *) ptr - 64;
+#ifdef _WIN32
+	{
+	HANDLE	hMap = * (HANDLE *) (p + 8);
+	HANDLE	hFile = * (HANDLE *) (p + 16);
+	UnmapViewOfFile (p);
+	CloseHandle (hMap);
+	CloseHandle (hFile);
+	}
+#elif defined (__linux__) || defined (__APPLE__) || defined (__FreeBSD__)
+	munmap (p, (size_t) * (uint64_t *) p);
+#endif
+}
+
+//*******************************************************
+//       Routines to manage a directory of cache files
+//*******************************************************
+
+/* Return the process ID, used to make temporary file names unique */
+
+unsigned long process_id (void)
+{
+#ifdef _WIN32
+	return ((unsigned long) _getpid ());
+#else
+	return ((unsigned long) getpid ());
+#endif
+}
+
+/* Mark a cache file as recently used by updating its modification time */
+
+void touch_file (
+	const char *filename)
+{
+#ifdef _WIN32
+	_utime (filename, NULL);
+#else
+	utime (filename, NULL);
+#endif
+}
+
+/* Delete the least recently modified files in a directory whose names start with prefix and end with suffix, until the matching files */
+/* use no more than max_bytes.  Also delete temporary files, named with suffix followed by a period and anything else, that were last */
+/* modified more than temp_age seconds ago.  These are left behind when a process dies while writing a cache file.  Errors are ignored. */
+
+struct trim_file_info {
+	char	*name;
+	uint64_t size;
+	time_t	mtime;
+	int	temp;			/* TRUE if this is a temporary file */
+};
+
+/* Return 0 if name does not match, 1 for a cache file, 2 for a temporary cache file */
+
+static int trim_name_match (
+	const char *name,
+	const char *prefix,
+	const char *suffix)
+{
+	size_t	nlen = strlen (name), plen = strlen (prefix), slen = strlen (suffix);
+	const char *p;
+
+	if (nlen < plen + slen || memcmp (name, prefix, plen)) return (0);
+	if (strcmp (name + nlen - slen, suffix) == 0) return (1);
+	for (p = name + plen; (p = strstr (p, suffix)) != NULL; p++)
+		if (p[slen] == '.') return (2);
+	return (0);
+}
+
+static int trim_file_compare (const void *a, const void *b)
+{
+	time_t	ta = ((const struct trim_file_info *) a)->mtime;
+	time_t	tb = ((const struct trim_file_info *) b)->mtime;
+	return (ta < tb ? -1 : ta > tb ? 1 : 0);
+}
+
+void trim_directory_files (
+	const char *dir,
+	const char *prefix,
+	const char *suffix,
+	uint64_t max_bytes,
+	int	temp_age)
+{
+	struct trim_file_info *files = NULL;
+	size_t	num_files = 0, array_size = 0, i, dirlen = strlen (dir);
+	uint64_t total = 0;
+	time_t	now = time (NULL);
+	char	path[1024];
+
+	if (dirlen + 2 >= sizeof (path)) return;
+
+/* Collect the name, size, and modification time of each matching file */
+
+#ifdef _WIN32
+	{
+	WIN32_FIND_DATAA fd;
+	HANDLE	h;
+	int	match;
+	snprintf (path, sizeof (path), "%s/%s*%s*", dir, prefix, suffix);
+	h = FindFirstFileA (path, &fd);
+	if (h == INVALID_HANDLE_VALUE) return;
+	do {
+		ULARGE_INTEGER t;
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+		match = trim_name_match (fd.cFileName, prefix, suffix);
+		if (match == 0) continue;
+		if (num_files == array_size) {
+			struct trim_file_info *newfiles = (struct trim_file_info *) realloc (files, (array_size + 100) * sizeof (struct trim_file_info));
+			if (newfiles == NULL) break;
+			files = newfiles;
+			array_size += 100;
+		}
+		t.LowPart = fd.ftLastWriteTime.dwLowDateTime;
+		t.HighPart = fd.ftLastWriteTime.dwHighDateTime;
+		files[num_files].name = _strdup (fd.cFileName);
+		files[num_files].size = ((uint64_t) fd.nFileSizeHigh << 32) + fd.nFileSizeLow;
+		files[num_files].mtime = (time_t) (t.QuadPart / 10000000 - 11644473600ULL);
+		files[num_files].temp = (match == 2);
+		if (files[num_files].name == NULL) break;
+		if (match == 1) total += files[num_files].size;
+		num_files++;
+	} while (FindNextFileA (h, &fd));
+	FindClose (h);
+	}
+#else
+	{
+	DIR	*d;
+	struct dirent *de;
+	struct stat st;
+	int	match;
+	d = opendir (dir);
+	if (d == NULL) return;
+	while ((de = readdir (d)) != NULL) {
+		match = trim_name_match (de->d_name, prefix, suffix);
+		if (match == 0) continue;
+		if (snprintf (path, sizeof (path), "%s/%s", dir, de->d_name) >= (int) sizeof (path)) continue;
+		if (stat (path, &st) != 0 || !S_ISREG (st.st_mode)) continue;
+		if (num_files == array_size) {
+			struct trim_file_info *newfiles = (struct trim_file_info *) realloc (files, (array_size + 100) * sizeof (struct trim_file_info));
+			if (newfiles == NULL) break;
+			files = newfiles;
+			array_size += 100;
+		}
+		files[num_files].name = strdup (de->d_name);
+		files[num_files].size = (uint64_t) st.st_size;
+		files[num_files].mtime = st.st_mtime;
+		files[num_files].temp = (match == 2);
+		if (files[num_files].name == NULL) break;
+		if (match == 1) total += files[num_files].size;
+		num_files++;
+	}
+	closedir (d);
+	}
+#endif
+
+/* Delete stale temporary files.  A recent one may still be being written by another thread or process. */
+
+	for (i = 0; i < num_files; i++) {
+		if (!files[i].temp || now - files[i].mtime <= temp_age) continue;
+		if (snprintf (path, sizeof (path), "%s/%s", dir, files[i].name) >= (int) sizeof (path)) continue;
+		remove (path);
+	}
+
+/* Delete the oldest files until we are under the limit */
+
+	if (total > max_bytes) {
+		qsort (files, num_files, sizeof (struct trim_file_info), trim_file_compare);
+		for (i = 0; i < num_files && total > max_bytes; i++) {
+			if (files[i].temp) continue;
+			if (snprintf (path, sizeof (path), "%s/%s", dir, files[i].name) >= (int) sizeof (path)) continue;
+			if (remove (path) == 0) total -= files[i].size;
+		}
+	}
+	for (i = 0; i < num_files; i++) free (files[i].name);
+	free (files);
+}
 
 //*******************************************************
 //       Utility routines used in copying strings
@@ -59,6 +59,18 @@ void large_pages_free (void *ptr);
 void * aligned_offset_large_pages_malloc (size_t size, size_t alignment, size_t mod);
 void * aligned_large_pages_malloc (size_t size, size_t alignment);
 void aligned_large_pages_free (void *ptr);
+void * thp_malloc (size_t size);
+
+/* File-backed memory routines.  Memory is backed by a temporary file in the given directory rather than the swap file. */
+
+void * file_backed_malloc (size_t size, const char *dir);
+void file_backed_free (void *ptr);
+
+/* Routines to manage a directory of cache files */
+
+unsigned long process_id (void);
+void touch_file (const char *filename);
+void trim_directory_files (const char *dir, const char *prefix, const char *suffix, uint64_t max_bytes, int temp_age);
 
 /* Utility string routines */
 
@@ -150,6 +150,7 @@ typedef struct {
 		uint64_t LSWs_skipped;		// Least significant coefficients that do not need to be returned
 		uint64_t MSWs_skipped;		// Most significant coefficients (of true_outvec_size) that do not need to be returned
 		int64_t addin[4];		// Outvec locations where four 1*1 values may need to be added at the very end of the polymult process
+		int64_t addin_probe[4];		// Outvec locations of the 1*1 values before checking for NULL outvec entries (validates a cached plan)
 		int64_t subout;			// Outvec location where 1*1 value may need to be subtracted at the very end of the polymult process
 		int	adjusted_shift;		// Number of coefficients to shift left the initial partial poly multiplication to reach true_outvec_size
 		int	adjusted_pad;		// Number of coefficients to pad on the left of the initial partial poly multiplication to reach true_outvec_size
@@ -157,6 +158,20 @@ typedef struct {
 	} planpart[1];
 } polymult_plan;
 
+// Internal description of a cached plan.  The key captures everything polymult_several's planning depends on other than the NULL entries in each outvec.
+// The NULL entries are checked using the planparts' addin_probe values.
+typedef struct {
+	uint64_t hash;			// Hash of the key for quick rejection
+	uint64_t last_used;		// Plan cache clock when this plan was last used.  The least recently used plan is evicted first.
+	int	key_size;		// Number of 64-bit words in the key
+	uint64_t *key;			// Poly sizes, options, preprocessed poly info, and tuning parameters used to generate the plan
+	polymult_plan *plan;		// The cached plan
+} cached_plan;
+
+#define PLAN_CACHE_MAX_OTHER_POLYS	8				// Polymult_several calls with more other polys are not cached
+#define PLAN_KEY_SIZE(n)		(10 + 6 * (n))			// Size of a plan cache key for n other polys
+#define DEFAULT_PLAN_CACHE_SIZE		64				// Default maximum number of cached plans
+
 #define POLYMULT_IMPL_BRUTE		0		// Brute force polymult
 #define POLYMULT_IMPL_KARATSUBA		1		// Karasuba polymult
 #define POLYMULT_IMPL_FFT		2		// FFT based polymult
@@ -542,6 +557,9 @@ void polymult_init (
 	pmdata->cached_twiddles_enabled = TRUE;
 	pmdata->twiddle_cache_additions_disabled = FALSE;
 
+	// Default enables caching plans
+	pmdata->plan_cache_size = DEFAULT_PLAN_CACHE_SIZE;
+
 	// Set default tuning parameters (L2 = 256KB, L3 = 6MB)
 	polymult_default_tuning (pmdata, 256, 6144);
 
@@ -646,6 +664,149 @@ void polymult_done (
 	pmdata->twiddles_initialized = 0;
 	pmdata->twiddles1 = NULL;
 	pmdata->twiddles2 = NULL;
+	polymult_flush_plan_cache (pmdata);
+	free (pmdata->cached_plans);
+	pmdata->cached_plans = NULL;
+}
+
+// Free all cached plans.  Plan cache statistics are not reset.
+void polymult_flush_plan_cache (
+	pmhandle *pmdata)		// Handle for polymult library
+{
+	cached_plan *cache = (cached_plan *) pmdata->cached_plans;
+	for (int i = 0; i < pmdata->plan_cache_count; i++) {
+		free (cache[i].key);
+		free (cache[i].plan);
+	}
+	pmdata->plan_cache_count = 0;
+}
+
+// Set the maximum number of plans to cache.  Zero disables the plan cache.
+void polymult_set_plan_cache_size (
+	pmhandle *pmdata,		// Handle for polymult library
+	int	size)			// Maximum number of plans to cache
+{
+	polymult_flush_plan_cache (pmdata);
+	free (pmdata->cached_plans);
+	pmdata->cached_plans = NULL;
+	pmdata->plan_cache_size = (size > 0) ? size : 0;
+}
+
+// Build the plan cache key for a polymult_several call.  Returns the key size or zero if this polymult cannot be cached.
+// Everything the planning code looks at must be in the key: poly sizes, options, the state of preprocessed polys, and the tuning parameters.
+// The one exception is the NULL pattern of each outvec, which is checked by polymult_plan_cache_lookup.
+#define preprocessed_key(p)	(is_preprocessed_poly (p) ? ((uint64_t) preprocessed_fft_size (p) << 3) + (is_preffted_poly (p) ? 4 : 0) + \
+						    (preprocessed_monics_included (p) ? 2 : 0) + 1 : 0)
+
+static int polymult_plan_key (
+	pmhandle *pmdata,		// Handle for polymult library
+	gwnum	*invec1,		// First input poly
+	uint64_t invec1_size,		// Size of the first input polynomial
+	polymult_arg *other_polys,	// Array of other poly descriptors
+	int	num_other_polys,	// Number of other polys
+	int	invec1_options,		// Options that only apply to invec1
+	uint64_t *key,			// Returned key, must hold PLAN_KEY_SIZE(PLAN_CACHE_MAX_OTHER_POLYS) words
+	uint64_t *hash)			// Returned hash of the key
+{
+	int	n = 0;
+
+	if (num_other_polys > PLAN_CACHE_MAX_OTHER_POLYS) return (0);
+
+	key[n++] = invec1_size;
+	key[n++] = num_other_polys;
+	key[n++] = invec1_options;
+	key[n++] = preprocessed_key (invec1);
+	key[n++] = pmdata->cpu_flags;
+	key[n++] = pmdata->num_threads;
+	key[n++] = ((uint64_t) pmdata->KARAT_BREAK << 32) + pmdata->FFT_BREAK;
+	key[n++] = pmdata->mt_ffts_start;
+	key[n++] = pmdata->mt_ffts_end;
+	key[n++] = pmdata->streamed_stores_start;
+	for (int i = 0; i < num_other_polys; i++) {
+		key[n++] = other_polys[i].invec2_size;
+		key[n++] = other_polys[i].outvec_size;
+		key[n++] = other_polys[i].options;
+		key[n++] = other_polys[i].circular_size;
+		key[n++] = other_polys[i].first_mulmid;
+		key[n++] = preprocessed_key (other_polys[i].invec2);
+	}
+
+	// FNV-1a style hash of the key
+	*hash = 0xCBF29CE484222325ULL;
+	for (int i = 0; i < n; i++) *hash = (*hash ^ key[i]) * 0x100000001B3ULL;
+	return (n);
+}
+
+// Find a cached plan matching the key and the NULL entries in each outvec.  Returns NULL if there is no matching plan.
+static polymult_plan *polymult_plan_cache_lookup (
+	pmhandle *pmdata,		// Handle for polymult library
+	uint64_t *key,			// Key built by polymult_plan_key
+	int	key_size,		// Size of the key
+	uint64_t hash,			// Hash of the key
+	polymult_arg *other_polys,	// Array of other poly descriptors
+	int	num_other_polys)	// Number of other polys
+{
+	cached_plan *cache = (cached_plan *) pmdata->cached_plans;
+
+	pmdata->plan_cache_clock++;
+	for (int i = 0; i < pmdata->plan_cache_count; i++) {
+		if (cache[i].hash != hash || cache[i].key_size != key_size || memcmp (cache[i].key, key, key_size * sizeof (uint64_t))) continue;
+		// A plan drops a 1*1 addin when the caller did not want that output coefficient.  Make sure this outvec has the same NULL entries.
+		polymult_plan *plan = cache[i].plan;
+		bool	match = TRUE;
+		for (int j = 0; match && j < num_other_polys; j++) {
+			for (int k = 0; k < 4; k++) {
+				int64_t probe = plan->planpart[j].addin_probe[k];
+				if (probe >= 0 && (other_polys[j].outvec[probe] == NULL) != (plan->planpart[j].addin[k] < 0)) { match = FALSE; break; }
+			}
+		}
+		if (!match) continue;
+		cache[i].last_used = pmdata->plan_cache_clock;
+		pmdata->plan_cache_hits++;
+		return (plan);
+	}
+	pmdata->plan_cache_misses++;
+	return (NULL);
+}
+
+// Add a newly generated plan to the plan cache, evicting the least recently used plan if the cache is full.  Returns FALSE if the plan was not cached.
+static bool polymult_plan_cache_add (
+	pmhandle *pmdata,		// Handle for polymult library
+	uint64_t *key,			// Key built by polymult_plan_key
+	int	key_size,		// Size of the key
+	uint64_t hash,			// Hash of the key
+	polymult_plan *plan)		// Plan to cache
+{
+	cached_plan *cache = (cached_plan *) pmdata->cached_plans;
+	int	i;
+
+	// Allocate the plan cache on first use
+	if (cache == NULL) {
+		cache = (cached_plan *) malloc (pmdata->plan_cache_size * sizeof (cached_plan));
+		if (cache == NULL) return (FALSE);
+		pmdata->cached_plans = cache;
+	}
+
+	// Copy the key
+	uint64_t *key_copy = (uint64_t *) malloc (key_size * sizeof (uint64_t));
+	if (key_copy == NULL) return (FALSE);
+	memcpy (key_copy, key, key_size * sizeof (uint64_t));
+
+	// Find a free slot or evict the least recently used plan
+	if (pmdata->plan_cache_count < pmdata->plan_cache_size) i = pmdata->plan_cache_count++;
+	else {
+		i = 0;
+		for (int j = 1; j < pmdata->plan_cache_count; j++) if (cache[j].last_used < cache[i].last_used) i = j;
+		free (cache[i].key);
+		free (cache[i].plan);
+		pmdata->plan_cache_evictions++;
+	}
+	cache[i].hash = hash;
+	cache[i].last_used = pmdata->plan_cache_clock;
+	cache[i].key_size = key_size;
+	cache[i].key = key_copy;
+	cache[i].plan = plan;
+	return (TRUE);
 }
 
 
@@ -4731,9 +4892,14 @@ gwarray polymult_preprocess (		// Returns a plug-in replacement for the input po
 	// Allocate and init the preprocessed output
 	plan.combine_two_lines = !pmdata->gwdata->NEGACYCLIC_FFT && !pmdata->gwdata->ZERO_PADDED_FFT && !(options & POLYMULT_PRE_FFT);
 	num_elements = plan.combine_two_lines ? pmdata->num_lines - 1 : pmdata->num_lines;
-	plan.hdr = (preprocessed_poly_header *) malloc ((size_t) (sizeof (preprocessed_poly_header) + 64 + num_elements * element_size));
+	size_t alloc_size = (size_t) (sizeof (preprocessed_poly_header) + 64 + num_elements * element_size);
+	// Do not fall back to regular memory if the temporary file cannot be created.  The caller planned memory use expecting this poly to
+	// take no memory, return NULL so that it can re-plan.
+	if (options & POLYMULT_PRE_FILE_BACKED) plan.hdr = (preprocessed_poly_header *) file_backed_malloc (alloc_size, pmdata->file_backed_dir);
+	else plan.hdr = (preprocessed_poly_header *) malloc (alloc_size);
 	if (plan.hdr == NULL) return (NULL);
 	memset (plan.hdr, 0, sizeof (preprocessed_poly_header));
+	if (options & POLYMULT_PRE_FILE_BACKED) plan.hdr->linkage.flags = GWARRAY_FILE_BACKED;
 	plan.hdr->element_size = element_size;
 	plan.hdr->options = options;
 	plan.hdr->monic_ones_included = !plan.strip_monic_from_invec1;
@@ -4779,7 +4945,9 @@ gwarray polymult_preprocess (		// Returns a plug-in replacement for the input po
 				src += uncompressed_blk_size;
 			}
 		}
-		plan.hdr = (preprocessed_poly_header *) realloc (plan.hdr, (size_t) (sizeof (preprocessed_poly_header) + 64 + num_elements * plan.max_element_size));
+		// A file-backed mapping cannot be shrunk.  Its unused tail is never touched and so never read from disk.
+		if (!(options & POLYMULT_PRE_FILE_BACKED))
+			plan.hdr = (preprocessed_poly_header *) realloc (plan.hdr, (size_t) (sizeof (preprocessed_poly_header) + 64 + num_elements * plan.max_element_size));
 		plan.hdr->element_size = plan.max_element_size;
 	}
 
@@ -4911,14 +5079,29 @@ void polymult_several (		// Multiply one poly with several polys
 	polymult_plan *plan;		// Plan for how to implement each of the invec1 by invec2 multiplications
 	int	invec1_options;		// Options that only apply to invec1
 	int	global_invec2_options;	// Options that apply to all invec2s
+	uint64_t plan_key[PLAN_KEY_SIZE(PLAN_CACHE_MAX_OTHER_POLYS)]; // Plan cache key
+	uint64_t plan_key_hash;		// Hash of the plan cache key
+	int	plan_key_size = 0;	// Size of the plan cache key.  Zero if the plan cache is not used.
 
 	// Split up options.  For convenience to the programmer, invec2 options that apply to all other_polys can be specified in options argument.
 	invec1_options = options & INVEC1_OPTIONS;
 	global_invec2_options = options & (INVEC2_OPTIONS | OUTVEC_OPTIONS);
 	for (int i = 0; i < num_other_polys; i++) other_polys[i].options |= global_invec2_options;
 
+	// Look for a cached plan unless the caller is managing the plan
+	plan = NULL;
+	if (!(options & PLAN_OPTIONS) && pmdata->plan_cache_size > 0) {
+		plan_key_size = polymult_plan_key (pmdata, invec1, invec1_size, other_polys, num_other_polys, invec1_options, plan_key, &plan_key_hash);
+		if (plan_key_size) plan = polymult_plan_cache_lookup (pmdata, plan_key, plan_key_size, plan_key_hash, other_polys, num_other_polys);
+	}
+
+	// Use a cached plan
+	if (plan != NULL) {
+		pmdata->plan = plan;
+	}
+
 	// Use a previously generated plan
-	if (options & POLYMULT_USE_PLAN) {
+	else if (options & POLYMULT_USE_PLAN) {
 	    plan = (polymult_plan *) pmdata->plan;
 #define ps_hash(a,b,c,d,e,f) ((a)*3+(b)*17+(c)*131071+(d)*8191001+(e)*1001+(f)*65537)
 	    ASSERTG (ps_hash (invec1_size, num_other_polys, other_polys[0].invec2_size, other_polys[0].outvec_size, other_polys[0].options & 0x7FFFF, options & 0x7FFFF) == ((polymult_plan *) pmdata->plan)->hash);
@@ -5180,6 +5363,13 @@ void polymult_several (		// Multiply one poly with several polys
 		    addin3 -= LSWs_skipped;
 		    addin4 -= LSWs_skipped;
 
+		    // Remember the 1*1 locations that depend on whether the caller wants the outvec coefficient.  A cached plan is only reused if
+		    // the outvec NULL entries at these locations match.
+		    plan->planpart[i].addin_probe[0] = (addin1 >= 0 && addin1 < (int64_t) outvec_size) ? addin1 : -1;
+		    plan->planpart[i].addin_probe[1] = (addin2 >= 0 && addin2 < (int64_t) outvec_size) ? addin2 : -1;
+		    plan->planpart[i].addin_probe[2] = (addin3 >= 0 && addin3 < (int64_t) outvec_size) ? addin3 : -1;
+		    plan->planpart[i].addin_probe[3] = (addin4 >= 0 && addin4 < (int64_t) outvec_size) ? addin4 : -1;
+
 		    // If any of the 1*1s are for a coefficient that is not returned to the caller, then clear the addin flag
 		    if (addin1 >= 0 && (addin1 >= (int64_t) outvec_size || outvec[addin1] == NULL)) addin1 = -1;
 		    if (addin2 >= 0 && (addin2 >= (int64_t) outvec_size || outvec[addin2] == NULL)) addin2 = -1;
@@ -5540,6 +5730,9 @@ use_it:		    ASSERTG (best_choice != 0);
 		    pass2_strip_monic_from_invec1 = FALSE;
 		}
 	    }
+
+	    // Remember the new plan in the plan cache
+	    if (plan_key_size && !polymult_plan_cache_add (pmdata, plan_key, plan_key_size, plan_key_hash, plan)) plan_key_size = 0;
 	}
 //GW		Change poly_preprocess to either fft_size of polymult_fft_size(insz1 + insz2 - 1) OR polymult_fft_size (outsz) if polymult circular set.
 //GW		This offloads some of this monic decision crap to the caller.  And lets him manage the exact fft size in case we would have decided wrong fft size.
@@ -5576,8 +5769,11 @@ use_it:		    ASSERTG (best_choice != 0);
 	pmdata->helper_opcode = HELPER_POST_UNFFT;	// The helpers are doing post-unFFT polymult work
 	polymult_launch_helpers (pmdata);
 
-	// Free array that planned each poly multiplication
-	if (!(options & POLYMULT_SAVE_PLAN)) free (pmdata->plan), pmdata->plan = NULL;
+	// Free array that planned each poly multiplication (unless the caller saved it or it is in the plan cache)
+	if (!(options & POLYMULT_SAVE_PLAN)) {
+		if (!plan_key_size) free (pmdata->plan);
+		pmdata->plan = NULL;
+	}
 }
 
 /* Multi-threaded FFT of all the input vectors in a polymult */
@@ -79,6 +79,18 @@ void polymult_default_tuning (
 void polymult_done (
 	pmhandle *pmdata);		// Handle for polymult library
 
+// Polymult caches the plans it generates, keyed by poly sizes, options, preprocessed poly state, and tuning parameters.  Repeated polymults of the
+// same shape (common in P-1/ECM stage 2) skip planning entirely.  When the cache is full the least recently used plan is discarded.  The default is
+// to cache 64 plans.  Tuning parameters are part of the key so they can be safely changed at any time.  Setting the size to zero disables the plan
+// cache.  Changing the size discards all cached plans.
+void polymult_set_plan_cache_size (
+	pmhandle *pmdata,		// Handle for polymult library
+	int	size);			// Maximum number of plans to cache
+
+// Free all cached plans
+void polymult_flush_plan_cache (
+	pmhandle *pmdata);		// Handle for polymult library
+
 /* Multiply two polynomials.  It is safe to use input gwnums in the output vector.  For a normal polynomial multiply outvec_size must be */
 /* invec1_size + invec2_size - 1.  For monic polynomial multiply, the leading input coefficients of 1 are omitted as is the leading 1 output */
 /* coefficient -- thus outvec_size must be invec1_size + invec2_size. */
@@ -159,6 +171,8 @@ void polymult2 (
 // The following options only apply to polymult_preprocess
 #define	POLYMULT_PRE_FFT	0x40	// Compute the forward FFT while creating a preprocessed polynomial
 #define	POLYMULT_PRE_COMPRESS	0x80	// Compress each double while creating a preprocessed polynomial
+#define	POLYMULT_PRE_FILE_BACKED 0x200000 // Store the preprocessed polynomial in a temporary file mapped into memory (see pmhandle's file_backed_dir).  Returns NULL if the file cannot be created.
+					// The OS pages lines in from disk as polymult reads them, letting callers use polynomials larger than available memory.
 
 /*-----------------------------------------------------------------------------
 |	Advanced polymult routines
@@ -180,6 +194,8 @@ void polymult2 (
 /* in future polymult calls with poly sizes and options that match those passed to this routine. */
 /* The POLYMULT_PRE_FFT preprocessing option allows the forward FFT of invec1 to be used over and over again.  The downside to the POLYMULT_PRE_FFT option */
 /* is the preprocessed poly consumes more memory. */
+/* The POLYMULT_PRE_FILE_BACKED option moves the preprocessed poly out of RAM.  If the temporary file cannot be created (e.g. not enough disk space), */
+/* NULL is returned.  The caller should re-plan its memory use and try again without this option. */
 gwarray polymult_preprocess (		// Returns a plug-in replacement for the input poly
 	pmhandle *pmdata,		// Handle for polymult library
 	gwnum	*invec1,		// Input poly
@@ -291,6 +307,15 @@ struct pmhandle_struct {
 		double	*twiddles2;	// Sin/cos table for radix-4 and radix-5
 	} cached_twiddles[40];
 	int	cached_twiddles_count;	// Number of cached twiddles
+	// Cached plans
+	int	plan_cache_size;	// Maximum number of cached plans, zero disables the plan cache
+	int	plan_cache_count;	// Number of cached plans
+	void	*cached_plans;		// Array of cached plans (allocated on first use)
+	uint64_t plan_cache_clock;	// Incremented on every plan cache lookup.  Used to find the least recently used plan.
+	uint64_t plan_cache_hits;	// Number of polymults that found their plan in the cache
+	uint64_t plan_cache_misses;	// Number of polymults that generated a new plan
+	uint64_t plan_cache_evictions;	// Number of cached plans discarded to make room for a new plan
+	const char *file_backed_dir;	// Directory for POLYMULT_PRE_FILE_BACKED temporary files.  NULL means the current directory.
 	// Arguments to the current polymult call.  Copied here so that helper threads can access the arguments.  Also, the plan for implementing the polymult.
 	gwnum	*invec1;		// First input poly
 	uint64_t invec1_size;		// Size of the first input polynomial
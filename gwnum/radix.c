@@ -136,7 +136,11 @@ int nonbase2_gianttogw (	/* Returns an error code or zero for success */
 		gwset_maxmulbyconst (work_gwdata, 1);
 		gwset_minimum_fftlen (work_gwdata, fftlen);
 		work_gwdata->radix_bigwords = num_pairs * radix_bigwords_per_mult;
-		if (gwdata->num_threads > 1) gwset_num_threads (work_gwdata, gwdata->num_threads);
+		if (gwdata->num_threads > 1) {
+			gwset_num_threads (work_gwdata, gwdata->num_threads);
+			gwset_thread_callback (work_gwdata, gwdata->thread_callback);
+			gwset_thread_callback_data (work_gwdata, gwdata->thread_callback_data);
+		}
 		err_code = gwsetup (work_gwdata, 1.0, gwdata->b, exp, -1);
 		if (err_code != 0) goto err;
 		ASSERTG (fftlen == work_gwdata->FFTLEN);
@@ -662,7 +666,11 @@ int nonbase2_gwtogiant (	/* Returns an error code or zero for success */
 		gwinit (work_gwdata);
 		gwset_maxmulbyconst (work_gwdata, 1);
 		gwset_minimum_fftlen (work_gwdata, fftlen);
-		if (gwdata->num_threads > 1) gwset_num_threads (work_gwdata, gwdata->num_threads);
+		if (gwdata->num_threads > 1) {
+			gwset_num_threads (work_gwdata, gwdata->num_threads);
+			gwset_thread_callback (work_gwdata, gwdata->thread_callback);
+			gwset_thread_callback_data (work_gwdata, gwdata->thread_callback_data);
+		}
 		err_code = gwsetup (work_gwdata, 1.0, 2, exp, -1);
 		if (err_code) goto err;
 		ASSERTG (fftlen == work_gwdata->FFTLEN);
@@ -624,6 +624,40 @@ void test_it (
 	if (CHECK_OFTEN) compare (thread_num, gwdata, x, g);
 	gwcopy (gwdata, x, x2); gtog (g, g2);
 
+/* Optionally time gwtogiant and gianttogw with and without the auxiliary threads.  Both must produce the same result. */
+/* The multithreaded code is only used on base-2 FFTs of 64K or more when gwdata has more than one thread. */
+
+	if (IniSectionGetInt (INI_FILE, "QA", "ConversionTests", 0)) {
+		double	timers[4];
+		int	j, num_conversions;
+
+		num_conversions = IniSectionGetInt (INI_FILE, "QA", "NUM_CONVERSIONS", 10);
+		clear_timers (timers, 4);
+		for (j = 0; j <= 1; j++) {
+			gwset_single_threaded_conversions (gwdata, j);
+			for (i = 0; i < num_conversions; i++) {
+				start_timer (timers, 2*j);
+				gwtogiant (gwdata, x2, g3);
+				end_timer (timers, 2*j);
+				start_timer (timers, 2*j+1);
+				gianttogw (gwdata, g3, x3);
+				end_timer (timers, 2*j+1);
+			}
+			compare_with_text_and_int (thread_num, gwdata, x3, g2, "Conversion", j);
+		}
+		gwset_single_threaded_conversions (gwdata, 0);
+		sprintf (buf, "%d conversions using %d threads.  gwtogiant: ", num_conversions, gwdata->num_threads);
+		print_timer (timers, 0, buf, 0);
+		strcat (buf, " (1 thread: ");
+		print_timer (timers, 2, buf, 0);
+		strcat (buf, "), gianttogw: ");
+		print_timer (timers, 1, buf, 0);
+		strcat (buf, " (1 thread: ");
+		print_timer (timers, 3, buf, 0);
+		strcat (buf, ")\n");
+		OutputBoth (thread_num, buf);
+	}
+
 /* Test 50 squarings */	
 
 	gwsetnormroutine (gwdata, 0, 1, 0);	/* Enable error checking */
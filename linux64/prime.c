@@ -23,6 +23,7 @@
 #include <asm/unistd.h>
 #define __USE_GNU
 #include <sched.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/sysinfo.h>
 #include <sys/time.h>
@@ -35,6 +36,7 @@
 #include <sched.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/sysctl.h>
 #include <sys/time.h>
@@ -51,6 +53,7 @@
 #include <unistd.h>
 #include <sys/param.h>
 #include <sys/cpuset.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/sysctl.h>
 #include <sys/types.h>
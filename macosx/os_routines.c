@@ -499,6 +499,66 @@ char getDirectorySeparator ()
 	return ('/');
 }
 
+/* Map a file into memory for reading.  Returns NULL if the file cannot be mapped. */
+
+void *mapFileForReading (
+	int	fd,
+	int64_t	size,
+	void	**map_handle)
+{
+	void	*addr;
+
+	*map_handle = NULL;
+	if (size <= 0) return (NULL);
+#if defined (__linux__) || defined (__APPLE__) || defined (__FreeBSD__)
+	addr = mmap (NULL, (size_t) size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) return (NULL);
+#else
+	addr = NULL;
+#endif
+	return (addr);
+}
+
+/* Unmap a file mapped by mapFileForReading */
+
+void unmapFile (
+	void	*addr,
+	int64_t	size,
+	void	*map_handle)
+{
+#if defined (__linux__) || defined (__APPLE__) || defined (__FreeBSD__)
+	if (addr != NULL) munmap (addr, (size_t) size);
+#endif
+}
+
+/* Reserve disk space for a file without writing data.  Returns TRUE only if the file system reserved real disk blocks for the entire size. */
+/* Compressing file systems and libc emulations that write zeros to them do not reserve blocks.  A small probe detects this cheaply. */
+
+int allocateFileSpace (
+	int	fd,
+	int64_t	size)
+{
+#if defined (__linux__) || defined (__FreeBSD__) || defined (__APPLE__)
+	struct stat st;
+	int64_t	probe_size, alloc_size;
+
+	probe_size = (size < 1048576) ? size : 1048576;
+	for (alloc_size = probe_size; ; alloc_size = size) {
+#ifdef __APPLE__
+		fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t) alloc_size, 0};
+		if (fcntl (fd, F_PREALLOCATE, &store) != 0) return (FALSE);
+		if (ftruncate (fd, (off_t) alloc_size) != 0) return (FALSE);
+#else
+		if (posix_fallocate (fd, 0, (off_t) alloc_size) != 0) return (FALSE);
+#endif
+		if (fstat (fd, &st) != 0 || (int64_t) st.st_blocks * 512 < alloc_size) return (FALSE);
+		if (alloc_size == size) return (TRUE);
+	}
+#else
+	return (FALSE);
+#endif
+}
+
 /* Tell malloc to free memory back to the OS */
 
 void mallocFreeForOS () {
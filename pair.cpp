@@ -318,7 +318,7 @@ public:
 	prime_generator (int thread_num, uint64_t first_relocatable, uint64_t last_relocatable, uint64_t B2_start_reloc, uint64_t B2_start,
 			 uint64_t B2_end_prime, uint64_t B2_end_relocs, int first_multiplier, int second_multiplier);
 	// Destructor
-	~prime_generator () { /* GW: end_sieve?? */ }
+	~prime_generator () { end_sieve (B2_sieve); end_sieve (relocatable_sieve); }
 	// Peek at the next prime
 	uint64_t peek ();
 	// Get the next "prime" as well small multiplier (one for a true prime)
@@ -1460,6 +1460,85 @@ if (FIRST_EXIT && WINDOWED && next_prime != 0 && p_best_pairing != NULL) break;
 oom:	return (OutOfMemory (thread_num));
 }
 
+/**********************************************************************************************************************/
+/*                                          Background pair map generation                                            */
+/**********************************************************************************************************************/
+
+/* Stage 2 processes a pairmap of max_pairmap_Dsections D sections at a time.  Rather than have the FFT threads sit idle while the next */
+/* pairmap is built, a producer thread builds pairmap N+1 while stage 2 consumes pairmap N.  Stage 2 only waits if the producer falls behind. */
+
+void pairmap_producer_thread (
+	void	*arg)
+{
+	pairmap_producer *pp = (pairmap_producer *) arg;
+	pp->stop_reason = fill_pairmap (pp->thread_num, NULL, pp->D, pp->WINDOW_SIZE, 0, 0, 0, pp->totrels, pp->relp_sets,
+					pp->first_relocatable, pp->last_relocatable, pp->B2_start, pp->B2, pp->max_pairmap_Dsections,
+					&pp->pairmap, &pp->pairmap_size);
+}
+
+void start_pairmap_producer (		/* Start building a pairing map in the background */
+	pairmap_producer *pp,
+	int	thread_num,		/* For outputting informative messages */
+	int	D,			/* Calculated by best_stage2_impl, best D value ("big step") */
+	int	WINDOW_SIZE,		/* Size (in number of D values) of the prime window */
+	int	totrels,		/* Calculated by best_stage2_impl, number of relative primes to use for pairing */
+	int16_t	*relp_sets,		/* Which non-contiguous sets of relative primes to use */
+	uint64_t first_relocatable,	/* First relocatable prime for the next pairmap */
+	uint64_t last_relocatable,	/* End of relocatable primes */
+	uint64_t B2_start,		/* First D section to place in the next pairmap */
+	uint64_t B2,			/* Bound #2 */
+	uint64_t max_pairmap_Dsections)	/* Number of D sections that can fit in a pairing map */
+{
+	int	i;
+
+	cancel_pairmap_producer (pp);
+	pp->thread_num = thread_num;
+	pp->D = D;
+	pp->WINDOW_SIZE = WINDOW_SIZE;
+	pp->totrels = totrels;
+	for (i = 0; i < 29; i++) pp->relp_sets[i] = relp_sets[i];
+	pp->first_relocatable = first_relocatable;
+	pp->last_relocatable = last_relocatable;
+	pp->B2_start = B2_start;
+	pp->B2 = B2;
+	pp->max_pairmap_Dsections = max_pairmap_Dsections;
+	pp->stop_reason = 0;
+	pp->pairmap = NULL;
+	pp->pairmap_size = 0;
+	pp->active = TRUE;
+	gwthread_create_waitable (&pp->thread, &pairmap_producer_thread, pp);
+}
+
+bool finish_pairmap_producer (		/* Wait for the background pairing map.  Returns FALSE if none was started for B2_start. */
+	pairmap_producer *pp,
+	uint64_t B2_start,		/* First D section the caller needs in the next pairmap */
+	int	*stop_reason,		/* Returned fill_pairmap stop reason */
+	uint8_t	**pairmap,		/* Pairing map to replace (it is freed) with the one built in the background */
+	uint64_t *pairmap_size)		/* Returned size of the pairing map */
+{
+	if (!pp->active) return (FALSE);
+	if (pp->B2_start != B2_start) {
+		cancel_pairmap_producer (pp);
+		return (FALSE);
+	}
+	gwthread_wait_for_exit (&pp->thread);
+	pp->active = FALSE;
+	*stop_reason = pp->stop_reason;
+	free (*pairmap);
+	*pairmap = pp->pairmap, pp->pairmap = NULL;
+	*pairmap_size = pp->pairmap_size;
+	return (TRUE);
+}
+
+void cancel_pairmap_producer (		/* Wait for any background pairing map and discard it */
+	pairmap_producer *pp)
+{
+	if (!pp->active) return;
+	gwthread_wait_for_exit (&pp->thread);
+	pp->active = FALSE;
+	free (pp->pairmap), pp->pairmap = NULL;
+}
+
 /**********************************************************************************************************************/
 /*                                                Pair map access                                                     */
 /**********************************************************************************************************************/
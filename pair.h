@@ -42,6 +42,51 @@ int fill_pairmap (			/* Generate a pairing map */
 	uint8_t	**pairmap,		/* Returned pointer to a pairing map that is allocated here */
 	uint64_t *pairmap_size);	/* Returned size of the pairing map */
 
+/* Build the next pairing map in a background thread while stage 2 processes the current one */
+
+typedef struct {
+	gwthread thread;		/* Thread building the pairing map */
+	bool	active;			/* TRUE if a pairing map is being built or has not been collected */
+	int	thread_num;		/* Arguments to fill_pairmap */
+	int	D;
+	int	WINDOW_SIZE;
+	int	totrels;
+	int16_t	relp_sets[29];		/* relp_sets+3 as passed to fill_pairmap */
+	uint64_t first_relocatable;
+	uint64_t last_relocatable;
+	uint64_t B2_start;
+	uint64_t B2;
+	uint64_t max_pairmap_Dsections;
+	int	stop_reason;		/* Results of fill_pairmap */
+	uint8_t	*pairmap;
+	uint64_t pairmap_size;
+	double	wait_time;		/* Seconds stage 2 spent waiting for the producer */
+	int	num_produced;		/* Count of pairing maps collected from the producer */
+} pairmap_producer;
+
+void start_pairmap_producer (		/* Start building a pairing map in the background */
+	pairmap_producer *pp,
+	int	thread_num,
+	int	D,
+	int	WINDOW_SIZE,
+	int	totrels,
+	int16_t	*relp_sets,
+	uint64_t first_relocatable,
+	uint64_t last_relocatable,
+	uint64_t B2_start,
+	uint64_t B2,
+	uint64_t max_pairmap_Dsections);
+
+bool finish_pairmap_producer (		/* Wait for the background pairing map.  Returns FALSE if none was started for B2_start. */
+	pairmap_producer *pp,
+	uint64_t B2_start,		/* First D section the caller needs in the next pairmap */
+	int	*stop_reason,		/* Returned fill_pairmap stop reason */
+	uint8_t	**pairmap,		/* Pairing map to replace (it is freed) with the one built in the background */
+	uint64_t *pairmap_size);
+
+void cancel_pairmap_producer (		/* Wait for any background pairing map and discard it */
+	pairmap_producer *pp);
+
 uint32_t next_pair (			/* Returns distance to next prime pairing (or single) */
 	uint8_t	**pairmap_ptr);		/* Current pointer into the pairing map generated by fill_pairmap -- this will be modified */
 
@@ -0,0 +1,493 @@
+/*----------------------------------------------------------------------
+| Copyright 2020-2024 Mersenne Research, Inc.  All rights reserved
+|
+| This file contains routines to verify a PRP proof file locally.
++---------------------------------------------------------------------*/
+
+/* A proof file with power p claims that A^(2^N) = B, where A is the starting value of the PRP test and B is the final residue.  The file */
+/* contains B and p middle values.  At each level i we compute h_i = hash(h_(i-1), M_i) and replace the claim with (A^h * M)^(2^ceil(N/2)) = */
+/* M^h * B (B is squared first when N is odd).  After p levels the claim is small enough to check with ceil(N/2^p) squarings. */
+
+/* Verifier state shared with the helper threads that update the A and B values of each partial proof */
+
+struct verify_state {
+	int	thread_num;		/* Worker number (for error messages) */
+	pmhandle pmdata;		/* Polymult handle -- we borrow its helper threads */
+	int	num_proofs;		/* Number of partial proofs in the file (the multiplier in POWER=PxM) */
+	int	proof_power;		/* Number of middle values in each partial proof */
+	int	level;			/* Level of the proof currently being processed */
+	uint64_t *h;			/* Truncated hashes, proof_power for each partial proof */
+	unsigned long *span;		/* Number of squarings from A to B in each partial proof */
+	gwnum	*A;			/* Start value of each partial proof */
+	gwnum	*B;			/* End value of each partial proof */
+	gwnum	*MA;			/* Middle value of this level, consumed by the A update */
+	gwnum	*MB;			/* Copy of the middle value consumed by the B update */
+};
+
+/* Each partial proof needs an A update and a B update at every level.  All of them are independent, so hand them out */
+/* to the polymult helper threads (each using its own cloned gwdata). */
+
+void verify_proof_helper (
+	int	helper_num,		// 0 = main thread, 1+ = helper thread num
+	gwhandle *gwdata,		// Single-threaded, thread-safe gwdata (probably cloned) to use
+	void	*info)
+{
+	struct verify_state *vs = (struct verify_state *) info;
+
+	for ( ; ; ) {
+		int	j = (int) atomic_fetch_incr (vs->pmdata.helper_counter);
+		if (j >= 2 * vs->num_proofs) break;
+		int	proof = j / 2;
+		uint64_t h = vs->h[proof * vs->proof_power + vs->level];
+		if ((j & 1) == 0) {				// A = A^h * M
+			exponentiate (gwdata, vs->A[proof], h);
+			gwmul3 (gwdata, vs->MA[proof], vs->A[proof], vs->A[proof], 0);
+		} else {					// B = M^h * B, where B is first squared if span is odd
+			if (vs->span[proof] & 1) gwsquare2 (gwdata, vs->B[proof], vs->B[proof], 0);
+			exponentiate (gwdata, vs->MB[proof], h);
+			gwmul3 (gwdata, vs->MB[proof], vs->B[proof], vs->B[proof], 0);
+		}
+	}
+}
+
+/* Read one line of the proof file header.  The header is only a few lines so reading a byte at a time is fine. */
+
+int readProofHeaderLine (		/* Returns TRUE if successful */
+	int	fd,
+	char	*buf,
+	int	bufsize)
+{
+	int	len;
+
+	for (len = 0; len < bufsize - 1; len++) {
+		if (_read (fd, buf + len, 1) != 1) return (FALSE);
+		if (buf[len] == '\n') {
+			buf[len] = 0;
+			return (TRUE);
+		}
+	}
+	return (FALSE);
+}
+
+/* Read a residue from the proof file.  Residues are stored as an array of bytes (LSB to MSB). */
+
+int readProofResidue (			/* Returns TRUE if successful */
+	gwhandle *gwdata,
+	int	fd,
+	int64_t	offset,			/* Offset of the residue in the proof file */
+	int	residue_size,		/* Size of the residue in bytes */
+	gwnum	x)
+{
+	int	i;
+	uint32_t *array;		/* Array to contain the binary value */
+	uint32_t arraylen;		/* Size of the array */
+
+	arraylen = divide_rounding_up (residue_size, 4);
+	array = (uint32_t *) malloc (arraylen * sizeof(uint32_t));
+	if (array == NULL) return (FALSE);
+	array[arraylen-1] = 0;		// Zero-pad the top few bytes
+
+	if (_lseeki64 (fd, offset, SEEK_SET) != offset || _read (fd, array, residue_size) != residue_size) {
+		free (array);
+		return (FALSE);
+	}
+
+	// Convert from an array of bytes (LSB to MSB) to an array of uint32_t
+	for (i = 0; i < (int) arraylen; i++) {
+		uint32_t val;
+		val = ((unsigned char *)&array[i])[3];
+		val = (val << 8) + ((unsigned char *)&array[i])[2];
+		val = (val << 8) + ((unsigned char *)&array[i])[1];
+		val = (val << 8) + ((unsigned char *)&array[i])[0];
+		array[i] = val;
+	}
+
+	// Convert binary to gwnum
+	binarytogw (gwdata, array, arraylen, x);
+	free (array);
+	return (TRUE);
+}
+
+/* Verify a PRP proof file */
+
+int verifyProof (
+	int	thread_num,		/* Worker number */
+	struct PriorityInfo *sp_info,	/* SetPriority information */
+	struct work_unit *w)		/* Worktodo entry */
+{
+	gwhandle gwdata;
+	struct verify_state vs;
+	int	fd, version, hashlen, prp_base, cofactor, is_prp, attempt, num_threads, near_fft_limit, first_bad_proof;
+	int	i, j, res, stop_reason;
+	unsigned long excess_squarings, proof_num_iters, initial_iters, iters, total_iters, done_iters;
+	int64_t	header_size, file_size, residue_size, proof_residues_size;
+	double	timers[2];
+	double	allowable_maxerr, output_adjustment, title_adjustment;
+	char	line[16384], number[16384];
+	char	buf[1000], fft_desc[200], string_rep[80];
+
+/* Init */
+
+	memset (&vs, 0, sizeof (vs));
+	vs.thread_num = thread_num;
+	gwinit (&gwdata);
+	fd = -1;
+	attempt = 0;
+	gw_as_string (string_rep, w->k, w->b, w->n, w->c);
+
+/* PRP proofs are only generated when the PRP test can do a long run of squarings, that is for k*2^n+c */
+
+	if (w->b != 2) {
+		sprintf (buf, "Cannot verify proof of %s.  Proofs are only generated for k*2^n+c numbers.\n", string_rep);
+		OutputBoth (thread_num, buf);
+		goto abandon_work;
+	}
+
+/* Open the proof file and parse the header.  The header looks like this: */
+/* PRP PROOF\n */
+/* VERSION=2\n */
+/* HASHSIZE=64\n */
+/* POWER=7x2\n	(the x2 is optional) */
+/* BASE=5\n	(optional, default is 3) */
+/* NUMBER=(2^1234+1)/2521\n */
+
+	fd = _open (w->proof_file, _O_BINARY | _O_RDONLY);
+	if (fd < 0) {
+		sprintf (buf, "Cannot open PRP proof file: %s\n", w->proof_file);
+		OutputBoth (thread_num, buf);
+		OutputBothErrno (thread_num);
+		goto abandon_work;
+	}
+
+	version = 0;
+	hashlen = 64;
+	vs.proof_power = 0;
+	vs.num_proofs = 1;
+	prp_base = 3;
+	if (!readProofHeaderLine (fd, line, sizeof (line)) || strcmp (line, "PRP PROOF") != 0) goto bad_header;
+	for ( ; ; ) {
+		if (!readProofHeaderLine (fd, line, sizeof (line))) goto bad_header;
+		if (strncmp (line, "VERSION=", 8) == 0) version = atoi (line+8);
+		else if (strncmp (line, "HASHSIZE=", 9) == 0) hashlen = atoi (line+9);
+		else if (strncmp (line, "POWER=", 6) == 0) sscanf (line+6, "%dx%d", &vs.proof_power, &vs.num_proofs);
+		else if (strncmp (line, "BASE=", 5) == 0) prp_base = atoi (line+5);
+		else if (strncmp (line, "NUMBER=", 7) == 0) break;
+		else goto bad_header;
+	}
+	if (version < 1 || version > 2 || hashlen < 32 || hashlen > 64 || vs.proof_power < 1 || vs.proof_power > 16 ||
+	    vs.num_proofs < 1 || vs.num_proofs > 4 || prp_base < 2) goto bad_header;
+
+	// Non-Mersennes with known factors are enclosed in parentheses.  Known factors are appended after slashes.
+	cofactor = (strchr (line, '/') != NULL);
+	if (line[7] == '(') {
+		char	*end = strchr (line+8, ')');
+		if (end == NULL) goto bad_header;
+		*end = 0;
+		strcpy (number, line+8);
+	} else {
+		if (cofactor) *strchr (line, '/') = 0;
+		strcpy (number, line+7);
+	}
+
+	header_size = _lseeki64 (fd, 0, SEEK_CUR);
+	file_size = _lseeki64 (fd, 0, SEEK_END);
+
+/* Calculate the number of squarings covered by each partial proof.  Version 1 proofs did some excess squarings so that */
+/* every span was a power of two.  The few squarings that did not fit in the partial proofs were done up front. */
+
+	excess_squarings = 0;
+	if (version == 1) excess_squarings = round_up_to_multiple_of (w->n, vs.num_proofs << vs.proof_power) - w->n;
+	proof_num_iters = (w->n + excess_squarings) / vs.num_proofs;
+	initial_iters = (w->n + excess_squarings) % vs.num_proofs;
+
+/* Init the FFT code for squaring modulo k*b^n+c.  If we get a mismatch or a roundoff error we retry with a larger FFT length. */
+
+retry:	if (IniGetInt (INI_FILE, "UseLargePages", 0)) gwset_use_large_pages (&gwdata);
+	if (HYPERTHREAD_LL) sp_info->normal_work_hyperthreading = TRUE, gwset_will_hyperthread (&gwdata, 2);
+	gwset_bench_cores (&gwdata, HW_NUM_CORES);
+	gwset_bench_workers (&gwdata, NUM_WORKERS);
+	if (ERRCHK) gwset_will_error_check (&gwdata);
+	else gwset_will_error_check_near_limit (&gwdata);
+	gwset_num_threads (&gwdata, get_worker_num_threads (thread_num, HYPERTHREAD_LL));
+	gwset_thread_callback (&gwdata, SetAuxThreadPriority);
+	gwset_thread_callback_data (&gwdata, sp_info);
+	gwset_minimum_fftlen (&gwdata, w->minimum_fftlen);
+	gwset_larger_fftlen_count (&gwdata, attempt);
+	gwset_use_spin_wait (&gwdata, IniGetInt (INI_FILE, "SpinWait", 0));
+	res = gwsetup (&gwdata, w->k, w->b, w->n, w->c);
+	if (res) {
+		sprintf (buf, "Proof verification cannot initialize FFT code for %s, errcode=%d\n", string_rep, res);
+		OutputBoth (thread_num, buf);
+		gwerror_text (&gwdata, res, buf, sizeof (buf) - 1);
+		strcat (buf, "\n");
+		OutputBoth (thread_num, buf);
+		goto abandon_work;
+	}
+
+/* Make sure the proof is for the number in the worktodo entry and that the file is the expected size */
+
+	if (strcmp (number, gwmodulo_as_string (&gwdata)) != 0) {
+		sprintf (buf, "PRP proof file %s is for %.80s, not %s\n", w->proof_file, number, gwmodulo_as_string (&gwdata));
+		OutputBoth (thread_num, buf);
+		goto abandon_work;
+	}
+	residue_size = divide_rounding_up ((int) ceil (gwdata.bit_length), 8);
+	proof_residues_size = (vs.proof_power + 1) * residue_size;
+	if (file_size != header_size + vs.num_proofs * proof_residues_size) {
+		sprintf (buf, "PRP proof file %s is the wrong size\n", w->proof_file);
+		OutputBoth (thread_num, buf);
+		goto abandon_work;
+	}
+
+/* Decide how many threads will update the A and B values.  There are only two updates per partial proof at each level. */
+
+	num_threads = IniGetInt (INI_FILE, "ProofVerifyThreads", gwget_num_threads (&gwdata));
+	if (num_threads > (int) gwget_num_threads (&gwdata)) num_threads = gwget_num_threads (&gwdata);
+	if (num_threads > 2 * vs.num_proofs) num_threads = 2 * vs.num_proofs;
+	if (num_threads < 1) num_threads = 1;
+
+/* Record the amount of memory being used by this thread.  Each exponentiate can use up to 16 temporaries. */
+
+	set_memory_usage (thread_num, 0, cvt_gwnums_to_mem (&gwdata, 4 * vs.num_proofs + 16 * num_threads));
+
+/* Allocate memory */
+
+	vs.h = (uint64_t *) malloc (vs.num_proofs * vs.proof_power * sizeof (uint64_t));
+	vs.span = (unsigned long *) malloc (vs.num_proofs * sizeof (unsigned long));
+	vs.A = (gwnum *) calloc (4 * vs.num_proofs, sizeof (gwnum));
+	if (vs.h == NULL || vs.span == NULL || vs.A == NULL) goto oom;
+	vs.B = vs.A + vs.num_proofs;
+	vs.MA = vs.B + vs.num_proofs;
+	vs.MB = vs.MA + vs.num_proofs;
+	for (i = 0; i < 4 * vs.num_proofs; i++) {
+		vs.A[i] = gwalloc (&gwdata);
+		if (vs.A[i] == NULL) goto oom;
+	}
+
+/* Output a message saying we are starting the verification */
+
+	gwfft_description (&gwdata, fft_desc);
+	sprintf (buf, "Verifying%s PRP proof of %s using %s.  Proof power = %d", cofactor ? " cofactor" : "", string_rep, fft_desc, vs.proof_power);
+	if (vs.num_proofs > 1) sprintf (buf+strlen(buf), "x%d", vs.num_proofs);
+	sprintf (buf+strlen(buf), ", Hash length = %d\n", hashlen);
+	OutputStr (thread_num, buf);
+	sprintf (buf, "Verify %s", string_rep);
+	title (thread_num, buf);
+
+/* Reset counters and errors, turn on error checking */
+
+	gw_clear_error (&gwdata);
+	gw_clear_maxerr (&gwdata);
+	gwsetnormroutine (&gwdata, 0, 1, 0);
+
+/* Recompute the hash chain of every partial proof from the residues in the file */
+
+	for (j = 0; j < vs.num_proofs; j++) {
+		hash256_t rooth, *prevh, thish;
+		int64_t	offset = header_size + j * proof_residues_size;
+
+		if (!readProofResidue (&gwdata, fd, offset, (int) residue_size, vs.B[j])) goto read_error;
+		if (!roothash (&gwdata, vs.B[j], &rooth)) goto hash_error;
+		for (i = 0, prevh = &rooth; i < vs.proof_power; i++, prevh = &thish) {
+			if (!readProofResidue (&gwdata, fd, offset + (i + 1) * residue_size, (int) residue_size, vs.MA[j])) goto read_error;
+			if (!hash (&gwdata, prevh, vs.MA[j], &thish)) goto hash_error;
+			vs.h[j * vs.proof_power + i] = truncate_hash (thish, hashlen);
+		}
+	}
+
+/* The final residue of the last partial proof tells us whether the number is a probable prime.  We prove that B = base^(k*2^(n+excess)). */
+/* Since N = k*2^n+c, N is a Fermat PRP when B = (base^(1-c))^(2^excess) or, for c > 1, when B * (base^(c-1))^(2^excess) = 1. */
+/* Proofs of cofactors with known factors would need the known factors to reach a conclusion -- just verify the proof. */
+
+	is_prp = FALSE;
+	if (!cofactor) {
+		dbltogw (&gwdata, (double) prp_base, vs.MA[0]);
+		exponentiate (&gwdata, vs.MA[0], (uint64_t) (w->c <= 1 ? 1 - w->c : w->c - 1));
+		for (iters = 0; iters < excess_squarings; iters++) gwsquare2 (&gwdata, vs.MA[0], vs.MA[0], 0);
+		if (w->c > 1) {
+			gwmul3 (&gwdata, vs.B[vs.num_proofs-1], vs.MA[0], vs.MA[0], GWMUL_PRESERVE_S1);
+			dbltogw (&gwdata, 1.0, vs.MB[0]);
+			is_prp = areTwoPRPValsEqual (&gwdata, w->n, vs.MA[0], 0, vs.MB[0], 0);
+		} else
+			is_prp = areTwoPRPValsEqual (&gwdata, w->n, vs.MA[0], 0, vs.B[vs.num_proofs-1], 0);
+	}
+
+/* The first partial proof starts at base^k after the squarings that did not fit in the partial proofs.  Each later partial proof starts */
+/* at the final residue of the previous partial proof. */
+
+	dbltogw (&gwdata, (double) prp_base, vs.A[0]);
+	exponentiate (&gwdata, vs.A[0], (uint64_t) w->k);
+	for (iters = 0; iters < initial_iters; iters++) gwsquare2 (&gwdata, vs.A[0], vs.A[0], 0);
+	for (j = 1; j < vs.num_proofs; j++) gwcopy (&gwdata, vs.B[j-1], vs.A[j]);
+	for (j = 0; j < vs.num_proofs; j++) vs.span[j] = proof_num_iters;
+
+/* Reduce each partial proof one level at a time.  The A and B updates of all the partial proofs run in parallel. */
+
+	polymult_init (&vs.pmdata, &gwdata);
+	polymult_set_max_num_threads (&vs.pmdata, num_threads);
+	vs.pmdata.helper_callback = &verify_proof_helper;
+	vs.pmdata.helper_callback_data = &vs;
+	for (vs.level = 0; vs.level < vs.proof_power; vs.level++) {
+		for (j = 0; j < vs.num_proofs; j++) {
+			int64_t	offset = header_size + j * proof_residues_size + (vs.level + 1) * residue_size;
+			if (!readProofResidue (&gwdata, fd, offset, (int) residue_size, vs.MA[j])) goto read_error;
+			gwcopy (&gwdata, vs.MA[j], vs.MB[j]);
+		}
+		polymult_launch_helpers (&vs.pmdata);
+		for (j = 0; j < vs.num_proofs; j++) vs.span[j] = (vs.span[j] + 1) / 2;
+	}
+	polymult_done (&vs.pmdata), vs.pmdata.gwdata = NULL;
+	_close (fd), fd = -1;
+	if (gw_test_for_error (&gwdata) || gw_get_maxerr (&gwdata) > 0.45) goto fft_error;
+
+/* Now do the remaining squarings of each partial proof using all the FFT threads */
+
+	clear_timers (timers, sizeof (timers) / sizeof (timers[0]));
+	strcpy (w->stage, "VP");
+	near_fft_limit = exponent_near_fft_limit (&gwdata);
+	allowable_maxerr = IniGetFloat (INI_FILE, "MaxRoundoffError", (float) (near_fft_limit ? 0.421875 : 0.40625));
+	calc_interval_adjustments (&gwdata, &output_adjustment, &title_adjustment);
+	for (j = 0, total_iters = 0; j < vs.num_proofs; j++) total_iters += vs.span[j];
+	done_iters = 0;
+	first_bad_proof = 0;
+	for (j = 0; j < vs.num_proofs; j++) {
+		for (iters = 0; iters < vs.span[j]; iters++) {
+			int	echk, actual_frequency;
+
+			stop_reason = stopCheck (thread_num);
+			if (stop_reason) {
+				sprintf (buf, "Stopping proof verification of %s [%.*f%%]\n", string_rep, (int) PRECISION, trunc_percent (w->pct_complete));
+				OutputStr (thread_num, buf);
+				goto exit;
+			}
+
+			echk = ERRCHK || near_fft_limit || (iters & 127) == 0;
+			gw_clear_maxerr (&gwdata);
+			start_timer (timers, 0);
+			gwsetnormroutine (&gwdata, 0, echk, 0);
+			gwsquare2 (&gwdata, vs.A[j], vs.A[j], GWMUL_STARTNEXTFFT_IF (iters != vs.span[j] - 1));
+			end_timer (timers, 0);
+			if (echk && gw_get_maxerr (&gwdata) > allowable_maxerr) goto fft_error;
+
+			done_iters++;
+			w->pct_complete = (double) done_iters / (double) total_iters;
+
+			actual_frequency = (int) (ITER_OUTPUT * title_adjustment);
+			if (actual_frequency < 1) actual_frequency = 1;
+			if (done_iters % actual_frequency == 0) {
+				sprintf (buf, "%.*f%% of verify %s", (int) PRECISION, trunc_percent (w->pct_complete), string_rep);
+				title (thread_num, buf);
+			}
+
+			actual_frequency = (int) (ITER_OUTPUT * output_adjustment);
+			if (actual_frequency < 1) actual_frequency = 1;
+			if (done_iters % actual_frequency == 0) {
+				double speed = timer_value (timers, 0) / (double) actual_frequency;
+				sprintf (buf, "Verify iteration: %lu / %lu [%.*f%%], ms/iter: %6.3f",
+					 done_iters, total_iters, (int) PRECISION, trunc_percent (w->pct_complete), speed * 1000.0);
+				formatETA ((total_iters - done_iters) * speed, buf+strlen(buf));
+				strcat (buf, "\n");
+				OutputStr (thread_num, buf);
+				clear_timer (timers, 0);
+			}
+		}
+
+/* The partial proof is valid if A^(2^span) = B */
+
+		if (gw_test_for_error (&gwdata)) goto fft_error;
+		if (!areTwoPRPValsEqual (&gwdata, w->n, vs.A[j], 0, vs.B[j], 0) && first_bad_proof == 0) first_bad_proof = j + 1;
+	}
+
+/* A mismatch could be a hardware error.  Retry once with a larger FFT before declaring the proof invalid. */
+
+	if (first_bad_proof && attempt == 0) {
+		OutputStr (thread_num, "PRP proof did not verify.  Rechecking using a larger FFT length.\n");
+		goto next_attempt;
+	}
+
+/* Print results */
+
+	if (first_bad_proof) {
+		sprintf (buf, "PRP proof file %s for %s is INVALID", w->proof_file, string_rep);
+		if (vs.num_proofs > 1) sprintf (buf+strlen(buf), " (partial proof %d failed)", first_bad_proof);
+		strcat (buf, ".\n");
+	} else {
+		sprintf (buf, "PRP proof file %s for %s is valid.", w->proof_file, string_rep);
+		if (!cofactor) {
+			sprintf (buf+strlen(buf), "  %s is %s", string_rep, is_prp ? "a probable prime" : "not prime");
+			if (is_prp && prp_base != 3) sprintf (buf+strlen(buf), " (%d-PRP)", prp_base);
+			strcat (buf, ".");
+		}
+		strcat (buf, "\n");
+	}
+	OutputStr (thread_num, buf);
+	formatMsgForResultsFile (buf, w);
+	writeResults (buf);
+	goto work_complete;
+
+/* Handle errors */
+
+bad_header:
+	sprintf (buf, "PRP proof file %s has an invalid header\n", w->proof_file);
+	OutputBoth (thread_num, buf);
+	goto abandon_work;
+
+read_error:
+	sprintf (buf, "Error reading PRP proof file %s\n", w->proof_file);
+	OutputBoth (thread_num, buf);
+	OutputBothErrno (thread_num);
+	stop_reason = STOP_FILE_IO_ERROR;
+	goto exit;
+
+hash_error:
+	OutputBoth (thread_num, "Error computing proof file hash.\n");
+	goto abandon_work;
+
+oom:
+	OutputStr (thread_num, "Error allocating memory for proof verification.\n");
+	stop_reason = STOP_OUT_OF_MEM;
+	goto exit;
+
+/* An FFT error or excessive roundoff.  Restart with a larger FFT length. */
+
+fft_error:
+	if (attempt >= 2) {
+		sprintf (buf, "Proof verification of %s is inconclusive.  Too many FFT errors.\n", string_rep);
+		OutputBoth (thread_num, buf);
+		goto abandon_work;
+	}
+	OutputBoth (thread_num, "Possible hardware error or excessive roundoff during proof verification.  Restarting with a larger FFT length.\n");
+
+next_attempt:
+	if (vs.pmdata.gwdata != NULL) polymult_done (&vs.pmdata), vs.pmdata.gwdata = NULL;
+	free (vs.h), vs.h = NULL;
+	free (vs.span), vs.span = NULL;
+	free (vs.A), vs.A = NULL;
+	gwdone (&gwdata);
+	gwinit (&gwdata);
+	if (fd < 0) fd = _open (w->proof_file, _O_BINARY | _O_RDONLY);
+	if (fd < 0) goto read_error;
+	attempt++;
+	goto retry;
+
+/* Abandon work and exit */
+
+abandon_work:
+	sprintf (buf, "Abandoning proof verification of %s.\n", string_rep);
+	OutputBoth (thread_num, buf);
+
+/* Return work unit complete "error" code */
+
+work_complete:
+	stop_reason = STOP_WORK_UNIT_COMPLETE;
+
+/* Cleanup and exit */
+
+exit:	if (fd >= 0) _close (fd);
+	if (vs.pmdata.gwdata != NULL) polymult_done (&vs.pmdata);
+	free (vs.h);
+	free (vs.span);
+	free (vs.A);
+	gwdone (&gwdata);
+	return (stop_reason);
+}